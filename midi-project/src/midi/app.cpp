@@ -6,15 +6,33 @@
 #include <algorithm>
 #include <iomanip>
 #include <cstdint>
+#include <chrono>
+#include <thread>
 #include "shell/command-line-parser.h"
 #include "imaging/bitmap.h"
 #include "imaging/bmp-format.h"
 #include "imaging/bmp-format.h"
+#include "imaging/qoi-format.h"
 #include "midi/midi.h"
+#include "midi/note-cache.h"
+#include "rendering/piano-roll.h"
+#include "rendering/frame-writer.h"
+#include "rendering/async-output.h"
+#include "rendering/tar-output.h"
+#include "rendering/spectrogram.h"
+#include "rendering/timeline.h"
+#include "rendering/avi-writer.h"
+#include "rendering/y4m-writer.h"
+#include "rendering/live-session.h"
+#include "io/stream-input.h"
+#include "audio/synth.h"
+#include "audio/wav-writer.h"
+#include "audio/synth-stream.h"
 using namespace midi;
 using namespace std;
 using namespace shell;
 using namespace imaging;
+using namespace rendering;
 
 void draw_rectangle(Bitmap& bitmap, const Position& pos,
 	const uint32_t& width, const uint32_t& height,
@@ -91,6 +109,26 @@ int main(int argn, char* argv[])
 	uint32_t scale = 10;
 	uint32_t step = 1;
 	uint32_t framewidth = 0;
+	string cache_directory = "";
+	uint32_t cache_size = 256;
+	string frames = "";
+	bool indexed = false;
+	bool rle = false;
+	bool keep_duplicates = false;
+	bool huge_pages = false;
+	string writer_mode = "sync";
+	string archive = "";
+	string audio_file = "";
+	uint32_t sample_rate = 44100;
+	uint32_t polyphony = 64;
+	string steal = "oldest";
+	uint32_t audio_threads = 0;
+	string audio_format = "pcm16";
+	bool spectrogram = false;
+	uint32_t fft_size = 2048;
+	string mux = "";
+	string fps = "30";
+	string live = "";
 	
 	// Nu lezen uit commmandline ofzoiets
 	CommandLineParser parser;
@@ -98,6 +136,26 @@ int main(int argn, char* argv[])
 	parser.add_argument(string("-d"), &step);
 	parser.add_argument(string("-s"), &scale);
 	parser.add_argument(string("-h"), &height);
+	parser.add_argument(string("--cache"), &cache_directory);
+	parser.add_argument(string("--cache-size"), &cache_size);
+	parser.add_argument(string("--frames"), &frames);
+	parser.add_argument(string("--indexed"), &indexed);
+	parser.add_argument(string("--rle"), &rle);
+	parser.add_argument(string("--keep-duplicates"), &keep_duplicates);
+	parser.add_argument(string("--huge-pages"), &huge_pages);
+	parser.add_argument(string("--writer"), &writer_mode);
+	parser.add_argument(string("--tar"), &archive);
+	parser.add_argument(string("--audio"), &audio_file);
+	parser.add_argument(string("--sample-rate"), &sample_rate);
+	parser.add_argument(string("--polyphony"), &polyphony);
+	parser.add_argument(string("--steal"), &steal);
+	parser.add_argument(string("--audio-threads"), &audio_threads);
+	parser.add_argument(string("--audio-format"), &audio_format);
+	parser.add_argument(string("--spectrogram"), &spectrogram);
+	parser.add_argument(string("--fft-size"), &fft_size);
+	parser.add_argument(string("--mux"), &mux);
+	parser.add_argument(string("--fps"), &fps);
+	parser.add_argument(string("--live"), &live);
 	parser.process(vector<string>(argv + 1, argv + argn));
 	vector<string> arrgs = parser.positional_arguments();
 	if (arrgs.size() >= 1)
@@ -109,8 +167,163 @@ int main(int argn, char* argv[])
 		outfile = arrgs[1];
 	}
 
-	ifstream in(file, ifstream::binary);
-	vector<NOTE> notes = read_notes(in);
+	WriteMode mode = WriteMode::sync;
+	if (writer_mode == "thread")
+	{
+		mode = WriteMode::thread;
+	}
+	else if (writer_mode == "io_uring")
+	{
+		mode = WriteMode::io_uring;
+
+		if (!io::IoUring::supported())
+		{
+			cout << "io_uring is not available, writing on threads instead" << endl;
+		}
+	}
+	else if (writer_mode != "sync")
+	{
+		cerr << "Unknown writer " << writer_mode << ", expected sync, thread or io_uring" << endl;
+		return -1;
+	}
+
+	audio::StealPolicy steal_policy = audio::StealPolicy::oldest;
+	if (steal == "quietest")
+	{
+		steal_policy = audio::StealPolicy::quietest;
+	}
+	else if (steal == "none")
+	{
+		steal_policy = audio::StealPolicy::none;
+	}
+	else if (steal != "oldest")
+	{
+		cerr << "Unknown voice stealing policy " << steal << ", expected oldest, quietest or none" << endl;
+		return -1;
+	}
+
+	// --fps is a number of frames per second, or a fraction such as 30000/1001
+	uint32_t fps_numerator = 30;
+	uint32_t fps_denominator = 1;
+	{
+		size_t slash = fps.find('/');
+		fps_numerator = stoul(fps.substr(0, slash));
+		if (slash != string::npos)
+		{
+			fps_denominator = stoul(fps.substr(slash + 1));
+		}
+		if (fps_numerator == 0 || fps_denominator == 0)
+		{
+			cerr << "Invalid frame rate " << fps << endl;
+			return -1;
+		}
+	}
+
+	// --live INPUT shows raw MIDI bytes from INPUT (a named pipe, or - for standard input)
+	// as they arrive. There is no MIDI file, so the only positional argument is where the
+	// Y4M stream goes, standard output if there is none or it is -
+	if (!live.empty())
+	{
+		if (framewidth == 0)
+		{
+			framewidth = 640;
+		}
+		string video = arrgs.empty() ? "-" : arrgs[0];
+		LiveRoll roll(framewidth, height, step);
+		ofstream file;
+		if (video != "-")
+		{
+			file.open(video, ofstream::binary);
+		}
+		Y4mWriter out(video == "-" ? cout : file, roll.width(), roll.height(), fps_numerator, fps_denominator);
+		io::StreamInput input(live);
+
+		LiveSession session(roll, out, fps_numerator, fps_denominator);
+		session.run([&input](uint8_t* buffer, size_t size) { return input.read(buffer, size); });
+
+		// Standard output may be the video, so the report goes to standard error
+		const LatencyHistogram& latency = session.latency();
+		cerr << "Frames ======================= " << session.frames() << " (" << session.late_frames() << " late)" << endl;
+		cerr << "Messages ===================== " << session.messages() << endl;
+		cerr << "Frame period ================= " << session.period() / 1000 << " us" << endl;
+		if (latency.count() != 0)
+		{
+			cerr << "Latency, median ============== " << latency.percentile(0.5) / 1000 << " us" << endl;
+			cerr << "Latency, 99% ================= " << latency.percentile(0.99) / 1000 << " us" << endl;
+			cerr << "Latency, max ================= " << latency.max() / 1000 << " us" << endl;
+			// A message waits for the next tick, up to a whole period, and then for its frame to be written
+			cerr << "Render time, 99% ============= " << session.render_time().percentile(0.99) / 1000 << " us" << endl;
+			cerr << "Median within a frame period = " << (latency.percentile(0.5) < session.period() ? "yes" : "no") << endl;
+		}
+		return 0;
+	}
+
+	bool mux_avi = mux.size() >= 4 && mux.compare(mux.size() - 4, 4, ".avi") == 0;
+	bool mux_y4m = mux.size() >= 4 && mux.compare(mux.size() - 4, 4, ".y4m") == 0;
+	if (!mux.empty() && !mux_avi && !mux_y4m)
+	{
+		cerr << "Unknown output " << mux << ", expected a .avi or .y4m file" << endl;
+		return -1;
+	}
+	if (!mux.empty())
+	{
+		// Muxed frames follow the audio clock rather than a fixed number of columns
+		step = 1;
+	}
+
+	audio::SampleFormat sample_format = audio::SampleFormat::pcm16;
+	if (audio_format == "float")
+	{
+		sample_format = audio::SampleFormat::float32;
+	}
+	else if (audio_format != "pcm16")
+	{
+		cerr << "Unknown audio format " << audio_format << ", expected pcm16 or float" << endl;
+		return -1;
+	}
+
+	// --audio PATH renders the score to a WAV file, written while it is being rendered
+	if (!audio_file.empty())
+	{
+		ifstream in(file, ifstream::binary);
+		audio::Score score(in);
+		// The samples are the same for any number of threads; 0 uses every core
+		if (audio_threads == 0)
+		{
+			audio_threads = max(1u, thread::hardware_concurrency());
+		}
+		audio::Synth synth(score, sample_rate, 256, polyphony, steal_policy, audio_threads);
+		vector<float> block(2 * synth.block_size());
+		audio::WavWriter out(audio_file, sample_rate, 2, sample_format);
+
+		auto start = chrono::steady_clock::now();
+		while (unsigned n = synth.render(block.data()))
+		{
+			out.write(block.data(), n);
+		}
+		out.close();
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+		double seconds = double(synth.length()) / sample_rate;
+		cout << "Audio length ================= " << seconds << " s" << endl;
+		cout << "Audio realtime factor ======== " << seconds / max(elapsed.count(), 1e-9) << "x" << endl;
+		cout << "Voices stolen ================ " << synth.stolen_voices() << endl;
+	}
+
+	vector<NOTE> notes;
+	if (cache_directory.empty())
+	{
+		ifstream in(file, ifstream::binary);
+		notes = read_notes(in);
+	}
+	else
+	{
+		// cache_size is in megabytes
+		NoteCache cache(cache_directory, uint64_t(cache_size) << 20);
+		notes = cache.load(file)->notes();
+		cout << "Note cache ================== " 
+			<< (cache.hits() != 0 ? "hit" : "miss") << endl;
+	}
 	uint32_t mapwidth = getWidth(notes) / scale;
 	if (framewidth == 0)
 	{
@@ -120,36 +333,165 @@ int main(int argn, char* argv[])
 	int high = getHighestNote(notes);
 	cout << "Actual bitmap size =========== " << mapwidth << " x " 
 		<< (high - low + 1) * height << endl;
-	Bitmap bitmap(mapwidth , 127 * height);
-	for (int i = 0; i <= 127; i++) {
-		for (NOTE n : notes) {
-			if (n.note_number == NoteNumber(i)) {
-				draw_rectangle(bitmap, Position(value(n.start) / scale, 
-					(127 - i) * height), 
-					value(n.duration) / scale, height, 
-					Color(0, 0, 1), Color(1,1,1));
+	PianoRoll roll(notes, scale, height, framewidth, step);
+	cout << "All notes have been succesfully read" << endl;
+
+	// --frames START:END renders frames START up to but not including END,
+	// so that a long render can be split up or partially redone
+	uint32_t first = 0;
+	uint32_t last = roll.frame_count();
+	if (!frames.empty())
+	{
+		size_t colon = frames.find(':');
+		first = stoul(frames.substr(0, colon));
+		if (colon != string::npos && colon + 1 < frames.size())
+		{
+			last = min(last, uint32_t(stoul(frames.substr(colon + 1))));
+		}
+	}
+
+	FrameFormat format = FrameFormat::bmp;
+	if (outfile.size() >= 4 && outfile.compare(outfile.size() - 4, 4, ".qoi") == 0)
+	{
+		format = FrameFormat::qoi;
+	}
+	else if (rle)
+	{
+		// 8-bit frames with the renderer's palette
+		format = FrameFormat::rle_bmp;
+	}
+	else if (indexed)
+	{
+		format = FrameFormat::indexed_bmp;
+	}
+
+	// --spectrogram draws the spectrum of the synthesized audio instead of the notes,
+	// with the same frame size, so that frame i of both covers the same ticks
+	unique_ptr<audio::Score> spectrogram_score;
+	unique_ptr<audio::Synth> spectrogram_synth;
+	unique_ptr<Spectrogram> spectrum;
+	if (spectrogram)
+	{
+		ifstream in(file, ifstream::binary);
+		spectrogram_score = make_unique<audio::Score>(in);
+		spectrogram_synth = make_unique<audio::Synth>(*spectrogram_score, sample_rate, 256, polyphony, steal_policy);
+		spectrum = make_unique<Spectrogram>(*spectrogram_synth, spectrogram_score->tempo_map(),
+			scale, roll.height(), roll.frame_width(), step, fft_size);
+	}
+
+	// Every frame is drawn into the same pooled buffer, and encoded into buffers
+	// from the same pool, so that the loop below does not allocate
+	BufferPool pool(64, huge_pages);
+	BufferPool::Buffer pixels = pool.borrow(sizeof(Color) * roll.frame_width() * roll.height());
+	Bitmap frame(make_shared<BufferGrid<Color>>(pixels.as<Color>(), roll.frame_width(), roll.height()));
+
+	// --mux PATH writes video and audio together, both timed by the tempo map: frame k
+	// shows the music at k / fps seconds and is followed by the audio up to the next frame.
+	// A .avi file holds both; a .y4m file gets its audio in a .wav file next to it
+	if (!mux.empty())
+	{
+		ifstream in(file, ifstream::binary);
+		audio::Score score(in);
+		if (audio_threads == 0)
+		{
+			audio_threads = max(1u, thread::hardware_concurrency());
+		}
+		audio::Synth synth(score, sample_rate, 256, polyphony, steal_policy, audio_threads);
+		audio::SynthStream stream(synth);
+		Timeline timeline(score.tempo_map(), sample_rate, fps_numerator, fps_denominator);
+
+		unique_ptr<AviWriter> avi;
+		unique_ptr<Y4mWriter> y4m;
+		unique_ptr<audio::WavWriter> wav;
+		if (mux_avi)
+		{
+			avi = make_unique<AviWriter>(mux, roll.frame_width(), roll.height(), fps_numerator, fps_denominator, sample_rate, !keep_duplicates);
+		}
+		else
+		{
+			y4m = make_unique<Y4mWriter>(mux, roll.frame_width(), roll.height(), fps_numerator, fps_denominator);
+			wav = make_unique<audio::WavWriter>(mux.substr(0, mux.size() - 4) + ".wav", sample_rate);
+		}
+
+		uint64_t count = timeline.frame_count(synth.length());
+		auto start = chrono::steady_clock::now();
+		for (uint64_t k = 0; k != count; k++)
+		{
+			// The frame whose left column is at the current tick; past the end, the last frame
+			uint32_t column = uint32_t(min(uint64_t(timeline.tick(k) / scale), uint64_t(max(roll.frame_count(), 1u) - 1)));
+			if (spectrum)
+			{
+				spectrum->render_frame(column, frame);
+			}
+			else
+			{
+				roll.render_frame(column, frame);
+			}
+
+			unsigned samples = timeline.samples(k);
+			const float* audio = stream.read(samples);
+			if (avi)
+			{
+				avi->write_frame(frame);
+				avi->write_audio(audio, samples);
 			}
+			else
+			{
+				y4m->write(frame);
+				wav->write(audio, samples);
+			}
+		}
+		if (avi)
+		{
+			avi->close();
+			cout << "Frames elided ================ " << avi->elided() << endl;
+		}
+		else
+		{
+			wav->close();
 		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+		cout << "Frames muxed ================= " << count << endl;
+		cout << "Mux realtime factor ========== " << (double(synth.length()) / sample_rate) / max(elapsed.count(), 1e-9) << "x" << endl;
+		return 0;
 	}
-	cout << "All notes have been succesfully read" << endl;
-	// zwarte randen knippen
-	bitmap = *bitmap.slice(0, height * (127 - high),
-		mapwidth, (high - low + 1) * height).get();
-	// opslaan
 
-	for (int i = 0; i <= mapwidth - framewidth; i += step)
+	// --tar ARCHIVE puts all frames in a single archive, named after the output pattern
+	unique_ptr<FrameOutput> output;
+	if (archive.empty())
+	{
+		output = create_file_output(mode);
+	}
+	else
 	{
-		Bitmap temp = *bitmap.slice(i, 0, framewidth,
-			(high - low + 1) * height).get();
+		output = make_unique<TarOutput>(archive);
+	}
+	FrameWriter writer(*output, format, spectrum ? spectrum->palette() : roll.palette(), !keep_duplicates, pool);
+	FrameNames names(outfile);
 
-		stringstream nummerken;
-		nummerken << setfill('0') << setw(5) << (i / step);
-		string out = outfile;
-		save_as_bmp(out.replace(out.find("%d"),
-			2, nummerken.str()), temp);
+	for (uint32_t i = first; i < last; i++)
+	{
+		if (spectrum)
+		{
+			spectrum->render_frame(i, frame);
+		}
+		else
+		{
+			roll.render_frame(i, frame);
+		}
 
-		cout << "Frame: " << (i / step) << " created" << endl;
+		if (writer.write(names[i], frame))
+		{
+			cout << "Frame: " << i << " repeated" << endl;
+		}
+		else
+		{
+			cout << "Frame: " << i << " created" << endl;
+		}
 	}
+	output->flush();
+	cout << "Frames elided ================ " << writer.elided() << endl;
 	return 0;
 }
 #endif
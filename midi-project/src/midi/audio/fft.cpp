@@ -0,0 +1,316 @@
+#include "audio/fft.h"
+#include "logging.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define X86_FFT
+#include <emmintrin.h>
+#endif
+
+
+using namespace audio;
+
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // The passes are Stockham autosort steps: each reads x and writes y in a different order,
+    // so that the result comes out in natural order without a bit reversal permutation.
+    // A pass splits sequences of n = radix * m elements, interleaved with stride s.
+
+    void radix2_scalar(unsigned m, unsigned s, const float* wr, const float* wi,
+        const float* xr, const float* xi, float* yr, float* yi)
+    {
+        for (unsigned p = 0; p != m; ++p)
+        {
+            for (unsigned q = 0; q != s; ++q)
+            {
+                const size_t i0 = q + size_t(s) * p;
+                const size_t i1 = i0 + size_t(s) * m;
+                const size_t o = q + size_t(s) * 2 * p;
+                const float dr = xr[i0] - xr[i1];
+                const float di = xi[i0] - xi[i1];
+
+                yr[o] = xr[i0] + xr[i1];
+                yi[o] = xi[i0] + xi[i1];
+                yr[o + s] = dr * wr[p] - di * wi[p];
+                yi[o + s] = dr * wi[p] + di * wr[p];
+            }
+        }
+    }
+
+    void radix4_scalar(unsigned m, unsigned s, const float* wr, const float* wi,
+        const float* xr, const float* xi, float* yr, float* yi)
+    {
+        // w, w^2 and w^3 of butterfly p are at p, m + p and 2 * m + p
+        for (unsigned p = 0; p != m; ++p)
+        {
+            const float w1r = wr[p], w1i = wi[p];
+            const float w2r = wr[m + p], w2i = wi[m + p];
+            const float w3r = wr[2 * m + p], w3i = wi[2 * m + p];
+
+            for (unsigned q = 0; q != s; ++q)
+            {
+                const size_t i0 = q + size_t(s) * p;
+                const size_t i1 = i0 + size_t(s) * m;
+                const size_t i2 = i1 + size_t(s) * m;
+                const size_t i3 = i2 + size_t(s) * m;
+                const size_t o = q + size_t(s) * 4 * p;
+
+                const float apc_r = xr[i0] + xr[i2], apc_i = xi[i0] + xi[i2];
+                const float amc_r = xr[i0] - xr[i2], amc_i = xi[i0] - xi[i2];
+                const float bpd_r = xr[i1] + xr[i3], bpd_i = xi[i1] + xi[i3];
+                const float bmd_r = xr[i1] - xr[i3], bmd_i = xi[i1] - xi[i3];
+
+                // (a - c) - i (b - d) and (a - c) + i (b - d)
+                const float u1r = amc_r + bmd_i, u1i = amc_i - bmd_r;
+                const float u2r = apc_r - bpd_r, u2i = apc_i - bpd_i;
+                const float u3r = amc_r - bmd_i, u3i = amc_i + bmd_r;
+
+                yr[o] = apc_r + bpd_r;
+                yi[o] = apc_i + bpd_i;
+                yr[o + s] = u1r * w1r - u1i * w1i;
+                yi[o + s] = u1r * w1i + u1i * w1r;
+                yr[o + 2 * s] = u2r * w2r - u2i * w2i;
+                yi[o + 2 * s] = u2r * w2i + u2i * w2r;
+                yr[o + 3 * s] = u3r * w3r - u3i * w3i;
+                yi[o + 3 * s] = u3r * w3i + u3i * w3r;
+            }
+        }
+    }
+
+#ifdef X86_FFT
+    struct VECTOR_COMPLEX
+    {
+        __m128 r;
+        __m128 i;
+    };
+
+    inline VECTOR_COMPLEX multiply(__m128 ar, __m128 ai, __m128 wr, __m128 wi)
+    {
+        return VECTOR_COMPLEX{
+            _mm_sub_ps(_mm_mul_ps(ar, wr), _mm_mul_ps(ai, wi)),
+            _mm_add_ps(_mm_mul_ps(ar, wi), _mm_mul_ps(ai, wr)) };
+    }
+
+    // The four outputs of four radix-4 butterflies, in the same order of operations as radix4_scalar
+    inline void butterflies(const float* xr, const float* xi, size_t i0, size_t stride,
+        __m128 w1r, __m128 w1i, __m128 w2r, __m128 w2i, __m128 w3r, __m128 w3i, VECTOR_COMPLEX out[4])
+    {
+        const __m128 ar = _mm_loadu_ps(xr + i0), ai = _mm_loadu_ps(xi + i0);
+        const __m128 br = _mm_loadu_ps(xr + i0 + stride), bi = _mm_loadu_ps(xi + i0 + stride);
+        const __m128 cr = _mm_loadu_ps(xr + i0 + 2 * stride), ci = _mm_loadu_ps(xi + i0 + 2 * stride);
+        const __m128 dr = _mm_loadu_ps(xr + i0 + 3 * stride), di = _mm_loadu_ps(xi + i0 + 3 * stride);
+
+        const __m128 apc_r = _mm_add_ps(ar, cr), apc_i = _mm_add_ps(ai, ci);
+        const __m128 amc_r = _mm_sub_ps(ar, cr), amc_i = _mm_sub_ps(ai, ci);
+        const __m128 bpd_r = _mm_add_ps(br, dr), bpd_i = _mm_add_ps(bi, di);
+        const __m128 bmd_r = _mm_sub_ps(br, dr), bmd_i = _mm_sub_ps(bi, di);
+
+        out[0] = VECTOR_COMPLEX{ _mm_add_ps(apc_r, bpd_r), _mm_add_ps(apc_i, bpd_i) };
+        out[1] = multiply(_mm_add_ps(amc_r, bmd_i), _mm_sub_ps(amc_i, bmd_r), w1r, w1i);
+        out[2] = multiply(_mm_sub_ps(apc_r, bpd_r), _mm_sub_ps(apc_i, bpd_i), w2r, w2i);
+        out[3] = multiply(_mm_sub_ps(amc_r, bmd_i), _mm_add_ps(amc_i, bmd_r), w3r, w3i);
+    }
+
+    // Four values of q at a time, sharing the twiddles of p
+    void radix4_sse2_strided(unsigned m, unsigned s, const float* wr, const float* wi,
+        const float* xr, const float* xi, float* yr, float* yi)
+    {
+        VECTOR_COMPLEX out[4];
+
+        for (unsigned p = 0; p != m; ++p)
+        {
+            const __m128 w1r = _mm_set1_ps(wr[p]), w1i = _mm_set1_ps(wi[p]);
+            const __m128 w2r = _mm_set1_ps(wr[m + p]), w2i = _mm_set1_ps(wi[m + p]);
+            const __m128 w3r = _mm_set1_ps(wr[2 * m + p]), w3i = _mm_set1_ps(wi[2 * m + p]);
+
+            for (unsigned q = 0; q != s; q += 4)
+            {
+                const size_t o = q + size_t(s) * 4 * p;
+
+                butterflies(xr, xi, q + size_t(s) * p, size_t(s) * m, w1r, w1i, w2r, w2i, w3r, w3i, out);
+
+                for (unsigned k = 0; k != 4; ++k)
+                {
+                    _mm_storeu_ps(yr + o + k * s, out[k].r);
+                    _mm_storeu_ps(yi + o + k * s, out[k].i);
+                }
+            }
+        }
+    }
+
+    // First pass, where s is 1: four values of p at a time. Output k of butterfly p goes to 4 * p + k,
+    // so the four output vectors are transposed before they are stored.
+    void radix4_sse2_first(unsigned m, const float* wr, const float* wi,
+        const float* xr, const float* xi, float* yr, float* yi)
+    {
+        VECTOR_COMPLEX out[4];
+
+        for (unsigned p = 0; p != m; p += 4)
+        {
+            butterflies(xr, xi, p, m,
+                _mm_loadu_ps(wr + p), _mm_loadu_ps(wi + p),
+                _mm_loadu_ps(wr + m + p), _mm_loadu_ps(wi + m + p),
+                _mm_loadu_ps(wr + 2 * m + p), _mm_loadu_ps(wi + 2 * m + p), out);
+
+            _MM_TRANSPOSE4_PS(out[0].r, out[1].r, out[2].r, out[3].r);
+            _MM_TRANSPOSE4_PS(out[0].i, out[1].i, out[2].i, out[3].i);
+
+            for (unsigned k = 0; k != 4; ++k)
+            {
+                _mm_storeu_ps(yr + 4 * (p + k), out[k].r);
+                _mm_storeu_ps(yi + 4 * (p + k), out[k].i);
+            }
+        }
+    }
+
+    void radix2_sse2_strided(unsigned m, unsigned s, const float* wr, const float* wi,
+        const float* xr, const float* xi, float* yr, float* yi)
+    {
+        for (unsigned p = 0; p != m; ++p)
+        {
+            const __m128 w_r = _mm_set1_ps(wr[p]), w_i = _mm_set1_ps(wi[p]);
+
+            for (unsigned q = 0; q != s; q += 4)
+            {
+                const size_t i0 = q + size_t(s) * p;
+                const size_t i1 = i0 + size_t(s) * m;
+                const size_t o = q + size_t(s) * 2 * p;
+                const __m128 ar = _mm_loadu_ps(xr + i0), ai = _mm_loadu_ps(xi + i0);
+                const __m128 br = _mm_loadu_ps(xr + i1), bi = _mm_loadu_ps(xi + i1);
+                const VECTOR_COMPLEX d = multiply(_mm_sub_ps(ar, br), _mm_sub_ps(ai, bi), w_r, w_i);
+
+                _mm_storeu_ps(yr + o, _mm_add_ps(ar, br));
+                _mm_storeu_ps(yi + o, _mm_add_ps(ai, bi));
+                _mm_storeu_ps(yr + o + s, d.r);
+                _mm_storeu_ps(yi + o + s, d.i);
+            }
+        }
+    }
+#endif
+}
+
+RealFft::RealFft(unsigned size)
+    : m_size(size)
+{
+    CHECK(size >= 4 && (size & (size - 1)) == 0) << "FFT size must be a power of two, at least 4, not " << size;
+
+    const unsigned half = size / 2;
+    unsigned n = half;
+    unsigned s = 1;
+
+    // Radix 4 as long as possible; an odd power of two needs one radix 2 pass at the end
+    while (n > 1)
+    {
+        const unsigned radix = n % 4 == 0 ? 4 : 2;
+        const unsigned m = n / radix;
+
+        m_stages.push_back(STAGE{ radix, m, s, m_twiddle_re.size() });
+
+        for (unsigned power = 1; power != (radix == 4 ? 4u : 2u); ++power)
+        {
+            for (unsigned p = 0; p != m; ++p)
+            {
+                const double angle = -2 * PI * double(power) * p / n;
+                m_twiddle_re.push_back(float(std::cos(angle)));
+                m_twiddle_im.push_back(float(std::sin(angle)));
+            }
+        }
+
+        n = m;
+        s *= radix;
+    }
+
+    for (unsigned k = 0; k <= half; ++k)
+    {
+        const double angle = -2 * PI * k / size;
+        m_split_re.push_back(float(std::cos(angle)));
+        m_split_im.push_back(float(std::sin(angle)));
+    }
+
+    for (unsigned b = 0; b != 2; ++b)
+    {
+        m_work_re[b].resize(half);
+        m_work_im[b].resize(half);
+    }
+    m_bins_re.resize(bins());
+    m_bins_im.resize(bins());
+}
+
+void RealFft::transform(const float* samples, float* re, float* im)
+{
+    const unsigned half = m_size / 2;
+    float* xr = m_work_re[0].data();
+    float* xi = m_work_im[0].data();
+    float* yr = m_work_re[1].data();
+    float* yi = m_work_im[1].data();
+
+    // Even samples are the real parts, odd samples the imaginary parts
+    for (unsigned k = 0; k != half; ++k)
+    {
+        xr[k] = samples[2 * k];
+        xi[k] = samples[2 * k + 1];
+    }
+
+    for (const STAGE& stage : m_stages)
+    {
+        const float* wr = &m_twiddle_re[stage.twiddles];
+        const float* wi = &m_twiddle_im[stage.twiddles];
+
+#ifdef X86_FFT
+        if (stage.radix == 4 && stage.s % 4 == 0)
+        {
+            radix4_sse2_strided(stage.m, stage.s, wr, wi, xr, xi, yr, yi);
+        }
+        else if (stage.radix == 4 && stage.s == 1 && stage.m % 4 == 0)
+        {
+            radix4_sse2_first(stage.m, wr, wi, xr, xi, yr, yi);
+        }
+        else if (stage.radix == 2 && stage.s % 4 == 0)
+        {
+            radix2_sse2_strided(stage.m, stage.s, wr, wi, xr, xi, yr, yi);
+        }
+        else
+#endif
+        if (stage.radix == 4)
+        {
+            radix4_scalar(stage.m, stage.s, wr, wi, xr, xi, yr, yi);
+        }
+        else
+        {
+            radix2_scalar(stage.m, stage.s, wr, wi, xr, xi, yr, yi);
+        }
+
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+
+    // xr, xi hold Z, the transform of the complex sequence. With Z'[k] = conj(Z[half - k]),
+    // the spectra of the even and odd samples are (Z + Z') / 2 and (Z - Z') / 2i
+    for (unsigned k = 0; k <= half; ++k)
+    {
+        const unsigned a = k == half ? 0 : k;
+        const unsigned b = k == 0 ? 0 : half - k;
+        const float even_r = (xr[a] + xr[b]) * 0.5f;
+        const float even_i = (xi[a] - xi[b]) * 0.5f;
+        const float odd_r = (xi[a] + xi[b]) * 0.5f;
+        const float odd_i = (xr[b] - xr[a]) * 0.5f;
+        const float cr = m_split_re[k];
+        const float ci = m_split_im[k];
+
+        re[k] = even_r + (cr * odd_r - ci * odd_i);
+        im[k] = even_i + (cr * odd_i + ci * odd_r);
+    }
+}
+
+void RealFft::power(const float* samples, float* out)
+{
+    transform(samples, m_bins_re.data(), m_bins_im.data());
+
+    for (unsigned k = 0; k != bins(); ++k)
+    {
+        out[k] = m_bins_re[k] * m_bins_re[k] + m_bins_im[k] * m_bins_im[k];
+    }
+}
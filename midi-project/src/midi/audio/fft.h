@@ -0,0 +1,70 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace audio
+{
+    /// <summary>
+    /// Fourier transform of real samples, for a size fixed at construction.
+    /// The samples are treated as size() / 2 complex numbers, transformed with radix-4 passes
+    /// (and one radix-2 pass if needed) that are vectorized with SSE2, and then separated
+    /// into the spectrum of the real input. Twiddle factors are computed once, in the constructor.
+    /// </summary>
+    class RealFft final
+    {
+    public:
+        /// <summary>
+        /// <paramref name="size" /> must be a power of two, at least 4.
+        /// </summary>
+        explicit RealFft(unsigned size);
+
+        unsigned size() const { return m_size; }
+
+        /// <summary>
+        /// Number of frequency bins: from 0 up to and including half the sample rate.
+        /// Bin k is at k * sample_rate / size() Hz.
+        /// </summary>
+        unsigned bins() const { return m_size / 2 + 1; }
+
+        /// <summary>
+        /// Transforms size() samples into bins() complex values, without scaling.
+        /// Does not allocate.
+        /// </summary>
+        void transform(const float* samples, float* re, float* im);
+
+        /// <summary>
+        /// Squared magnitude of every bin.
+        /// </summary>
+        void power(const float* samples, float* out);
+
+    private:
+        struct STAGE
+        {
+            unsigned radix;
+            // Butterflies per group and distance between groups
+            unsigned m;
+            unsigned s;
+            // Index of the stage's twiddles; radix 4 stages have 3 * m of them, w, w^2 and w^3
+            size_t twiddles;
+        };
+
+        unsigned m_size;
+        std::vector<STAGE> m_stages;
+        std::vector<float> m_twiddle_re;
+        std::vector<float> m_twiddle_im;
+        // e^(-2 pi i k / size), to separate the spectrum of the real input
+        std::vector<float> m_split_re;
+        std::vector<float> m_split_im;
+        // Ping-pong buffers for the complex transform
+        std::vector<float> m_work_re[2];
+        std::vector<float> m_work_im[2];
+        std::vector<float> m_bins_re;
+        std::vector<float> m_bins_im;
+    };
+}
+
+#endif
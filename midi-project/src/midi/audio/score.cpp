@@ -0,0 +1,119 @@
+#include "audio/score.h"
+#include "midi/midi.h"
+#include "logging.h"
+#include <algorithm>
+
+
+using namespace audio;
+
+
+namespace
+{
+    struct TEMPO_CHANGE
+    {
+        midi::Time time;
+        uint32_t microseconds_per_quarter;
+    };
+
+    // Collects the events of one track, with absolute times
+    class TrackReader : public midi::EventReceiver
+    {
+    public:
+        TrackReader(std::vector<EVENT>& events, std::vector<TEMPO_CHANGE>& tempo_changes)
+            : m_events(events), m_tempo_changes(tempo_changes), m_time(0) { }
+
+        midi::Time time() const { return m_time; }
+
+        void note_on(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t velocity) override
+        {
+            add(dt, velocity == 0 ? EventType::note_off : EventType::note_on, channel, value(note), velocity);
+        }
+
+        void note_off(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t velocity) override
+        {
+            add(dt, EventType::note_off, channel, value(note), velocity);
+        }
+
+        void polyphonic_key_pressure(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t pressure) override
+        {
+            add(dt, EventType::key_pressure, channel, value(note), pressure);
+        }
+
+        void control_change(midi::Duration dt, midi::Channel channel, uint8_t controller, uint8_t value) override
+        {
+            add(dt, EventType::control_change, channel, controller, value);
+        }
+
+        void program_change(midi::Duration dt, midi::Channel channel, midi::Instrument program) override
+        {
+            add(dt, EventType::program_change, channel, value(program), 0);
+        }
+
+        void channel_pressure(midi::Duration dt, midi::Channel channel, uint8_t pressure) override
+        {
+            add(dt, EventType::channel_pressure, channel, 0, pressure);
+        }
+
+        void pitch_wheel_change(midi::Duration dt, midi::Channel channel, uint16_t value) override
+        {
+            add(dt, EventType::pitch_wheel, channel, 0, value);
+        }
+
+        void meta(midi::Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override
+        {
+            m_time += dt;
+
+            // Set Tempo: microseconds per quarter note, 24 bits
+            if (type == 0x51 && data_size == 3)
+            {
+                m_tempo_changes.push_back(TEMPO_CHANGE{ m_time, uint32_t(data[0]) << 16 | uint32_t(data[1]) << 8 | data[2] });
+            }
+        }
+
+        void sysex(midi::Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override
+        {
+            m_time += dt;
+        }
+
+    private:
+        void add(midi::Duration dt, EventType type, midi::Channel channel, uint8_t data1, uint16_t data2)
+        {
+            m_time += dt;
+            m_events.push_back(EVENT{ m_time, type, value(channel), data1, data2 });
+        }
+
+        std::vector<EVENT>& m_events;
+        std::vector<TEMPO_CHANGE>& m_tempo_changes;
+        midi::Time m_time;
+    };
+}
+
+Score::Score(std::istream& in)
+    : m_tempo_map(0x0100), m_end(0)
+{
+    midi::MTHD header;
+    midi::read_mthd(in, &header);
+    m_tempo_map = TempoMap(header.division);
+
+    std::vector<TEMPO_CHANGE> tempo_changes;
+
+    for (unsigned i = 0; i != header.ntracks; ++i)
+    {
+        TrackReader reader(m_events, tempo_changes);
+        midi::read_mtrk(in, reader);
+        m_end = std::max(m_end, reader.time());
+    }
+
+    // Tracks are read one after the other; a stable sort keeps them in order at equal times
+    std::stable_sort(m_events.begin(), m_events.end(), [](const EVENT& a, const EVENT& b) {
+        return a.time < b.time;
+    });
+    std::stable_sort(tempo_changes.begin(), tempo_changes.end(), [](const TEMPO_CHANGE& a, const TEMPO_CHANGE& b) {
+        return a.time < b.time;
+    });
+
+    for (const TEMPO_CHANGE& change : tempo_changes)
+    {
+        m_tempo_map.set_tempo(change.time, change.microseconds_per_quarter);
+    }
+}
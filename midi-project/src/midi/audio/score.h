@@ -0,0 +1,65 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+#include "audio/tempo-map.h"
+#include "midi/primitives.h"
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+
+namespace audio
+{
+    enum class EventType : uint8_t
+    {
+        note_on,
+        note_off,
+        key_pressure,
+        control_change,
+        program_change,
+        channel_pressure,
+        pitch_wheel
+    };
+
+    /// <summary>
+    /// A channel event at an absolute time. data1 is the note, controller or program,
+    /// data2 the velocity, pressure, controller value or 14-bit pitch wheel position.
+    /// </summary>
+    struct EVENT
+    {
+        midi::Time time;
+        EventType type;
+        uint8_t channel;
+        uint8_t data1;
+        uint16_t data2;
+    };
+
+    /// <summary>
+    /// The channel events of all tracks of a MIDI file, merged into a single
+    /// list in order of time, together with the file's tempo map.
+    /// </summary>
+    class Score final
+    {
+    public:
+        /// <summary>
+        /// Reads an entire MIDI file. A note on with velocity 0 becomes a note off.
+        /// Events at the same time keep the order of their tracks.
+        /// </summary>
+        Score(std::istream& in);
+
+        const std::vector<EVENT>& events() const { return m_events; }
+        const TempoMap& tempo_map() const { return m_tempo_map; }
+
+        /// <summary>
+        /// Time of the last event, including meta events such as End of Track.
+        /// </summary>
+        midi::Time end() const { return m_end; }
+
+    private:
+        std::vector<EVENT> m_events;
+        TempoMap m_tempo_map;
+        midi::Time m_end;
+    };
+}
+
+#endif
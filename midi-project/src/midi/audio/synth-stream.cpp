@@ -0,0 +1,46 @@
+#include "audio/synth-stream.h"
+#include <algorithm>
+
+
+using namespace audio;
+
+
+SynthStream::SynthStream(Synth& synth)
+    : m_synth(synth), m_start(0), m_end(0), m_position(0)
+{
+}
+
+const float* SynthStream::read(size_t frames)
+{
+    const size_t wanted = 2 * frames;
+    const size_t block = 2 * size_t(m_synth.block_size());
+
+    // Whatever is left over from the last read moves to the front
+    std::copy(m_buffer.begin() + m_start, m_buffer.begin() + m_end, m_buffer.begin());
+    m_end -= m_start;
+    m_start = 0;
+
+    if (m_buffer.size() < wanted + block)
+    {
+        m_buffer.resize(wanted + block);
+    }
+
+    while (m_end < wanted)
+    {
+        const unsigned rendered = m_synth.render(&m_buffer[m_end]);
+
+        if (rendered == 0)
+        {
+            std::fill(m_buffer.begin() + m_end, m_buffer.begin() + wanted, 0.0f);
+            m_end = wanted;
+        }
+        else
+        {
+            m_end += 2 * size_t(rendered);
+        }
+    }
+
+    m_start = wanted;
+    m_position += frames;
+    return m_buffer.data();
+}
@@ -0,0 +1,42 @@
+#ifndef SYNTH_STREAM_H
+#define SYNTH_STREAM_H
+
+#include "audio/synth.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace audio
+{
+    /// <summary>
+    /// Reads the output of a Synth in spans of any length instead of whole blocks,
+    /// e.g. the samples that go with one video frame. After the end of the rendering it reads silence.
+    /// </summary>
+    class SynthStream final
+    {
+    public:
+        SynthStream(Synth& synth);
+
+        /// <summary>
+        /// The next <paramref name="frames" /> frames, interleaved left, right.
+        /// The pointer is valid until the next call. Once the buffer has grown to
+        /// the largest span read so far, this does not allocate.
+        /// </summary>
+        const float* read(size_t frames);
+
+        /// <summary>
+        /// Number of frames read so far.
+        /// </summary>
+        uint64_t position() const { return m_position; }
+
+    private:
+        Synth& m_synth;
+        // Samples that have been rendered but not read yet are in [m_start, m_end)
+        std::vector<float> m_buffer;
+        size_t m_start;
+        size_t m_end;
+        uint64_t m_position;
+    };
+}
+
+#endif
@@ -0,0 +1,505 @@
+#include "audio/synth.h"
+#include "logging.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+using namespace audio;
+
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // Envelope times in seconds
+    const double ATTACK = 0.005;
+    const double DECAY = 0.1;
+    const double RELEASE = 0.15;
+    const float SUSTAIN_LEVEL = 0.7f;
+    const double PERCUSSION_DECAY = 0.15;
+
+    // Voice frames in a span below which it is not worth waking up other threads
+    const uint64_t PARALLEL_WORK = 4096;
+
+    // Leaves headroom for a few dozen notes at full velocity
+    const float MASTER_GAIN = 0.2f;
+
+    const uint8_t PERCUSSION_CHANNEL = 9;
+
+    float step(double seconds, unsigned sample_rate)
+    {
+        return float(1.0 / std::max(1.0, seconds * sample_rate));
+    }
+
+    // One waveform per family of 8 General MIDI programs, in turn
+    Waveform waveform_for(uint8_t program)
+    {
+        return Waveform((program >> 3) % 4);
+    }
+
+    // Faded out, or percussion that has decayed to silence
+    bool silent(const VoicePool& voices, unsigned voice)
+    {
+        const EnvelopeStage stage = voices.stages[voice];
+        return voices.envelopes[voice] == 0 && (stage == EnvelopeStage::release || stage == EnvelopeStage::sustain);
+    }
+
+    const uint16_t VOLUME = 7;
+    const uint16_t PAN = 10;
+    const uint16_t EXPRESSION = 11;
+    const uint8_t RESET_ALL_CONTROLLERS = 121;
+
+    // The controllers that set channel gains, timed in frames. Reset All Controllers
+    // restores expression; volume and pan are not reset by it.
+    midi::Automation gain_automation(const Score& score, unsigned sample_rate)
+    {
+        std::vector<midi::AUTOMATION_POINT> points;
+
+        for (const EVENT& event : score.events())
+        {
+            if (event.type != EventType::control_change)
+            {
+                continue;
+            }
+
+            const midi::Time frame(score.tempo_map().frame(event.time, sample_rate));
+            const midi::Channel channel(event.channel);
+
+            if (event.data1 == VOLUME || event.data1 == PAN || event.data1 == EXPRESSION)
+            {
+                points.push_back(midi::AUTOMATION_POINT{ channel, event.data1, frame, event.data2 });
+            }
+            else if (event.data1 == RESET_ALL_CONTROLLERS)
+            {
+                points.push_back(midi::AUTOMATION_POINT{ channel, EXPRESSION, frame, midi::default_value(EXPRESSION) });
+            }
+        }
+
+        return midi::Automation(std::move(points));
+    }
+}
+
+const unsigned Synth::CONTROL_PERIOD;
+
+Synth::Synth(const Score& score, unsigned sample_rate, unsigned block_size, unsigned polyphony, StealPolicy steal, unsigned threads)
+    : m_sample_rate(sample_rate), m_block_size(block_size),
+      m_position(0), m_next_event(0), m_automation(gain_automation(score, sample_rate)),
+      m_voices(polyphony, steal), m_notes_started(0),
+      m_kernel(detect_kernel_isa()), m_channel_buffers(16 * 2 * size_t(block_size)), m_workers(threads)
+{
+    CHECK(sample_rate > 0) << "Sample rate must be positive";
+    CHECK(block_size > 0) << "Block size must be positive";
+
+    const TempoMap& tempo_map = score.tempo_map();
+    m_events.reserve(score.events().size());
+
+    for (const EVENT& event : score.events())
+    {
+        m_events.push_back(TIMED_EVENT{ tempo_map.frame(event.time, sample_rate), event });
+    }
+
+    // Room for the last notes to fade out
+    m_length = tempo_map.frame(score.end(), sample_rate) + uint64_t(std::ceil(RELEASE * sample_rate)) + 1;
+
+    for (uint8_t channel = 0; channel != 16; ++channel)
+    {
+        CHANNEL& state = m_channels[channel];
+        state.program = 0;
+        state.bend = 0;
+        state.sustain = false;
+
+        m_channel_voices[channel].reserve(polyphony);
+        m_ramps[channel].end = 0;
+
+        for (uint16_t lane : { VOLUME, EXPRESSION, PAN })
+        {
+            m_gain_cursors.push_back(m_automation.cursor(midi::Channel(channel), lane));
+        }
+    }
+}
+
+unsigned Synth::render(float* out)
+{
+    const unsigned frames = unsigned(std::min(uint64_t(m_block_size), m_length - m_position));
+    const uint64_t end = m_position + frames;
+    unsigned done = 0;
+
+    std::fill(m_channel_used, m_channel_used + 16, false);
+
+    while (m_next_event != m_events.size() && m_events[m_next_event].frame < end)
+    {
+        // Render up to the event's frame, so that it takes effect on exactly that sample
+        const TIMED_EVENT& timed = m_events[m_next_event++];
+        const unsigned offset = unsigned(std::max(timed.frame, m_position) - m_position);
+
+        mix(done, offset - done);
+        done = offset;
+        reclaim();
+        apply(timed.event);
+    }
+
+    mix(done, frames - done);
+    mix_down(out, frames);
+    m_position = end;
+
+    if (finished())
+    {
+        reclaim();
+    }
+
+    return frames;
+}
+
+void Synth::apply(const EVENT& event)
+{
+    CHANNEL& channel = m_channels[event.channel];
+
+    switch (event.type)
+    {
+    case EventType::note_on:
+        note_on(event.channel, event.data1, uint8_t(event.data2));
+        break;
+
+    case EventType::note_off:
+        note_off(event.channel, event.data1);
+        break;
+
+    case EventType::control_change:
+        control_change(event.channel, event.data1, uint8_t(event.data2));
+        break;
+
+    case EventType::program_change:
+        channel.program = event.data1;
+        break;
+
+    case EventType::pitch_wheel:
+        // Center 0x2000, range of 2 semitones up and down
+        channel.bend = (int(event.data2) - 0x2000) / 8192.0 * 2;
+
+        for (unsigned i = 0; i != m_voices.size(); ++i)
+        {
+            if (m_voices.channels[m_voices[i]] == event.channel)
+            {
+                set_increment(m_voices[i]);
+            }
+        }
+        break;
+
+    case EventType::key_pressure:
+    case EventType::channel_pressure:
+        break;
+    }
+}
+
+void Synth::note_on(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    const unsigned voice = m_voices.allocate();
+
+    if (voice == VoicePool::NONE)
+    {
+        return;
+    }
+
+    const bool percussion = channel == PERCUSSION_CHANNEL;
+
+    m_voices.channels[voice] = channel;
+    m_voices.notes[voice] = note;
+    m_voices.waveforms[voice] = percussion ? Waveform::noise : waveform_for(m_channels[channel].program);
+    m_voices.stages[voice] = EnvelopeStage::attack;
+    m_voices.sustained[voice] = false;
+    m_voices.velocities[voice] = velocity / 127.0f;
+    m_voices.envelopes[voice] = 0;
+    m_voices.envelope_rates[voice] = step(ATTACK, m_sample_rate);
+    m_voices.envelope_targets[voice] = 1;
+    m_voices.decay_rates[voice] = percussion
+        ? -step(PERCUSSION_DECAY, m_sample_rate) : -step(DECAY, m_sample_rate) * (1 - SUSTAIN_LEVEL);
+    m_voices.sustain_levels[voice] = percussion ? 0.0f : SUSTAIN_LEVEL;
+    m_voices.phases[voice] = 0;
+    // Seeded by the order of notes, so that renderings are reproducible
+    m_voices.noise[voice] = 0x9E3779B9u ^ (++m_notes_started * 0x85EBCA6Bu);
+    set_increment(voice);
+}
+
+void Synth::note_off(uint8_t channel, uint8_t note)
+{
+    for (unsigned i = 0; i != m_voices.size(); ++i)
+    {
+        const unsigned voice = m_voices[i];
+
+        if (m_voices.channels[voice] == channel && m_voices.notes[voice] == note
+            && m_voices.stages[voice] != EnvelopeStage::release && !m_voices.sustained[voice])
+        {
+            if (m_channels[channel].sustain)
+            {
+                m_voices.sustained[voice] = true;
+            }
+            else
+            {
+                release(voice);
+            }
+        }
+    }
+}
+
+void Synth::control_change(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    CHANNEL& state = m_channels[channel];
+
+    // Volume, pan and expression come from the automation lanes, see mix_down
+    switch (controller)
+    {
+    case 64:
+        state.sustain = value >= 64;
+
+        if (!state.sustain)
+        {
+            for (unsigned i = 0; i != m_voices.size(); ++i)
+            {
+                const unsigned voice = m_voices[i];
+
+                if (m_voices.channels[voice] == channel && m_voices.sustained[voice])
+                {
+                    m_voices.sustained[voice] = false;
+                    release(voice);
+                }
+            }
+        }
+        break;
+
+    case 120: // All Sound Off
+    case 123: // All Notes Off
+        release_all(channel);
+        break;
+
+    case RESET_ALL_CONTROLLERS:
+        state.bend = 0;
+        state.sustain = false;
+
+        for (unsigned i = 0; i != m_voices.size(); ++i)
+        {
+            if (m_voices.channels[m_voices[i]] == channel)
+            {
+                set_increment(m_voices[i]);
+            }
+        }
+        break;
+    }
+}
+
+void Synth::release(unsigned voice)
+{
+    // Fades out from the current level in RELEASE seconds at most
+    m_voices.stages[voice] = EnvelopeStage::release;
+    m_voices.envelope_rates[voice] = -(m_voices.envelopes[voice] * step(RELEASE, m_sample_rate));
+    m_voices.envelope_targets[voice] = 0;
+}
+
+void Synth::release_all(uint8_t channel)
+{
+    for (unsigned i = 0; i != m_voices.size(); ++i)
+    {
+        const unsigned voice = m_voices[i];
+
+        if (m_voices.channels[voice] == channel && m_voices.stages[voice] != EnvelopeStage::release)
+        {
+            m_voices.sustained[voice] = false;
+            release(voice);
+        }
+    }
+}
+
+void Synth::set_increment(unsigned voice)
+{
+    const double bend = m_channels[m_voices.channels[voice]].bend;
+    const double frequency = 440 * std::pow(2.0, (m_voices.notes[voice] - 69 + bend) / 12);
+
+    // Only the fraction of a cycle matters; 2^32 is one cycle
+    double cycles = frequency / m_sample_rate;
+    cycles -= std::floor(cycles);
+    m_voices.increments[voice] = uint32_t(cycles * 4294967296.0);
+}
+
+void Synth::reclaim()
+{
+    unsigned i = 0;
+
+    while (i != m_voices.size())
+    {
+        const unsigned voice = m_voices[i];
+
+        if (silent(m_voices, voice))
+        {
+            // Moves the last voice in use to position i
+            m_voices.release(voice);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void Synth::mix(unsigned offset, unsigned frames)
+{
+    if (frames == 0)
+    {
+        return;
+    }
+
+    for (std::vector<unsigned>& voices : m_channel_voices)
+    {
+        voices.clear();
+    }
+
+    // Silent voices keep their lanes until they are reclaimed at the next event: dropping them
+    // here would regroup the voices after them, and change the order their samples are added in
+    // at a point that depends on the block size
+    for (unsigned i = 0; i != m_voices.size(); ++i)
+    {
+        const unsigned voice = m_voices[i];
+        m_channel_voices[m_voices.channels[voice]].push_back(voice);
+    }
+
+    unsigned busy = 0;
+    uint64_t work = 0;
+
+    for (uint8_t channel = 0; channel != 16; ++channel)
+    {
+        if (!m_channel_voices[channel].empty())
+        {
+            if (!m_channel_used[channel])
+            {
+                float* buffer = &m_channel_buffers[2 * m_block_size * channel];
+                std::fill(buffer, buffer + 2 * m_block_size, 0.0f);
+                m_channel_used[channel] = true;
+            }
+
+            m_busy_channels[busy++] = channel;
+            work += m_channel_voices[channel].size() * frames;
+        }
+    }
+
+    // Channels only touch their own voices and buffer, so which thread renders them makes no difference
+    auto render = [this, offset, frames](unsigned i) { render_channel(m_busy_channels[i], offset, frames); };
+
+    if (work >= PARALLEL_WORK)
+    {
+        m_workers.run(busy, render);
+    }
+    else
+    {
+        for (unsigned i = 0; i != busy; ++i)
+        {
+            render(i);
+        }
+    }
+}
+
+void Synth::render_channel(uint8_t channel, unsigned offset, unsigned frames)
+{
+    float* out = &m_channel_buffers[2 * (m_block_size * channel + offset)];
+    const std::vector<unsigned>& voices = m_channel_voices[channel];
+
+    // Voices are copied into lanes KERNEL_WIDTH at a time, rendered together and copied back
+    for (size_t i = 0; i < voices.size(); i += KERNEL_WIDTH)
+    {
+        mix_lanes(out, frames, &voices[i], unsigned(std::min(voices.size() - i, size_t(KERNEL_WIDTH))));
+    }
+}
+
+void Synth::mix_down(float* out, unsigned frames)
+{
+    std::fill(out, out + 2 * frames, 0.0f);
+
+    // Always in the order of the channels
+    for (uint8_t channel = 0; channel != 16; ++channel)
+    {
+        if (m_channel_used[channel])
+        {
+            const float* buffer = &m_channel_buffers[2 * m_block_size * channel];
+            GAIN_RAMP& ramp = m_ramps[channel];
+
+            for (unsigned i = 0; i != frames; ++i)
+            {
+                const uint64_t frame = m_position + i;
+
+                if (frame >= ramp.end)
+                {
+                    // Control periods are aligned to frame 0, not to blocks
+                    float left, right;
+                    ramp.start = frame - frame % CONTROL_PERIOD;
+                    ramp.end = ramp.start + CONTROL_PERIOD;
+                    channel_gain(channel, ramp.start, ramp.left, ramp.right);
+                    channel_gain(channel, ramp.end, left, right);
+                    ramp.left_step = (left - ramp.left) / CONTROL_PERIOD;
+                    ramp.right_step = (right - ramp.right) / CONTROL_PERIOD;
+                }
+
+                const float t = float(frame - ramp.start);
+                out[2 * i] += buffer[2 * i] * (ramp.left + ramp.left_step * t);
+                out[2 * i + 1] += buffer[2 * i + 1] * (ramp.right + ramp.right_step * t);
+            }
+        }
+    }
+}
+
+void Synth::channel_gain(uint8_t channel, uint64_t frame, float& left, float& right)
+{
+    midi::AutomationCursor* cursors = &m_gain_cursors[3 * channel];
+    const midi::Time time(frame);
+    const float volume = std::min(cursors[0].at(time), uint16_t(127)) / 127.0f;
+    const float expression = std::min(cursors[1].at(time), uint16_t(127)) / 127.0f;
+    const uint16_t pan = std::min(cursors[2].at(time), uint16_t(127));
+
+    // Equal power: center is -3 dB on both sides
+    const double angle = pan / 127.0 * PI / 2;
+    left = volume * expression * float(std::cos(angle));
+    right = volume * expression * float(std::sin(angle));
+}
+
+void Synth::mix_lanes(float* out, unsigned frames, const unsigned* voices, unsigned count)
+{
+    VOICE_LANES lanes;
+    std::memset(&lanes, 0, sizeof(lanes));
+
+    for (unsigned k = 0; k != count; ++k)
+    {
+        const unsigned voice = voices[k];
+        // Channel gains are applied in mix_down
+        const float gain = MASTER_GAIN * m_voices.velocities[voice];
+        const Waveform waveform = m_voices.waveforms[voice];
+
+        lanes.phases[k] = m_voices.phases[voice];
+        lanes.increments[k] = m_voices.increments[voice];
+        lanes.tables[k] = waveform == Waveform::noise ? 0 : unsigned(waveform) * (WAVETABLE_SIZE + 1);
+        lanes.noise_masks[k] = waveform == Waveform::noise ? ~0u : 0;
+        lanes.noise[k] = m_voices.noise[voice];
+        lanes.envelopes[k] = m_voices.envelopes[voice];
+        lanes.rates[k] = m_voices.envelope_rates[voice];
+        lanes.targets[k] = m_voices.envelope_targets[voice];
+        lanes.decay_rates[k] = m_voices.decay_rates[voice];
+        lanes.sustain_levels[k] = m_voices.sustain_levels[voice];
+        lanes.left[k] = gain;
+        lanes.right[k] = gain;
+    }
+
+    render_lanes(m_kernel, lanes, out, frames);
+
+    for (unsigned k = 0; k != count; ++k)
+    {
+        const unsigned voice = voices[k];
+        const float rate = lanes.rates[k];
+
+        m_voices.phases[voice] = lanes.phases[k];
+        m_voices.noise[voice] = lanes.noise[k];
+        m_voices.envelopes[voice] = lanes.envelopes[k];
+        m_voices.envelope_rates[voice] = rate;
+        m_voices.envelope_targets[voice] = lanes.targets[k];
+
+        if (m_voices.stages[voice] != EnvelopeStage::release)
+        {
+            m_voices.stages[voice] = rate > 0 ? EnvelopeStage::attack : rate < 0 ? EnvelopeStage::decay : EnvelopeStage::sustain;
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "audio/score.h"
+#include "audio/voice-kernels.h"
+#include "audio/voice-pool.h"
+#include "midi/automation.h"
+#include "util/worker-pool.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace audio
+{
+    /// <summary>
+    /// Renders a Score to stereo PCM, offline, one block of frames at a time.
+    /// Events take effect at the exact sample they fall on, not at the next block boundary,
+    /// so the output does not depend on the block size.
+    /// Each MIDI channel is rendered into its own buffer, possibly on its own thread, and the buffers
+    /// are summed in the order of the channels, so the output does not depend on the number of threads either.
+    /// Volume, expression and pan are read from automation lanes every CONTROL_PERIOD frames
+    /// and ramped linearly in between, so that controller changes do not click.
+    /// </summary>
+    class Synth final
+    {
+    public:
+        /// <summary>
+        /// At most <paramref name="polyphony" /> notes sound at the same time. A note beyond that
+        /// takes over a sounding one as chosen by <paramref name="steal" />, or is dropped.
+        /// Channels are rendered on <paramref name="threads" /> threads, the calling one included.
+        /// </summary>
+        Synth(const Score& score, unsigned sample_rate = 44100, unsigned block_size = 256, unsigned polyphony = 64,
+            StealPolicy steal = StealPolicy::oldest, unsigned threads = 1);
+
+        unsigned sample_rate() const { return m_sample_rate; }
+        unsigned block_size() const { return m_block_size; }
+
+        /// <summary>
+        /// Index of the next frame render() produces.
+        /// </summary>
+        uint64_t position() const { return m_position; }
+
+        /// <summary>
+        /// Number of frames in the entire rendering: up to the end of the score, plus the release of the last notes.
+        /// </summary>
+        uint64_t length() const { return m_length; }
+
+        bool finished() const { return m_position == m_length; }
+
+        /// <summary>
+        /// Renders the next block into <paramref name="out" />, which must hold 2 * block_size() floats.
+        /// Frames are interleaved left, right. Returns the number of frames rendered,
+        /// which is less than block_size() for the last block and 0 once finished.
+        /// </summary>
+        unsigned render(float* out);
+
+        /// <summary>
+        /// Number of voices in use, including those being released. Voices that have faded out
+        /// go back to the pool at the next event, so that which voice a note gets does not depend on the block size.
+        /// </summary>
+        unsigned active_voices() const { return m_voices.size(); }
+
+        uint64_t stolen_voices() const { return m_voices.stolen(); }
+
+        /// <summary>
+        /// Kernel the voices are rendered with; the best one the processor supports unless changed.
+        /// All kernels produce the same samples.
+        /// </summary>
+        KernelIsa kernel() const { return m_kernel; }
+        void set_kernel(KernelIsa isa) { m_kernel = isa; }
+
+        unsigned threads() const { return m_workers.threads(); }
+
+        /// <summary>
+        /// Volume (7), pan (10) and expression (11) of every channel, timed in frames rather than ticks.
+        /// </summary>
+        const midi::Automation& automation() const { return m_automation; }
+
+        static const unsigned CONTROL_PERIOD = 64;
+
+    private:
+        struct CHANNEL
+        {
+            uint8_t program;
+            // In semitones
+            double bend;
+            bool sustain;
+        };
+
+        // Channel gains from start to end; each frame's gain depends only on its index
+        struct GAIN_RAMP
+        {
+            uint64_t start;
+            uint64_t end;
+            float left;
+            float right;
+            float left_step;
+            float right_step;
+        };
+
+        struct TIMED_EVENT
+        {
+            uint64_t frame;
+            EVENT event;
+        };
+
+        unsigned m_sample_rate;
+        unsigned m_block_size;
+        uint64_t m_position;
+        uint64_t m_length;
+        std::vector<TIMED_EVENT> m_events;
+        size_t m_next_event;
+        CHANNEL m_channels[16];
+        midi::Automation m_automation;
+        // Volume, expression and pan of each channel, in that order
+        std::vector<midi::AutomationCursor> m_gain_cursors;
+        GAIN_RAMP m_ramps[16];
+        VoicePool m_voices;
+        uint32_t m_notes_started;
+        KernelIsa m_kernel;
+        // One block per channel, and whether it has been used in the current block
+        std::vector<float> m_channel_buffers;
+        bool m_channel_used[16];
+        // Sounding voices of each channel, for the span being rendered
+        std::vector<unsigned> m_channel_voices[16];
+        uint8_t m_busy_channels[16];
+        WorkerPool m_workers;
+
+        void apply(const EVENT& event);
+        void note_on(uint8_t channel, uint8_t note, uint8_t velocity);
+        void note_off(uint8_t channel, uint8_t note);
+        void control_change(uint8_t channel, uint8_t controller, uint8_t value);
+        void release(unsigned voice);
+        void release_all(uint8_t channel);
+        void set_increment(unsigned voice);
+        void reclaim();
+        void mix(unsigned offset, unsigned frames);
+        void render_channel(uint8_t channel, unsigned offset, unsigned frames);
+        void mix_down(float* out, unsigned frames);
+        void channel_gain(uint8_t channel, uint64_t frame, float& left, float& right);
+        void mix_lanes(float* out, unsigned frames, const unsigned* voices, unsigned count);
+    };
+}
+
+#endif
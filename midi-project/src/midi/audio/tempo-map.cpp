@@ -0,0 +1,76 @@
+#include "audio/tempo-map.h"
+#include "logging.h"
+#include <algorithm>
+#include <cmath>
+
+
+using namespace audio;
+
+
+TempoMap::TempoMap(uint16_t division)
+    : m_smpte((division & 0x8000) != 0), m_ticks_per_quarter(division)
+{
+    if (m_smpte)
+    {
+        // The upper byte is the negated frame rate, e.g. -25; 29.97 fps is stored as -29
+        const unsigned frames_per_second = unsigned(-int8_t(division >> 8));
+        const unsigned ticks_per_frame = division & 0xFF;
+        CHECK(frames_per_second != 0 && ticks_per_frame != 0) << "Invalid SMPTE division " << division;
+
+        m_segments.push_back(SEGMENT{ 0, 0, 1.0 / (frames_per_second * ticks_per_frame) });
+    }
+    else
+    {
+        CHECK(division != 0) << "Division must be positive";
+
+        m_segments.push_back(SEGMENT{ 0, 0, 0.5 / division });
+    }
+}
+
+void TempoMap::set_tempo(midi::Time tick, uint32_t microseconds_per_quarter)
+{
+    if (m_smpte)
+    {
+        return;
+    }
+
+    SEGMENT& last = m_segments.back();
+    CHECK(value(tick) >= last.tick) << "Tempo changes must be made in order";
+
+    const double seconds_per_tick = microseconds_per_quarter / (1e6 * m_ticks_per_quarter);
+
+    if (value(tick) == last.tick)
+    {
+        last.seconds_per_tick = seconds_per_tick;
+    }
+    else
+    {
+        const double seconds = last.seconds + (value(tick) - last.tick) * last.seconds_per_tick;
+        m_segments.push_back(SEGMENT{ value(tick), seconds, seconds_per_tick });
+    }
+}
+
+double TempoMap::seconds(midi::Time tick) const
+{
+    // Last segment starting at or before tick
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), value(tick),
+        [](uint64_t t, const SEGMENT& segment) { return t < segment.tick; });
+    const SEGMENT& segment = *(it - 1);
+
+    return segment.seconds + (value(tick) - segment.tick) * segment.seconds_per_tick;
+}
+
+double TempoMap::ticks(double seconds) const
+{
+    // Last segment starting at or before seconds
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), seconds,
+        [](double s, const SEGMENT& segment) { return s < segment.seconds; });
+    const SEGMENT& segment = it == m_segments.begin() ? *it : *(it - 1);
+
+    return segment.tick + (seconds - segment.seconds) / segment.seconds_per_tick;
+}
+
+uint64_t TempoMap::frame(midi::Time tick, unsigned sample_rate) const
+{
+    return uint64_t(std::floor(seconds(tick) * sample_rate + 0.5));
+}
@@ -0,0 +1,56 @@
+#ifndef TEMPO_MAP_H
+#define TEMPO_MAP_H
+
+#include "midi/primitives.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace audio
+{
+    /// <summary>
+    /// Converts MIDI ticks to seconds, following the tempo changes of a score.
+    /// </summary>
+    class TempoMap final
+    {
+    public:
+        /// <summary>
+        /// <paramref name="division" /> as found in the MThd chunk: ticks per quarter note, or, if the
+        /// top bit is set, SMPTE frames per second (negated) and ticks per frame, in which case tempo changes do not matter.
+        /// Until the first tempo change, the tempo is 120 beats per minute.
+        /// </summary>
+        TempoMap(uint16_t division);
+
+        /// <summary>
+        /// Changes the tempo from <paramref name="tick" /> on. Changes must be made in order of time.
+        /// </summary>
+        void set_tempo(midi::Time tick, uint32_t microseconds_per_quarter);
+
+        double seconds(midi::Time tick) const;
+
+        /// <summary>
+        /// Inverse of seconds(): the tick, with fraction, that falls at <paramref name="seconds" />.
+        /// </summary>
+        double ticks(double seconds) const;
+
+        /// <summary>
+        /// Index of the sample at which <paramref name="tick" /> falls.
+        /// </summary>
+        uint64_t frame(midi::Time tick, unsigned sample_rate) const;
+
+    private:
+        struct SEGMENT
+        {
+            uint64_t tick;
+            double seconds;
+            double seconds_per_tick;
+        };
+
+        bool m_smpte;
+        unsigned m_ticks_per_quarter;
+        // Sorted by tick; the first one starts at tick 0
+        std::vector<SEGMENT> m_segments;
+    };
+}
+
+#endif
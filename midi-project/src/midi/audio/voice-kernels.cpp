@@ -0,0 +1,392 @@
+#include "audio/voice-kernels.h"
+#include "logging.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define X86_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere; GCC and Clang need the target on the function
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+
+using namespace audio;
+
+
+namespace
+{
+    const unsigned FRACTION_BITS = 32 - WAVETABLE_BITS;
+    const uint32_t FRACTION_MASK = (1u << FRACTION_BITS) - 1;
+    const float FRACTION_SCALE = 1.0f / (1u << FRACTION_BITS);
+    const float NOISE_SCALE = 1.0f / 2147483648.0f;
+
+    std::vector<float> build_wavetables()
+    {
+        const double pi = 3.14159265358979323846;
+        std::vector<float> tables(4 * (WAVETABLE_SIZE + 1));
+
+        for (unsigned i = 0; i <= WAVETABLE_SIZE; ++i)
+        {
+            const double phase = double(i % WAVETABLE_SIZE) / WAVETABLE_SIZE;
+
+            tables[i] = float(std::sin(2 * pi * phase));
+            tables[(WAVETABLE_SIZE + 1) + i] = float(4 * std::abs(phase - 0.5) - 1);
+            tables[2 * (WAVETABLE_SIZE + 1) + i] = float(2 * phase - 1);
+            tables[3 * (WAVETABLE_SIZE + 1) + i] = phase < 0.5 ? 1.0f : -1.0f;
+        }
+        return tables;
+    }
+
+    // min and max as minps and maxps compute them, so that all kernels agree
+    inline float min_ps(float a, float b) { return a < b ? a : b; }
+    inline float max_ps(float a, float b) { return a > b ? a : b; }
+
+    // The reference kernel: one lane at a time, in the same order of operations as the vectorized ones
+    void render_scalar(VOICE_LANES& lanes, float* out, unsigned frames)
+    {
+        const float* table = wavetables();
+
+        for (unsigned j = 0; j != frames; ++j)
+        {
+            float left[KERNEL_WIDTH];
+            float right[KERNEL_WIDTH];
+
+            for (unsigned k = 0; k != KERNEL_WIDTH; ++k)
+            {
+                // Envelope
+                const float rate = lanes.rates[k];
+                const float target = lanes.targets[k];
+                const bool rising = rate > 0;
+                float envelope = lanes.envelopes[k] + rate;
+                envelope = rising ? min_ps(envelope, target) : max_ps(envelope, target);
+
+                if (envelope == target)
+                {
+                    lanes.rates[k] = rising ? lanes.decay_rates[k] : 0.0f;
+                    lanes.targets[k] = rising ? lanes.sustain_levels[k] : target;
+                }
+                lanes.envelopes[k] = envelope;
+
+                // Oscillator
+                const uint32_t phase = lanes.phases[k];
+                const uint32_t index = lanes.tables[k] + (phase >> FRACTION_BITS);
+                const float fraction = float(int32_t(phase & FRACTION_MASK)) * FRACTION_SCALE;
+                const float a = table[index];
+                const float b = table[index + 1];
+                float sample = a + (b - a) * fraction;
+
+                uint32_t noise = lanes.noise[k];
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+                lanes.noise[k] = noise;
+
+                if (lanes.noise_masks[k])
+                {
+                    sample = float(int32_t(noise)) * NOISE_SCALE;
+                }
+
+                lanes.phases[k] = phase + lanes.increments[k];
+
+                sample *= envelope;
+                left[k] = sample * lanes.left[k];
+                right[k] = sample * lanes.right[k];
+            }
+
+            out[2 * j] += ((left[0] + left[4]) + (left[2] + left[6])) + ((left[1] + left[5]) + (left[3] + left[7]));
+            out[2 * j + 1] += ((right[0] + right[4]) + (right[2] + right[6])) + ((right[1] + right[5]) + (right[3] + right[7]));
+        }
+    }
+
+#ifdef X86_KERNELS
+    // ((0 + 4) + (2 + 6)) + ((1 + 5) + (3 + 7)), given the sums 0 + 4, 1 + 5, 2 + 6 and 3 + 7
+    inline float sum_halves(__m128 s4)
+    {
+        const __m128 s2 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+        return _mm_cvtss_f32(_mm_add_ss(s2, _mm_shuffle_ps(s2, s2, 1)));
+    }
+
+    // Lanes 0-3 and 4-7 in separate registers
+    struct HALVES
+    {
+        __m128 lo;
+        __m128 hi;
+    };
+
+    struct IHALVES
+    {
+        __m128i lo;
+        __m128i hi;
+    };
+
+    inline __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline __m128i xorshift(__m128i x)
+    {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    }
+
+    // SSE2 has no gather; the table reads are done one lane at a time
+    inline __m128 gather(const float* table, __m128i indices)
+    {
+        alignas(16) uint32_t i[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(i), indices);
+        return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+    }
+
+    void render_sse2(VOICE_LANES& lanes, float* out, unsigned frames)
+    {
+        const float* table = wavetables();
+        const __m128 zero = _mm_setzero_ps();
+        const __m128i fraction_mask = _mm_set1_epi32(int(FRACTION_MASK));
+        const __m128 fraction_scale = _mm_set1_ps(FRACTION_SCALE);
+        const __m128 noise_scale = _mm_set1_ps(NOISE_SCALE);
+        const __m128i one = _mm_set1_epi32(1);
+
+        auto loadf = [](const float* p) { return HALVES{ _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; };
+        auto loadi = [](const uint32_t* p) {
+            return IHALVES{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)) };
+        };
+
+        HALVES envelope = loadf(lanes.envelopes);
+        HALVES rate = loadf(lanes.rates);
+        HALVES target = loadf(lanes.targets);
+        const HALVES decay_rate = loadf(lanes.decay_rates);
+        const HALVES sustain_level = loadf(lanes.sustain_levels);
+        const HALVES left = loadf(lanes.left);
+        const HALVES right = loadf(lanes.right);
+        IHALVES phase = loadi(lanes.phases);
+        const IHALVES increment = loadi(lanes.increments);
+        const IHALVES tables = loadi(lanes.tables);
+        const IHALVES noise_mask = loadi(lanes.noise_masks);
+        IHALVES noise = loadi(lanes.noise);
+
+        for (unsigned j = 0; j != frames; ++j)
+        {
+            __m128 l[2];
+            __m128 r[2];
+
+            for (int h = 0; h != 2; ++h)
+            {
+                __m128& e = h ? envelope.hi : envelope.lo;
+                __m128& rt = h ? rate.hi : rate.lo;
+                __m128& tg = h ? target.hi : target.lo;
+                __m128i& ph = h ? phase.hi : phase.lo;
+                __m128i& ns = h ? noise.hi : noise.lo;
+
+                const __m128 rising = _mm_cmpgt_ps(rt, zero);
+                const __m128 sum = _mm_add_ps(e, rt);
+                e = select(rising, _mm_min_ps(sum, tg), _mm_max_ps(sum, tg));
+
+                const __m128 reached = _mm_cmpeq_ps(e, tg);
+                const __m128 next_rate = _mm_and_ps(rising, h ? decay_rate.hi : decay_rate.lo);
+                const __m128 next_target = select(rising, h ? sustain_level.hi : sustain_level.lo, tg);
+                rt = select(reached, next_rate, rt);
+                tg = select(reached, next_target, tg);
+
+                const __m128i index = _mm_add_epi32(h ? tables.hi : tables.lo, _mm_srli_epi32(ph, FRACTION_BITS));
+                const __m128 fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(ph, fraction_mask)), fraction_scale);
+                const __m128 a = gather(table, index);
+                const __m128 b = gather(table, _mm_add_epi32(index, one));
+                __m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+
+                ns = xorshift(ns);
+                const __m128 noise_sample = _mm_mul_ps(_mm_cvtepi32_ps(ns), noise_scale);
+                sample = select(_mm_castsi128_ps(h ? noise_mask.hi : noise_mask.lo), noise_sample, sample);
+
+                ph = _mm_add_epi32(ph, h ? increment.hi : increment.lo);
+
+                sample = _mm_mul_ps(sample, e);
+                l[h] = _mm_mul_ps(sample, h ? left.hi : left.lo);
+                r[h] = _mm_mul_ps(sample, h ? right.hi : right.lo);
+            }
+
+            out[2 * j] += sum_halves(_mm_add_ps(l[0], l[1]));
+            out[2 * j + 1] += sum_halves(_mm_add_ps(r[0], r[1]));
+        }
+
+        auto storef = [](float* p, const HALVES& v) { _mm_storeu_ps(p, v.lo); _mm_storeu_ps(p + 4, v.hi); };
+        auto storei = [](uint32_t* p, const IHALVES& v) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v.lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 4), v.hi);
+        };
+        storef(lanes.envelopes, envelope);
+        storef(lanes.rates, rate);
+        storef(lanes.targets, target);
+        storei(lanes.phases, phase);
+        storei(lanes.noise, noise);
+    }
+
+    AVX2_TARGET
+    void render_avx2(VOICE_LANES& lanes, float* out, unsigned frames)
+    {
+        const float* table = wavetables();
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256i fraction_mask = _mm256_set1_epi32(int(FRACTION_MASK));
+        const __m256 fraction_scale = _mm256_set1_ps(FRACTION_SCALE);
+        const __m256 noise_scale = _mm256_set1_ps(NOISE_SCALE);
+        const __m256i one = _mm256_set1_epi32(1);
+
+        __m256 envelope = _mm256_loadu_ps(lanes.envelopes);
+        __m256 rate = _mm256_loadu_ps(lanes.rates);
+        __m256 target = _mm256_loadu_ps(lanes.targets);
+        const __m256 decay_rate = _mm256_loadu_ps(lanes.decay_rates);
+        const __m256 sustain_level = _mm256_loadu_ps(lanes.sustain_levels);
+        const __m256 left = _mm256_loadu_ps(lanes.left);
+        const __m256 right = _mm256_loadu_ps(lanes.right);
+        __m256i phase = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.phases));
+        const __m256i increment = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.increments));
+        const __m256i tables = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.tables));
+        const __m256 noise_mask = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.noise_masks)));
+        __m256i noise = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.noise));
+
+        for (unsigned j = 0; j != frames; ++j)
+        {
+            const __m256 rising = _mm256_cmp_ps(rate, zero, _CMP_GT_OQ);
+            const __m256 sum = _mm256_add_ps(envelope, rate);
+            envelope = _mm256_blendv_ps(_mm256_max_ps(sum, target), _mm256_min_ps(sum, target), rising);
+
+            const __m256 reached = _mm256_cmp_ps(envelope, target, _CMP_EQ_OQ);
+            const __m256 next_rate = _mm256_and_ps(rising, decay_rate);
+            const __m256 next_target = _mm256_blendv_ps(target, sustain_level, rising);
+            rate = _mm256_blendv_ps(rate, next_rate, reached);
+            target = _mm256_blendv_ps(target, next_target, reached);
+
+            const __m256i index = _mm256_add_epi32(tables, _mm256_srli_epi32(phase, FRACTION_BITS));
+            const __m256 fraction = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase, fraction_mask)), fraction_scale);
+            const __m256 a = _mm256_i32gather_ps(table, index, 4);
+            const __m256 b = _mm256_i32gather_ps(table, _mm256_add_epi32(index, one), 4);
+            __m256 sample = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), fraction));
+
+            noise = _mm256_xor_si256(noise, _mm256_slli_epi32(noise, 13));
+            noise = _mm256_xor_si256(noise, _mm256_srli_epi32(noise, 17));
+            noise = _mm256_xor_si256(noise, _mm256_slli_epi32(noise, 5));
+            const __m256 noise_sample = _mm256_mul_ps(_mm256_cvtepi32_ps(noise), noise_scale);
+            sample = _mm256_blendv_ps(sample, noise_sample, noise_mask);
+
+            phase = _mm256_add_epi32(phase, increment);
+
+            sample = _mm256_mul_ps(sample, envelope);
+            const __m256 l = _mm256_mul_ps(sample, left);
+            const __m256 r = _mm256_mul_ps(sample, right);
+
+            out[2 * j] += sum_halves(_mm_add_ps(_mm256_castps256_ps128(l), _mm256_extractf128_ps(l, 1)));
+            out[2 * j + 1] += sum_halves(_mm_add_ps(_mm256_castps256_ps128(r), _mm256_extractf128_ps(r, 1)));
+        }
+
+        _mm256_storeu_ps(lanes.envelopes, envelope);
+        _mm256_storeu_ps(lanes.rates, rate);
+        _mm256_storeu_ps(lanes.targets, target);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.phases), phase);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.noise), noise);
+    }
+
+    bool cpu_has_avx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX needs both the instructions and the OS saving the YMM registers
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+}
+
+const float* audio::wavetables()
+{
+    static const std::vector<float> tables = build_wavetables();
+    return tables.data();
+}
+
+bool audio::is_supported(KernelIsa isa)
+{
+    switch (isa)
+    {
+#ifdef X86_KERNELS
+    case KernelIsa::avx2:
+    {
+        static const bool avx2 = cpu_has_avx2();
+        return avx2;
+    }
+
+    case KernelIsa::sse2:
+        return true;
+#endif
+
+    case KernelIsa::scalar:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+KernelIsa audio::detect_kernel_isa()
+{
+    if (is_supported(KernelIsa::avx2))
+    {
+        return KernelIsa::avx2;
+    }
+    else if (is_supported(KernelIsa::sse2))
+    {
+        return KernelIsa::sse2;
+    }
+    else
+    {
+        return KernelIsa::scalar;
+    }
+}
+
+void audio::render_lanes(KernelIsa isa, VOICE_LANES& lanes, float* out, unsigned frames)
+{
+    CHECK(is_supported(isa)) << "Kernel not supported by this processor";
+
+    switch (isa)
+    {
+#ifdef X86_KERNELS
+    case KernelIsa::avx2:
+        render_avx2(lanes, out, frames);
+        break;
+
+    case KernelIsa::sse2:
+        render_sse2(lanes, out, frames);
+        break;
+#endif
+
+    default:
+        render_scalar(lanes, out, frames);
+        break;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef VOICE_KERNELS_H
+#define VOICE_KERNELS_H
+
+#include <cstdint>
+
+
+namespace audio
+{
+    /// <summary>
+    /// Number of voices a kernel advances together.
+    /// </summary>
+    const unsigned KERNEL_WIDTH = 8;
+
+    /// <summary>
+    /// Bits of a phase used to index the wavetables; the remaining bits interpolate.
+    /// </summary>
+    const unsigned WAVETABLE_BITS = 11;
+    const unsigned WAVETABLE_SIZE = 1 << WAVETABLE_BITS;
+
+    enum class KernelIsa : uint8_t
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    /// <summary>
+    /// State of KERNEL_WIDTH voices, one column per field. Unused lanes must have zero gains.
+    /// </summary>
+    struct VOICE_LANES
+    {
+        // Fixed point, 2^32 is one cycle
+        uint32_t phases[KERNEL_WIDTH];
+        uint32_t increments[KERNEL_WIDTH];
+        // Offset of the voice's wavetable in wavetables()
+        uint32_t tables[KERNEL_WIDTH];
+        // All ones for voices that play noise instead of a wavetable
+        uint32_t noise_masks[KERNEL_WIDTH];
+        uint32_t noise[KERNEL_WIDTH];
+        // The envelope moves by rate per sample until it reaches target.
+        // Rising, it then decays towards sustain_level at decay_rate; falling, it stays.
+        float envelopes[KERNEL_WIDTH];
+        float rates[KERNEL_WIDTH];
+        float targets[KERNEL_WIDTH];
+        float decay_rates[KERNEL_WIDTH];
+        float sustain_levels[KERNEL_WIDTH];
+        float left[KERNEL_WIDTH];
+        float right[KERNEL_WIDTH];
+    };
+
+    /// <summary>
+    /// Sine, triangle, saw and square, in the order of Waveform,
+    /// each WAVETABLE_SIZE + 1 entries long so that interpolation can read one past the end.
+    /// </summary>
+    const float* wavetables();
+
+    /// <summary>
+    /// Best kernel the processor supports.
+    /// </summary>
+    KernelIsa detect_kernel_isa();
+
+    bool is_supported(KernelIsa isa);
+
+    /// <summary>
+    /// Advances <paramref name="lanes" /> by <paramref name="frames" /> samples and adds them to
+    /// <paramref name="out" />, interleaved left, right. Every kernel produces exactly the same bits:
+    /// the lanes of each frame are summed in the same order, ((0 + 4) + (2 + 6)) + ((1 + 5) + (3 + 7)).
+    /// </summary>
+    void render_lanes(KernelIsa isa, VOICE_LANES& lanes, float* out, unsigned frames);
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "audio/voice-pool.h"
+#include "logging.h"
+
+
+using namespace audio;
+
+
+const unsigned VoicePool::NONE;
+
+VoicePool::VoicePool(unsigned capacity, StealPolicy policy)
+    : channels(capacity), notes(capacity), waveforms(capacity), stages(capacity), sustained(capacity),
+      velocities(capacity), envelopes(capacity), envelope_rates(capacity), envelope_targets(capacity),
+      decay_rates(capacity), sustain_levels(capacity),
+      phases(capacity), increments(capacity), noise(capacity),
+      m_capacity(capacity), m_policy(policy), m_positions(capacity), m_ages(capacity), m_allocations(0), m_stolen(0)
+{
+    CHECK(capacity > 0 && capacity <= 0x10000) << "Voice pool capacity must be between 1 and 65536";
+
+    m_active.reserve(capacity);
+    m_free.reserve(capacity);
+
+    // Lowest index on top, so that the first voices are handed out in order
+    for (unsigned i = capacity; i != 0; --i)
+    {
+        m_free.push_back(uint16_t(i - 1));
+    }
+}
+
+unsigned VoicePool::allocate()
+{
+    unsigned index;
+
+    if (!m_free.empty())
+    {
+        index = m_free.back();
+        m_free.pop_back();
+        m_positions[index] = uint16_t(m_active.size());
+        m_active.push_back(uint16_t(index));
+    }
+    else if (m_policy == StealPolicy::none)
+    {
+        return NONE;
+    }
+    else
+    {
+        // Stays at its position among the voices in use
+        index = steal();
+        ++m_stolen;
+    }
+
+    m_ages[index] = m_allocations++;
+    return index;
+}
+
+void VoicePool::release(unsigned index)
+{
+    const uint16_t position = m_positions[index];
+    const uint16_t last = m_active.back();
+
+    m_active[position] = last;
+    m_positions[last] = position;
+    m_active.pop_back();
+    m_free.push_back(uint16_t(index));
+}
+
+unsigned VoicePool::steal() const
+{
+    unsigned best = m_active[0];
+
+    for (uint16_t index : m_active)
+    {
+        if (m_policy == StealPolicy::oldest)
+        {
+            const bool released = stages[index] == EnvelopeStage::release;
+            const bool best_released = stages[best] == EnvelopeStage::release;
+
+            if (released != best_released ? released : m_ages[index] < m_ages[best])
+            {
+                best = index;
+            }
+        }
+        else
+        {
+            const float level = envelopes[index] * velocities[index];
+            const float best_level = envelopes[best] * velocities[best];
+
+            if (level < best_level || (level == best_level && m_ages[index] < m_ages[best]))
+            {
+                best = index;
+            }
+        }
+    }
+
+    return best;
+}
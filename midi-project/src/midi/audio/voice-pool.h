@@ -0,0 +1,118 @@
+#ifndef VOICE_POOL_H
+#define VOICE_POOL_H
+
+#include <cstdint>
+#include <vector>
+
+
+namespace audio
+{
+    enum class Waveform : uint8_t
+    {
+        sine,
+        triangle,
+        saw,
+        square,
+        noise
+    };
+
+    enum class EnvelopeStage : uint8_t
+    {
+        attack,
+        decay,
+        sustain,
+        release
+    };
+
+    /// <summary>
+    /// Which voice to take over when a note starts while all voices are in use.
+    /// </summary>
+    enum class StealPolicy : uint8_t
+    {
+        /// <summary>
+        /// Drop the new note.
+        /// </summary>
+        none,
+        /// <summary>
+        /// The voice that started first, preferring voices that are already being released.
+        /// </summary>
+        oldest,
+        /// <summary>
+        /// The voice with the lowest envelope times velocity; the oldest of those on a tie.
+        /// </summary>
+        quietest
+    };
+
+    /// <summary>
+    /// A fixed number of voices, stored column-wise: the i-th voice is made up of
+    /// the i-th element of each column. Allocating and releasing a voice take constant time
+    /// and never allocate memory; only stealing scans the voices in use.
+    /// </summary>
+    class VoicePool final
+    {
+    public:
+        static const unsigned NONE = ~0u;
+
+        std::vector<uint8_t> channels;
+        std::vector<uint8_t> notes;
+        std::vector<Waveform> waveforms;
+        std::vector<EnvelopeStage> stages;
+        // Held by the sustain pedal after its note off
+        std::vector<uint8_t> sustained;
+        std::vector<float> velocities;
+        // See VOICE_LANES for the meaning of the envelope columns
+        std::vector<float> envelopes;
+        std::vector<float> envelope_rates;
+        std::vector<float> envelope_targets;
+        std::vector<float> decay_rates;
+        std::vector<float> sustain_levels;
+        // Phase and phase increment per sample, fixed point: 2^32 is one cycle
+        std::vector<uint32_t> phases;
+        std::vector<uint32_t> increments;
+        std::vector<uint32_t> noise;
+
+        VoicePool(unsigned capacity, StealPolicy policy = StealPolicy::oldest);
+
+        unsigned capacity() const { return m_capacity; }
+        StealPolicy policy() const { return m_policy; }
+
+        /// <summary>
+        /// Number of voices in use.
+        /// </summary>
+        unsigned size() const { return unsigned(m_active.size()); }
+
+        /// <summary>
+        /// Index of the <paramref name="i" />-th voice in use. Releasing a voice moves the last one in its place.
+        /// </summary>
+        unsigned operator [](unsigned i) const { return m_active[i]; }
+
+        /// <summary>
+        /// Index of a voice for a new note, which the caller must initialize. If all voices are in use,
+        /// one is stolen according to the policy, or NONE is returned if the policy is StealPolicy::none.
+        /// </summary>
+        unsigned allocate();
+
+        void release(unsigned index);
+
+        /// <summary>
+        /// Number of voices that have been stolen so far.
+        /// </summary>
+        uint64_t stolen() const { return m_stolen; }
+
+    private:
+        unsigned m_capacity;
+        StealPolicy m_policy;
+        std::vector<uint16_t> m_free;
+        std::vector<uint16_t> m_active;
+        // Position of each voice in m_active
+        std::vector<uint16_t> m_positions;
+        // When each voice was allocated, to find the oldest
+        std::vector<uint64_t> m_ages;
+        uint64_t m_allocations;
+        uint64_t m_stolen;
+
+        unsigned steal() const;
+    };
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "audio/wav-writer.h"
+#include "logging.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define X86_CONVERSION
+#include <emmintrin.h>
+#endif
+
+
+using namespace audio;
+
+
+namespace
+{
+    const size_t BUFFER_SIZE = size_t(1) << 20;
+
+#   pragma pack(push, r1, 1)
+    struct RIFF_HEADER
+    {
+        char riff[4];
+        uint32_t size;      /* Size of the file minus 8 */
+        char wave[4];
+    };
+
+    struct CHUNK_HEADER
+    {
+        char id[4];
+        uint32_t size;
+    };
+
+    struct FORMAT
+    {
+        uint16_t format_tag;      /* 1 for PCM, 3 for IEEE float */
+        uint16_t channels;
+        uint32_t sample_rate;
+        uint32_t bytes_per_second;
+        uint16_t block_align;     /* Bytes per frame */
+        uint16_t bits_per_sample;
+        uint16_t extension_size;  /* Only for formats other than PCM; always 0 */
+    };
+
+    // For float data: the fmt chunk has the extension size, and a fact chunk with the number of frames follows
+    struct WAV_HEADER
+    {
+        RIFF_HEADER riff;
+        CHUNK_HEADER format_header;
+        FORMAT format;
+        CHUNK_HEADER fact_header;
+        uint32_t frames;
+        CHUNK_HEADER data_header;
+    };
+#   pragma pack(pop, r1)
+
+    // PCM headers leave out the format's extension size and the fact chunk
+    const size_t PCM_HEADER_SIZE = sizeof(RIFF_HEADER) + sizeof(CHUNK_HEADER) + 16 + sizeof(CHUNK_HEADER);
+    const size_t FLOAT_HEADER_SIZE = sizeof(WAV_HEADER);
+
+    size_t bytes_per_sample(SampleFormat format)
+    {
+        return format == SampleFormat::pcm16 ? 2 : 4;
+    }
+
+    // Everything of the header in front of the samples, with the given sizes
+    size_t build_header(uint8_t* out, SampleFormat format, unsigned sample_rate, unsigned channels, uint64_t frames, bool known)
+    {
+        const uint32_t block_align = uint32_t(channels * bytes_per_sample(format));
+        const uint64_t data_size = frames * block_align;
+        const uint32_t unknown = std::numeric_limits<uint32_t>::max();
+        const bool pcm = format == SampleFormat::pcm16;
+        const size_t header_size = pcm ? PCM_HEADER_SIZE : FLOAT_HEADER_SIZE;
+
+        WAV_HEADER header;
+        memcpy(header.riff.riff, "RIFF", 4);
+        header.riff.size = known ? uint32_t(header_size - 8 + data_size) : unknown;
+        memcpy(header.riff.wave, "WAVE", 4);
+        memcpy(header.format_header.id, "fmt ", 4);
+        header.format_header.size = pcm ? 16 : 18;
+        header.format.format_tag = pcm ? 1 : 3;
+        header.format.channels = uint16_t(channels);
+        header.format.sample_rate = sample_rate;
+        header.format.bytes_per_second = sample_rate * block_align;
+        header.format.block_align = uint16_t(block_align);
+        header.format.bits_per_sample = uint16_t(8 * bytes_per_sample(format));
+        header.format.extension_size = 0;
+        memcpy(header.fact_header.id, "fact", 4);
+        header.fact_header.size = 4;
+        header.frames = known ? uint32_t(frames) : unknown;
+        memcpy(header.data_header.id, "data", 4);
+        header.data_header.size = known ? uint32_t(data_size) : unknown;
+
+        if (pcm)
+        {
+            // RIFF header and fmt chunk without the extension size, then straight on to data
+            const size_t format_end = sizeof(RIFF_HEADER) + sizeof(CHUNK_HEADER) + 16;
+            memcpy(out, &header, format_end);
+            memcpy(out + format_end, &header.data_header, sizeof(CHUNK_HEADER));
+        }
+        else
+        {
+            memcpy(out, &header, sizeof(header));
+        }
+
+        return header_size;
+    }
+
+    int16_t to_pcm16(float sample)
+    {
+        // Same comparisons as maxps and minps, so that NaN ends up at -1 like in the vectorized loop
+        sample = sample > -1.0f ? sample : -1.0f;
+        sample = sample < 1.0f ? sample : 1.0f;
+        return int16_t(std::lrint(sample * 32767.0f));
+    }
+}
+
+void audio::convert_to_pcm16(const float* samples, int16_t* out, size_t count)
+{
+    size_t i = 0;
+
+#ifdef X86_CONVERSION
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+
+    // 8 samples at a time: clamp, scale, round to nearest and pack
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), low), high);
+        const __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i + 4), low), high);
+        const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#endif
+
+    for (; i != count; ++i)
+    {
+        out[i] = to_pcm16(samples[i]);
+    }
+}
+
+WavWriter::WavWriter(const std::string& path, unsigned sample_rate, unsigned channels, SampleFormat format)
+    : m_buffer(BufferPool::shared().borrow(BUFFER_SIZE)), m_out(m_file),
+      m_sample_rate(sample_rate), m_channels(channels), m_format(format), m_used(0), m_frames(0), m_closed(false)
+{
+    m_file.open(path, std::ios::binary);
+    CHECK(m_file) << "Could not create " << path;
+
+    write_header();
+}
+
+WavWriter::WavWriter(std::ostream& out, unsigned sample_rate, unsigned channels, SampleFormat format)
+    : m_buffer(BufferPool::shared().borrow(BUFFER_SIZE)), m_out(out),
+      m_sample_rate(sample_rate), m_channels(channels), m_format(format), m_used(0), m_frames(0), m_closed(false)
+{
+    write_header();
+}
+
+WavWriter::~WavWriter()
+{
+    if (!m_closed)
+    {
+        close();
+    }
+}
+
+void WavWriter::write_header()
+{
+    CHECK(m_channels > 0 && m_channels <= 0xFFFF) << "Invalid number of channels " << m_channels;
+    CHECK(m_sample_rate > 0) << "Sample rate must be positive";
+
+    m_start = m_out.tellp();
+
+    uint8_t header[sizeof(WAV_HEADER)];
+    const size_t size = build_header(header, m_format, m_sample_rate, m_channels, 0, false);
+    m_out.write(reinterpret_cast<const char*>(header), std::streamsize(size));
+}
+
+void WavWriter::write(const float* samples, size_t frames)
+{
+    CHECK(!m_closed) << "WAV file has been closed";
+
+    const size_t sample_size = bytes_per_sample(m_format);
+    const size_t header_size = m_format == SampleFormat::pcm16 ? PCM_HEADER_SIZE : FLOAT_HEADER_SIZE;
+    size_t remaining = frames * m_channels;
+
+    m_frames += frames;
+    CHECK(header_size - 8 + m_frames * m_channels * sample_size <= std::numeric_limits<uint32_t>::max()) << "Audio is too long for a WAV file";
+
+    while (remaining != 0)
+    {
+        // Whole samples that fit in the rest of the buffer
+        const size_t count = std::min(remaining, (m_buffer.capacity() - m_used) / sample_size);
+        uint8_t* destination = m_buffer.data() + m_used;
+
+        if (m_format == SampleFormat::pcm16)
+        {
+            convert_to_pcm16(samples, reinterpret_cast<int16_t*>(destination), count);
+        }
+        else
+        {
+            memcpy(destination, samples, count * sizeof(float));
+        }
+
+        samples += count;
+        remaining -= count;
+        m_used += count * sample_size;
+
+        if (m_buffer.capacity() - m_used < sample_size)
+        {
+            flush_buffer();
+        }
+    }
+}
+
+void WavWriter::flush_buffer()
+{
+    m_out.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(m_used));
+    m_used = 0;
+
+    CHECK(m_out) << "Could not write WAV data";
+}
+
+void WavWriter::close()
+{
+    CHECK(!m_closed) << "WAV file has already been closed";
+    m_closed = true;
+
+    flush_buffer();
+
+    if (m_start != std::streampos(-1))
+    {
+        const std::streampos end = m_out.tellp();
+        uint8_t header[sizeof(WAV_HEADER)];
+        const size_t size = build_header(header, m_format, m_sample_rate, m_channels, m_frames, true);
+
+        m_out.seekp(m_start);
+        m_out.write(reinterpret_cast<const char*>(header), std::streamsize(size));
+        m_out.seekp(end);
+    }
+
+    m_out.flush();
+    CHECK(m_out) << "Could not write WAV header";
+
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include "util/buffer-pool.h"
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+
+namespace audio
+{
+    enum class SampleFormat : uint8_t
+    {
+        pcm16,
+        float32
+    };
+
+    /// <summary>
+    /// Converts <paramref name="count" /> samples to 16-bit PCM: clamped to [-1, 1],
+    /// scaled by 32767 and rounded to the nearest integer, ties to even. NaN becomes -32767.
+    /// </summary>
+    void convert_to_pcm16(const float* samples, int16_t* out, size_t count);
+
+    /// <summary>
+    /// Writes a WAV file while it is being rendered, without holding it in memory.
+    /// The header is written up front with empty sizes, which close() fills in.
+    /// Samples are converted into a large buffer that is written out whenever it is full.
+    /// </summary>
+    class WavWriter final
+    {
+    public:
+        /// <summary>
+        /// Creates the file at <paramref name="path" />.
+        /// </summary>
+        WavWriter(const std::string& path, unsigned sample_rate, unsigned channels = 2, SampleFormat format = SampleFormat::pcm16);
+
+        /// <summary>
+        /// Writes to <paramref name="out" />. Sizes can only be filled in if the stream supports seeking;
+        /// otherwise they are left at their maximum, which most readers take as "until the end".
+        /// </summary>
+        WavWriter(std::ostream& out, unsigned sample_rate, unsigned channels = 2, SampleFormat format = SampleFormat::pcm16);
+
+        /// <summary>
+        /// Closes the file if close() has not been called.
+        /// </summary>
+        ~WavWriter();
+
+        WavWriter(const WavWriter&) = delete;
+        WavWriter& operator =(const WavWriter&) = delete;
+
+        /// <summary>
+        /// Appends <paramref name="frames" /> frames of interleaved samples in [-1, 1].
+        /// </summary>
+        void write(const float* samples, size_t frames);
+
+        /// <summary>
+        /// Writes out the buffer and fills in the sizes in the header.
+        /// </summary>
+        void close();
+
+        uint64_t frames() const { return m_frames; }
+
+    private:
+        void write_header();
+        void flush_buffer();
+
+        BufferPool::Buffer m_buffer;
+        std::ofstream m_file;
+        std::ostream& m_out;
+        unsigned m_sample_rate;
+        unsigned m_channels;
+        SampleFormat m_format;
+        std::streampos m_start;
+        size_t m_used;
+        uint64_t m_frames;
+        bool m_closed;
+    };
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "imaging/bitmap.h"
 #include "util/array.h"
+#include "util/buffer-pool.h"
 #include "logging.h"
 #include <algorithm>
 #include <assert.h>
@@ -12,6 +13,16 @@
 
 using namespace imaging;
 
+
+namespace
+{
+    // The 8-bit channels the encoders write for c, so that pixels that end up the same on disk compare equal
+    uint32_t to_rgb8(const Color& c)
+    {
+        return uint32_t(uint8_t(c.r * 255)) << 16 | uint32_t(uint8_t(c.g * 255)) << 8 | uint8_t(c.b * 255);
+    }
+}
+
 Bitmap::Bitmap(std::shared_ptr<Grid<Color>> pixels)
     : m_pixels(pixels)
 {
@@ -59,11 +70,16 @@ const Color& Bitmap::operator[](const Position& p) const
     return (*m_pixels)[p];
 }
 
+void Bitmap::read_row(const Position& p, unsigned count, Color* out) const
+{
+    assert(count == 0 || is_inside(Position(p.x + count - 1, p.y)));
+
+    m_pixels->read_row(p, count, out);
+}
+
 void Bitmap::clear(const Color& Color)
 {
-    for_each_position([this, &Color](const Position& p) {
-        (*m_pixels)[p] = Color;
-    });
+    m_pixels->fill(Color);
 }
 
 void Bitmap::for_each_position(std::function<void(const Position&)> callback) const
@@ -76,4 +92,57 @@ std::shared_ptr<Bitmap> Bitmap::slice(int x, int y, int width, int height) const
     auto sg = subgrid(m_pixels, Position(x, y), width, height);
 
     return std::shared_ptr<Bitmap>( new Bitmap(sg) );
-}
\ No newline at end of file
+}
+
+uint64_t imaging::content_hash(const Bitmap& bitmap)
+{
+    const uint64_t prime = 0x100000001B3ULL;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    BufferPool::Buffer buffer = BufferPool::shared().borrow(sizeof(Color) * bitmap.width());
+    Color* row = buffer.as<Color>();
+
+    hash = (hash ^ bitmap.width()) * prime;
+    hash = (hash ^ bitmap.height()) * prime;
+
+    for (unsigned y = 0; y != bitmap.height(); ++y)
+    {
+        bitmap.read_row(Position(0, y), bitmap.width(), row);
+
+        // A pixel is hashed as one word rather than byte by byte
+        for (unsigned x = 0; x != bitmap.width(); ++x)
+        {
+            hash = (hash ^ to_rgb8(row[x])) * prime;
+        }
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+bool imaging::same_pixels(const Bitmap& a, const Bitmap& b)
+{
+    if (a.width() != b.width() || a.height() != b.height())
+    {
+        return false;
+    }
+
+    BufferPool::Buffer buffer_a = BufferPool::shared().borrow(sizeof(Color) * a.width());
+    BufferPool::Buffer buffer_b = BufferPool::shared().borrow(sizeof(Color) * b.width());
+    Color* row_a = buffer_a.as<Color>();
+    Color* row_b = buffer_b.as<Color>();
+
+    for (unsigned y = 0; y != a.height(); ++y)
+    {
+        a.read_row(Position(0, y), a.width(), row_a);
+        b.read_row(Position(0, y), b.width(), row_b);
+
+        for (unsigned x = 0; x != a.width(); ++x)
+        {
+            if (to_rgb8(row_a[x]) != to_rgb8(row_b[x]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
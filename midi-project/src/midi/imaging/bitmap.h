@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 #include <functional>
+#include <cstdint>
 
 
 namespace imaging
@@ -24,6 +25,12 @@ namespace imaging
         /// </summary>
         Bitmap(unsigned width, unsigned height);
 
+        /// <summary>
+        /// Creates a bitmap backed by the given <paramref name="pixels" />,
+        /// e.g. a TiledGrid for large, mostly empty bitmaps.
+        /// </summary>
+        Bitmap(std::shared_ptr<Grid<Color>> pixels);
+
         /// <summary>
         /// Copy constructor.
         /// </summary>
@@ -44,6 +51,13 @@ namespace imaging
         /// </summary>
         const Color& operator [](const Position&) const;
 
+        /// <summary>
+        /// Copies <paramref name="count" /> pixels of row <paramref name="position" />.y,
+        /// starting at column <paramref name="position" />.x, to <paramref name="out" />.
+        /// Much faster than reading them one by one.
+        /// </summary>
+        void read_row(const Position& position, unsigned count, Color* out) const;
+
         /// <summary>
         /// Returns the width of the bitmap.
         /// </summary>
@@ -69,10 +83,20 @@ namespace imaging
         std::shared_ptr<Bitmap> slice(int x, int y, int width, int height) const;
 
     private:
-        Bitmap(std::shared_ptr<Grid<Color>> pixels);
-
         std::shared_ptr<Grid<Color>> m_pixels;
     };
+
+    /// <summary>
+    /// Hash of the dimensions and pixels of <paramref name="bitmap" />, with each channel
+    /// reduced to the 8 bits that the encoders write. Bitmaps with equal pixels have equal hashes.
+    /// </summary>
+    uint64_t content_hash(const Bitmap& bitmap);
+
+    /// <summary>
+    /// Checks whether both bitmaps have the same dimensions, and pixels that are the same
+    /// once reduced to 8 bits per channel.
+    /// </summary>
+    bool same_pixels(const Bitmap& a, const Bitmap& b);
 }
 
 #endif
@@ -6,6 +6,10 @@
 #include <iostream>
 #include <stdlib.h>
 #include <cstring>
+#include <limits>
+#include <vector>
+#include "util/buffer-pool.h"
+#include "logging.h"
 
 
 using namespace imaging;
@@ -90,6 +94,203 @@ namespace
 
         return ARGB{ b, g, r, a };
     }
+
+    bool same_color(const Color& a, const Color& b)
+    {
+        return a.r == b.r && a.g == b.g && a.b == b.b;
+    }
+
+    uint32_t to_key(const ARGB& argb)
+    {
+        return uint32_t(argb.a) << 24 | uint32_t(argb.r) << 16 | uint32_t(argb.g) << 8 | argb.b;
+    }
+
+    // Maps colors to palette indices, remembering the last lookup since
+    // consecutive pixels usually have the same color.
+    // Palettes are small, so a linear search on a color change is cheap and needs no allocation.
+    class PaletteIndex
+    {
+    public:
+        PaletteIndex() : m_size(0), m_last_key(0), m_last_index(0), m_has_last(false) { }
+
+        bool contains(uint32_t key) const
+        {
+            return find(key) != m_size;
+        }
+
+        void add(const ARGB& argb)
+        {
+            assert(m_size < 256);
+
+            m_keys[m_size] = to_key(argb);
+            m_entries[m_size] = argb;
+            ++m_size;
+        }
+
+        uint8_t operator [](const Color& color)
+        {
+            uint32_t key = to_key(to_argb(color));
+
+            if (!m_has_last || key != m_last_key)
+            {
+                const unsigned index = find(key);
+                CHECK(index != m_size) << "Color " << color << " is not in the palette";
+
+                m_last_key = key;
+                m_last_index = uint8_t(index);
+                m_has_last = true;
+            }
+
+            return m_last_index;
+        }
+
+        const ARGB* entries() const
+        {
+            return m_entries;
+        }
+
+        unsigned size() const
+        {
+            return m_size;
+        }
+
+    private:
+        unsigned find(uint32_t key) const
+        {
+            // Keys are unique, since add() is only called for keys that are not there yet
+            for (unsigned i = m_size; i != 0; --i)
+            {
+                if (m_keys[i - 1] == key)
+                {
+                    return i - 1;
+                }
+            }
+
+            return m_size;
+        }
+
+        uint32_t m_keys[256];
+        ARGB m_entries[256];
+        unsigned m_size;
+        uint32_t m_last_key;
+        uint8_t m_last_index;
+        bool m_has_last;
+    };
+
+    void fill_header(BITMAP_FILE_V5& header, const Bitmap& bitmap)
+    {
+        memset(&header, 0, sizeof(header));
+
+        header.file_header.FileType = 0x4D42;
+        header.file_header.Reserved1 = 0;
+        header.file_header.Reserved2 = 0;
+
+        header.bitmap_header.Size = sizeof(BITMAP_HEADER_V5);
+        header.bitmap_header.Width = bitmap.width();
+        header.bitmap_header.Height = bitmap.height();
+        header.bitmap_header.Planes = 1;
+        header.bitmap_header.HorzResolution = 3779;
+        header.bitmap_header.VertResolution = 3779;
+        header.bitmap_header.CSType = 0x73524742;
+        header.bitmap_header.Intent = 4;
+    }
+
+    // Converts row y to palette indices
+    void index_row(const Bitmap& bitmap, unsigned y, PaletteIndex& palette, Color* colors, uint8_t* row)
+    {
+        bitmap.read_row(Position(0, y), bitmap.width(), colors);
+
+        for (unsigned x = 0; x < bitmap.width(); ++x)
+        {
+            row[x] = x != 0 && same_color(colors[x], colors[x - 1]) ? row[x - 1] : palette[colors[x]];
+        }
+    }
+
+    // RLE8 in encoded mode only: every run becomes a (count, index) pair.
+    // Piano rolls consist of long runs, so absolute mode would rarely pay off.
+    // Writes at most 2 * width + 2 bytes to out and returns how many.
+    size_t compress_row(const uint8_t* row, unsigned width, uint8_t* out)
+    {
+        size_t size = 0;
+
+        for (unsigned x = 0; x < width; )
+        {
+            unsigned run = 1;
+
+            while (x + run < width && run < 255 && row[x + run] == row[x])
+            {
+                ++run;
+            }
+
+            out[size++] = uint8_t(run);
+            out[size++] = row[x];
+            x += run;
+        }
+
+        // End of line
+        out[size++] = 0;
+        out[size++] = 0;
+
+        return size;
+    }
+
+    void write_indexed_bmp(std::ostream& out, const Bitmap& bitmap, PaletteIndex& palette, bool rle)
+    {
+        const unsigned stride = (bitmap.width() + 3) & ~3u;
+        const size_t max_size = rle ? (2 * size_t(bitmap.width()) + 2) * bitmap.height() + 2 : size_t(stride) * bitmap.height();
+        BufferPool::Buffer pixels = BufferPool::shared().borrow(max_size);
+        BufferPool::Buffer row = BufferPool::shared().borrow(stride);
+        BufferPool::Buffer colors = BufferPool::shared().borrow(sizeof(Color) * bitmap.width());
+        size_t size = 0;
+
+        for (int y = bitmap.height() - 1; y >= 0; --y)
+        {
+            index_row(bitmap, y, palette, colors.as<Color>(), row.data());
+
+            if (rle)
+            {
+                size += compress_row(row.data(), bitmap.width(), pixels.data() + size);
+            }
+            else
+            {
+                std::fill(row.data() + bitmap.width(), row.data() + stride, uint8_t(0));
+                std::copy(row.data(), row.data() + stride, pixels.data() + size);
+                size += stride;
+            }
+        }
+
+        if (rle)
+        {
+            // End of bitmap
+            pixels.data()[size++] = 0;
+            pixels.data()[size++] = 1;
+        }
+
+        const uint32_t palette_size = uint32_t(sizeof(ARGB) * palette.size());
+        const uint64_t file_size = sizeof(BITMAP_FILE_V5) + palette_size + uint64_t(size);
+        CHECK(file_size <= std::numeric_limits<uint32_t>::max()) << "Bitmap of " << bitmap.width() << "x" << bitmap.height() << " is too large for BMP";
+
+        BITMAP_FILE_V5 header;
+        fill_header(header, bitmap);
+        header.file_header.FileSize = uint32_t(file_size);
+        header.file_header.BitmapOffset = sizeof(BITMAP_FILE_V5) + palette_size;
+        header.bitmap_header.BitsPerPixel = 8;
+        header.bitmap_header.Compression = rle ? 1 : 0;
+        header.bitmap_header.SizeOfBitmap = uint32_t(size);
+        header.bitmap_header.ColorsUsed = palette.size();
+
+        // Palette entries are stored as B, G, R, 0
+        ARGB entries[256];
+        std::copy(palette.entries(), palette.entries() + palette.size(), entries);
+        for (unsigned i = 0; i != palette.size(); ++i)
+        {
+            entries[i].a = 0;
+        }
+
+        out.write(reinterpret_cast<char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries), palette_size);
+        out.write(reinterpret_cast<const char*>(pixels.data()), size);
+    }
 }
 
 void imaging::save_as_bmp(const std::string& path, const Bitmap& bitmap)
@@ -100,46 +301,98 @@ void imaging::save_as_bmp(const std::string& path, const Bitmap& bitmap)
 
 void imaging::save_as_bmp(std::ostream& out, const Bitmap& bitmap)
 {
-    BITMAP_FILE_V5 header;
-    memset(&header, 0, sizeof(header));
+    const uint64_t file_size = sizeof(BITMAP_FILE_V5) + 4 * uint64_t(bitmap.width()) * bitmap.height();
+    CHECK(file_size <= std::numeric_limits<uint32_t>::max()) << "Bitmap of " << bitmap.width() << "x" << bitmap.height() << " is too large for BMP";
 
-    header.file_header.FileType = 0x4D42;
-    header.file_header.FileSize = sizeof(BITMAP_FILE_V5) + 4 * bitmap.width() * bitmap.height();
-    header.file_header.Reserved1 = 0;
-    header.file_header.Reserved2 = 0;
+    BITMAP_FILE_V5 header;
+    fill_header(header, bitmap);
+    header.file_header.FileSize = uint32_t(file_size);
     header.file_header.BitmapOffset = sizeof(BITMAP_FILE_V5);
-
-    header.bitmap_header.Size = sizeof(BITMAP_HEADER_V5);
-    header.bitmap_header.Width = bitmap.width();
-    header.bitmap_header.Height = bitmap.height();
-    header.bitmap_header.Planes = 1;
     header.bitmap_header.BitsPerPixel = 32;
     header.bitmap_header.Compression = 0;
     header.bitmap_header.SizeOfBitmap = 0;
-    header.bitmap_header.HorzResolution = 3779;
-    header.bitmap_header.VertResolution = 3779;
-    header.bitmap_header.ColorsUsed = 0;
-    header.bitmap_header.ColorsImportant = 0;
     header.bitmap_header.RedMask = 0x00FF0000;
     header.bitmap_header.GreenMask = 0x0000FF00;
     header.bitmap_header.BlueMask = 0x000000FF;
     header.bitmap_header.AlphaMask = 0xFF000000;
-    header.bitmap_header.CSType = 0x73524742;
-    header.bitmap_header.Intent = 4;
-    
+
     out.write(reinterpret_cast<char*>(&header), sizeof(header));
 
-    std::unique_ptr<ARGB[]> scanline = std::make_unique<ARGB[]>(bitmap.width());
+    BufferPool::Buffer scanline_buffer = BufferPool::shared().borrow(sizeof(ARGB) * bitmap.width());
+    BufferPool::Buffer row_buffer = BufferPool::shared().borrow(sizeof(Color) * bitmap.width());
+    ARGB* scanline = scanline_buffer.as<ARGB>();
+    Color* row = row_buffer.as<Color>();
 
     for (int y = bitmap.height() - 1; y >= 0; --y)
     {
+        bitmap.read_row(Position(0, y), bitmap.width(), row);
+
+        for (unsigned x = 0; x < bitmap.width(); ++x)
+        {
+            // Most pixels have the same color as their left neighbour
+            scanline[x] = x != 0 && same_color(row[x], row[x - 1]) ? scanline[x - 1] : to_argb(row[x]);
+        }
+
+        out.write(reinterpret_cast<char*>(scanline), sizeof(ARGB) * bitmap.width());
+    }
+}
+
+void imaging::save_as_indexed_bmp(const std::string& path, const Bitmap& bitmap, bool rle)
+{
+    std::ofstream out(path, std::ios::binary);
+    save_as_indexed_bmp(out, bitmap, rle);
+}
+
+void imaging::save_as_indexed_bmp(std::ostream& out, const Bitmap& bitmap, bool rle)
+{
+    PaletteIndex palette;
+    BufferPool::Buffer buffer = BufferPool::shared().borrow(sizeof(Color) * bitmap.width());
+    Color* colors = buffer.as<Color>();
+
+    for (unsigned y = 0; y != bitmap.height(); ++y)
+    {
+        bitmap.read_row(Position(0, y), bitmap.width(), colors);
+
         for (unsigned x = 0; x < bitmap.width(); ++x)
         {
-            Position pos(x, y);
+            if (x != 0 && same_color(colors[x], colors[x - 1]))
+            {
+                continue;
+            }
+
+            ARGB argb = to_argb(colors[x]);
 
-            scanline[x] = to_argb(bitmap[pos]);
+            if (!palette.contains(to_key(argb)))
+            {
+                CHECK(palette.size() < 256) << "Bitmap has more than 256 colors";
+                palette.add(argb);
+            }
         }
+    }
+
+    write_indexed_bmp(out, bitmap, palette, rle);
+}
+
+void imaging::save_as_indexed_bmp(const std::string& path, const Bitmap& bitmap, const std::vector<Color>& colors, bool rle)
+{
+    std::ofstream out(path, std::ios::binary);
+    save_as_indexed_bmp(out, bitmap, colors, rle);
+}
 
-        out.write(reinterpret_cast<char*>(scanline.get()), sizeof(ARGB) * bitmap.width());
+void imaging::save_as_indexed_bmp(std::ostream& out, const Bitmap& bitmap, const std::vector<Color>& colors, bool rle)
+{
+    CHECK(colors.size() <= 256) << "Palette has more than 256 colors";
+
+    PaletteIndex palette;
+    for (const Color& color : colors)
+    {
+        // Colors that come out the same in 8 bits share an entry
+        const ARGB argb = to_argb(color);
+        if (!palette.contains(to_key(argb)))
+        {
+            palette.add(argb);
+        }
     }
+
+    write_indexed_bmp(out, bitmap, palette, rle);
 }
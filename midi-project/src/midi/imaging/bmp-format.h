@@ -2,12 +2,22 @@
 #define BMP_FORMAT_H
 
 #include "imaging/bitmap.h"
+#include <vector>
 
 
 namespace imaging
 {
     void save_as_bmp(const std::string& path, const Bitmap& bitmap);
     void save_as_bmp(std::ostream& out, const Bitmap& bitmap);
+
+    // 8-bit palette-indexed BMP, optionally RLE8-compressed.
+    // The palette is built from the bitmap itself, which may hold at most 256 distinct colors.
+    void save_as_indexed_bmp(const std::string& path, const Bitmap& bitmap, bool rle);
+    void save_as_indexed_bmp(std::ostream& out, const Bitmap& bitmap, bool rle);
+
+    // Same, with a known palette; every pixel must appear in it.
+    void save_as_indexed_bmp(const std::string& path, const Bitmap& bitmap, const std::vector<Color>& palette, bool rle);
+    void save_as_indexed_bmp(std::ostream& out, const Bitmap& bitmap, const std::vector<Color>& palette, bool rle);
 }
 
 #endif
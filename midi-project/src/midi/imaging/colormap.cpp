@@ -0,0 +1,36 @@
+#include "imaging/colormap.h"
+#include "logging.h"
+#include <algorithm>
+
+
+using namespace imaging;
+
+
+Colormap::Colormap(const std::vector<Color>& stops)
+{
+    CHECK(stops.size() >= 2) << "A colormap needs at least two stops";
+
+    const unsigned segments = unsigned(stops.size() - 1);
+    m_colors.reserve(256);
+
+    for (unsigned level = 0; level != 256; ++level)
+    {
+        // Position in stops, from 0 to segments
+        const double position = level * double(segments) / 255;
+        const unsigned segment = std::min(unsigned(position), segments - 1);
+        const double t = position - segment;
+
+        m_colors.push_back(stops[segment] * (1 - t) + stops[segment + 1] * t);
+    }
+}
+
+Colormap Colormap::heat()
+{
+    return Colormap({
+        colors::black(),
+        Color(0.25, 0.0, 0.45),
+        Color(0.75, 0.1, 0.35),
+        Color(1.0, 0.45, 0.0),
+        Color(1.0, 0.85, 0.2),
+        colors::white() });
+}
@@ -0,0 +1,40 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include "imaging/color.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Lookup table of 256 colors, interpolated linearly between evenly spaced stops.
+    /// Looking up a level is a single array access.
+    /// </summary>
+    class Colormap final
+    {
+    public:
+        /// <summary>
+        /// The first stop is level 0, the last one level 255. At least two stops are needed.
+        /// </summary>
+        Colormap(const std::vector<Color>& stops);
+
+        const Color& operator [](uint8_t level) const { return m_colors[level]; }
+
+        /// <summary>
+        /// All 256 colors, e.g. as the palette of an indexed bitmap.
+        /// </summary>
+        const std::vector<Color>& colors() const { return m_colors; }
+
+        /// <summary>
+        /// Black through purple, red and orange to white, for intensities such as a spectrogram's.
+        /// </summary>
+        static Colormap heat();
+
+    private:
+        std::vector<Color> m_colors;
+    };
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include "imaging/qoi-format.h"
+#include "util/buffer-pool.h"
+#include "logging.h"
+#include <assert.h>
+#include <stdint.h>
+#include <fstream>
+#include <cstring>
+#include <vector>
+
+
+using namespace imaging;
+
+namespace
+{
+    const uint8_t QOI_OP_INDEX = 0x00;
+    const uint8_t QOI_OP_DIFF = 0x40;
+    const uint8_t QOI_OP_LUMA = 0x80;
+    const uint8_t QOI_OP_RUN = 0xC0;
+    const uint8_t QOI_OP_RGB = 0xFE;
+    const uint8_t QOI_OP_RGBA = 0xFF;
+    const uint8_t QOI_MASK = 0xC0;
+
+    const uint8_t QOI_MAGIC[] = { 'q', 'o', 'i', 'f' };
+    const uint8_t QOI_END[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    const unsigned QOI_MAX_RUN = 62;
+
+    struct RGBA
+    {
+        uint8_t r, g, b, a;
+
+        bool operator ==(const RGBA& other) const
+        {
+            return r == other.r && g == other.g && b == other.b && a == other.a;
+        }
+
+        bool operator !=(const RGBA& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    RGBA to_rgba(const Color& c)
+    {
+        return RGBA{ uint8_t(c.r * 255), uint8_t(c.g * 255), uint8_t(c.b * 255), 255 };
+    }
+
+    unsigned hash(const RGBA& px)
+    {
+        return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+    }
+
+    // Output is flushed once this much has been collected
+    const size_t FLUSH_SIZE = size_t(1) << 16;
+
+    class Encoder
+    {
+    public:
+        // A row of width pixels encodes to at most 5 bytes per pixel, plus one run byte
+        // for every 62 pixels; the buffer holds a full flush block plus one such row
+        Encoder(std::ostream& out, unsigned width)
+            : m_out(out), m_buffer(BufferPool::shared().borrow(FLUSH_SIZE + 6 * size_t(width) + 64)), m_size(0),
+              m_previous{ 0, 0, 0, 255 }, m_run(0)
+        {
+            memset(m_index, 0, sizeof(m_index));
+        }
+
+        // Encodes count copies of px
+        void push(const RGBA& px, unsigned count)
+        {
+            if (px == m_previous)
+            {
+                extend_run(count);
+            }
+            else
+            {
+                flush_run();
+                encode(px);
+                extend_run(count - 1);
+            }
+        }
+
+        void finish()
+        {
+            flush_run();
+            put(QOI_END, sizeof(QOI_END));
+            flush_buffer();
+        }
+
+        // Output is collected in m_buffer and written in large blocks
+        void flush_buffer()
+        {
+            m_out.write(reinterpret_cast<const char*>(m_buffer.data()), m_size);
+            m_size = 0;
+        }
+
+        size_t buffered() const { return m_size; }
+
+        void put(uint8_t byte)
+        {
+            assert(m_size < m_buffer.capacity());
+
+            m_buffer.data()[m_size++] = byte;
+        }
+
+        void put(const uint8_t* bytes, size_t count)
+        {
+            assert(m_size + count <= m_buffer.capacity());
+
+            memcpy(m_buffer.data() + m_size, bytes, count);
+            m_size += count;
+        }
+
+        void put_u32(uint32_t x)
+        {
+            const uint8_t bytes[] = { uint8_t(x >> 24), uint8_t(x >> 16), uint8_t(x >> 8), uint8_t(x) };
+            put(bytes, sizeof(bytes));
+        }
+
+    private:
+        void extend_run(unsigned count)
+        {
+            m_run += count;
+
+            while (m_run >= QOI_MAX_RUN)
+            {
+                put(uint8_t(QOI_OP_RUN | (QOI_MAX_RUN - 1)));
+                m_run -= QOI_MAX_RUN;
+            }
+        }
+
+        void flush_run()
+        {
+            if (m_run != 0)
+            {
+                put(uint8_t(QOI_OP_RUN | (m_run - 1)));
+                m_run = 0;
+            }
+        }
+
+        void encode(const RGBA& px)
+        {
+            const unsigned h = hash(px);
+
+            if (m_index[h] == px)
+            {
+                put(uint8_t(QOI_OP_INDEX | h));
+            }
+            else
+            {
+                m_index[h] = px;
+
+                if (px.a == m_previous.a)
+                {
+                    const int8_t dr = int8_t(px.r - m_previous.r);
+                    const int8_t dg = int8_t(px.g - m_previous.g);
+                    const int8_t db = int8_t(px.b - m_previous.b);
+                    const int8_t dr_dg = int8_t(dr - dg);
+                    const int8_t db_dg = int8_t(db - dg);
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        put(uint8_t(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+                    {
+                        put(uint8_t(QOI_OP_LUMA | (dg + 32)));
+                        put(uint8_t((dr_dg + 8) << 4 | (db_dg + 8)));
+                    }
+                    else
+                    {
+                        const uint8_t bytes[] = { QOI_OP_RGB, px.r, px.g, px.b };
+                        put(bytes, sizeof(bytes));
+                    }
+                }
+                else
+                {
+                    const uint8_t bytes[] = { QOI_OP_RGBA, px.r, px.g, px.b, px.a };
+                    put(bytes, sizeof(bytes));
+                }
+            }
+
+            m_previous = px;
+        }
+
+        std::ostream& m_out;
+        BufferPool::Buffer m_buffer;
+        size_t m_size;
+        RGBA m_index[64];
+        RGBA m_previous;
+        unsigned m_run;
+    };
+}
+
+void imaging::save_as_qoi(const std::string& path, const Bitmap& bitmap)
+{
+    std::ofstream out(path, std::ios::binary);
+    save_as_qoi(out, bitmap);
+}
+
+void imaging::save_as_qoi(std::ostream& out, const Bitmap& bitmap)
+{
+    Encoder encoder(out, bitmap.width());
+
+    encoder.put(QOI_MAGIC, sizeof(QOI_MAGIC));
+    encoder.put_u32(bitmap.width());
+    encoder.put_u32(bitmap.height());
+    encoder.put(3); // Channels
+    encoder.put(0); // sRGB with linear alpha
+
+    BufferPool::Buffer buffer = BufferPool::shared().borrow(sizeof(Color) * bitmap.width());
+    Color* row = buffer.as<Color>();
+
+    for (unsigned y = 0; y != bitmap.height(); ++y)
+    {
+        bitmap.read_row(Position(0, y), bitmap.width(), row);
+
+        // Runs of equal colors are converted and pushed once
+        for (unsigned x = 0; x < bitmap.width(); )
+        {
+            const Color& color = row[x];
+            unsigned run = 1;
+
+            while (x + run < bitmap.width() && row[x + run].r == color.r && row[x + run].g == color.g && row[x + run].b == color.b)
+            {
+                ++run;
+            }
+
+            encoder.push(to_rgba(color), run);
+            x += run;
+        }
+
+        if (encoder.buffered() >= FLUSH_SIZE)
+        {
+            encoder.flush_buffer();
+        }
+    }
+
+    encoder.finish();
+}
+
+Bitmap imaging::load_qoi(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    CHECK(in) << "Could not open " << path;
+
+    return load_qoi(in);
+}
+
+Bitmap imaging::load_qoi(std::istream& in)
+{
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK(data.size() >= 14 + sizeof(QOI_END)) << "QOI data is too short";
+    CHECK(memcmp(data.data(), QOI_MAGIC, sizeof(QOI_MAGIC)) == 0) << "Not a QOI image";
+
+    auto read_u32 = [&data](size_t offset) {
+        return uint32_t(data[offset]) << 24 | uint32_t(data[offset + 1]) << 16 | uint32_t(data[offset + 2]) << 8 | data[offset + 3];
+    };
+    const unsigned width = read_u32(4);
+    const unsigned height = read_u32(8);
+    const size_t end = data.size() - sizeof(QOI_END);
+
+    Bitmap bitmap(width, height);
+    RGBA index[64];
+    memset(index, 0, sizeof(index));
+    RGBA px{ 0, 0, 0, 255 };
+    unsigned run = 0;
+    size_t p = 14;
+
+    for (unsigned y = 0; y != height; ++y)
+    {
+        for (unsigned x = 0; x != width; ++x)
+        {
+            if (run != 0)
+            {
+                --run;
+            }
+            else
+            {
+                CHECK(p < end) << "QOI data is truncated";
+                const uint8_t b1 = data[p++];
+
+                if (b1 == QOI_OP_RGB)
+                {
+                    px.r = data[p++];
+                    px.g = data[p++];
+                    px.b = data[p++];
+                }
+                else if (b1 == QOI_OP_RGBA)
+                {
+                    px.r = data[p++];
+                    px.g = data[p++];
+                    px.b = data[p++];
+                    px.a = data[p++];
+                }
+                else if ((b1 & QOI_MASK) == QOI_OP_INDEX)
+                {
+                    px = index[b1];
+                }
+                else if ((b1 & QOI_MASK) == QOI_OP_DIFF)
+                {
+                    px.r += ((b1 >> 4) & 0x03) - 2;
+                    px.g += ((b1 >> 2) & 0x03) - 2;
+                    px.b += (b1 & 0x03) - 2;
+                }
+                else if ((b1 & QOI_MASK) == QOI_OP_LUMA)
+                {
+                    const uint8_t b2 = data[p++];
+                    const int dg = (b1 & 0x3F) - 32;
+
+                    px.r += dg - 8 + ((b2 >> 4) & 0x0F);
+                    px.g += dg;
+                    px.b += dg - 8 + (b2 & 0x0F);
+                }
+                else
+                {
+                    run = b1 & 0x3F;
+                }
+
+                index[hash(px)] = px;
+            }
+
+            bitmap[Position(x, y)] = Color(px.r / 255.0, px.g / 255.0, px.b / 255.0);
+        }
+    }
+
+    return bitmap;
+}
@@ -0,0 +1,19 @@
+#ifndef QOI_FORMAT_H
+#define QOI_FORMAT_H
+
+#include "imaging/bitmap.h"
+#include <istream>
+
+
+namespace imaging
+{
+    // QOI ("Quite OK Image") format, see https://qoiformat.org/qoi-specification.pdf.
+    // Lossless, encoded in a single pass. Bitmaps are written with 3 channels.
+    void save_as_qoi(const std::string& path, const Bitmap& bitmap);
+    void save_as_qoi(std::ostream& out, const Bitmap& bitmap);
+
+    Bitmap load_qoi(const std::string& path);
+    Bitmap load_qoi(std::istream& in);
+}
+
+#endif
@@ -0,0 +1,276 @@
+#include "io/io-uring.h"
+#include "logging.h"
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+namespace
+{
+	int io_uring_setup(unsigned entries, io_uring_params* params)
+	{
+		return int(syscall(__NR_io_uring_setup, entries, params));
+	}
+
+	int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+	{
+		return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+	}
+
+	int io_uring_register(int fd, unsigned opcode, void* arg, unsigned count)
+	{
+		return int(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+	}
+
+	bool probe()
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		const int fd = io_uring_setup(4, &params);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		const size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+		alignas(io_uring_probe) uint8_t buffer[size];
+		memset(buffer, 0, size);
+		io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer);
+
+		bool supported = io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+		for (uint8_t opcode : { uint8_t(IORING_OP_UNLINKAT), uint8_t(IORING_OP_OPENAT), uint8_t(IORING_OP_WRITE), uint8_t(IORING_OP_CLOSE) })
+		{
+			supported = supported && opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+		}
+
+		::close(fd);
+		return supported;
+	}
+}
+
+bool io::IoUring::supported()
+{
+	static const bool result = probe();
+
+	return result;
+}
+
+io::IoUring::IoUring(unsigned entries)
+	: m_queued(0)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	m_fd = io_uring_setup(entries, &params);
+	CHECK(m_fd >= 0) << "io_uring_setup failed: " << strerror(errno);
+
+	m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	// Since 5.4, both rings share a single mapping
+	const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap)
+	{
+		m_sq_ring_size = m_cq_ring_size = m_sq_ring_size > m_cq_ring_size ? m_sq_ring_size : m_cq_ring_size;
+	}
+
+	m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+	CHECK(m_sq_ring != MAP_FAILED) << "Could not map io_uring submission queue";
+
+	if (single_mmap)
+	{
+		m_cq_ring = m_sq_ring;
+	}
+	else
+	{
+		m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+		CHECK(m_cq_ring != MAP_FAILED) << "Could not map io_uring completion queue";
+	}
+
+	m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+	CHECK(sqes != MAP_FAILED) << "Could not map io_uring submission queue entries";
+	m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+	uint8_t* sq = static_cast<uint8_t*>(m_sq_ring);
+	m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+	m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	m_sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+
+	uint8_t* cq = static_cast<uint8_t*>(m_cq_ring);
+	m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+io::IoUring::~IoUring()
+{
+	munmap(m_sqes, m_sqes_size);
+	if (m_cq_ring != m_sq_ring)
+	{
+		munmap(m_cq_ring, m_cq_ring_size);
+	}
+	munmap(m_sq_ring, m_sq_ring_size);
+	::close(m_fd);
+}
+
+io_uring_sqe* io::IoUring::prepare(uint8_t opcode, uint64_t user_data)
+{
+	// The kernel moves the head as it consumes entries
+	const unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+	const unsigned tail = *m_sq_tail;
+
+	if (tail - head >= m_sq_entries)
+	{
+		return nullptr;
+	}
+
+	const unsigned index = tail & m_sq_mask;
+	io_uring_sqe* sqe = &m_sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->user_data = user_data;
+	m_sq_array[index] = index;
+
+	return sqe;
+}
+
+void io::IoUring::commit()
+{
+	// The kernel may read the entry as soon as it sees the new tail
+	__atomic_store_n(m_sq_tail, *m_sq_tail + 1, __ATOMIC_RELEASE);
+	++m_queued;
+}
+
+bool io::IoUring::queue_open(const char* path, int flags, unsigned mode, uint64_t user_data)
+{
+	io_uring_sqe* sqe = prepare(IORING_OP_OPENAT, user_data);
+	if (sqe == nullptr)
+	{
+		return false;
+	}
+
+	sqe->fd = AT_FDCWD;
+	sqe->addr = uint64_t(reinterpret_cast<uintptr_t>(path));
+	sqe->len = mode;
+	sqe->open_flags = uint32_t(flags);
+	commit();
+	return true;
+}
+
+bool io::IoUring::queue_unlink(const char* path, uint64_t user_data)
+{
+	io_uring_sqe* sqe = prepare(IORING_OP_UNLINKAT, user_data);
+	if (sqe == nullptr)
+	{
+		return false;
+	}
+
+	sqe->fd = AT_FDCWD;
+	sqe->addr = uint64_t(reinterpret_cast<uintptr_t>(path));
+	// A hard link, unlike a plain link, does not cancel the next operation when this one fails
+	sqe->flags = IOSQE_IO_HARDLINK;
+	commit();
+	return true;
+}
+
+bool io::IoUring::queue_write(int fd, const uint8_t* data, uint32_t size, uint64_t offset, uint64_t user_data)
+{
+	io_uring_sqe* sqe = prepare(IORING_OP_WRITE, user_data);
+	if (sqe == nullptr)
+	{
+		return false;
+	}
+
+	sqe->fd = fd;
+	sqe->addr = uint64_t(reinterpret_cast<uintptr_t>(data));
+	sqe->len = size;
+	sqe->off = offset;
+	commit();
+	return true;
+}
+
+bool io::IoUring::queue_close(int fd, uint64_t user_data)
+{
+	io_uring_sqe* sqe = prepare(IORING_OP_CLOSE, user_data);
+	if (sqe == nullptr)
+	{
+		return false;
+	}
+
+	sqe->fd = fd;
+	commit();
+	return true;
+}
+
+void io::IoUring::submit(unsigned wait_for)
+{
+	if (m_queued == 0 && wait_for == 0)
+	{
+		return;
+	}
+
+	int result;
+	do
+	{
+		result = io_uring_enter(m_fd, m_queued, wait_for, wait_for != 0 ? IORING_ENTER_GETEVENTS : 0);
+	} while (result < 0 && errno == EINTR);
+
+	CHECK(result >= 0) << "io_uring_enter failed: " << strerror(errno);
+	m_queued -= unsigned(result) < m_queued ? unsigned(result) : m_queued;
+}
+
+bool io::IoUring::next_completion(uint64_t* user_data, int32_t* result)
+{
+	const unsigned head = *m_cq_head;
+
+	if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+	{
+		return false;
+	}
+
+	const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+	*user_data = cqe.user_data;
+	*result = cqe.res;
+
+	__atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#else
+
+bool io::IoUring::supported()
+{
+	return false;
+}
+
+io::IoUring::IoUring(unsigned)
+{
+	CHECK(false) << "io_uring is only available on Linux";
+}
+
+io::IoUring::~IoUring()
+{
+	// NOP
+}
+
+bool io::IoUring::queue_open(const char*, int, unsigned, uint64_t) { return false; }
+bool io::IoUring::queue_unlink(const char*, uint64_t) { return false; }
+bool io::IoUring::queue_write(int, const uint8_t*, uint32_t, uint64_t, uint64_t) { return false; }
+bool io::IoUring::queue_close(int, uint64_t) { return false; }
+void io::IoUring::submit(unsigned) { }
+bool io::IoUring::next_completion(uint64_t*, int32_t*) { return false; }
+
+#endif
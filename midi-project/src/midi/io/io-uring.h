@@ -0,0 +1,74 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstdint>
+#include <cstddef>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace io {
+	// Minimal io_uring submission and completion queue, using the system calls directly.
+	// Operations are queued with the queue_* functions, handed to the kernel in one go by submit(),
+	// and their results are picked up with next_completion(). Each operation carries a user_data
+	// value that is passed back with its completion.
+	// Only available on Linux 5.11 and later, and may be disabled by the system; check supported() first.
+	class IoUring
+	{
+	public:
+		IoUring(unsigned entries);
+		~IoUring();
+
+		IoUring(const IoUring&) = delete;
+		IoUring& operator =(const IoUring&) = delete;
+
+		// Whether io_uring can be used, including the unlinkat, openat, write and close operations
+		static bool supported();
+
+		// Return false if the submission queue is full
+		bool queue_open(const char* path, int flags, unsigned mode, uint64_t user_data);
+		// The operation queued next does not start before the unlink is done, whether it succeeded or not
+		bool queue_unlink(const char* path, uint64_t user_data);
+		bool queue_write(int fd, const uint8_t* data, uint32_t size, uint64_t offset, uint64_t user_data);
+		bool queue_close(int fd, uint64_t user_data);
+
+		// Hands all queued operations to the kernel, then waits until
+		// at least wait_for completions are available
+		void submit(unsigned wait_for = 0);
+
+		// Operations queued, but not yet submitted
+		unsigned queued() const { return m_queued; }
+
+		// Takes the next completion off the queue; result is what the
+		// system call would have returned, or -errno
+		bool next_completion(uint64_t* user_data, int32_t* result);
+
+	private:
+		// The entry is only handed to the kernel by commit(), once it is filled in
+		io_uring_sqe* prepare(uint8_t opcode, uint64_t user_data);
+		void commit();
+
+		int m_fd;
+		void* m_sq_ring;
+		size_t m_sq_ring_size;
+		void* m_cq_ring;
+		size_t m_cq_ring_size;
+		io_uring_sqe* m_sqes;
+		size_t m_sqes_size;
+
+		unsigned* m_sq_head;
+		unsigned* m_sq_tail;
+		unsigned* m_sq_array;
+		unsigned m_sq_mask;
+		unsigned m_sq_entries;
+		unsigned* m_cq_head;
+		unsigned* m_cq_tail;
+		unsigned m_cq_mask;
+		io_uring_cqe* m_cqes;
+
+		// Queued, but not yet submitted
+		unsigned m_queued;
+	};
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include "io/mapped-file.h"
+#include "logging.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+io::MappedFile::MappedFile(const std::string& path)
+	: m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	CHECK(m_file != INVALID_HANDLE_VALUE) << "Could not open " << path;
+
+	LARGE_INTEGER size;
+	CHECK(GetFileSizeEx(m_file, &size)) << "Could not determine size of " << path;
+	m_size = size_t(size.QuadPart);
+
+	if (m_size != 0)
+	{
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CHECK(m_mapping != nullptr) << "Could not map " << path;
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		CHECK(m_data != nullptr) << "Could not map " << path;
+	}
+}
+
+io::MappedFile::~MappedFile()
+{
+	if (m_data != nullptr) UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+io::MappedScratchFile::MappedScratchFile(const std::string& path, uint64_t size)
+	: m_data(nullptr), m_size(size), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+	CHECK(m_file != INVALID_HANDLE_VALUE) << "Could not create " << path;
+
+	// Without this, NTFS would allocate (and zero) the whole file up front
+	DWORD returned;
+	DeviceIoControl(m_file, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+
+	if (m_size != 0)
+	{
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+		CHECK(m_mapping != nullptr) << "Could not map " << path;
+		m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+		CHECK(m_data != nullptr) << "Could not map " << path;
+	}
+}
+
+io::MappedScratchFile::~MappedScratchFile()
+{
+	if (m_data != nullptr) UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+#else
+
+io::MappedFile::MappedFile(const std::string& path)
+	: m_data(nullptr), m_size(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	CHECK(fd >= 0) << "Could not open " << path;
+
+	struct stat info;
+	CHECK(fstat(fd, &info) == 0) << "Could not determine size of " << path;
+	m_size = size_t(info.st_size);
+
+	if (m_size != 0)
+	{
+		void* address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		CHECK(address != MAP_FAILED) << "Could not map " << path;
+		m_data = static_cast<const uint8_t*>(address);
+	}
+
+	close(fd);
+}
+
+io::MappedFile::~MappedFile()
+{
+	if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+}
+
+io::MappedScratchFile::MappedScratchFile(const std::string& path, uint64_t size)
+	: m_data(nullptr), m_size(size)
+{
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	CHECK(fd >= 0) << "Could not create " << path;
+
+	// The mapping keeps the file alive, so it can be unlinked right away.
+	// ftruncate leaves a sparse file behind: nothing is allocated until written.
+	unlink(path.c_str());
+	CHECK(ftruncate(fd, off_t(size)) == 0) << "Could not resize " << path << " to " << size << " bytes";
+
+	if (m_size != 0)
+	{
+		void* address = mmap(nullptr, size_t(m_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		CHECK(address != MAP_FAILED) << "Could not map " << path;
+		m_data = static_cast<uint8_t*>(address);
+	}
+
+	close(fd);
+}
+
+io::MappedScratchFile::~MappedScratchFile()
+{
+	if (m_data != nullptr) munmap(m_data, size_t(m_size));
+}
+
+#endif
+
+bool io::file_exists(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return in.good();
+}
+
+bool io::create_hard_link(const std::string& target, const std::string& link)
+{
+	std::remove(link.c_str());
+
+#if defined(_WIN32)
+	return CreateHardLinkA(link.c_str(), target.c_str(), nullptr) != 0;
+#else
+	return ::link(target.c_str(), link.c_str()) == 0;
+#endif
+}
+
+void io::write_file(const std::string& path, const uint8_t* data, size_t size)
+{
+	// An existing file may be a hard link shared with other frames; truncating it
+	// would overwrite all of them, so it gets a new file of its own instead
+#if defined(_WIN32)
+	DeleteFileA(path.c_str());
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	CHECK(file != INVALID_HANDLE_VALUE) << "Could not create " << path;
+
+	while (size != 0)
+	{
+		DWORD written = 0;
+		const DWORD chunk = DWORD(std::min<size_t>(size, 1u << 30));
+		CHECK(WriteFile(file, data, chunk, &written, nullptr) && written != 0) << "Could not write to " << path;
+		data += written;
+		size -= written;
+	}
+
+	CloseHandle(file);
+#else
+	::unlink(path.c_str());
+	int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	CHECK(fd != -1) << "Could not create " << path;
+
+	while (size != 0)
+	{
+		const ssize_t written = ::write(fd, data, size);
+		CHECK(written > 0) << "Could not write to " << path;
+		data += written;
+		size -= size_t(written);
+	}
+
+	::close(fd);
+#endif
+}
+
+bool io::replace_file(const std::string& path, const uint8_t* data, size_t size)
+{
+	// Unique per process, so that processes replacing the same file do not write into each other's copy
+#if defined(_WIN32)
+	const std::string temporary = path + "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+#else
+	const std::string temporary = path + "." + std::to_string(::getpid()) + ".tmp";
+#endif
+
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+		out.close();
+
+		if (!out)
+		{
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+
+#if defined(_WIN32)
+	const bool renamed = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	const bool renamed = std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+
+	if (!renamed)
+	{
+		std::remove(temporary.c_str());
+	}
+	return renamed;
+}
+
+#if defined(_WIN32)
+
+io::FileLock::FileLock(const std::string& path)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	OVERLAPPED overlapped = {};
+	if (m_file != INVALID_HANDLE_VALUE && !LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped))
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+}
+
+io::FileLock::~FileLock()
+{
+	// Closing the handle releases the lock
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+bool io::FileLock::locked() const
+{
+	return m_file != INVALID_HANDLE_VALUE;
+}
+
+#else
+
+io::FileLock::FileLock(const std::string& path)
+{
+	m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if (m_fd != -1 && ::flock(m_fd, LOCK_EX) != 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+}
+
+io::FileLock::~FileLock()
+{
+	// Closing the descriptor releases the lock
+	if (m_fd != -1) ::close(m_fd);
+}
+
+bool io::FileLock::locked() const
+{
+	return m_fd != -1;
+}
+
+#endif
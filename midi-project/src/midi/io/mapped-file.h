@@ -0,0 +1,95 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+
+namespace io {
+	// Read-only view of an entire file, mapped into memory.
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator =(const MappedFile&) = delete;
+
+		const uint8_t* data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+#if defined(_WIN32)
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+
+	// Writable scratch file of a fixed size, mapped into memory. The file is
+	// created (or truncated) at path and removed again when the mapping is
+	// destroyed. Pages are only backed by disk once they are written to,
+	// and the OS is free to page them out.
+	class MappedScratchFile
+	{
+	public:
+		MappedScratchFile(const std::string& path, uint64_t size);
+		~MappedScratchFile();
+
+		MappedScratchFile(const MappedScratchFile&) = delete;
+		MappedScratchFile& operator =(const MappedScratchFile&) = delete;
+
+		uint8_t* data() const { return m_data; }
+		uint64_t size() const { return m_size; }
+
+	private:
+		uint8_t* m_data;
+		uint64_t m_size;
+#if defined(_WIN32)
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+
+	bool file_exists(const std::string& path);
+
+	// Makes link another name for the existing file target, replacing link if it exists.
+	// Returns false if the file system does not support this.
+	bool create_hard_link(const std::string& target, const std::string& link);
+
+	// Creates the file at path and writes data to it, without any buffering on the way.
+	// Meant for data that is already complete in memory. An existing file is removed
+	// first, so other hard links to it keep their contents.
+	void write_file(const std::string& path, const uint8_t* data, size_t size);
+
+	// Writes data to a temporary file next to path and renames it to path, so that readers,
+	// including those that have the old file mapped, see either the old or the new contents
+	// in full. Returns false, leaving path alone, if anything fails.
+	bool replace_file(const std::string& path, const uint8_t* data, size_t size);
+
+	// Exclusive lock on the file at path, which is created if needed, held for the lifetime
+	// of the object. Only serializes processes that take the same lock.
+	class FileLock
+	{
+	public:
+		// Waits for other holders of the lock
+		FileLock(const std::string& path);
+		~FileLock();
+
+		FileLock(const FileLock&) = delete;
+		FileLock& operator =(const FileLock&) = delete;
+
+		// False if the lock file could not be created
+		bool locked() const;
+
+	private:
+#if defined(_WIN32)
+		void* m_file;
+#else
+		int m_fd;
+#endif
+	};
+}
+
+#endif
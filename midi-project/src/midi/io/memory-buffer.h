@@ -0,0 +1,41 @@
+#ifndef MEMORY_BUFFER_H
+#define MEMORY_BUFFER_H
+
+#include <streambuf>
+#include <cstdint>
+
+namespace io {
+	// Lets an std::istream read directly from a block of memory, without copying it.
+	class MemoryBuffer : public std::streambuf
+	{
+	public:
+		MemoryBuffer(const uint8_t* data, size_t size)
+		{
+			char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+			setg(begin, begin, begin + size);
+		}
+
+	protected:
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+		{
+			off_type base = direction == std::ios_base::beg ? 0 :
+				direction == std::ios_base::cur ? gptr() - eback() : egptr() - eback();
+			off_type position = base + offset;
+
+			if (!(which & std::ios_base::in) || position < 0 || position > egptr() - eback())
+			{
+				return pos_type(off_type(-1));
+			}
+
+			setg(eback(), eback() + position, egptr());
+			return pos_type(position);
+		}
+
+		pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+		{
+			return seekoff(off_type(position), std::ios_base::beg, which);
+		}
+	};
+}
+
+#endif
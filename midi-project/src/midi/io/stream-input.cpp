@@ -0,0 +1,78 @@
+#include "io/stream-input.h"
+#include "logging.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+io::StreamInput::StreamInput(const std::string& path)
+	: m_handle(INVALID_HANDLE_VALUE), m_owned(path != "-")
+{
+	if (m_owned)
+	{
+		m_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	}
+	else
+	{
+		m_handle = GetStdHandle(STD_INPUT_HANDLE);
+	}
+	CHECK(m_handle != INVALID_HANDLE_VALUE) << "Could not open " << path;
+}
+
+io::StreamInput::~StreamInput()
+{
+	if (m_owned && m_handle != INVALID_HANDLE_VALUE) CloseHandle(m_handle);
+}
+
+size_t io::StreamInput::read(uint8_t* buffer, size_t size)
+{
+	DWORD count = 0;
+	if (!ReadFile(m_handle, buffer, DWORD(size), &count, nullptr))
+	{
+		// The writer closing its end of a pipe is the end of the input
+		CHECK(GetLastError() == ERROR_BROKEN_PIPE) << "Could not read input";
+		return 0;
+	}
+	return count;
+}
+
+#else
+
+io::StreamInput::StreamInput(const std::string& path)
+	: m_fd(0), m_owned(path != "-")
+{
+	if (m_owned)
+	{
+		// Opening a FIFO waits until a writer opens it as well
+		m_fd = open(path.c_str(), O_RDONLY);
+	}
+	CHECK(m_fd >= 0) << "Could not open " << path;
+}
+
+io::StreamInput::~StreamInput()
+{
+	if (m_owned && m_fd >= 0) close(m_fd);
+}
+
+size_t io::StreamInput::read(uint8_t* buffer, size_t size)
+{
+	for (;;)
+	{
+		const ssize_t count = ::read(m_fd, buffer, size);
+		if (count >= 0)
+		{
+			return size_t(count);
+		}
+		CHECK(errno == EINTR) << "Could not read input";
+	}
+}
+
+#endif
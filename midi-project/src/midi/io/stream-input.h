@@ -0,0 +1,36 @@
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace io {
+	// Unbuffered input from standard input, a named pipe or a file.
+	// A read returns as soon as any bytes are available instead of waiting
+	// for a whole buffer, so that bytes can be handled the moment they arrive.
+	class StreamInput
+	{
+	public:
+		// A path of "-" reads standard input
+		StreamInput(const std::string& path);
+		~StreamInput();
+
+		StreamInput(const StreamInput&) = delete;
+		StreamInput& operator =(const StreamInput&) = delete;
+
+		// Waits until at least one byte is available, then reads up to size bytes.
+		// Returns 0 once the other end has closed the pipe, or at the end of a file.
+		size_t read(uint8_t* buffer, size_t size);
+
+	private:
+#if defined(_WIN32)
+		void* m_handle;
+#else
+		int m_fd;
+#endif
+		bool m_owned;
+	};
+}
+
+#endif
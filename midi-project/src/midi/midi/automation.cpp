@@ -0,0 +1,252 @@
+#include "automation.h"
+#include "logging.h"
+#include <algorithm>
+
+namespace
+{
+	// Same encoding as delta times in a MIDI file: 7 bits per byte,
+	// most significant first, the top bit set on all but the last byte
+	void write_vli(std::vector<uint8_t>& out, uint64_t value)
+	{
+		uint8_t bytes[10];
+		size_t count = 0;
+
+		do
+		{
+			bytes[count++] = uint8_t(value & 0x7F);
+			value >>= 7;
+		} while (value != 0);
+
+		while (count > 1)
+		{
+			out.push_back(bytes[--count] | 0x80);
+		}
+		out.push_back(bytes[0]);
+	}
+
+	uint64_t read_vli(const uint8_t*& position)
+	{
+		uint64_t acc = 0;
+		uint8_t byte;
+
+		do
+		{
+			byte = *position++;
+			acc = (acc << 7) | (byte & 0x7F);
+		} while (byte & 0x80);
+
+		return acc;
+	}
+
+	uint32_t key(midi::Channel channel, uint16_t lane)
+	{
+		return uint32_t(value(channel)) << 16 | lane;
+	}
+}
+
+namespace midi {
+
+	uint16_t default_value(uint16_t lane)
+	{
+		switch (lane)
+		{
+		case 7: return 100;
+		case 10: return 64;
+		case 11: return 127;
+		case PITCH_WHEEL_LANE: return 0x2000;
+		default: return 0;
+		}
+	}
+
+	// ========================================================
+	// AutomationLane =========================================
+	// ========================================================
+
+	void AutomationLane::add(Time time, uint16_t level)
+	{
+		CHECK(m_size == 0 || time >= m_last) << "Automation points must be added in order of time";
+
+		write_vli(m_data, value(time) - value(m_last));
+		write_vli(m_data, level);
+		m_last = time;
+		++m_size;
+	}
+
+	// ========================================================
+	// AutomationCursor =======================================
+	// ========================================================
+
+	AutomationCursor::AutomationCursor(const AutomationLane& lane, uint16_t default_value) :
+		m_position(lane.data().data()), m_end(lane.data().data() + lane.data().size()),
+		m_started(false), m_time(0), m_value(default_value), m_has_next(false),
+		m_next_time(0), m_next_value(0)
+	{
+		decode_next();
+	}
+
+	void AutomationCursor::decode_next()
+	{
+		m_has_next = m_position != m_end;
+
+		if (m_has_next)
+		{
+			m_next_time = m_next_time + Duration(read_vli(m_position));
+			m_next_value = uint16_t(read_vli(m_position));
+		}
+	}
+
+	void AutomationCursor::advance(Time time)
+	{
+		CHECK(!m_started || time >= m_time) << "Automation cursor cannot go back in time";
+
+		while (m_has_next && m_next_time <= time)
+		{
+			m_started = true;
+			m_time = m_next_time;
+			m_value = m_next_value;
+			decode_next();
+		}
+	}
+
+	uint16_t AutomationCursor::at(Time time)
+	{
+		advance(time);
+		return m_value;
+	}
+
+	double AutomationCursor::interpolated(Time time)
+	{
+		advance(time);
+
+		if (!m_started || !m_has_next)
+		{
+			return m_value;
+		}
+
+		// m_time <= time < m_next_time
+		const double fraction = double(value(time - m_time)) / double(value(m_next_time - m_time));
+		return m_value + (double(m_next_value) - m_value) * fraction;
+	}
+
+	// ========================================================
+	// Automation =============================================
+	// ========================================================
+
+	Automation::Automation(std::vector<AUTOMATION_POINT> points)
+	{
+		std::stable_sort(points.begin(), points.end(), [](const AUTOMATION_POINT& a, const AUTOMATION_POINT& b)
+		{
+			const uint32_t ka = key(a.channel, a.lane);
+			const uint32_t kb = key(b.channel, b.lane);
+			return ka != kb ? ka < kb : a.time < b.time;
+		});
+
+		AutomationLane* lane = nullptr;
+		uint32_t current = ~0u;
+
+		for (const AUTOMATION_POINT& point : points)
+		{
+			CHECK(point.lane < LANE_COUNT) << "Invalid automation lane " << point.lane;
+
+			if (key(point.channel, point.lane) != current)
+			{
+				current = key(point.channel, point.lane);
+				lane = &m_lanes[current];
+			}
+			lane->add(point.time, point.value);
+		}
+	}
+
+	const AutomationLane* Automation::find(Channel channel, uint16_t lane) const
+	{
+		auto it = m_lanes.find(key(channel, lane));
+		return it == m_lanes.end() ? nullptr : &it->second;
+	}
+
+	AutomationCursor Automation::cursor(Channel channel, uint16_t lane) const
+	{
+		static const AutomationLane empty;
+		const AutomationLane* found = find(channel, lane);
+
+		return AutomationCursor(found ? *found : empty, default_value(lane));
+	}
+
+	size_t Automation::point_count() const
+	{
+		size_t total = 0;
+		for (const auto& entry : m_lanes)
+		{
+			total += entry.second.size();
+		}
+		return total;
+	}
+
+	size_t Automation::byte_count() const
+	{
+		size_t total = 0;
+		for (const auto& entry : m_lanes)
+		{
+			total += entry.second.data().size();
+		}
+		return total;
+	}
+
+	// ========================================================
+	// AutomationCollector ====================================
+	// ========================================================
+
+	void AutomationCollector::note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+	{
+		this->time += dt;
+	}
+	void AutomationCollector::note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+	{
+		this->time += dt;
+	}
+	void AutomationCollector::polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure)
+	{
+		this->time += dt;
+		this->points.push_back(AUTOMATION_POINT{ channel, uint16_t(KEY_PRESSURE_LANE + value(note)), this->time, pressure });
+	}
+	void AutomationCollector::control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value)
+	{
+		this->time += dt;
+		this->points.push_back(AUTOMATION_POINT{ channel, controller, this->time, value });
+	}
+	void AutomationCollector::program_change(Duration dt, Channel channel, Instrument program)
+	{
+		this->time += dt;
+	}
+	void AutomationCollector::channel_pressure(Duration dt, Channel channel, uint8_t pressure)
+	{
+		this->time += dt;
+		this->points.push_back(AUTOMATION_POINT{ channel, CHANNEL_PRESSURE_LANE, this->time, pressure });
+	}
+	void AutomationCollector::pitch_wheel_change(Duration dt, Channel channel, uint16_t value)
+	{
+		this->time += dt;
+		this->points.push_back(AUTOMATION_POINT{ channel, PITCH_WHEEL_LANE, this->time, value });
+	}
+	void AutomationCollector::meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+	{
+		this->time += dt;
+	}
+	void AutomationCollector::sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+	{
+		this->time += dt;
+	}
+
+	Automation read_automation(std::istream& in)
+	{
+		MTHD header;
+		read_mthd(in, &header);
+		std::vector<AUTOMATION_POINT> points;
+
+		for (int i = 0; i < header.ntracks; i++)
+		{
+			AutomationCollector collector(points);
+			read_mtrk(in, collector);
+		}
+		return Automation(std::move(points));
+	}
+}
@@ -0,0 +1,126 @@
+#ifndef AUTOMATION_H
+#define AUTOMATION_H
+
+#include "midi.h"
+#include <istream>
+#include <map>
+#include <vector>
+
+namespace midi {
+
+	// Lanes of a channel: one per controller (0-127), then the pitch wheel,
+	// channel pressure and the key pressure of each of the 128 notes.
+	const uint16_t PITCH_WHEEL_LANE = 128;
+	const uint16_t CHANNEL_PRESSURE_LANE = 129;
+	const uint16_t KEY_PRESSURE_LANE = 130;
+	const uint16_t LANE_COUNT = KEY_PRESSURE_LANE + 128;
+
+	// Value of a lane before its first point: the General MIDI defaults
+	// for volume, pan and expression, the center for the pitch wheel, 0 otherwise.
+	uint16_t default_value(uint16_t lane);
+
+	struct AUTOMATION_POINT
+	{
+	public:
+		Channel channel;
+		uint16_t lane;
+		Time time;
+		uint16_t value;
+	};
+
+	// Time series of a single lane, stored as pairs of variable length integers
+	// (time since the previous point, value). Most points take 2 or 3 bytes.
+	class AutomationLane
+	{
+	public:
+		// Points must be added in order of time; later points at the same time win.
+		void add(Time time, uint16_t level);
+
+		size_t size() const { return m_size; }
+		const std::vector<uint8_t>& data() const { return m_data; }
+
+	private:
+		std::vector<uint8_t> m_data;
+		size_t m_size = 0;
+		Time m_last = Time(0);
+	};
+
+	// Reads a lane from front to back. Queries must not go back in time;
+	// each point is decoded once, so a query costs O(1) amortized.
+	class AutomationCursor
+	{
+	public:
+		AutomationCursor(const AutomationLane& lane, uint16_t default_value);
+
+		// Value of the last point at or before time
+		uint16_t at(Time time);
+
+		// Linear interpolation between the points around time.
+		// Before the first point and after the last, the value is held.
+		double interpolated(Time time);
+
+	private:
+		const uint8_t* m_position;
+		const uint8_t* m_end;
+		// Last point at or before the latest query, or the default value
+		bool m_started;
+		Time m_time;
+		uint16_t m_value;
+		// Following point, if any
+		bool m_has_next;
+		Time m_next_time;
+		uint16_t m_next_value;
+
+		void advance(Time time);
+		void decode_next();
+	};
+
+	// Controller, pitch wheel and pressure lanes of all channels.
+	// Only lanes that have points take memory.
+	class Automation
+	{
+	public:
+		Automation() = default;
+		// Points may come in any order; those at the same time keep their order.
+		explicit Automation(std::vector<AUTOMATION_POINT> points);
+
+		// Lane with the points of channel, or nullptr if there are none
+		const AutomationLane* find(Channel channel, uint16_t lane) const;
+
+		AutomationCursor cursor(Channel channel, uint16_t lane) const;
+
+		size_t lane_count() const { return m_lanes.size(); }
+		size_t point_count() const;
+		// Size of the encoded points
+		size_t byte_count() const;
+
+	private:
+		std::map<uint32_t, AutomationLane> m_lanes;
+	};
+
+	// Gathers the controller, pitch wheel and pressure events of a single track.
+	class AutomationCollector : public EventReceiver
+	{
+	public:
+		Time time = Time(0);
+		std::vector<AUTOMATION_POINT>& points;
+
+		AutomationCollector(std::vector<AUTOMATION_POINT>& points) :
+			points(points) { }
+
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+		void program_change(Duration dt, Channel channel, Instrument program) override;
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+	};
+
+	// Automation of all tracks of a file, in ticks
+	Automation read_automation(std::istream& in);
+}
+
+#endif
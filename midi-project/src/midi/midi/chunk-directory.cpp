@@ -0,0 +1,92 @@
+#include "chunk-directory.h"
+#include "logging.h"
+#include <string>
+
+namespace midi {
+
+	ChunkDirectory::ChunkDirectory(std::istream& in) :
+		m_in(in)
+	{
+		// Seeking past the end does not fail, so chunks are checked against the size of the stream
+		const std::streampos start = in.tellg();
+		in.seekg(0, std::ios::end);
+		const uint64_t size = uint64_t(in.tellg());
+		in.seekg(start);
+
+		read_mthd(in, &m_mthd);
+
+		// MThd may be longer than the 6 bytes we know about
+		CHECK(m_mthd.header.size >= 6) << "MThd is too short";
+		in.seekg(std::streamoff(m_mthd.header.size) - 6, std::ios::cur);
+
+		while (in.peek() != std::char_traits<char>::eof())
+		{
+			CHUNK_ENTRY entry;
+			entry.offset = uint64_t(in.tellg());
+			read_chunk_header(in, &entry.header);
+
+			if (header_id(entry.header) == "MTrk")
+			{
+				m_tracks.push_back(m_chunks.size());
+			}
+			m_chunks.push_back(entry);
+
+			CHECK(entry.offset + 8 + entry.header.size <= size) << "Chunk " << header_id(entry.header) << " is truncated";
+			in.seekg(entry.header.size, std::ios::cur);
+		}
+		in.clear();
+	}
+
+	const CHUNK_ENTRY& ChunkDirectory::track(size_t index) const
+	{
+		CHECK(index < m_tracks.size()) << "Track " << index << " does not exist";
+
+		return m_chunks[m_tracks[index]];
+	}
+
+	void ChunkDirectory::read_track(size_t index, EventReceiver& receiver)
+	{
+		const CHUNK_ENTRY& entry = track(index);
+
+		m_in.clear();
+		m_in.seekg(std::streamoff(entry.offset));
+		read_mtrk(m_in, receiver);
+	}
+
+	std::vector<NOTE> ChunkDirectory::read_notes(const std::vector<size_t>& tracks)
+	{
+		std::vector<NOTE> notes;
+
+		for (size_t index : tracks)
+		{
+			NoteCollector collector([&notes](const NOTE& note)
+			{ notes.push_back(note); });
+			read_track(index, collector);
+		}
+		return notes;
+	}
+
+	std::vector<NOTE> ChunkDirectory::read_notes(const std::vector<size_t>& tracks, const std::vector<Channel>& channels)
+	{
+		std::vector<NOTE> notes;
+
+		for (size_t index : tracks)
+		{
+			std::vector<ChannelNoteCollector> collectors;
+			collectors.reserve(channels.size());
+			for (Channel channel : channels)
+			{
+				collectors.emplace_back(channel, [&notes](const NOTE& note)
+				{ notes.push_back(note); });
+			}
+
+			EventFanout<ChannelNoteCollector> fanout;
+			for (ChannelNoteCollector& collector : collectors)
+			{
+				fanout.receivers.push_back(&collector);
+			}
+			read_track(index, fanout);
+		}
+		return notes;
+	}
+}
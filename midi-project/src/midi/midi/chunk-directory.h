@@ -0,0 +1,48 @@
+#ifndef CHUNK_DIRECTORY_H
+#define CHUNK_DIRECTORY_H
+
+#include "midi.h"
+#include <istream>
+#include <vector>
+
+namespace midi {
+
+	struct CHUNK_ENTRY
+	{
+	public:
+		CHUNK_HEADER header;
+		// Stream position of the chunk header
+		uint64_t offset;
+	};
+
+	// Lists the chunks of a MIDI file without decoding them, so that
+	// only the tracks of interest need to be read.
+	// The stream must be seekable and outlive the directory.
+	class ChunkDirectory
+	{
+	public:
+		ChunkDirectory(std::istream& in);
+
+		const MTHD& mthd() const { return m_mthd; }
+
+		// All chunks following MThd, including those of unknown type
+		const std::vector<CHUNK_ENTRY>& chunks() const { return m_chunks; }
+
+		// Number of MTrk chunks
+		size_t track_count() const { return m_tracks.size(); }
+		const CHUNK_ENTRY& track(size_t index) const;
+
+		void read_track(size_t index, EventReceiver& receiver);
+
+		std::vector<NOTE> read_notes(const std::vector<size_t>& tracks);
+		std::vector<NOTE> read_notes(const std::vector<size_t>& tracks, const std::vector<Channel>& channels);
+
+	private:
+		std::istream& m_in;
+		MTHD m_mthd;
+		std::vector<CHUNK_ENTRY> m_chunks;
+		std::vector<size_t> m_tracks;
+	};
+}
+
+#endif
@@ -28,144 +28,371 @@ namespace midi {
 	};
 #pragma pack(pop)
 	void read_mthd(std::istream&, MTHD*);
-//
-//	bool is_sysex_event(uint8_t);
-//	bool is_meta_event(uint8_t);
-//	bool is_midi_event(uint8_t);
-//	bool is_running_status(uint8_t);
-//
-//	uint8_t extract_midi_event_type(uint8_t);
-//	Channel extract_midi_event_channel(uint8_t);
-//
-//	bool is_note_off(uint8_t);
-//	bool is_note_on(uint8_t);
-//	bool is_polyphonic_key_pressure(uint8_t);
-//	bool is_control_change(uint8_t);
-//	bool is_program_change(uint8_t);
-//	bool is_channel_pressure(uint8_t);
-//	bool is_pitch_wheel_change(uint8_t);
-//
-//	class EventReceiver
-//	{
-//	public:
-//		virtual void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) = 0;
-//		virtual void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) = 0;
-//		virtual void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) = 0;
-//		virtual void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) = 0;
-//		virtual void program_change(Duration dt, Channel channel, Instrument program) = 0;
-//		virtual void channel_pressure(Duration dt, Channel channel, uint8_t pressure) = 0;
-//		virtual void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) = 0;
-//
-//		virtual void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) = 0;
-//		virtual void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) = 0;
-//	};
-//
-//	void read_mtrk(std::istream&, EventReceiver&);
-//
-//	struct NOTE
-//	{
-//	public:
-//		NoteNumber note_number;
-//		Time start;
-//		Duration duration;
-//		uint8_t velo;
-//		Instrument instrument;
-//
-//		NOTE(NoteNumber num, Time tim, Duration dur, uint8_t velo, Instrument instru) :
-//		note_number(num), start(tim), duration(dur), velo(velo), instrument(instru) { }
-//	
-//		bool operator ==(const NOTE& other) const;
-//		bool operator !=(const NOTE& other) const;
-//	};
-//
-//	std::ostream& operator <<(std::ostream& out, const NOTE& note);
-//
-//
-//	struct ChannelNoteCollector : public EventReceiver
-//	{
-//		Channel channel;
-//		Time time = Time(0);
-//		Instrument instr = Instrument(0);
-//		Time tijdjes[128];
-//		uint16_t velos[128];
-//		std::function<void(const NOTE&)> receiver;
-//		
-//		ChannelNoteCollector(Channel chan,
-//			std::function<void(const NOTE&)> receiver) :
-//			channel(chan), receiver(receiver) 
-//		{
-//			for (uint16_t& v : velos)
-//			{
-//				v = 6969;
-//			}
-//		}
-//
-//			// Inherited via EventReceiver
-//		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
-//		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
-//		void program_change(Duration dt, Channel channel, Instrument program) override;
-//		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
-//		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
-//		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//	};
-//
-//	class EventMulticaster : public EventReceiver
-//	{
-//	public:
-//		std::vector<std::shared_ptr<EventReceiver>> note_filters;
-//
-//		EventMulticaster(std::vector<std::shared_ptr<EventReceiver>> note_filters) :
-//			note_filters(note_filters) { };
-//		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
-//		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
-//		void program_change(Duration dt, Channel channel, Instrument program) override;
-//		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
-//		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
-//		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//	};
-//
-//	class NoteCollector : public EventReceiver
-//	{
-//	public:
-//		EventMulticaster multicaster;
-//		std::function<void(const NOTE&)> receiver;
-//
-//		static std::vector<std::shared_ptr<EventReceiver>> 
-//			create_list(std::function<void(const NOTE&)> receiver)
-//		{
-//			std::vector<std::shared_ptr<EventReceiver>> receivers;
-//			for (int channel = 0; channel < 16; channel++)
-//			{
-//				auto ptr = std::make_shared<ChannelNoteCollector>
-//					(Channel(channel), receiver);
-//				receivers.push_back(ptr);
-//			}
-//			return receivers;
-//		}
-//
-//		NoteCollector(std::function<void(const NOTE&)> receiver) : 
-//			receiver(receiver), multicaster(create_list(receiver)){ }
-//		
-//		// Inherited via EventReceiver
-//		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
-//		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
-//		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
-//		void program_change(Duration dt, Channel channel, Instrument program) override;
-//		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
-//		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
-//		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
-//
-//	};
-//
-//	std::vector<NOTE> read_notes(std::istream&);
+
+	bool is_sysex_event(uint8_t);
+	bool is_meta_event(uint8_t);
+	bool is_midi_event(uint8_t);
+	bool is_running_status(uint8_t);
+
+	uint8_t extract_midi_event_type(uint8_t);
+	Channel extract_midi_event_channel(uint8_t);
+
+	bool is_note_off(uint8_t);
+	bool is_note_on(uint8_t);
+	bool is_polyphonic_key_pressure(uint8_t);
+	bool is_control_change(uint8_t);
+	bool is_program_change(uint8_t);
+	bool is_channel_pressure(uint8_t);
+	bool is_pitch_wheel_change(uint8_t);
+
+	enum class EventKind : uint8_t
+	{
+		running_status,
+		note_off,
+		note_on,
+		polyphonic_key_pressure,
+		control_change,
+		program_change,
+		channel_pressure,
+		pitch_wheel_change,
+		sysex,
+		meta,
+		unsupported
+	};
+
+	// Everything read_mtrk needs to know about a status byte.
+	struct STATUS_INFO
+	{
+	public:
+		EventKind kind;
+		uint8_t channel;
+		// Number of data bytes following the status byte, 0 if variable
+		uint8_t data_bytes;
+		// Whether later events may omit this status byte
+		bool running_status;
+	};
+
+	constexpr STATUS_INFO classify_status(uint8_t status)
+	{
+		switch (status >> 4)
+		{
+		case 0x8: return { EventKind::note_off, uint8_t(status & 0x0F), 2, true };
+		case 0x9: return { EventKind::note_on, uint8_t(status & 0x0F), 2, true };
+		case 0xA: return { EventKind::polyphonic_key_pressure, uint8_t(status & 0x0F), 2, true };
+		case 0xB: return { EventKind::control_change, uint8_t(status & 0x0F), 2, true };
+		case 0xC: return { EventKind::program_change, uint8_t(status & 0x0F), 1, true };
+		case 0xD: return { EventKind::channel_pressure, uint8_t(status & 0x0F), 1, true };
+		case 0xE: return { EventKind::pitch_wheel_change, uint8_t(status & 0x0F), 2, true };
+		case 0xF:
+			if (status == 0xF0 || status == 0xF7) return { EventKind::sysex, 0, 0, false };
+			if (status == 0xFF) return { EventKind::meta, 0, 0, false };
+			return { EventKind::unsupported, 0, 0, false };
+		default: return { EventKind::running_status, 0, 0, false };
+		}
+	}
+
+	struct STATUS_TABLE
+	{
+	public:
+		STATUS_INFO entries[256];
+
+		constexpr const STATUS_INFO& operator [](uint8_t status) const
+		{
+			return entries[status];
+		}
+	};
+
+	constexpr STATUS_TABLE make_status_table()
+	{
+		STATUS_TABLE table = {};
+		for (int status = 0; status != 256; ++status)
+		{
+			table.entries[status] = classify_status(uint8_t(status));
+		}
+		return table;
+	}
+
+	// Lookup table equivalent of classify_status, indexed by status byte.
+	extern const STATUS_TABLE status_table;
+
+	class EventReceiver
+	{
+	public:
+		virtual void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) = 0;
+		virtual void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) = 0;
+		virtual void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) = 0;
+		virtual void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) = 0;
+		virtual void program_change(Duration dt, Channel channel, Instrument program) = 0;
+		virtual void channel_pressure(Duration dt, Channel channel, uint8_t pressure) = 0;
+		virtual void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) = 0;
+
+		virtual void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) = 0;
+		virtual void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) = 0;
+	};
+
+	// Decodes a single event at the current position of the stream. running_status
+	// holds the status byte in effect and is updated when the event sets a new one.
+	// Returns false once End of Track has been read.
+	bool read_event(std::istream&, EventReceiver&, uint8_t& running_status);
+	void read_mtrk(std::istream&, EventReceiver&);
+
+	struct NOTE
+	{
+	public:
+		NoteNumber note_number;
+		Time start;
+		Duration duration;
+		uint8_t velo;
+		Instrument instrument;
+
+		NOTE(NoteNumber num, Time tim, Duration dur, uint8_t velo, Instrument instru) :
+		note_number(num), start(tim), duration(dur), velo(velo), instrument(instru) { }
+	
+		bool operator ==(const NOTE& other) const;
+		bool operator !=(const NOTE& other) const;
+	};
+
+	std::ostream& operator <<(std::ostream& out, const NOTE& note);
+
+	// Receives completed notes a block at a time.
+	class NoteSink
+	{
+	public:
+		virtual ~NoteSink() { }
+
+		virtual void receive(const NOTE* notes, size_t count) = 0;
+	};
+
+	// Gathers notes and passes them on to a NoteSink in blocks of
+	// block_size notes. Whatever is left must be pushed out with flush().
+	class NoteBlockBuffer
+	{
+	public:
+		NoteBlockBuffer(NoteSink& sink, size_t block_size = 256);
+
+		void push_back(const NOTE& note)
+		{
+			this->buffer.push_back(note);
+			if (this->buffer.size() == this->block_size)
+			{
+				flush();
+			}
+		}
+
+		void flush();
+
+	private:
+		NoteSink& sink;
+		size_t block_size;
+		std::vector<NOTE> buffer;
+	};
+
+	// Column-wise note table: the i-th note is made up of
+	// the i-th element of each column.
+	struct NoteColumns : public NoteSink
+	{
+	public:
+		std::vector<NoteNumber> note_numbers;
+		std::vector<Time> starts;
+		std::vector<Duration> durations;
+		std::vector<uint8_t> velocities;
+		std::vector<Instrument> instruments;
+
+		size_t size() const;
+		void reserve(size_t);
+		void clear();
+		void push_back(const NOTE&);
+		NOTE operator [](size_t index) const;
+
+		void receive(const NOTE* notes, size_t count) override;
+	};
+
+
+	struct ChannelNoteCollector final : public EventReceiver
+	{
+		Channel channel;
+		Time time = Time(0);
+		Instrument instr = Instrument(0);
+		Time tijdjes[128];
+		uint16_t velos[128];
+		std::function<void(const NOTE&)> receiver;
+		NoteBlockBuffer* block_buffer = nullptr;
+		
+		ChannelNoteCollector(Channel chan,
+			std::function<void(const NOTE&)> receiver) :
+			channel(chan), receiver(receiver) 
+		{
+			for (uint16_t& v : velos)
+			{
+				v = 6969;
+			}
+		}
+
+		// Completed notes are appended to block_buffer
+		// instead of being passed to a callback one by one.
+		ChannelNoteCollector(Channel chan, NoteBlockBuffer& block_buffer) :
+			ChannelNoteCollector(chan, nullptr)
+		{
+			this->block_buffer = &block_buffer;
+		}
+
+		bool is_sounding(NoteNumber note) const { return velos[value(note)] != 6969; }
+
+			// Inherited via EventReceiver
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+		void program_change(Duration dt, Channel channel, Instrument program) override;
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+	};
+
+	std::unique_ptr<uint8_t[]> copy(const std::unique_ptr<uint8_t[]>& p, uint64_t data_size);
+
+	class EventMulticaster : public EventReceiver
+	{
+	public:
+		std::vector<std::shared_ptr<EventReceiver>> note_filters;
+
+		EventMulticaster(std::vector<std::shared_ptr<EventReceiver>> note_filters) :
+			note_filters(note_filters) { };
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+		void program_change(Duration dt, Channel channel, Instrument program) override;
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+	};
+
+	// Non-owning counterpart of EventMulticaster for receiver sets that
+	// outlive the fan-out. No reference counts are touched per event and,
+	// when RECEIVER is a final class, every forwarded event is a direct call.
+	template<typename RECEIVER = EventReceiver>
+	class EventFanout : public EventReceiver
+	{
+	public:
+		std::vector<RECEIVER*> receivers;
+
+		EventFanout() { }
+		EventFanout(std::vector<RECEIVER*> receivers) :
+			receivers(receivers) { }
+
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->note_on(dt, channel, note, velocity);
+			}
+		}
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->note_off(dt, channel, note, velocity);
+			}
+		}
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->polyphonic_key_pressure(dt, channel, note, pressure);
+			}
+		}
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->control_change(dt, channel, controller, value);
+			}
+		}
+		void program_change(Duration dt, Channel channel, Instrument program) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->program_change(dt, channel, program);
+			}
+		}
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->channel_pressure(dt, channel, pressure);
+			}
+		}
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override
+		{
+			for (RECEIVER* receiver : receivers)
+			{
+				receiver->pitch_wheel_change(dt, channel, value);
+			}
+		}
+		// Only the first receivers get a copy of the payload, the last one
+		// takes over the original buffer.
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override
+		{
+			for (size_t i = 0; i < receivers.size(); ++i)
+			{
+				if (i + 1 == receivers.size())
+				{
+					receivers[i]->meta(dt, type, std::move(data), data_size);
+				}
+				else
+				{
+					receivers[i]->meta(dt, type, copy(data, data_size), data_size);
+				}
+			}
+		}
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override
+		{
+			for (size_t i = 0; i < receivers.size(); ++i)
+			{
+				if (i + 1 == receivers.size())
+				{
+					receivers[i]->sysex(dt, std::move(data), data_size);
+				}
+				else
+				{
+					receivers[i]->sysex(dt, copy(data, data_size), data_size);
+				}
+			}
+		}
+	};
+
+	class NoteCollector : public EventReceiver
+	{
+	public:
+		std::function<void(const NOTE&)> receiver;
+		std::vector<ChannelNoteCollector> collectors;
+		EventFanout<ChannelNoteCollector> fanout;
+
+		NoteCollector(std::function<void(const NOTE&)> receiver);
+		NoteCollector(NoteBlockBuffer& block_buffer);
+
+		// fanout points into collectors
+		NoteCollector(const NoteCollector&) = delete;
+		NoteCollector& operator =(const NoteCollector&) = delete;
+
+		// Inherited via EventReceiver
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+		void program_change(Duration dt, Channel channel, Instrument program) override;
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+
+	};
+
+	std::vector<NOTE> read_notes(std::istream&);
+	void read_notes(std::istream&, NoteSink&, size_t block_size = 256);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,461 @@
+#include "note-cache.h"
+#include "io/mapped-file.h"
+#include "io/memory-buffer.h"
+#include "util/check-size.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	const uint32_t CACHE_VERSION = 1;
+
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t hash;
+		uint64_t source_size;
+		uint64_t note_count;
+		uint64_t tempo_count;
+		uint64_t end;
+		uint8_t lowest;
+		uint8_t highest;
+		uint8_t padding[6];
+	};
+
+	// Byte offsets of the columns inside a cache image
+	struct LAYOUT
+	{
+		size_t starts;
+		size_t durations;
+		size_t tempo_times;
+		size_t tempo_values;
+		size_t note_numbers;
+		size_t velocities;
+		size_t instruments;
+		size_t total;
+	};
+
+	LAYOUT layout(uint64_t note_count, uint64_t tempo_count)
+	{
+		LAYOUT result;
+		size_t offset = sizeof(CACHE_HEADER);
+
+		result.starts = offset;
+		offset += sizeof(uint64_t) * note_count;
+		result.durations = offset;
+		offset += sizeof(uint64_t) * note_count;
+		result.tempo_times = offset;
+		offset += sizeof(uint64_t) * tempo_count;
+		result.tempo_values = offset;
+		offset += sizeof(uint32_t) * tempo_count;
+		result.note_numbers = offset;
+		offset += note_count;
+		result.velocities = offset;
+		offset += note_count;
+		result.instruments = offset;
+		offset += note_count;
+		result.total = (offset + 7) & ~size_t(7);
+
+		return result;
+	}
+
+	const CACHE_HEADER& header_of(const uint8_t* image)
+	{
+		return *reinterpret_cast<const CACHE_HEADER*>(image);
+	}
+
+	uint64_t mix(uint64_t x)
+	{
+		x ^= x >> 31;
+		x *= 0xBF58476D1CE4E5B9;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EB;
+		x ^= x >> 31;
+		return x;
+	}
+}
+
+namespace midi {
+
+	// Processes the input 8 bytes at a time; not suitable for cryptographic use.
+	uint64_t content_hash(const uint8_t* data, size_t size)
+	{
+		const uint64_t multiplier = 0x9E3779B97F4A7C15;
+		uint64_t hash = mix(size * multiplier);
+		size_t i = 0;
+
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ mix(word)) * multiplier;
+		}
+
+		uint64_t tail = 0;
+		for (size_t shift = 0; i < size; ++i, shift += 8)
+		{
+			tail |= uint64_t(data[i]) << shift;
+		}
+
+		return mix(hash ^ mix(tail));
+	}
+
+	// ========================================================
+	// TempoCollector =========================================
+	// ========================================================
+
+	void TempoCollector::note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::program_change(Duration dt, Channel channel, Instrument program)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::channel_pressure(Duration dt, Channel channel, uint8_t pressure)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::pitch_wheel_change(Duration dt, Channel channel, uint16_t value)
+	{
+		this->time += dt;
+	}
+	void TempoCollector::meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+	{
+		this->time += dt;
+		if (type == 0x51 && data_size == 3)
+		{
+			uint32_t tempo = uint32_t(data[0]) << 16 | uint32_t(data[1]) << 8 | uint32_t(data[2]);
+			this->tempo_map.push_back(TEMPO_CHANGE{ this->time, tempo });
+		}
+	}
+	void TempoCollector::sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+	{
+		this->time += dt;
+	}
+
+	NOTE_STATS compute_stats(const std::vector<NOTE>& notes)
+	{
+		NOTE_STATS stats{ notes.size(), Time(0), NoteNumber(127), NoteNumber(0) };
+
+		for (const NOTE& note : notes)
+		{
+			stats.end = std::max(stats.end, note.start + note.duration);
+			stats.lowest = std::min(stats.lowest, note.note_number);
+			stats.highest = std::max(stats.highest, note.note_number);
+		}
+
+		return stats;
+	}
+
+	// ========================================================
+	// CachedNotes ============================================
+	// ========================================================
+
+	CachedNotes::CachedNotes(std::shared_ptr<const void> owner, const uint8_t* image, size_t image_size) :
+		m_owner(owner), m_image(image), m_image_size(image_size)
+	{
+		check_size<CACHE_HEADER, 56>();
+	}
+
+	std::shared_ptr<CachedNotes> CachedNotes::parse(const uint8_t* data, size_t size)
+	{
+		io::MemoryBuffer buffer(data, size);
+		std::istream in(&buffer);
+		MTHD methhead;
+		read_mthd(in, &methhead);
+
+		std::vector<NOTE> notes;
+		std::vector<TEMPO_CHANGE> tempo_map;
+		for (int i = 0; i < methhead.ntracks; i++)
+		{
+			NoteCollector note_collector([&notes](const NOTE& note)
+			{ notes.push_back(note); });
+			TempoCollector tempo_collector(tempo_map);
+			EventFanout<> fanout({ &note_collector, &tempo_collector });
+			read_mtrk(in, fanout);
+		}
+		std::stable_sort(tempo_map.begin(), tempo_map.end(),
+			[](const TEMPO_CHANGE& x, const TEMPO_CHANGE& y) { return x.time < y.time; });
+
+		NOTE_STATS stats = compute_stats(notes);
+		LAYOUT offsets = layout(notes.size(), tempo_map.size());
+		auto image = std::make_shared<std::vector<uint8_t>>(offsets.total);
+		uint8_t* p = image->data();
+
+		CACHE_HEADER header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "MNC1", 4);
+		header.version = CACHE_VERSION;
+		header.hash = content_hash(data, size);
+		header.source_size = size;
+		header.note_count = notes.size();
+		header.tempo_count = tempo_map.size();
+		header.end = value(stats.end);
+		header.lowest = value(stats.lowest);
+		header.highest = value(stats.highest);
+		memcpy(p, &header, sizeof(header));
+
+		for (size_t i = 0; i != notes.size(); ++i)
+		{
+			reinterpret_cast<uint64_t*>(p + offsets.starts)[i] = value(notes[i].start);
+			reinterpret_cast<uint64_t*>(p + offsets.durations)[i] = value(notes[i].duration);
+			p[offsets.note_numbers + i] = value(notes[i].note_number);
+			p[offsets.velocities + i] = notes[i].velo;
+			p[offsets.instruments + i] = value(notes[i].instrument);
+		}
+		for (size_t i = 0; i != tempo_map.size(); ++i)
+		{
+			reinterpret_cast<uint64_t*>(p + offsets.tempo_times)[i] = value(tempo_map[i].time);
+			reinterpret_cast<uint32_t*>(p + offsets.tempo_values)[i] = tempo_map[i].microseconds_per_quarter;
+		}
+
+		return from_image(image, image->data(), image->size());
+	}
+
+	std::shared_ptr<CachedNotes> CachedNotes::from_image(std::shared_ptr<const void> owner, const uint8_t* data, size_t size)
+	{
+		if (size < sizeof(CACHE_HEADER))
+		{
+			return nullptr;
+		}
+
+		const CACHE_HEADER& header = header_of(data);
+		if (memcmp(header.magic, "MNC1", 4) != 0 || header.version != CACHE_VERSION ||
+			layout(header.note_count, header.tempo_count).total != size)
+		{
+			return nullptr;
+		}
+
+		return std::shared_ptr<CachedNotes>(new CachedNotes(owner, data, size));
+	}
+
+	uint64_t CachedNotes::hash() const
+	{
+		return header_of(m_image).hash;
+	}
+
+	uint64_t CachedNotes::source_size() const
+	{
+		return header_of(m_image).source_size;
+	}
+
+	NOTE_STATS CachedNotes::stats() const
+	{
+		const CACHE_HEADER& header = header_of(m_image);
+		return NOTE_STATS{ header.note_count, Time(header.end), NoteNumber(header.lowest), NoteNumber(header.highest) };
+	}
+
+	size_t CachedNotes::size() const
+	{
+		return size_t(header_of(m_image).note_count);
+	}
+
+	NOTE CachedNotes::operator [](size_t index) const
+	{
+		return NOTE(NoteNumber(note_numbers()[index]), Time(starts()[index]),
+			Duration(durations()[index]), velocities()[index],
+			Instrument(instruments()[index]));
+	}
+
+	std::vector<NOTE> CachedNotes::notes() const
+	{
+		std::vector<NOTE> result;
+		result.reserve(size());
+		for (size_t i = 0; i != size(); ++i)
+		{
+			result.push_back((*this)[i]);
+		}
+		return result;
+	}
+
+	const uint64_t* CachedNotes::starts() const
+	{
+		return reinterpret_cast<const uint64_t*>(m_image + layout(size(), tempo_count()).starts);
+	}
+
+	const uint64_t* CachedNotes::durations() const
+	{
+		return reinterpret_cast<const uint64_t*>(m_image + layout(size(), tempo_count()).durations);
+	}
+
+	const uint8_t* CachedNotes::note_numbers() const
+	{
+		return m_image + layout(size(), tempo_count()).note_numbers;
+	}
+
+	const uint8_t* CachedNotes::velocities() const
+	{
+		return m_image + layout(size(), tempo_count()).velocities;
+	}
+
+	const uint8_t* CachedNotes::instruments() const
+	{
+		return m_image + layout(size(), tempo_count()).instruments;
+	}
+
+	size_t CachedNotes::tempo_count() const
+	{
+		return size_t(header_of(m_image).tempo_count);
+	}
+
+	TEMPO_CHANGE CachedNotes::tempo(size_t index) const
+	{
+		LAYOUT offsets = layout(size(), tempo_count());
+		return TEMPO_CHANGE{
+			Time(reinterpret_cast<const uint64_t*>(m_image + offsets.tempo_times)[index]),
+			reinterpret_cast<const uint32_t*>(m_image + offsets.tempo_values)[index] };
+	}
+
+	// ========================================================
+	// NoteCache ==============================================
+	// ========================================================
+
+	NoteCache::NoteCache(const std::string& directory, uint64_t max_size) :
+		m_directory(directory), m_max_size(max_size), m_clock(0), m_hits(0), m_misses(0)
+	{
+		io::FileLock lock(lock_path());
+		read_index();
+	}
+
+	std::shared_ptr<CachedNotes> NoteCache::load(const std::string& midi_path)
+	{
+		io::MappedFile source(midi_path);
+		uint64_t hash = content_hash(source.data(), source.size());
+
+		auto it = m_entries.find(hash);
+		if (it != m_entries.end() && io::file_exists(entry_path(hash)))
+		{
+			auto file = std::make_shared<io::MappedFile>(entry_path(hash));
+			auto cached = CachedNotes::from_image(file, file->data(), file->size());
+
+			if (cached != nullptr && cached->hash() == hash && cached->source_size() == source.size())
+			{
+				++m_hits;
+				update_index(hash, it->second.size);
+				return cached;
+			}
+		}
+
+		++m_misses;
+		auto cached = CachedNotes::parse(source.data(), source.size());
+		store(*cached);
+		return cached;
+	}
+
+	uint64_t NoteCache::total_size() const
+	{
+		uint64_t total = 0;
+		for (const auto& entry : m_entries)
+		{
+			total += entry.second.size;
+		}
+		return total;
+	}
+
+	std::string NoteCache::entry_path(uint64_t hash) const
+	{
+		std::stringstream path;
+		path << m_directory << "/" << std::hex << std::setfill('0') << std::setw(16) << hash << ".notes";
+		return path.str();
+	}
+
+	std::string NoteCache::index_path() const
+	{
+		return m_directory + "/notes.index";
+	}
+
+	std::string NoteCache::lock_path() const
+	{
+		return m_directory + "/notes.lock";
+	}
+
+	// Each line of the index holds the hash, size and last use of one entry.
+	void NoteCache::read_index()
+	{
+		std::ifstream in(index_path());
+		uint64_t hash;
+		ENTRY entry;
+
+		while (in >> std::hex >> hash >> std::dec >> entry.size >> entry.last_used)
+		{
+			m_entries[hash] = entry;
+			m_clock = std::max(m_clock, entry.last_used);
+		}
+	}
+
+	void NoteCache::write_index() const
+	{
+		std::stringstream out;
+		for (const auto& entry : m_entries)
+		{
+			out << std::hex << entry.first << " " << std::dec
+				<< entry.second.size << " " << entry.second.last_used << "\n";
+		}
+
+		const std::string text = out.str();
+		io::replace_file(index_path(), reinterpret_cast<const uint8_t*>(text.data()), text.size());
+	}
+
+	// Other processes may have added, used or evicted entries since the index was read.
+	// They all go through here as well, so the index on disk is up to date once the lock is held.
+	void NoteCache::update_index(uint64_t hash, uint64_t size)
+	{
+		io::FileLock lock(lock_path());
+		if (!lock.locked())
+		{
+			return;
+		}
+
+		m_entries.clear();
+		read_index();
+
+		if (io::file_exists(entry_path(hash)))
+		{
+			m_entries[hash] = ENTRY{ size, ++m_clock };
+		}
+
+		evict();
+		write_index();
+	}
+
+	void NoteCache::store(const CachedNotes& notes)
+	{
+		// Other processes may have the old entry mapped, so it must not be rewritten in place.
+		// The cache is best effort: an unwritable directory only costs speed.
+		if (io::replace_file(entry_path(notes.hash()), notes.image(), notes.image_size()))
+		{
+			update_index(notes.hash(), notes.image_size());
+		}
+	}
+
+	void NoteCache::evict()
+	{
+		while (!m_entries.empty() && total_size() > m_max_size)
+		{
+			auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+				[](const std::pair<const uint64_t, ENTRY>& x, const std::pair<const uint64_t, ENTRY>& y)
+			{ return x.second.last_used < y.second.last_used; });
+
+			std::remove(entry_path(oldest->first).c_str());
+			m_entries.erase(oldest);
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#ifndef NOTE_CACHE_H
+#define NOTE_CACHE_H
+
+#include "midi.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace midi {
+
+	uint64_t content_hash(const uint8_t* data, size_t size);
+
+	struct TEMPO_CHANGE
+	{
+	public:
+		Time time;
+		uint32_t microseconds_per_quarter;
+	};
+
+	// Gathers set tempo (0x51) meta events of a single track.
+	class TempoCollector : public EventReceiver
+	{
+	public:
+		Time time = Time(0);
+		std::vector<TEMPO_CHANGE>& tempo_map;
+
+		TempoCollector(std::vector<TEMPO_CHANGE>& tempo_map) :
+			tempo_map(tempo_map) { }
+
+		void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+		void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+		void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+		void program_change(Duration dt, Channel channel, Instrument program) override;
+		void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+		void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+		void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+		void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+	};
+
+	struct NOTE_STATS
+	{
+	public:
+		uint64_t note_count;
+		// Time at which the last note ends
+		Time end;
+		NoteNumber lowest;
+		NoteNumber highest;
+	};
+
+	NOTE_STATS compute_stats(const std::vector<NOTE>& notes);
+
+	// Serialized form of everything read_notes extracts from a MIDI file.
+	// All arrays are stored column-wise and 8-byte aligned so that a
+	// mapped cache file can be used in place.
+	class CachedNotes
+	{
+	public:
+		// Parses a MIDI file
+		static std::shared_ptr<CachedNotes> parse(const uint8_t* data, size_t size);
+
+		// Takes ownership of a serialized image, nullptr if it is invalid
+		static std::shared_ptr<CachedNotes> from_image(std::shared_ptr<const void> owner, const uint8_t* data, size_t size);
+
+		const uint8_t* image() const { return m_image; }
+		size_t image_size() const { return m_image_size; }
+
+		uint64_t hash() const;
+		uint64_t source_size() const;
+		NOTE_STATS stats() const;
+
+		size_t size() const;
+		NOTE operator [](size_t index) const;
+		std::vector<NOTE> notes() const;
+
+		const uint64_t* starts() const;
+		const uint64_t* durations() const;
+		const uint8_t* note_numbers() const;
+		const uint8_t* velocities() const;
+		const uint8_t* instruments() const;
+
+		size_t tempo_count() const;
+		TEMPO_CHANGE tempo(size_t index) const;
+
+	private:
+		CachedNotes(std::shared_ptr<const void> owner, const uint8_t* image, size_t image_size);
+
+		std::shared_ptr<const void> m_owner;
+		const uint8_t* m_image;
+		size_t m_image_size;
+	};
+
+	// On-disk cache of parsed MIDI files, keyed by content_hash of the file.
+	// Least recently used entries are removed once the total size exceeds max_size bytes.
+	// Several processes can share a directory: files are replaced by renaming, never
+	// rewritten in place, and the index is only read and written under a lock file.
+	class NoteCache
+	{
+	public:
+		NoteCache(const std::string& directory, uint64_t max_size);
+
+		std::shared_ptr<CachedNotes> load(const std::string& midi_path);
+
+		unsigned hits() const { return m_hits; }
+		unsigned misses() const { return m_misses; }
+		uint64_t total_size() const;
+
+	private:
+		struct ENTRY
+		{
+			uint64_t size;
+			uint64_t last_used;
+		};
+
+		std::string entry_path(uint64_t hash) const;
+		std::string index_path() const;
+		std::string lock_path() const;
+		void read_index();
+		void write_index() const;
+		void update_index(uint64_t hash, uint64_t size);
+		void store(const CachedNotes&);
+		void evict();
+
+		std::string m_directory;
+		uint64_t m_max_size;
+		uint64_t m_clock;
+		std::map<uint64_t, ENTRY> m_entries;
+		unsigned m_hits;
+		unsigned m_misses;
+	};
+}
+
+#endif
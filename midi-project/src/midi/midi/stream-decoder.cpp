@@ -0,0 +1,75 @@
+#include "stream-decoder.h"
+
+namespace midi {
+
+	StreamDecoder::StreamDecoder()
+		: m_status(0), m_received(0), m_needed(0), m_skip(0), m_in_sysex(false), m_dropped(0)
+	{
+		m_data[0] = m_data[1] = 0;
+	}
+
+	size_t StreamDecoder::decode(const uint8_t* bytes, size_t count, MESSAGE* out)
+	{
+		size_t messages = 0;
+
+		for (size_t i = 0; i != count; ++i)
+		{
+			const uint8_t byte = bytes[i];
+
+			if (byte >= 0xF8)
+			{
+				// Real-time messages interrupt nothing
+				continue;
+			}
+
+			if (byte & 0x80)
+			{
+				const STATUS_INFO& info = status_table[byte];
+				m_in_sysex = byte == 0xF0;
+				m_received = 0;
+
+				if (info.running_status)
+				{
+					m_status = byte;
+					m_needed = info.data_bytes;
+					m_skip = 0;
+				}
+				else
+				{
+					// System exclusive (up to 0xF7) and system common messages
+					m_status = 0;
+					m_skip = byte == 0xF2 ? 2 : byte == 0xF1 || byte == 0xF3 ? 1 : 0;
+				}
+				continue;
+			}
+
+			if (m_in_sysex)
+			{
+				continue;
+			}
+
+			if (m_skip != 0)
+			{
+				--m_skip;
+				continue;
+			}
+
+			if (m_status == 0)
+			{
+				++m_dropped;
+				continue;
+			}
+
+			m_data[m_received++] = byte;
+
+			if (m_received == m_needed)
+			{
+				out[messages++] = MESSAGE{ m_status, m_data[0], m_needed == 2 ? m_data[1] : uint8_t(0) };
+				// Running status: the next data byte starts a message with the same status
+				m_received = 0;
+			}
+		}
+
+		return messages;
+	}
+}
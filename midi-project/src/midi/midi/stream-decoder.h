@@ -0,0 +1,56 @@
+#ifndef STREAM_DECODER_H
+#define STREAM_DECODER_H
+
+#include "midi.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace midi {
+
+	// A channel message as it arrives on the wire. data2 is 0 for
+	// messages with a single data byte (program change, channel pressure).
+	struct MESSAGE
+	{
+	public:
+		uint8_t status;
+		uint8_t data1;
+		uint8_t data2;
+	};
+
+	// Decodes raw MIDI bytes as sent over a cable or a pipe, without the
+	// delta times and chunks of a file, in pieces of any size: a message
+	// may be split over several calls to decode.
+	//
+	// Running status is honoured. Real-time bytes (0xF8-0xFF) may appear
+	// anywhere, even in between the data bytes of a message, and are skipped;
+	// note that 0xFF is a reset on the wire, not a meta event. System exclusive
+	// and system common messages are skipped as well and cancel running status.
+	// Data bytes without a status to go with them are dropped.
+	class StreamDecoder
+	{
+	public:
+		StreamDecoder();
+
+		// Decodes count bytes, and stores the channel messages they complete
+		// in out, which must have room for count messages. Returns how many
+		// there were. Does not allocate.
+		size_t decode(const uint8_t* bytes, size_t count, MESSAGE* out);
+
+		// Number of bytes that were dropped because they belonged to no message
+		uint64_t dropped() const { return m_dropped; }
+
+	private:
+		// Status of the message being read; 0 if there is none
+		uint8_t m_status;
+		uint8_t m_data[2];
+		uint8_t m_received;
+		// Data bytes the current message needs
+		uint8_t m_needed;
+		// Data bytes of a system common message still to skip
+		uint8_t m_skip;
+		bool m_in_sysex;
+		uint64_t m_dropped;
+	};
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "track-index.h"
+#include "logging.h"
+#include <algorithm>
+
+namespace midi {
+
+	namespace
+	{
+		class NullReceiver : public EventReceiver
+		{
+		public:
+			void note_on(Duration, Channel, NoteNumber, uint8_t) override { }
+			void note_off(Duration, Channel, NoteNumber, uint8_t) override { }
+			void polyphonic_key_pressure(Duration, Channel, NoteNumber, uint8_t) override { }
+			void control_change(Duration, Channel, uint8_t, uint8_t) override { }
+			void program_change(Duration, Channel, Instrument) override { }
+			void channel_pressure(Duration, Channel, uint8_t) override { }
+			void pitch_wheel_change(Duration, Channel, uint16_t) override { }
+			void meta(Duration, uint8_t, std::unique_ptr<uint8_t[]>, uint64_t) override { }
+			void sysex(Duration, std::unique_ptr<uint8_t[]>, uint64_t) override { }
+		};
+
+		// One collector per channel, all feeding the same callback
+		class ChannelCollectors
+		{
+		public:
+			std::vector<ChannelNoteCollector> collectors;
+			EventFanout<ChannelNoteCollector> fanout;
+
+			ChannelCollectors(std::function<void(const NOTE&)> receiver)
+			{
+				collectors.reserve(16);
+				for (uint8_t channel = 0; channel != 16; ++channel)
+				{
+					collectors.emplace_back(Channel(channel), receiver);
+				}
+				for (ChannelNoteCollector& collector : collectors)
+				{
+					fanout.receivers.push_back(&collector);
+				}
+			}
+
+			ChannelCollectors(const ChannelCollectors&) = delete;
+			ChannelCollectors& operator =(const ChannelCollectors&) = delete;
+
+			CHECKPOINT save(uint64_t offset, uint8_t running_status) const
+			{
+				CHECKPOINT checkpoint;
+				checkpoint.offset = offset;
+				checkpoint.time = collectors[0].time;
+				checkpoint.running_status = running_status;
+
+				for (const ChannelNoteCollector& collector : collectors)
+				{
+					checkpoint.instruments[value(collector.channel)] = collector.instr;
+
+					for (uint8_t note = 0; note != 128; ++note)
+					{
+						if (collector.is_sounding(NoteNumber(note)))
+						{
+							checkpoint.sounding_notes.push_back(SOUNDING_NOTE{
+								collector.channel, NoteNumber(note),
+								collector.tijdjes[note], uint8_t(collector.velos[note]) });
+						}
+					}
+				}
+				return checkpoint;
+			}
+
+			void restore(const CHECKPOINT& checkpoint)
+			{
+				for (ChannelNoteCollector& collector : collectors)
+				{
+					collector.time = checkpoint.time;
+					collector.instr = checkpoint.instruments[value(collector.channel)];
+				}
+				for (const SOUNDING_NOTE& note : checkpoint.sounding_notes)
+				{
+					ChannelNoteCollector& collector = collectors[value(note.channel)];
+					collector.tijdjes[value(note.note_number)] = note.start;
+					collector.velos[value(note.note_number)] = note.velocity;
+				}
+			}
+		};
+	}
+
+	TrackIndex::TrackIndex(std::istream& in, EventReceiver& receiver, size_t interval) :
+		m_interval(interval)
+	{
+		build(in, receiver);
+	}
+
+	TrackIndex::TrackIndex(std::istream& in, size_t interval) :
+		m_interval(interval)
+	{
+		NullReceiver receiver;
+		build(in, receiver);
+	}
+
+	void TrackIndex::build(std::istream& in, EventReceiver& receiver)
+	{
+		CHECK(m_interval > 0) << "Checkpoint interval must be positive";
+
+		CHUNK_HEADER header;
+		read_chunk_header(in, &header);
+		CHECK(header_id(header) == "MTrk") << "Expected MTrk, got " << header_id(header);
+
+		ChannelCollectors state([](const NOTE&) { });
+		EventFanout<> fanout({ &state.fanout, &receiver });
+		uint8_t running_status = 0;
+		size_t events = 0;
+
+		do
+		{
+			if (events % m_interval == 0)
+			{
+				m_checkpoints.push_back(state.save(uint64_t(in.tellg()), running_status));
+			}
+			++events;
+		} while (read_event(in, fanout, running_status));
+	}
+
+	const CHECKPOINT& TrackIndex::find(Time time) const
+	{
+		// Strictly before time, so that no event at time itself has been consumed yet
+		auto it = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), time,
+			[](const CHECKPOINT& checkpoint, Time t) { return checkpoint.time < t; });
+
+		return it == m_checkpoints.begin() ? *it : *(it - 1);
+	}
+
+	void TrackIndex::resume(std::istream& in, const CHECKPOINT& checkpoint, EventReceiver& receiver) const
+	{
+		in.clear();
+		in.seekg(std::streamoff(checkpoint.offset));
+		uint8_t running_status = checkpoint.running_status;
+
+		while (read_event(in, receiver, running_status))
+		{
+			// NOP
+		}
+	}
+
+	std::vector<NOTE> TrackIndex::read_notes_from(std::istream& in, Time time) const
+	{
+		std::vector<NOTE> notes;
+		ChannelCollectors state([&notes, time](const NOTE& note)
+		{
+			if (note.start + note.duration > time || note.start >= time)
+			{
+				notes.push_back(note);
+			}
+		});
+
+		const CHECKPOINT& checkpoint = find(time);
+		state.restore(checkpoint);
+		resume(in, checkpoint, state.fanout);
+
+		return notes;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef TRACK_INDEX_H
+#define TRACK_INDEX_H
+
+#include "midi.h"
+#include <istream>
+#include <vector>
+
+namespace midi {
+
+	struct SOUNDING_NOTE
+	{
+	public:
+		Channel channel;
+		NoteNumber note_number;
+		Time start;
+		uint8_t velocity;
+	};
+
+	// Decoder state in between two events of a track.
+	struct CHECKPOINT
+	{
+	public:
+		// Stream position of the next event
+		uint64_t offset;
+		// Absolute time of the last event read
+		Time time;
+		uint8_t running_status;
+		Instrument instruments[16];
+		// Notes that have been turned on but not yet off
+		std::vector<SOUNDING_NOTE> sounding_notes;
+	};
+
+	// Records a checkpoint every interval events while a track is decoded,
+	// so that later reads can start close to a given time instead of at
+	// the beginning of the track.
+	// Checkpoint offsets are absolute positions in the stream that was indexed.
+	class TrackIndex
+	{
+	public:
+		// Decodes the MTrk chunk at the current position of in,
+		// passing every event on to receiver.
+		TrackIndex(std::istream& in, EventReceiver& receiver, size_t interval = 1024);
+		TrackIndex(std::istream& in, size_t interval = 1024);
+
+		size_t interval() const { return m_interval; }
+		const std::vector<CHECKPOINT>& checkpoints() const { return m_checkpoints; }
+
+		// Last checkpoint before time, or the start of the track
+		const CHECKPOINT& find(Time time) const;
+
+		// Decodes the events following checkpoint up to End of Track.
+		// The first event's delta time is relative to checkpoint.time.
+		void resume(std::istream& in, const CHECKPOINT& checkpoint, EventReceiver& receiver) const;
+
+		// Notes of the track that are still sounding at time or start later,
+		// in the same order as read_notes would produce them.
+		std::vector<NOTE> read_notes_from(std::istream& in, Time time) const;
+
+	private:
+		size_t m_interval;
+		std::vector<CHECKPOINT> m_checkpoints;
+
+		void build(std::istream& in, EventReceiver& receiver);
+	};
+}
+
+#endif
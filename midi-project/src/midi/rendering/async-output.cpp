@@ -0,0 +1,257 @@
+#include "rendering/async-output.h"
+#include "io/mapped-file.h"
+#include "logging.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+
+
+using namespace rendering;
+
+
+namespace
+{
+    // Marks the user data of unlinks, whose completions only tell whether there was a file to remove
+    const uint64_t UNLINK = uint64_t(1) << 32;
+
+    // Operations that may wait before write hands them to the kernel
+    const unsigned SUBMIT_BATCH = 16;
+}
+
+
+ThreadedFileOutput::ThreadedFileOutput(unsigned threads, unsigned max_in_flight)
+    : m_jobs(max_in_flight), m_queue(max_in_flight), m_queue_first(0), m_queue_size(0), m_pending(0), m_stopping(false)
+{
+    CHECK(threads > 0 && max_in_flight > 0) << "Need at least one thread and one frame in flight";
+
+    for (unsigned i = max_in_flight; i != 0; --i)
+    {
+        m_free.push_back(i - 1);
+    }
+    for (unsigned i = 0; i != threads; ++i)
+    {
+        m_threads.emplace_back([this]() { work(); });
+    }
+}
+
+ThreadedFileOutput::~ThreadedFileOutput()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_job_available.notify_all();
+
+    // Threads finish the queue before they stop
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadedFileOutput::write(const std::string& name, BufferPool::Buffer data)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job_done.wait(lock, [this]() { return !m_free.empty(); });
+
+    const unsigned index = m_free.back();
+    m_free.pop_back();
+    m_jobs[index].name.assign(name);
+    m_jobs[index].data = std::move(data);
+
+    m_queue[(m_queue_first + m_queue_size) % m_queue.size()] = index;
+    ++m_queue_size;
+    ++m_pending;
+
+    lock.unlock();
+    m_job_available.notify_one();
+}
+
+bool ThreadedFileOutput::repeat(const std::string& name, const std::string& original)
+{
+    flush();
+
+    return io::create_hard_link(original, name);
+}
+
+void ThreadedFileOutput::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job_done.wait(lock, [this]() { return m_pending == 0; });
+}
+
+void ThreadedFileOutput::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_job_available.wait(lock, [this]() { return m_queue_size != 0 || m_stopping; });
+
+        if (m_queue_size == 0)
+        {
+            return;
+        }
+
+        const unsigned index = m_queue[m_queue_first];
+        m_queue_first = (m_queue_first + 1) % m_queue.size();
+        --m_queue_size;
+
+        // Nobody else touches the slot until it is back on the free list
+        JOB& job = m_jobs[index];
+        lock.unlock();
+        io::write_file(job.name, job.data.data(), job.data.size());
+        job.data.release();
+        lock.lock();
+
+        m_free.push_back(index);
+        --m_pending;
+        m_job_done.notify_all();
+    }
+}
+
+UringFileOutput::UringFileOutput(unsigned max_in_flight)
+    : m_ring(2 * max_in_flight), m_jobs(max_in_flight)
+{
+    CHECK(max_in_flight > 0) << "Need at least one frame in flight";
+
+    for (unsigned i = max_in_flight; i != 0; --i)
+    {
+        m_jobs[i - 1].state = State::free;
+        m_free.push_back(i - 1);
+    }
+}
+
+UringFileOutput::~UringFileOutput()
+{
+    flush();
+}
+
+void UringFileOutput::write(const std::string& name, BufferPool::Buffer data)
+{
+    // Every job has at most two operations in flight, so the submission queue,
+    // which has room for two per job, cannot overflow
+    complete();
+    while (m_free.empty())
+    {
+        m_ring.submit(1);
+        complete();
+    }
+
+    const unsigned index = m_free.back();
+    m_free.pop_back();
+
+    JOB& job = m_jobs[index];
+    job.state = State::opening;
+    job.name.assign(name);
+    job.data = std::move(data);
+    job.written = 0;
+    job.fd = -1;
+
+    // The frame may be a hard link left by an earlier render; truncating it would change every name linked to it
+    CHECK(m_ring.queue_unlink(job.name.c_str(), UNLINK | index)) << "io_uring submission queue is full";
+    CHECK(m_ring.queue_open(job.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644, index)) << "io_uring submission queue is full";
+
+    // Also passes on the writes and closes queued by complete(); waiting for a free job and flush() submit the rest
+    if (m_ring.queued() >= SUBMIT_BATCH)
+    {
+        m_ring.submit();
+    }
+}
+
+bool UringFileOutput::repeat(const std::string& name, const std::string& original)
+{
+    flush();
+
+    return io::create_hard_link(original, name);
+}
+
+void UringFileOutput::flush()
+{
+    complete();
+    while (m_free.size() != m_jobs.size())
+    {
+        m_ring.submit(1);
+        complete();
+    }
+}
+
+void UringFileOutput::queue_write(unsigned index)
+{
+    JOB& job = m_jobs[index];
+    const size_t left = job.data.size() - job.written;
+    const uint32_t size = uint32_t(std::min<size_t>(left, 1u << 30));
+
+    CHECK(m_ring.queue_write(job.fd, job.data.data() + job.written, size, job.written, index)) << "io_uring submission queue is full";
+}
+
+void UringFileOutput::complete()
+{
+    uint64_t user_data;
+    int32_t result;
+
+    while (m_ring.next_completion(&user_data, &result))
+    {
+        // The open that follows reports any problem with the file
+        if (user_data & UNLINK)
+        {
+            continue;
+        }
+
+        const unsigned index = unsigned(user_data);
+        JOB& job = m_jobs[index];
+
+        switch (job.state)
+        {
+        case State::opening:
+            CHECK(result >= 0) << "Could not create " << job.name << ": " << strerror(-result);
+            job.fd = result;
+            job.state = State::writing;
+            queue_write(index);
+            break;
+
+        case State::writing:
+            CHECK(result > 0 || job.data.size() == 0) << "Could not write to " << job.name << ": " << strerror(-result);
+            job.written += size_t(std::max(result, 0));
+
+            // Short writes continue where they left off
+            if (job.written < job.data.size())
+            {
+                queue_write(index);
+            }
+            else
+            {
+                job.data.release();
+                job.state = State::closing;
+                CHECK(m_ring.queue_close(job.fd, index)) << "io_uring submission queue is full";
+            }
+            break;
+
+        case State::closing:
+            job.state = State::free;
+            m_free.push_back(index);
+            break;
+
+        case State::free:
+            CHECK(false) << "Completion for a free job";
+            break;
+        }
+    }
+}
+
+std::unique_ptr<FrameOutput> rendering::create_file_output(WriteMode mode, unsigned max_in_flight)
+{
+    switch (mode)
+    {
+    case WriteMode::io_uring:
+        if (io::IoUring::supported())
+        {
+            return std::make_unique<UringFileOutput>(max_in_flight);
+        }
+        // Fall through
+    case WriteMode::thread:
+        return std::make_unique<ThreadedFileOutput>(2, max_in_flight);
+    default:
+        return std::make_unique<FileOutput>();
+    }
+}
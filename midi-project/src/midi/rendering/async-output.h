@@ -0,0 +1,121 @@
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+#include "rendering/frame-writer.h"
+#include "io/io-uring.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace rendering
+{
+    enum class WriteMode
+    {
+        sync,
+        thread,
+        io_uring
+    };
+
+    /// <summary>
+    /// Writes each frame to its own file on background threads, so that rendering and
+    /// encoding go on while the file system works. At most <paramref name="max_in_flight" />
+    /// frames are waiting to be written; write() blocks while that many are.
+    /// Buffers go back to their pool as soon as their frame is in its file.
+    /// </summary>
+    class ThreadedFileOutput final : public FrameOutput
+    {
+    public:
+        ThreadedFileOutput(unsigned threads = 2, unsigned max_in_flight = 32);
+        ~ThreadedFileOutput();
+
+        ThreadedFileOutput(const ThreadedFileOutput&) = delete;
+        ThreadedFileOutput& operator =(const ThreadedFileOutput&) = delete;
+
+        void write(const std::string& name, BufferPool::Buffer data) override;
+
+        /// <summary>
+        /// Hard links need the original file, so this waits for pending writes first.
+        /// </summary>
+        bool repeat(const std::string& name, const std::string& original) override;
+
+        void flush() override;
+
+    private:
+        struct JOB
+        {
+            std::string name;
+            BufferPool::Buffer data;
+        };
+
+        void work();
+
+        std::mutex m_mutex;
+        std::condition_variable m_job_available;
+        std::condition_variable m_job_done;
+        // Jobs are slots that are reused, so that their names keep their capacity
+        std::vector<JOB> m_jobs;
+        std::vector<unsigned> m_free;
+        // Ring of slots waiting for a thread
+        std::vector<unsigned> m_queue;
+        size_t m_queue_first;
+        size_t m_queue_size;
+        unsigned m_pending;
+        bool m_stopping;
+        std::vector<std::thread> m_threads;
+    };
+
+    /// <summary>
+    /// Writes each frame to its own file through io_uring: the unlink of any old file, open, write
+    /// and close of many frames are handed to the kernel in batches, with one system call per
+    /// batch. Same bounds and buffer handling as ThreadedFileOutput.
+    /// Requires io::IoUring::supported().
+    /// </summary>
+    class UringFileOutput final : public FrameOutput
+    {
+    public:
+        UringFileOutput(unsigned max_in_flight = 32);
+        ~UringFileOutput();
+
+        void write(const std::string& name, BufferPool::Buffer data) override;
+        bool repeat(const std::string& name, const std::string& original) override;
+        void flush() override;
+
+    private:
+        enum class State
+        {
+            free,
+            opening,
+            writing,
+            closing
+        };
+
+        struct JOB
+        {
+            State state;
+            std::string name;
+            BufferPool::Buffer data;
+            size_t written;
+            int fd;
+        };
+
+        void queue_write(unsigned index);
+        // Handles the completions that are available, queueing the next step of each job
+        void complete();
+
+        io::IoUring m_ring;
+        std::vector<JOB> m_jobs;
+        std::vector<unsigned> m_free;
+    };
+
+    /// <summary>
+    /// Output that writes frames to files using <paramref name="mode" />.
+    /// io_uring falls back to threads when it is not supported.
+    /// </summary>
+    std::unique_ptr<FrameOutput> create_file_output(WriteMode mode, unsigned max_in_flight = 32);
+}
+
+#endif
@@ -0,0 +1,392 @@
+#include "rendering/avi-writer.h"
+#include "audio/wav-writer.h"
+#include "logging.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+namespace
+{
+    // AVIF_HASINDEX | AVIF_ISINTERLEAVED
+    const uint32_t AVI_FLAGS = 0x10 | 0x100;
+
+    // AVIIF_KEYFRAME
+    const uint32_t KEYFRAME = 0x10;
+
+    const unsigned AUDIO_CHANNELS = 2;
+    const unsigned AUDIO_BLOCK_ALIGN = AUDIO_CHANNELS * sizeof(int16_t);
+
+#   pragma pack(push, r1, 1)
+    struct CHUNK_HEADER
+    {
+        char id[4];
+        uint32_t size;
+    };
+
+    struct LIST_HEADER
+    {
+        char list[4];
+        uint32_t size;      /* Size of the list's contents, including the type */
+        char type[4];
+    };
+
+    struct MAIN_HEADER
+    {
+        uint32_t microseconds_per_frame;
+        uint32_t max_bytes_per_second;
+        uint32_t padding_granularity;
+        uint32_t flags;
+        uint32_t total_frames;
+        uint32_t initial_frames;
+        uint32_t streams;
+        uint32_t suggested_buffer_size;
+        uint32_t width;
+        uint32_t height;
+        uint32_t reserved[4];
+    };
+
+    struct STREAM_HEADER
+    {
+        char type[4];
+        char handler[4];
+        uint32_t flags;
+        uint16_t priority;
+        uint16_t language;
+        uint32_t initial_frames;
+        uint32_t scale;         /* Rate / scale is the number of samples per second */
+        uint32_t rate;
+        uint32_t start;
+        uint32_t length;        /* In samples */
+        uint32_t suggested_buffer_size;
+        uint32_t quality;
+        uint32_t sample_size;   /* 0 if samples vary in size */
+        int16_t frame[4];
+    };
+
+    struct BITMAP_INFO
+    {
+        uint32_t size;
+        int32_t width;
+        int32_t height;         /* Positive for bottom-up rows */
+        uint16_t planes;
+        uint16_t bit_count;
+        uint32_t compression;
+        uint32_t size_image;
+        int32_t x_pixels_per_meter;
+        int32_t y_pixels_per_meter;
+        uint32_t colors_used;
+        uint32_t colors_important;
+    };
+
+    struct WAVE_FORMAT
+    {
+        uint16_t format_tag;
+        uint16_t channels;
+        uint32_t sample_rate;
+        uint32_t bytes_per_second;
+        uint16_t block_align;
+        uint16_t bits_per_sample;
+        uint16_t extension_size;
+    };
+
+    // Everything in front of the first chunk of the movi list
+    struct AVI_HEADERS
+    {
+        LIST_HEADER riff;
+        LIST_HEADER hdrl;
+        CHUNK_HEADER avih_header;
+        MAIN_HEADER avih;
+        LIST_HEADER video_strl;
+        CHUNK_HEADER video_strh_header;
+        STREAM_HEADER video_strh;
+        CHUNK_HEADER video_strf_header;
+        BITMAP_INFO video_strf;
+        LIST_HEADER audio_strl;
+        CHUNK_HEADER audio_strh_header;
+        STREAM_HEADER audio_strh;
+        CHUNK_HEADER audio_strf_header;
+        WAVE_FORMAT audio_strf;
+        LIST_HEADER movi;
+    };
+#   pragma pack(pop, r1)
+
+    template<typename T>
+    uint32_t size_from(const T& member, const AVI_HEADERS& headers, size_t end)
+    {
+        // Bytes from right after member, a list or chunk header's size field, to end
+        const size_t start = size_t(reinterpret_cast<const char*>(&member) - reinterpret_cast<const char*>(&headers)) + 8;
+        return uint32_t(end - start);
+    }
+
+    size_t row_size(unsigned width)
+    {
+        // Rows of a DIB are padded to a multiple of 4 bytes
+        return (3 * size_t(width) + 3) & ~size_t(3);
+    }
+}
+
+AviWriter::AviWriter(const std::string& path, unsigned width, unsigned height, unsigned numerator, unsigned denominator,
+    unsigned sample_rate, bool elide_duplicates)
+    : m_out(m_file), m_width(width), m_height(height), m_numerator(numerator), m_denominator(denominator),
+      m_sample_rate(sample_rate), m_elide_duplicates(elide_duplicates), m_size(0), m_movi(0), m_largest_chunk(0),
+      m_frames(0), m_elided(0), m_audio_frames(0), m_closed(false), m_row(width)
+{
+    m_file.open(path, std::ios::binary);
+    CHECK(m_file) << "Could not create " << path;
+
+    start();
+}
+
+AviWriter::AviWriter(std::ostream& out, unsigned width, unsigned height, unsigned numerator, unsigned denominator,
+    unsigned sample_rate, bool elide_duplicates)
+    : m_out(out), m_width(width), m_height(height), m_numerator(numerator), m_denominator(denominator),
+      m_sample_rate(sample_rate), m_elide_duplicates(elide_duplicates), m_size(0), m_movi(0), m_largest_chunk(0),
+      m_frames(0), m_elided(0), m_audio_frames(0), m_closed(false), m_row(width)
+{
+    start();
+}
+
+AviWriter::~AviWriter()
+{
+    if (!m_closed)
+    {
+        close();
+    }
+}
+
+void AviWriter::start()
+{
+    CHECK(m_width > 0 && m_height > 0) << "Frames must not be empty";
+    CHECK(m_numerator > 0 && m_denominator > 0) << "Invalid frame rate " << m_numerator << "/" << m_denominator;
+    CHECK(m_sample_rate > 0) << "Sample rate must be positive";
+
+    const size_t frame_size = row_size(m_width) * m_height;
+    CHECK(frame_size <= std::numeric_limits<uint32_t>::max() / 2) << "Frames are too large for an AVI file";
+
+    m_pixels.resize(frame_size);
+    m_previous.resize(frame_size);
+
+    // Counts are still 0; close() writes the headers again once they are known
+    m_start = m_out.tellp();
+    m_size = sizeof(AVI_HEADERS);
+    m_movi = offsetof(AVI_HEADERS, movi) + offsetof(LIST_HEADER, type);
+    write_headers(m_size, m_size);
+}
+
+void AviWriter::write_headers(uint64_t movi_end, uint64_t file_end)
+{
+    const size_t frame_size = m_pixels.size();
+    const uint64_t movi_size = movi_end - sizeof(AVI_HEADERS);
+    const uint32_t audio_bytes_per_second = m_sample_rate * AUDIO_BLOCK_ALIGN;
+
+    AVI_HEADERS headers;
+    memset(&headers, 0, sizeof(headers));
+
+    memcpy(headers.riff.list, "RIFF", 4);
+    headers.riff.size = uint32_t(file_end - 8);
+    memcpy(headers.riff.type, "AVI ", 4);
+
+    memcpy(headers.hdrl.list, "LIST", 4);
+    headers.hdrl.size = size_from(headers.hdrl, headers, offsetof(AVI_HEADERS, movi));
+    memcpy(headers.hdrl.type, "hdrl", 4);
+
+    memcpy(headers.avih_header.id, "avih", 4);
+    headers.avih_header.size = sizeof(MAIN_HEADER);
+    headers.avih.microseconds_per_frame = uint32_t(uint64_t(1000000) * m_denominator / m_numerator);
+    headers.avih.max_bytes_per_second = uint32_t(std::min<uint64_t>(
+        uint64_t(frame_size) * m_numerator / m_denominator + audio_bytes_per_second, std::numeric_limits<uint32_t>::max()));
+    headers.avih.flags = AVI_FLAGS;
+    headers.avih.total_frames = uint32_t(m_frames);
+    headers.avih.streams = 2;
+    headers.avih.suggested_buffer_size = m_largest_chunk;
+    headers.avih.width = m_width;
+    headers.avih.height = m_height;
+
+    memcpy(headers.video_strl.list, "LIST", 4);
+    headers.video_strl.size = size_from(headers.video_strl, headers, offsetof(AVI_HEADERS, audio_strl));
+    memcpy(headers.video_strl.type, "strl", 4);
+
+    memcpy(headers.video_strh_header.id, "strh", 4);
+    headers.video_strh_header.size = sizeof(STREAM_HEADER);
+    memcpy(headers.video_strh.type, "vids", 4);
+    memcpy(headers.video_strh.handler, "DIB ", 4);
+    headers.video_strh.scale = m_denominator;
+    headers.video_strh.rate = m_numerator;
+    headers.video_strh.length = uint32_t(m_frames);
+    headers.video_strh.suggested_buffer_size = uint32_t(frame_size);
+    headers.video_strh.quality = std::numeric_limits<uint32_t>::max();
+    headers.video_strh.frame[2] = int16_t(m_width);
+    headers.video_strh.frame[3] = int16_t(m_height);
+
+    memcpy(headers.video_strf_header.id, "strf", 4);
+    headers.video_strf_header.size = sizeof(BITMAP_INFO);
+    headers.video_strf.size = sizeof(BITMAP_INFO);
+    headers.video_strf.width = int32_t(m_width);
+    headers.video_strf.height = int32_t(m_height);
+    headers.video_strf.planes = 1;
+    headers.video_strf.bit_count = 24;
+    headers.video_strf.size_image = uint32_t(frame_size);
+
+    memcpy(headers.audio_strl.list, "LIST", 4);
+    headers.audio_strl.size = size_from(headers.audio_strl, headers, offsetof(AVI_HEADERS, movi));
+    memcpy(headers.audio_strl.type, "strl", 4);
+
+    memcpy(headers.audio_strh_header.id, "strh", 4);
+    headers.audio_strh_header.size = sizeof(STREAM_HEADER);
+    memcpy(headers.audio_strh.type, "auds", 4);
+    headers.audio_strh.scale = 1;
+    headers.audio_strh.rate = m_sample_rate;
+    headers.audio_strh.length = uint32_t(m_audio_frames);
+    headers.audio_strh.suggested_buffer_size = m_largest_chunk;
+    headers.audio_strh.quality = std::numeric_limits<uint32_t>::max();
+    headers.audio_strh.sample_size = AUDIO_BLOCK_ALIGN;
+
+    memcpy(headers.audio_strf_header.id, "strf", 4);
+    headers.audio_strf_header.size = sizeof(WAVE_FORMAT);
+    headers.audio_strf.format_tag = 1;
+    headers.audio_strf.channels = AUDIO_CHANNELS;
+    headers.audio_strf.sample_rate = m_sample_rate;
+    headers.audio_strf.bytes_per_second = audio_bytes_per_second;
+    headers.audio_strf.block_align = AUDIO_BLOCK_ALIGN;
+    headers.audio_strf.bits_per_sample = 16;
+
+    memcpy(headers.movi.list, "LIST", 4);
+    headers.movi.size = uint32_t(movi_size + 4);
+    memcpy(headers.movi.type, "movi", 4);
+
+    m_out.write(reinterpret_cast<const char*>(&headers), sizeof(headers));
+
+    CHECK(m_out) << "Could not write AVI headers";
+}
+
+void AviWriter::write_chunk(const char* id, const void* data, uint32_t size, uint32_t flags)
+{
+    const uint32_t padding = size & 1;
+
+    // The index is appended at the end, and the whole must fit in 32 bits
+    const uint64_t index_size = sizeof(CHUNK_HEADER) + (m_index.size() + 1) * sizeof(INDEX_ENTRY);
+    CHECK(m_size + sizeof(CHUNK_HEADER) + size + padding + index_size <= std::numeric_limits<uint32_t>::max())
+        << "Video is too long for an AVI file";
+
+    INDEX_ENTRY entry;
+    memcpy(entry.id, id, 4);
+    entry.flags = flags;
+    entry.offset = uint32_t(m_size - m_movi);
+    entry.size = size;
+    m_index.push_back(entry);
+
+    CHUNK_HEADER header;
+    memcpy(header.id, id, 4);
+    header.size = size;
+
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.write(static_cast<const char*>(data), std::streamsize(size));
+    if (padding)
+    {
+        m_out.put(0);
+    }
+    CHECK(m_out) << "Could not write AVI chunk";
+
+    m_size += sizeof(header) + size + padding;
+    m_largest_chunk = std::max(m_largest_chunk, size);
+}
+
+bool AviWriter::write_frame(const Bitmap& frame)
+{
+    CHECK(!m_closed) << "AVI file has been closed";
+    CHECK(frame.width() == m_width && frame.height() == m_height) << "Frame has the wrong size";
+
+    const size_t stride = row_size(m_width);
+
+    for (unsigned y = 0; y != m_height; ++y)
+    {
+        frame.read_row(Position(0, y), m_width, m_row.data());
+
+        // Bottom row first
+        uint8_t* out = &m_pixels[size_t(m_height - 1 - y) * stride];
+
+        for (unsigned x = 0; x != m_width; ++x)
+        {
+            const Color& c = m_row[x];
+            out[3 * x + 0] = uint8_t(c.b * 255);
+            out[3 * x + 1] = uint8_t(c.g * 255);
+            out[3 * x + 2] = uint8_t(c.r * 255);
+        }
+    }
+
+    const bool duplicate = m_elide_duplicates && m_frames != 0 && m_pixels == m_previous;
+    ++m_frames;
+
+    if (duplicate)
+    {
+        write_chunk("00db", nullptr, 0, 0);
+        ++m_elided;
+    }
+    else
+    {
+        write_chunk("00db", m_pixels.data(), uint32_t(m_pixels.size()), KEYFRAME);
+        m_pixels.swap(m_previous);
+    }
+
+    return duplicate;
+}
+
+void AviWriter::write_audio(const float* samples, size_t frames)
+{
+    CHECK(!m_closed) << "AVI file has been closed";
+
+    if (frames == 0)
+    {
+        return;
+    }
+
+    const size_t count = AUDIO_CHANNELS * frames;
+    CHECK(count * sizeof(int16_t) <= std::numeric_limits<uint32_t>::max() / 2) << "Too much audio for one chunk";
+
+    if (m_pcm.size() < count)
+    {
+        m_pcm.resize(count);
+    }
+    audio::convert_to_pcm16(samples, m_pcm.data(), count);
+
+    write_chunk("01wb", m_pcm.data(), uint32_t(count * sizeof(int16_t)), KEYFRAME);
+    m_audio_frames += frames;
+}
+
+void AviWriter::close()
+{
+    CHECK(!m_closed) << "AVI file has already been closed";
+    m_closed = true;
+
+    const uint64_t movi_end = m_size;
+
+    CHUNK_HEADER header;
+    memcpy(header.id, "idx1", 4);
+    header.size = uint32_t(m_index.size() * sizeof(INDEX_ENTRY));
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.write(reinterpret_cast<const char*>(m_index.data()), std::streamsize(header.size));
+    m_size += sizeof(header) + header.size;
+
+    if (m_start != std::streampos(-1))
+    {
+        const std::streampos end = m_out.tellp();
+
+        m_out.seekp(m_start);
+        write_headers(movi_end, m_size);
+        m_out.seekp(end);
+    }
+
+    m_out.flush();
+    CHECK(m_out) << "Could not write AVI index";
+
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef AVI_WRITER_H
+#define AVI_WRITER_H
+
+#include "imaging/bitmap.h"
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Writes an uncompressed AVI file with one video stream of 24-bit frames
+    /// and one audio stream of 16-bit stereo PCM, interleaved as they are written.
+    /// Chunks go straight to the output; only the index (16 bytes per chunk) is kept in memory,
+    /// and is appended by close(), which also fills in the lengths in the headers.
+    /// </summary>
+    class AviWriter final
+    {
+    public:
+        /// <summary>
+        /// Creates the file at <paramref name="path" />, at numerator / denominator frames per second.
+        /// If <paramref name="elide_duplicates" /> is set, a frame identical to the previous one
+        /// is stored as an empty chunk, which players take to mean "show the previous frame again".
+        /// </summary>
+        AviWriter(const std::string& path, unsigned width, unsigned height, unsigned numerator, unsigned denominator,
+            unsigned sample_rate, bool elide_duplicates = true);
+
+        /// <summary>
+        /// Writes to <paramref name="out" />, which must support seeking for close() to fill in the headers.
+        /// </summary>
+        AviWriter(std::ostream& out, unsigned width, unsigned height, unsigned numerator, unsigned denominator,
+            unsigned sample_rate, bool elide_duplicates = true);
+
+        /// <summary>
+        /// Closes the file if close() has not been called.
+        /// </summary>
+        ~AviWriter();
+
+        AviWriter(const AviWriter&) = delete;
+        AviWriter& operator =(const AviWriter&) = delete;
+
+        /// <summary>
+        /// Appends <paramref name="frame" />, which must be width x height.
+        /// Returns true if it was the same as the previous frame and was elided.
+        /// </summary>
+        bool write_frame(const imaging::Bitmap& frame);
+
+        /// <summary>
+        /// Appends <paramref name="frames" /> frames of interleaved stereo samples in [-1, 1].
+        /// Audio that goes with a video frame should be written right after it.
+        /// </summary>
+        void write_audio(const float* samples, size_t frames);
+
+        /// <summary>
+        /// Writes the index and fills in the headers.
+        /// </summary>
+        void close();
+
+        uint64_t frames() const { return m_frames; }
+        uint64_t elided() const { return m_elided; }
+        uint64_t audio_frames() const { return m_audio_frames; }
+
+    private:
+        struct INDEX_ENTRY
+        {
+            char id[4];
+            uint32_t flags;
+            // From the 'movi' identifier to the chunk's header
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        void start();
+        void write_headers(uint64_t movi_end, uint64_t file_end);
+        void write_chunk(const char* id, const void* data, uint32_t size, uint32_t flags);
+
+        std::ofstream m_file;
+        std::ostream& m_out;
+        unsigned m_width;
+        unsigned m_height;
+        unsigned m_numerator;
+        unsigned m_denominator;
+        unsigned m_sample_rate;
+        bool m_elide_duplicates;
+        std::streampos m_start;
+        // Bytes written so far, and the offset of the 'movi' identifier
+        uint64_t m_size;
+        uint64_t m_movi;
+        uint32_t m_largest_chunk;
+        uint64_t m_frames;
+        uint64_t m_elided;
+        uint64_t m_audio_frames;
+        bool m_closed;
+        std::vector<INDEX_ENTRY> m_index;
+        // Bottom-up BGR rows of the current and the previous frame
+        std::vector<uint8_t> m_pixels;
+        std::vector<uint8_t> m_previous;
+        std::vector<imaging::Color> m_row;
+        std::vector<int16_t> m_pcm;
+    };
+}
+
+#endif
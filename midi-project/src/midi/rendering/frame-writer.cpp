@@ -0,0 +1,236 @@
+#include "rendering/frame-writer.h"
+#include "imaging/bmp-format.h"
+#include "imaging/qoi-format.h"
+#include "io/mapped-file.h"
+#include "logging.h"
+#include <algorithm>
+#include <cstring>
+#include <streambuf>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+namespace
+{
+    // Lets an std::ostream write into a pooled buffer, trading it for a larger one when it is full
+    class PooledBuffer : public std::streambuf
+    {
+    public:
+        PooledBuffer(BufferPool& pool, size_t capacity)
+            : m_pool(pool), m_buffer(pool.borrow(capacity))
+        {
+            reset(0);
+        }
+
+        BufferPool::Buffer take()
+        {
+            m_buffer.resize(size());
+            return std::move(m_buffer);
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                return traits_type::not_eof(c);
+            }
+
+            reserve(1);
+            *pptr() = traits_type::to_char_type(c);
+            reset(size() + 1);
+
+            return c;
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override
+        {
+            reserve(size_t(count));
+            memcpy(pptr(), data, size_t(count));
+            reset(size() + size_t(count));
+
+            return count;
+        }
+
+    private:
+        size_t size() const
+        {
+            return size_t(pptr() - reinterpret_cast<const char*>(m_buffer.data()));
+        }
+
+        // Puts the write position at offset; avoids pbump, which only takes an int
+        void reset(size_t offset)
+        {
+            char* begin = reinterpret_cast<char*>(m_buffer.data());
+            setp(begin + offset, begin + m_buffer.capacity());
+        }
+
+        void reserve(size_t count)
+        {
+            const size_t used = size();
+
+            if (m_buffer.capacity() - used < count)
+            {
+                BufferPool::Buffer larger = m_pool.borrow(std::max(2 * m_buffer.capacity(), used + count));
+                memcpy(larger.data(), m_buffer.data(), used);
+                m_buffer = std::move(larger);
+                reset(used);
+            }
+        }
+
+        BufferPool& m_pool;
+        BufferPool::Buffer m_buffer;
+    };
+}
+
+void rendering::encode_frame(std::ostream& out, const Bitmap& frame, FrameFormat format, const std::vector<Color>& palette)
+{
+    switch (format)
+    {
+    case FrameFormat::bmp:
+        save_as_bmp(out, frame);
+        break;
+    case FrameFormat::indexed_bmp:
+        save_as_indexed_bmp(out, frame, palette, false);
+        break;
+    case FrameFormat::rle_bmp:
+        save_as_indexed_bmp(out, frame, palette, true);
+        break;
+    case FrameFormat::qoi:
+        save_as_qoi(out, frame);
+        break;
+    }
+}
+
+void FileOutput::write(const std::string& name, BufferPool::Buffer data)
+{
+    // The frame is already in memory, so it goes out in a single write
+    io::write_file(name, data.data(), data.size());
+}
+
+bool FileOutput::repeat(const std::string& name, const std::string& original)
+{
+    return io::create_hard_link(original, name);
+}
+
+FrameNames::FrameNames(const std::string& pattern)
+    : m_name(pattern), m_position(pattern.find("%d")), m_digits(2)
+{
+    CHECK(m_position != std::string::npos) << "Pattern " << pattern << " does not contain %d";
+}
+
+const std::string& FrameNames::operator [](unsigned index)
+{
+    char digits[16];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = char('0' + index % 10);
+        index /= 10;
+    } while (index != 0);
+
+    while (count < 5)
+    {
+        digits[count++] = '0';
+    }
+
+    // Only changes length when the number of digits does
+    if (size_t(count) != m_digits)
+    {
+        m_name.replace(m_position, m_digits, size_t(count), '0');
+        m_digits = count;
+    }
+
+    for (int i = 0; i != count; ++i)
+    {
+        m_name[m_position + i] = digits[count - 1 - i];
+    }
+
+    return m_name;
+}
+
+FrameWriter::FrameWriter(FrameOutput& output, FrameFormat format, const std::vector<Color>& palette, bool elide_duplicates, BufferPool& pool)
+    : m_output(output), m_format(format), m_palette(palette), m_elide_duplicates(elide_duplicates), m_pool(pool),
+      m_written(0), m_elided(0), m_encoded_size(4096), m_previous_hash(0)
+{
+    // NOP
+}
+
+bool FrameWriter::write(const std::string& name, const Bitmap& frame)
+{
+    if (m_elide_duplicates)
+    {
+        const uint64_t hash = content_hash(frame);
+
+        // The hash only rules out differences; equal hashes are confirmed pixel by pixel
+        if (m_previous && hash == m_previous_hash && same_pixels(frame, *m_previous))
+        {
+            if (m_output.repeat(name, m_previous_name))
+            {
+                ++m_elided;
+                return true;
+            }
+
+            // The output cannot repeat frames, so it gets the bytes of the previous one again, without encoding them again
+            m_output.write(name, copy(m_previous_data));
+            ++m_written;
+            return false;
+        }
+
+        m_previous_hash = hash;
+        m_previous_name = name;
+        keep(frame);
+    }
+
+    BufferPool::Buffer data = encode(frame);
+    if (m_elide_duplicates)
+    {
+        m_previous_data = BufferPool::Buffer();
+        m_previous_data = copy(data);
+    }
+    m_output.write(name, std::move(data));
+    ++m_written;
+
+    return false;
+}
+
+BufferPool::Buffer FrameWriter::copy(const BufferPool::Buffer& data)
+{
+    BufferPool::Buffer result = m_pool.borrow(data.size());
+
+    memcpy(result.data(), data.data(), data.size());
+    result.resize(data.size());
+    return result;
+}
+
+BufferPool::Buffer FrameWriter::encode(const Bitmap& frame)
+{
+    PooledBuffer buffer(m_pool, m_encoded_size);
+    std::ostream out(&buffer);
+
+    encode_frame(out, frame, m_format, m_palette);
+
+    BufferPool::Buffer data = buffer.take();
+    m_encoded_size = std::max(m_encoded_size, data.size());
+
+    return data;
+}
+
+void FrameWriter::keep(const Bitmap& frame)
+{
+    if (!m_previous || m_previous->width() != frame.width() || m_previous->height() != frame.height())
+    {
+        m_previous.reset();
+        m_previous_pixels = m_pool.borrow(sizeof(Color) * frame.width() * frame.height());
+        m_previous = std::make_unique<Bitmap>(std::make_shared<BufferGrid<Color>>(m_previous_pixels.as<Color>(), frame.width(), frame.height()));
+    }
+
+    Color* pixels = m_previous_pixels.as<Color>();
+    for (unsigned y = 0; y != frame.height(); ++y)
+    {
+        frame.read_row(Position(0, y), frame.width(), pixels + size_t(y) * frame.width());
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include "imaging/bitmap.h"
+#include "util/buffer-pool.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace rendering
+{
+    enum class FrameFormat
+    {
+        bmp,
+        indexed_bmp,
+        rle_bmp,
+        qoi
+    };
+
+    /// <summary>
+    /// Encodes <paramref name="frame" /> in the given <paramref name="format" />.
+    /// The palette is only used by the indexed formats.
+    /// </summary>
+    void encode_frame(std::ostream& out, const imaging::Bitmap& frame, FrameFormat format, const std::vector<imaging::Color>& palette);
+
+    /// <summary>
+    /// Destination of encoded frames.
+    /// </summary>
+    class FrameOutput
+    {
+    public:
+        virtual ~FrameOutput() { }
+
+        /// <summary>
+        /// Stores the encoded frame held in <paramref name="data" />. The buffer goes back
+        /// to its pool once the output lets go of it.
+        /// </summary>
+        virtual void write(const std::string& name, BufferPool::Buffer data) = 0;
+
+        /// <summary>
+        /// Stores frame <paramref name="name" /> as a repeat of the earlier frame <paramref name="original" />.
+        /// Returns false if this output cannot do so, in which case the frame is written in full instead.
+        /// </summary>
+        virtual bool repeat(const std::string& name, const std::string& original) = 0;
+
+        /// <summary>
+        /// Waits until every frame passed on so far has been stored.
+        /// </summary>
+        virtual void flush() { }
+    };
+
+    /// <summary>
+    /// Writes each frame to its own file. Repeated frames become hard links.
+    /// </summary>
+    class FileOutput final : public FrameOutput
+    {
+    public:
+        void write(const std::string& name, BufferPool::Buffer data) override;
+        bool repeat(const std::string& name, const std::string& original) override;
+    };
+
+    /// <summary>
+    /// Produces file names from a pattern containing %d, which is replaced by the frame index,
+    /// padded with zeros to five digits. The name is updated in place, so that this does not allocate.
+    /// </summary>
+    class FrameNames final
+    {
+    public:
+        FrameNames(const std::string& pattern);
+
+        const std::string& operator [](unsigned index);
+
+    private:
+        std::string m_name;
+        size_t m_position;
+        size_t m_digits;
+    };
+
+    /// <summary>
+    /// Encodes frames and passes them on to a FrameOutput. A frame that is
+    /// pixel-identical to the one before it is not encoded again, but stored
+    /// as a repeat, which is common during rests and long chords.
+    /// Encoded frames are written into buffers borrowed from <paramref name="pool" />;
+    /// once all buffers have been seen, writing a frame does not allocate.
+    /// </summary>
+    class FrameWriter final
+    {
+    public:
+        FrameWriter(FrameOutput& output, FrameFormat format, const std::vector<imaging::Color>& palette, bool elide_duplicates = true, BufferPool& pool = BufferPool::shared());
+
+        /// <summary>
+        /// Returns true if the frame was elided, i.e. stored as a repeat of the previous one.
+        /// If the output cannot store repeats, a duplicate gets a copy of the previous frame's encoded bytes
+        /// and counts as written.
+        /// </summary>
+        bool write(const std::string& name, const imaging::Bitmap& frame);
+
+        unsigned written() const { return m_written; }
+        unsigned elided() const { return m_elided; }
+
+    private:
+        BufferPool::Buffer encode(const imaging::Bitmap& frame);
+        BufferPool::Buffer copy(const BufferPool::Buffer& data);
+        void keep(const imaging::Bitmap& frame);
+
+        FrameOutput& m_output;
+        FrameFormat m_format;
+        std::vector<imaging::Color> m_palette;
+        bool m_elide_duplicates;
+        BufferPool& m_pool;
+        unsigned m_written;
+        unsigned m_elided;
+        // Size of the last encoded frame; the next one will likely need as much
+        size_t m_encoded_size;
+
+        // Copy of the last frame that was written in full
+        BufferPool::Buffer m_previous_pixels;
+        std::unique_ptr<imaging::Bitmap> m_previous;
+        uint64_t m_previous_hash;
+        std::string m_previous_name;
+        // Its encoded bytes, for outputs that cannot repeat frames
+        BufferPool::Buffer m_previous_data;
+    };
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "rendering/live-roll.h"
+#include "logging.h"
+#include <algorithm>
+#include <cstring>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+LiveRoll::LiveRoll(unsigned width, unsigned note_height, unsigned step, unsigned low, unsigned high)
+    : m_width(width), m_note_height(note_height), m_step(step), m_low(low), m_high(high),
+      m_height((high - low + 1) * note_height), m_next(0)
+{
+    CHECK(width > 0 && note_height > 0 && step > 0) << "Width, note height and step must be positive";
+    CHECK(low <= high && high < 128) << "Invalid note range " << low << " to " << high;
+
+    m_pixels.assign(size_t(m_width) * m_height, colors::black());
+    memset(m_on, 0, sizeof(m_on));
+    memset(m_held, 0, sizeof(m_held));
+    memset(m_fresh, 0, sizeof(m_fresh));
+}
+
+std::vector<Color> LiveRoll::palette() const
+{
+    return { colors::black(), colors::blue(), colors::white() };
+}
+
+void LiveRoll::apply(const midi::MESSAGE& message)
+{
+    const uint8_t kind = message.status & 0xF0;
+    const uint8_t channel = message.status & 0x0F;
+
+    if (kind == 0x90 && message.data2 != 0)
+    {
+        if (!m_on[channel][message.data1])
+        {
+            m_on[channel][message.data1] = true;
+
+            if (m_held[message.data1]++ == 0)
+            {
+                m_fresh[message.data1] = true;
+            }
+        }
+    }
+    else if (kind == 0x80 || kind == 0x90)
+    {
+        // Note on with velocity 0 is a note off
+        release(channel, message.data1);
+    }
+    else if (kind == 0xB0 && (message.data1 == 120 || message.data1 == 123))
+    {
+        // All Sound Off, All Notes Off
+        for (uint8_t note = 0; note != 128; ++note)
+        {
+            release(channel, note);
+        }
+    }
+}
+
+void LiveRoll::release(uint8_t channel, uint8_t note)
+{
+    if (!m_on[channel][note])
+    {
+        return;
+    }
+    m_on[channel][note] = false;
+
+    // The last column drawn becomes the right border, unless the note has not been drawn at all yet,
+    // in which case the next advance() draws it as a single border column
+    if (--m_held[note] == 0 && !m_fresh[note] && note >= m_low && note <= m_high)
+    {
+        paint((m_next + m_width - 1) % m_width, note, true);
+    }
+}
+
+void LiveRoll::paint(unsigned column, unsigned key, bool border)
+{
+    const unsigned top = (m_high - key) * m_note_height;
+
+    for (unsigned j = 0; j != m_note_height; ++j)
+    {
+        const bool on_border = border || j < 1 || j + 2 > m_note_height;
+        m_pixels[size_t(top + j) * m_width + column] = on_border ? colors::white() : colors::blue();
+    }
+}
+
+void LiveRoll::advance()
+{
+    for (unsigned i = 0; i != m_step; ++i)
+    {
+        const unsigned column = m_next;
+        m_next = (m_next + 1) % m_width;
+
+        for (unsigned y = 0; y != m_height; ++y)
+        {
+            m_pixels[size_t(y) * m_width + column] = colors::black();
+        }
+
+        for (unsigned key = m_low; key <= m_high; ++key)
+        {
+            if (m_fresh[key])
+            {
+                // Left border
+                paint(column, key, true);
+            }
+            else if (m_held[key] != 0)
+            {
+                paint(column, key, false);
+            }
+        }
+
+        memset(m_fresh, 0, sizeof(m_fresh));
+    }
+}
+
+void LiveRoll::render(Bitmap& frame) const
+{
+    CHECK(frame.width() == m_width && frame.height() == m_height) << "Frame has the wrong size";
+
+    // The oldest column, m_next, goes on the left: first the columns from there to the end of the ring, then those before it
+    const unsigned split = m_width - m_next;
+
+    for (unsigned y = 0; y != m_height; ++y)
+    {
+        const Color* row = &m_pixels[size_t(y) * m_width];
+
+        for (unsigned x = 0; x != split; ++x)
+        {
+            frame[Position(x, y)] = row[m_next + x];
+        }
+        for (unsigned x = split; x != m_width; ++x)
+        {
+            frame[Position(x, y)] = row[x - split];
+        }
+    }
+}
+
+unsigned LiveRoll::sounding() const
+{
+    return unsigned(std::count_if(m_held, m_held + 128, [](uint8_t held) { return held != 0; }));
+}
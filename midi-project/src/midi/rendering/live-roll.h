@@ -0,0 +1,76 @@
+#ifndef LIVE_ROLL_H
+#define LIVE_ROLL_H
+
+#include "imaging/bitmap.h"
+#include "midi/stream-decoder.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Piano roll of notes as they are played, for live input. The roll scrolls
+    /// to the left by step pixels at a time; the right edge is the present.
+    /// Notes are drawn like PianoRoll draws them: blue with a white border, highest note at the top.
+    /// </summary>
+    class LiveRoll final
+    {
+    public:
+        /// <summary>
+        /// Shows notes <paramref name="low" /> up to and including <paramref name="high" />, by default the keys of a piano.
+        /// </summary>
+        LiveRoll(unsigned width, unsigned note_height, unsigned step, unsigned low = 21, unsigned high = 108);
+
+        unsigned width() const { return m_width; }
+        unsigned height() const { return m_height; }
+
+        /// <summary>
+        /// All colors the roll is drawn with, background first.
+        /// </summary>
+        std::vector<imaging::Color> palette() const;
+
+        /// <summary>
+        /// Applies a note on, note off or All Notes Off. Other messages are ignored.
+        /// A note that is released before the next advance() is still drawn, one pixel wide.
+        /// </summary>
+        void apply(const midi::MESSAGE& message);
+
+        /// <summary>
+        /// Scrolls by step pixels, drawing the notes sounding now in the new columns.
+        /// Does not allocate.
+        /// </summary>
+        void advance();
+
+        /// <summary>
+        /// Copies the roll onto <paramref name="frame" />, which must be width() x height().
+        /// </summary>
+        void render(imaging::Bitmap& frame) const;
+
+        /// <summary>
+        /// Number of keys that are held down.
+        /// </summary>
+        unsigned sounding() const;
+
+    private:
+        void release(uint8_t channel, uint8_t note);
+        void paint(unsigned column, unsigned key, bool border);
+
+        unsigned m_width;
+        unsigned m_note_height;
+        unsigned m_step;
+        unsigned m_low;
+        unsigned m_high;
+        unsigned m_height;
+        // Row-major pixels; column x of the roll is at (m_next + x) % m_width, so m_next is the oldest one
+        std::vector<imaging::Color> m_pixels;
+        unsigned m_next;
+        // Whether a note is on, per channel and note, and how many channels have each key on
+        bool m_on[16][128];
+        uint8_t m_held[128];
+        // Keys pressed since the last advance(), which have not been drawn yet
+        bool m_fresh[128];
+    };
+}
+
+#endif
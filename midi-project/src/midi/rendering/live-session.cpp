@@ -0,0 +1,153 @@
+#include "rendering/live-session.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Messages that can be waiting to be shown; a frame period of a busy stream is far fewer
+    const size_t QUEUE_CAPACITY = 4096;
+
+    const size_t READ_SIZE = 256;
+
+    int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+}
+
+const int64_t LatencyHistogram::BUCKET;
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(100000), m_count(0), m_max(0)
+{
+}
+
+void LatencyHistogram::add(int64_t nanoseconds)
+{
+    const size_t bucket = size_t(std::min(std::max(nanoseconds, int64_t(0)) / BUCKET, int64_t(m_buckets.size() - 1)));
+
+    ++m_buckets[bucket];
+    ++m_count;
+    m_max = std::max(m_max, nanoseconds);
+}
+
+int64_t LatencyHistogram::percentile(double fraction) const
+{
+    // Smallest number of latencies that makes up the fraction, and at least one
+    const uint64_t wanted = std::max(uint64_t(fraction * m_count + 0.999999), uint64_t(1));
+    uint64_t seen = 0;
+
+    for (size_t bucket = 0; bucket != m_buckets.size(); ++bucket)
+    {
+        seen += m_buckets[bucket];
+        if (seen >= wanted)
+        {
+            // The last bucket has no end
+            return bucket + 1 == m_buckets.size() ? m_max : std::min(int64_t(bucket + 1) * BUCKET, m_max);
+        }
+    }
+    return m_max;
+}
+
+LiveSession::LiveSession(LiveRoll& roll, Y4mWriter& out, unsigned numerator, unsigned denominator)
+    : m_roll(roll), m_out(out), m_numerator(numerator), m_denominator(denominator), m_queue(QUEUE_CAPACITY),
+      m_frames(0), m_messages(0), m_late_frames(0)
+{
+    CHECK(numerator > 0 && denominator > 0) << "Invalid frame rate " << numerator << "/" << denominator;
+}
+
+int64_t LiveSession::period() const
+{
+    return int64_t(uint64_t(1000000000) * m_denominator / m_numerator);
+}
+
+void LiveSession::read_input(std::function<size_t(uint8_t*, size_t)>& read)
+{
+    midi::StreamDecoder decoder;
+    uint8_t bytes[READ_SIZE];
+    midi::MESSAGE messages[READ_SIZE];
+    LIVE_EVENT events[READ_SIZE];
+
+    while (size_t count = read(bytes, READ_SIZE))
+    {
+        const int64_t arrival = now();
+        const size_t decoded = decoder.decode(bytes, count, messages);
+
+        for (size_t i = 0; i != decoded; ++i)
+        {
+            events[i] = LIVE_EVENT{ messages[i], arrival };
+        }
+
+        // The renderer empties the queue every frame, so it only fills up if rendering falls far behind
+        size_t pushed = 0;
+        while ((pushed += m_queue.push(events + pushed, decoded - pushed)) != decoded)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void LiveSession::run(std::function<size_t(uint8_t* buffer, size_t size)> read)
+{
+    std::atomic<bool> finished(false);
+    std::thread reader([this, &read, &finished]() {
+        read_input(read);
+        finished.store(true, std::memory_order_release);
+    });
+
+    Bitmap frame(m_roll.width(), m_roll.height());
+    std::vector<LIVE_EVENT> events(QUEUE_CAPACITY);
+    const int64_t start = now();
+
+    for (uint64_t tick = 0; ; ++tick)
+    {
+        // Ticks are counted from the start, so that sleeping too long does not delay later frames
+        const int64_t deadline = start + int64_t(tick * uint64_t(1000000000) * m_denominator / m_numerator);
+        std::this_thread::sleep_until(Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(deadline))));
+
+        // Checked before emptying the queue: once the reader has finished, this frame shows all it read
+        const bool last = finished.load(std::memory_order_acquire);
+        const size_t count = m_queue.pop(events.data(), events.size());
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            m_roll.apply(events[i].message);
+        }
+
+        m_roll.advance();
+        m_roll.render(frame);
+        m_out.write(frame);
+        m_out.flush();
+
+        const int64_t shown = now();
+        for (size_t i = 0; i != count; ++i)
+        {
+            m_latency.add(shown - events[i].arrival);
+        }
+
+        m_render_time.add(shown - deadline);
+        m_messages += count;
+        ++m_frames;
+        if (shown - deadline > period())
+        {
+            ++m_late_frames;
+        }
+
+        if (last && count != events.size())
+        {
+            break;
+        }
+    }
+
+    reader.join();
+}
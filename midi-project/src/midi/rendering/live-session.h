@@ -0,0 +1,105 @@
+#ifndef LIVE_SESSION_H
+#define LIVE_SESSION_H
+
+#include "midi/stream-decoder.h"
+#include "rendering/live-roll.h"
+#include "rendering/y4m-writer.h"
+#include "util/spsc-queue.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Counts latencies in buckets of 10 microseconds, up to a second; anything longer goes in the last bucket.
+    /// </summary>
+    class LatencyHistogram final
+    {
+    public:
+        LatencyHistogram();
+
+        void add(int64_t nanoseconds);
+
+        uint64_t count() const { return m_count; }
+        int64_t max() const { return m_max; }
+
+        /// <summary>
+        /// Latency that <paramref name="fraction" /> of all latencies are at or below,
+        /// rounded up to the end of its bucket, in nanoseconds.
+        /// </summary>
+        int64_t percentile(double fraction) const;
+
+    private:
+        static const int64_t BUCKET = 10000;
+
+        std::vector<uint64_t> m_buckets;
+        uint64_t m_count;
+        int64_t m_max;
+    };
+
+    /// <summary>
+    /// Shows MIDI as it is played: raw bytes are read and decoded on a thread of their own,
+    /// and handed over through a SpscQueue, stamped with the time they arrived, to the calling thread.
+    /// That thread writes a frame at every tick of a fixed frame rate, showing every message that arrived
+    /// before the tick. The latency of each message, from reading its bytes to writing the frame that shows it,
+    /// is recorded. Waiting for the tick takes half a frame period on average and up to a whole one,
+    /// after which the frame still has to be rendered and written.
+    /// </summary>
+    class LiveSession final
+    {
+    public:
+        LiveSession(LiveRoll& roll, Y4mWriter& out, unsigned numerator, unsigned denominator = 1);
+
+        /// <summary>
+        /// Reads raw MIDI bytes with <paramref name="read" />, which waits for bytes to arrive,
+        /// stores up to size of them and returns how many that was, and returns 0 at the end of the input.
+        /// Writes frames until the input ends and everything it contained is shown.
+        /// </summary>
+        void run(std::function<size_t(uint8_t* buffer, size_t size)> read);
+
+        uint64_t frames() const { return m_frames; }
+        uint64_t messages() const { return m_messages; }
+
+        /// <summary>
+        /// Frames that were written more than a frame period after their tick.
+        /// </summary>
+        uint64_t late_frames() const { return m_late_frames; }
+
+        /// <summary>
+        /// Frame period in nanoseconds.
+        /// </summary>
+        int64_t period() const;
+
+        const LatencyHistogram& latency() const { return m_latency; }
+
+        /// <summary>
+        /// Time from each tick until its frame has been written.
+        /// </summary>
+        const LatencyHistogram& render_time() const { return m_render_time; }
+
+    private:
+        struct LIVE_EVENT
+        {
+            midi::MESSAGE message;
+            // Steady clock time at which its last byte was read, in nanoseconds
+            int64_t arrival;
+        };
+
+        void read_input(std::function<size_t(uint8_t*, size_t)>& read);
+
+        LiveRoll& m_roll;
+        Y4mWriter& m_out;
+        unsigned m_numerator;
+        unsigned m_denominator;
+        SpscQueue<LIVE_EVENT> m_queue;
+        uint64_t m_frames;
+        uint64_t m_messages;
+        uint64_t m_late_frames;
+        LatencyHistogram m_latency;
+        LatencyHistogram m_render_time;
+    };
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "rendering/piano-roll.h"
+#include "util/tiled-grid.h"
+#include "logging.h"
+#include <algorithm>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+PianoRoll::PianoRoll(const std::vector<midi::NOTE>& notes, unsigned scale, unsigned note_height, unsigned frame_width, unsigned step)
+    : m_step(step)
+{
+    CHECK(!notes.empty()) << "No notes to render";
+    CHECK(scale > 0 && step > 0) << "Scale and step must be positive";
+
+    std::vector<midi::NOTE> sorted = notes;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const midi::NOTE& a, const midi::NOTE& b) {
+        return a.note_number < b.note_number;
+    });
+
+    const unsigned low = value(sorted.front().note_number);
+    const unsigned high = value(sorted.back().note_number);
+    uint64_t end = 0;
+
+    for (const midi::NOTE& note : sorted)
+    {
+        end = std::max(end, value(note.start + note.duration));
+    }
+
+    m_width = unsigned(end / scale);
+    m_height = (high - low + 1) * note_height;
+    m_frame_width = frame_width == 0 ? m_width : frame_width;
+
+    m_rectangles.reserve(sorted.size());
+    for (const midi::NOTE& note : sorted)
+    {
+        m_rectangles.push_back(RECTANGLE{
+            unsigned(value(note.start) / scale),
+            (high - value(note.note_number)) * note_height,
+            unsigned(value(note.duration) / scale),
+            note_height });
+    }
+
+    const unsigned bucket_width = std::max(m_frame_width, 1u);
+    m_buckets.resize(m_width / bucket_width + 1);
+
+    for (uint32_t i = 0; i != m_rectangles.size(); ++i)
+    {
+        const RECTANGLE& rectangle = m_rectangles[i];
+
+        if (rectangle.width != 0)
+        {
+            const unsigned first = rectangle.x / bucket_width;
+            const unsigned last = (rectangle.x + rectangle.width - 1) / bucket_width;
+
+            for (unsigned b = first; b <= last && b < m_buckets.size(); ++b)
+            {
+                m_buckets[b].push_back(i);
+            }
+        }
+    }
+}
+
+unsigned PianoRoll::frame_count() const
+{
+    return m_width < m_frame_width ? 0 : (m_width - m_frame_width) / m_step + 1;
+}
+
+std::vector<Color> PianoRoll::palette() const
+{
+    return { colors::black(), colors::blue(), colors::white() };
+}
+
+void PianoRoll::draw(Bitmap& bitmap, const RECTANGLE& rectangle, unsigned left) const
+{
+    // Clip horizontally to [left, left + bitmap.width()), but decide which pixels
+    // belong to the border relative to the whole rectangle
+    const unsigned from = std::max(rectangle.x, left);
+    const unsigned to = std::min(rectangle.x + rectangle.width, left + bitmap.width());
+    const Color fill = colors::blue();
+    const Color border = colors::white();
+
+    for (unsigned x = from; x < to; ++x)
+    {
+        const unsigned i = x - rectangle.x;
+
+        for (unsigned j = 0; j != rectangle.height; ++j)
+        {
+            const bool on_border = i < 1 || j < 1 || i + 2 > rectangle.width || j + 2 > rectangle.height;
+
+            bitmap[Position(x - left, rectangle.y + j)] = on_border ? border : fill;
+        }
+    }
+}
+
+Bitmap PianoRoll::render() const
+{
+    // Most of a piano roll is background; only tiles covered by notes are allocated
+    return render(std::make_shared<TiledGrid<Color>>(m_width, m_height, colors::black()));
+}
+
+Bitmap PianoRoll::render(std::shared_ptr<Grid<Color>> canvas) const
+{
+    CHECK(canvas->width() == m_width && canvas->height() == m_height) << "Canvas has the wrong size";
+
+    Bitmap bitmap(canvas);
+
+    for (const RECTANGLE& rectangle : m_rectangles)
+    {
+        draw(bitmap, rectangle, 0);
+    }
+
+    return bitmap;
+}
+
+Bitmap PianoRoll::render_frame(unsigned index) const
+{
+    Bitmap bitmap(m_frame_width, m_height);
+
+    render_frame(index, bitmap);
+
+    return bitmap;
+}
+
+void PianoRoll::render_frame(unsigned index, Bitmap& frame) const
+{
+    CHECK(index < frame_count()) << "Frame " << index << " does not exist";
+    CHECK(frame.width() == m_frame_width && frame.height() == m_height) << "Frame has the wrong size";
+
+    frame.clear(colors::black());
+
+    if (m_frame_width == 0)
+    {
+        return;
+    }
+
+    // A frame overlaps at most two buckets. Both list rectangles in increasing order,
+    // so merging them visits every rectangle once, in drawing order.
+    const unsigned left = index * m_step;
+    const unsigned first = left / m_frame_width;
+    const unsigned last = std::min(unsigned((left + m_frame_width - 1) / m_frame_width), unsigned(m_buckets.size() - 1));
+    const std::vector<uint32_t>& a = m_buckets[first];
+    const std::vector<uint32_t>& b = m_buckets[last];
+    auto i = a.begin();
+    auto j = first == last ? b.end() : b.begin();
+
+    while (i != a.end() || j != b.end())
+    {
+        uint32_t next;
+
+        if (j == b.end() || (i != a.end() && *i < *j))
+        {
+            next = *i++;
+        }
+        else if (i == a.end() || *j < *i)
+        {
+            next = *j++;
+        }
+        else
+        {
+            next = *i++;
+            ++j;
+        }
+
+        draw(frame, m_rectangles[next], left);
+    }
+}
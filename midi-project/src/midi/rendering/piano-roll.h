@@ -0,0 +1,81 @@
+#ifndef PIANO_ROLL_H
+#define PIANO_ROLL_H
+
+#include "imaging/bitmap.h"
+#include "midi/midi.h"
+#include <vector>
+#include <cstdint>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Lays out notes as rectangles on a piano roll: time runs left to right,
+    /// the highest note is at the top. Frames are windows of frame_width pixels
+    /// that advance step pixels at a time.
+    /// </summary>
+    class PianoRoll final
+    {
+    public:
+        /// <summary>
+        /// A frame_width of 0 makes a single frame spanning the whole piano roll.
+        /// </summary>
+        PianoRoll(const std::vector<midi::NOTE>& notes, unsigned scale, unsigned note_height, unsigned frame_width, unsigned step);
+
+        unsigned width() const { return m_width; }
+        unsigned height() const { return m_height; }
+        unsigned frame_width() const { return m_frame_width; }
+        unsigned frame_count() const;
+
+        /// <summary>
+        /// All colors the piano roll is drawn with, background first.
+        /// </summary>
+        std::vector<imaging::Color> palette() const;
+
+        /// <summary>
+        /// Renders the entire piano roll.
+        /// </summary>
+        imaging::Bitmap render() const;
+
+        /// <summary>
+        /// Renders the entire piano roll onto <paramref name="canvas" />, which must be width() x height()
+        /// and initialized to black. Use a MappedGrid for piano rolls that do not fit in memory.
+        /// </summary>
+        imaging::Bitmap render(std::shared_ptr<Grid<imaging::Color>> canvas) const;
+
+        /// <summary>
+        /// Renders frame <paramref name="index" />. Only the notes overlapping the frame are visited,
+        /// and the result is identical to the corresponding slice of render().
+        /// </summary>
+        imaging::Bitmap render_frame(unsigned index) const;
+
+        /// <summary>
+        /// Renders frame <paramref name="index" /> onto <paramref name="frame" />, which must be
+        /// frame_width() x height(). Does not allocate, so that a frame bitmap can be reused,
+        /// e.g. one backed by a BufferPool.
+        /// </summary>
+        void render_frame(unsigned index, imaging::Bitmap& frame) const;
+
+    private:
+        struct RECTANGLE
+        {
+            unsigned x, y, width, height;
+        };
+
+        void draw(imaging::Bitmap& bitmap, const RECTANGLE& rectangle, unsigned left) const;
+
+        unsigned m_width;
+        unsigned m_height;
+        unsigned m_frame_width;
+        unsigned m_step;
+
+        // Sorted so that drawing them in order reproduces overlaps as they were always drawn:
+        // by note number, then in the order they were read
+        std::vector<RECTANGLE> m_rectangles;
+
+        // m_buckets[b] lists the rectangles overlapping pixel columns [b * m_frame_width, (b + 1) * m_frame_width)
+        std::vector<std::vector<uint32_t>> m_buckets;
+    };
+}
+
+#endif
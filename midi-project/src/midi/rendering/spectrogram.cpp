@@ -0,0 +1,155 @@
+#include "rendering/spectrogram.h"
+#include "logging.h"
+#include <algorithm>
+#include <cmath>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // Lowest frequency shown, in Hz
+    const double MIN_FREQUENCY = 30;
+
+    // Levels from full scale down to this many dB below it are shown; anything quieter is black
+    const float RANGE = 80;
+
+    // Audio before the current window is dropped once this many samples have piled up
+    const size_t DISCARD = size_t(1) << 16;
+}
+
+Spectrogram::Spectrogram(audio::Synth& synth, const audio::TempoMap& tempo_map, unsigned scale, unsigned height,
+    unsigned frame_width, unsigned step, unsigned fft_size)
+    : m_synth(synth), m_tempo_map(tempo_map), m_scale(scale), m_height(height), m_frame_width(frame_width), m_step(step),
+      m_fft(fft_size), m_colormap(Colormap::heat()), m_window(fft_size), m_samples(fft_size), m_power(m_fft.bins()),
+      m_columns(size_t(frame_width) * height), m_first_column(0), m_next_column(0), m_columns_computed(0),
+      m_audio_start(0), m_block(2 * synth.block_size())
+{
+    CHECK(scale > 0 && step > 0 && frame_width > 0) << "Scale, step and frame width must be positive";
+    CHECK(synth.position() == 0) << "Synth has already rendered audio";
+
+    double sum = 0;
+    for (unsigned i = 0; i != fft_size; ++i)
+    {
+        m_window[i] = float(0.5 - 0.5 * std::cos(2 * PI * i / fft_size));
+        sum += m_window[i];
+    }
+    // A sine of amplitude 1 peaks at half the sum of the window
+    m_reference = float(sum * sum / 4);
+
+    const double nyquist = synth.sample_rate() / 2.0;
+    const double bin_width = double(synth.sample_rate()) / fft_size;
+    const double low = std::min(MIN_FREQUENCY, nyquist / 2);
+    m_row_bins.reserve(2 * size_t(height));
+
+    for (unsigned y = 0; y != height; ++y)
+    {
+        const double top = nyquist * std::pow(low / nyquist, double(y) / height);
+        const double bottom = nyquist * std::pow(low / nyquist, double(y + 1) / height);
+        const uint32_t first = std::min(uint32_t(bottom / bin_width), m_fft.bins() - 1);
+        const uint32_t last = std::min(std::max(first + 1, uint32_t(std::ceil(top / bin_width))), m_fft.bins());
+
+        m_row_bins.push_back(first);
+        m_row_bins.push_back(last);
+    }
+}
+
+void Spectrogram::render_frame(unsigned index, Bitmap& frame)
+{
+    CHECK(frame.width() == m_frame_width && frame.height() == m_height) << "Frame has the wrong size";
+
+    const uint64_t left = uint64_t(index) * m_step;
+    const uint64_t right = left + m_frame_width;
+    CHECK(left >= m_first_column) << "Frames must be rendered in increasing order";
+
+    if (left > m_next_column)
+    {
+        // Nothing in common with the previous frame
+        m_next_column = left;
+    }
+    m_first_column = left;
+
+    while (m_next_column < right)
+    {
+        compute_column(m_next_column++);
+    }
+
+    for (unsigned y = 0; y != m_height; ++y)
+    {
+        for (unsigned x = 0; x != m_frame_width; ++x)
+        {
+            const size_t slot = size_t((left + x) % m_frame_width);
+            frame[Position(x, y)] = m_colormap[m_columns[slot * m_height + y]];
+        }
+    }
+}
+
+void Spectrogram::compute_column(uint64_t column)
+{
+    const unsigned size = m_fft.size();
+    const uint64_t middle = m_tempo_map.frame(midi::Time(column * m_scale + m_scale / 2), m_synth.sample_rate());
+    const int64_t start = int64_t(middle) - size / 2;
+
+    pull_audio(uint64_t(std::max(start, int64_t(0))), middle + size / 2);
+
+    for (unsigned i = 0; i != size; ++i)
+    {
+        // Before the start and past the end of the rendering is silence
+        const int64_t f = start + i;
+        const bool inside = f >= int64_t(m_audio_start) && f < int64_t(m_audio_start + m_audio.size());
+
+        m_samples[i] = inside ? m_audio[size_t(f - int64_t(m_audio_start))] * m_window[i] : 0.0f;
+    }
+
+    m_fft.power(m_samples.data(), m_power.data());
+
+    uint8_t* levels = &m_columns[size_t(column % m_frame_width) * m_height];
+
+    for (unsigned y = 0; y != m_height; ++y)
+    {
+        const float loudest = *std::max_element(&m_power[m_row_bins[2 * y]], &m_power[0] + m_row_bins[2 * y + 1]);
+        const float decibels = 10 * std::log10(loudest / m_reference + 1e-30f);
+        const float level = std::min(std::max((decibels + RANGE) / RANGE, 0.0f), 1.0f);
+
+        levels[y] = uint8_t(std::lrint(level * 255));
+    }
+
+    // Later columns never look further back than this one
+    if (start > int64_t(m_audio_start + DISCARD))
+    {
+        const size_t drop = std::min(size_t(start - int64_t(m_audio_start)), m_audio.size());
+        m_audio.erase(m_audio.begin(), m_audio.begin() + drop);
+        m_audio_start += drop;
+    }
+
+    ++m_columns_computed;
+}
+
+void Spectrogram::pull_audio(uint64_t from, uint64_t end)
+{
+    if (m_audio_start + m_audio.size() <= from)
+    {
+        m_audio_start += m_audio.size();
+        m_audio.clear();
+    }
+
+    while (m_audio_start + m_audio.size() < end && !m_synth.finished())
+    {
+        const unsigned frames = m_synth.render(m_block.data());
+
+        for (unsigned i = 0; i != frames; ++i)
+        {
+            // After a jump ahead, the audio in between is not needed
+            if (m_audio.empty() && m_audio_start < from)
+            {
+                ++m_audio_start;
+                continue;
+            }
+            m_audio.push_back((m_block[2 * i] + m_block[2 * i + 1]) * 0.5f);
+        }
+    }
+}
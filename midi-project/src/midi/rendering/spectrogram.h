@@ -0,0 +1,84 @@
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+#include "audio/fft.h"
+#include "audio/synth.h"
+#include "audio/tempo-map.h"
+#include "imaging/bitmap.h"
+#include "imaging/colormap.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Shows the spectrum of the synthesized audio over time, laid out like a PianoRoll:
+    /// pixel column x covers ticks [x * scale, (x + 1) * scale), and frame i shows columns
+    /// [i * step, i * step + frame_width), so that frame i of both shows the same stretch of music.
+    /// Frequency goes up logarithmically from the bottom row to the top one.
+    /// </summary>
+    class Spectrogram final
+    {
+    public:
+        /// <summary>
+        /// Audio is pulled from <paramref name="synth" />, which must not have rendered anything yet.
+        /// Each column is the spectrum of <paramref name="fft_size" /> samples around its middle, Hann windowed.
+        /// </summary>
+        Spectrogram(audio::Synth& synth, const audio::TempoMap& tempo_map, unsigned scale, unsigned height,
+            unsigned frame_width, unsigned step, unsigned fft_size = 2048);
+
+        unsigned frame_width() const { return m_frame_width; }
+        unsigned height() const { return m_height; }
+
+        /// <summary>
+        /// All colors the spectrogram is drawn with, quietest first.
+        /// </summary>
+        const std::vector<imaging::Color>& palette() const { return m_colormap.colors(); }
+
+        /// <summary>
+        /// Renders frame <paramref name="index" /> onto <paramref name="frame" />, which must be
+        /// frame_width() x height(). Frames must come in increasing order. Columns shared with
+        /// the previous frame are kept, so each frame only computes step new ones.
+        /// Once the audio buffer has grown to its working size, does not allocate.
+        /// </summary>
+        void render_frame(unsigned index, imaging::Bitmap& frame);
+
+        /// <summary>
+        /// Number of columns whose spectrum has been computed so far.
+        /// </summary>
+        uint64_t columns_computed() const { return m_columns_computed; }
+
+    private:
+        void compute_column(uint64_t column);
+        void pull_audio(uint64_t from, uint64_t end);
+
+        audio::Synth& m_synth;
+        audio::TempoMap m_tempo_map;
+        unsigned m_scale;
+        unsigned m_height;
+        unsigned m_frame_width;
+        unsigned m_step;
+        audio::RealFft m_fft;
+        imaging::Colormap m_colormap;
+        std::vector<float> m_window;
+        // Power that maps to the top of the colormap: a full scale sine
+        float m_reference;
+        // Row y shows the loudest of bins [m_row_bins[2 * y], m_row_bins[2 * y + 1]); row 0 is the highest
+        std::vector<uint32_t> m_row_bins;
+        std::vector<float> m_samples;
+        std::vector<float> m_power;
+        // Levels of the last frame_width columns; column x is at x % frame_width
+        std::vector<uint8_t> m_columns;
+        // Columns [m_first_column, m_next_column) are in m_columns; m_first_column is the left of the last frame
+        uint64_t m_first_column;
+        uint64_t m_next_column;
+        uint64_t m_columns_computed;
+        // Mono audio, starting at frame m_audio_start
+        std::vector<float> m_audio;
+        uint64_t m_audio_start;
+        std::vector<float> m_block;
+    };
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "rendering/tar-output.h"
+#include "logging.h"
+#include <cstring>
+#include <ctime>
+
+
+using namespace rendering;
+
+
+namespace
+{
+    const size_t BLOCK_SIZE = 512;
+    const size_t STAGING_SIZE = size_t(4) << 20;
+
+    struct TAR_HEADER
+    {
+        char name[100];
+        char mode[8];
+        char uid[8];
+        char gid[8];
+        char size[12];
+        char mtime[12];
+        char checksum[8];
+        char type;
+        char link[100];
+        char magic[6];
+        char version[2];
+        char user[32];
+        char group[32];
+        char device_major[8];
+        char device_minor[8];
+        char prefix[155];
+        char padding[12];
+    };
+
+    static_assert(sizeof(TAR_HEADER) == BLOCK_SIZE, "Tar headers are a block");
+
+    // Zero-padded octal number filling field, except for its terminating NUL
+    void put_octal(char* field, size_t width, uint64_t value)
+    {
+        for (size_t i = width - 1; i != 0; --i)
+        {
+            field[i - 1] = char('0' + (value & 7));
+            value >>= 3;
+        }
+        field[width - 1] = 0;
+
+        CHECK(value == 0) << "Value does not fit in a tar header";
+    }
+
+    // Copies count characters of path, with Windows separators turned into slashes
+    void put_path(char* field, const char* path, size_t count)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            field[i] = path[i] == '\\' ? '/' : path[i];
+        }
+    }
+
+    // ustar splits paths longer than 100 characters over prefix and name at a slash
+    void put_name(TAR_HEADER& header, const std::string& path)
+    {
+        if (path.size() <= sizeof(header.name))
+        {
+            put_path(header.name, path.data(), path.size());
+            return;
+        }
+
+        const size_t slash = path.find_last_of("/\\", sizeof(header.prefix));
+        CHECK(slash != std::string::npos && path.size() - slash - 1 <= sizeof(header.name)) << "Name " << path << " is too long for a tar archive";
+
+        put_path(header.prefix, path.data(), slash);
+        put_path(header.name, path.data() + slash + 1, path.size() - slash - 1);
+    }
+}
+
+TarOutput::TarOutput(const std::string& path)
+    : m_buffer(BufferPool::shared().borrow(STAGING_SIZE)), m_out(m_file), m_time(int64_t(std::time(nullptr)))
+{
+    // The buffer must be in place before the file is opened
+    m_file.rdbuf()->pubsetbuf(reinterpret_cast<char*>(m_buffer.data()), std::streamsize(m_buffer.capacity()));
+    m_file.open(path, std::ios::binary);
+    CHECK(m_file) << "Could not create " << path;
+}
+
+TarOutput::TarOutput(std::ostream& out)
+    : m_out(out), m_time(int64_t(std::time(nullptr)))
+{
+    // NOP
+}
+
+TarOutput::~TarOutput()
+{
+    // The end of an archive is marked by two empty blocks
+    const char zeros[2 * BLOCK_SIZE] = { 0 };
+    m_out.write(zeros, sizeof(zeros));
+    m_out.flush();
+
+    if (m_file.is_open())
+    {
+        // Before the buffer goes back to its pool
+        m_file.close();
+    }
+}
+
+void TarOutput::write_header(const std::string& name, uint64_t size, char type, const std::string& link)
+{
+    TAR_HEADER header;
+    memset(&header, 0, sizeof(header));
+
+    put_name(header, name);
+    put_octal(header.mode, sizeof(header.mode), 0644);
+    put_octal(header.uid, sizeof(header.uid), 0);
+    put_octal(header.gid, sizeof(header.gid), 0);
+    put_octal(header.size, sizeof(header.size), size);
+    put_octal(header.mtime, sizeof(header.mtime), uint64_t(m_time));
+    header.type = type;
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+
+    CHECK(link.size() <= sizeof(header.link)) << "Link target " << link << " is too long for a tar archive";
+    put_path(header.link, link.data(), link.size());
+
+    // The checksum is computed with the checksum field filled with spaces
+    memset(header.checksum, ' ', sizeof(header.checksum));
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+    unsigned checksum = 0;
+    for (size_t i = 0; i != sizeof(header); ++i)
+    {
+        checksum += bytes[i];
+    }
+    put_octal(header.checksum, 7, checksum);
+
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void TarOutput::write(const std::string& name, BufferPool::Buffer data)
+{
+    write_header(name, data.size(), '0', "");
+    m_out.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    // Contents are padded to a whole number of blocks
+    const char zeros[BLOCK_SIZE] = { 0 };
+    m_out.write(zeros, (BLOCK_SIZE - data.size() % BLOCK_SIZE) % BLOCK_SIZE);
+
+    CHECK(m_out) << "Could not write " << name << " to the archive";
+}
+
+bool TarOutput::repeat(const std::string& name, const std::string& original)
+{
+    // A link target is not split over prefix and name like a name is, so a long one cannot be linked to
+    if (original.size() > sizeof(TAR_HEADER().link))
+    {
+        return false;
+    }
+
+    write_header(name, 0, '1', original);
+    return true;
+}
+
+void TarOutput::flush()
+{
+    m_out.flush();
+}
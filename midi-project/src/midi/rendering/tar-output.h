@@ -0,0 +1,53 @@
+#ifndef TAR_OUTPUT_H
+#define TAR_OUTPUT_H
+
+#include "rendering/frame-writer.h"
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Appends frames to a single uncompressed (ustar) tar archive instead of creating a file per frame,
+    /// which avoids a file system metadata operation per frame. Frame names are used as the names
+    /// inside the archive, and repeated frames become hard link entries, which take up a single header.
+    /// Frames whose original has a name of over 100 characters cannot be linked to and are written in full.
+    /// The archive is complete once the output is destroyed.
+    /// </summary>
+    class TarOutput final : public FrameOutput
+    {
+    public:
+        /// <summary>
+        /// Creates the archive at <paramref name="path" />. Output is collected in a large buffer,
+        /// so that the file is written in large sequential blocks.
+        /// </summary>
+        TarOutput(const std::string& path);
+
+        /// <summary>
+        /// Writes the archive to <paramref name="out" />.
+        /// </summary>
+        TarOutput(std::ostream& out);
+
+        ~TarOutput();
+
+        TarOutput(const TarOutput&) = delete;
+        TarOutput& operator =(const TarOutput&) = delete;
+
+        void write(const std::string& name, BufferPool::Buffer data) override;
+        bool repeat(const std::string& name, const std::string& original) override;
+        void flush() override;
+
+    private:
+        void write_header(const std::string& name, uint64_t size, char type, const std::string& link);
+
+        BufferPool::Buffer m_buffer;
+        std::ofstream m_file;
+        std::ostream& m_out;
+        int64_t m_time;
+    };
+}
+
+#endif
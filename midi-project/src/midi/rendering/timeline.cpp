@@ -0,0 +1,40 @@
+#include "rendering/timeline.h"
+#include "logging.h"
+
+
+using namespace rendering;
+
+
+Timeline::Timeline(const audio::TempoMap& tempo_map, unsigned sample_rate, unsigned numerator, unsigned denominator)
+    : m_tempo_map(tempo_map), m_sample_rate(sample_rate), m_numerator(numerator), m_denominator(denominator)
+{
+    CHECK(sample_rate > 0) << "Sample rate must be positive";
+    CHECK(numerator > 0 && denominator > 0) << "Invalid frame rate " << numerator << "/" << denominator;
+}
+
+double Timeline::seconds(uint64_t frame) const
+{
+    return double(frame) * m_denominator / m_numerator;
+}
+
+double Timeline::tick(uint64_t frame) const
+{
+    return m_tempo_map.ticks(seconds(frame));
+}
+
+uint64_t Timeline::first_sample(uint64_t frame) const
+{
+    return frame * m_sample_rate * m_denominator / m_numerator;
+}
+
+unsigned Timeline::samples(uint64_t frame) const
+{
+    return unsigned(first_sample(frame + 1) - first_sample(frame));
+}
+
+uint64_t Timeline::frame_count(uint64_t samples) const
+{
+    // Smallest count whose frames start at or after the last sample
+    const uint64_t per_second = uint64_t(m_sample_rate) * m_denominator;
+    return (samples * m_numerator + per_second - 1) / per_second;
+}
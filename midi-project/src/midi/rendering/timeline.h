@@ -0,0 +1,55 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "audio/tempo-map.h"
+#include <cstdint>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Video frames at a fixed rate of numerator / denominator frames per second, and the audio samples
+    /// and MIDI ticks that go with each of them, so that video and audio are rendered against the same clock.
+    /// Frame k starts at k * denominator / numerator seconds. Sample boundaries are computed
+    /// from the frame index with integers, so they do not drift, however long the rendering.
+    /// </summary>
+    class Timeline final
+    {
+    public:
+        Timeline(const audio::TempoMap& tempo_map, unsigned sample_rate, unsigned numerator, unsigned denominator = 1);
+
+        unsigned numerator() const { return m_numerator; }
+        unsigned denominator() const { return m_denominator; }
+        unsigned sample_rate() const { return m_sample_rate; }
+
+        double seconds(uint64_t frame) const;
+
+        /// <summary>
+        /// Tick, with fraction, at which <paramref name="frame" /> starts.
+        /// </summary>
+        double tick(uint64_t frame) const;
+
+        /// <summary>
+        /// Index of the first audio sample of <paramref name="frame" />.
+        /// </summary>
+        uint64_t first_sample(uint64_t frame) const;
+
+        /// <summary>
+        /// Number of audio samples that go with <paramref name="frame" />.
+        /// </summary>
+        unsigned samples(uint64_t frame) const;
+
+        /// <summary>
+        /// Number of frames needed to show <paramref name="samples" /> samples of audio.
+        /// </summary>
+        uint64_t frame_count(uint64_t samples) const;
+
+    private:
+        audio::TempoMap m_tempo_map;
+        unsigned m_sample_rate;
+        unsigned m_numerator;
+        unsigned m_denominator;
+    };
+}
+
+#endif
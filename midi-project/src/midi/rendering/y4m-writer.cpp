@@ -0,0 +1,110 @@
+#include "rendering/y4m-writer.h"
+#include "logging.h"
+#include <sstream>
+
+
+using namespace rendering;
+using namespace imaging;
+
+
+namespace
+{
+    struct YUV
+    {
+        uint8_t y;
+        uint8_t u;
+        uint8_t v;
+    };
+
+    // BT.601, limited range, in 8-bit fixed point like in libyuv
+    YUV to_yuv(uint8_t r, uint8_t g, uint8_t b)
+    {
+        const int y = (66 * r + 129 * g + 25 * b + 128) >> 8;
+        const int u = (-38 * r - 74 * g + 112 * b + 128) >> 8;
+        const int v = (112 * r - 94 * g - 18 * b + 128) >> 8;
+
+        return YUV{ uint8_t(y + 16), uint8_t(u + 128), uint8_t(v + 128) };
+    }
+
+    YUV to_yuv(const Color& c)
+    {
+        // Same conversion to bytes as the BMP writer
+        return to_yuv(uint8_t(c.r * 255), uint8_t(c.g * 255), uint8_t(c.b * 255));
+    }
+}
+
+Y4mWriter::Y4mWriter(const std::string& path, unsigned width, unsigned height, unsigned numerator, unsigned denominator)
+    : m_out(m_file), m_width(width), m_height(height), m_frames(0),
+      m_planes(3 * size_t(width) * height), m_row(width)
+{
+    m_file.open(path, std::ios::binary);
+    CHECK(m_file) << "Could not create " << path;
+
+    write_header(numerator, denominator);
+}
+
+Y4mWriter::Y4mWriter(std::ostream& out, unsigned width, unsigned height, unsigned numerator, unsigned denominator)
+    : m_out(out), m_width(width), m_height(height), m_frames(0),
+      m_planes(3 * size_t(width) * height), m_row(width)
+{
+    write_header(numerator, denominator);
+}
+
+void Y4mWriter::write_header(unsigned numerator, unsigned denominator)
+{
+    CHECK(m_width > 0 && m_height > 0) << "Frames must not be empty";
+    CHECK(numerator > 0 && denominator > 0) << "Invalid frame rate " << numerator << "/" << denominator;
+
+    std::ostringstream header;
+    header << "YUV4MPEG2 W" << m_width << " H" << m_height << " F" << numerator << ":" << denominator << " Ip A1:1 C444\n";
+    m_out << header.str();
+
+    CHECK(m_out) << "Could not write Y4M header";
+}
+
+void Y4mWriter::write(const Bitmap& frame)
+{
+    CHECK(frame.width() == m_width && frame.height() == m_height) << "Frame has the wrong size";
+
+    const size_t plane = size_t(m_width) * m_height;
+    uint8_t* y_plane = m_planes.data();
+    uint8_t* u_plane = y_plane + plane;
+    uint8_t* v_plane = u_plane + plane;
+
+    // Frames mostly consist of runs of a few colors, so the last conversion is usually the one needed
+    Color last = colors::black();
+    YUV converted = to_yuv(last);
+
+    for (unsigned y = 0; y != m_height; ++y)
+    {
+        frame.read_row(Position(0, y), m_width, m_row.data());
+
+        for (unsigned x = 0; x != m_width; ++x)
+        {
+            const Color& c = m_row[x];
+
+            if (c.r != last.r || c.g != last.g || c.b != last.b)
+            {
+                last = c;
+                converted = to_yuv(c);
+            }
+
+            const size_t i = size_t(y) * m_width + x;
+            y_plane[i] = converted.y;
+            u_plane[i] = converted.u;
+            v_plane[i] = converted.v;
+        }
+    }
+
+    m_out.write("FRAME\n", 6);
+    m_out.write(reinterpret_cast<const char*>(m_planes.data()), std::streamsize(m_planes.size()));
+    CHECK(m_out) << "Could not write Y4M frame";
+
+    ++m_frames;
+}
+
+void Y4mWriter::flush()
+{
+    m_out.flush();
+    CHECK(m_out) << "Could not write Y4M frame";
+}
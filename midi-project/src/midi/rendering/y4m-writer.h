@@ -0,0 +1,60 @@
+#ifndef Y4M_WRITER_H
+#define Y4M_WRITER_H
+
+#include "imaging/bitmap.h"
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace rendering
+{
+    /// <summary>
+    /// Writes frames as a YUV4MPEG2 stream: uncompressed 4:4:4 video that ffmpeg and most players
+    /// read directly, from a file or a pipe. Colors are converted to limited range BT.601.
+    /// Since the stream has no header that depends on its length, nothing is ever rewritten,
+    /// so it can go to a stream that does not support seeking.
+    /// </summary>
+    class Y4mWriter final
+    {
+    public:
+        /// <summary>
+        /// Creates the file at <paramref name="path" />, at numerator / denominator frames per second.
+        /// </summary>
+        Y4mWriter(const std::string& path, unsigned width, unsigned height, unsigned numerator, unsigned denominator = 1);
+
+        Y4mWriter(std::ostream& out, unsigned width, unsigned height, unsigned numerator, unsigned denominator = 1);
+
+        Y4mWriter(const Y4mWriter&) = delete;
+        Y4mWriter& operator =(const Y4mWriter&) = delete;
+
+        /// <summary>
+        /// Appends <paramref name="frame" />, which must be width x height.
+        /// Does not allocate.
+        /// </summary>
+        void write(const imaging::Bitmap& frame);
+
+        /// <summary>
+        /// Passes the frames written so far on to the output, e.g. so that a player reading from a pipe sees them right away.
+        /// </summary>
+        void flush();
+
+        uint64_t frames() const { return m_frames; }
+
+    private:
+        void write_header(unsigned numerator, unsigned denominator);
+
+        std::ofstream m_file;
+        std::ostream& m_out;
+        unsigned m_width;
+        unsigned m_height;
+        uint64_t m_frames;
+        // Y, U and V planes of one frame
+        std::vector<uint8_t> m_planes;
+        std::vector<imaging::Color> m_row;
+    };
+}
+
+#endif
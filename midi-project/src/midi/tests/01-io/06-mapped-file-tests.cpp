@@ -0,0 +1,123 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "io/mapped-file.h"
+#include "io/memory-buffer.h"
+#include "io/read.h"
+#include "Catch.h"
+#include <cstdio>
+#include <fstream>
+#include <istream>
+
+
+TEST_CASE("MappedFile maps file contents")
+{
+    const char* path = "mapped-file-test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "hello world";
+    }
+
+    {
+        io::MappedFile file(path);
+
+        CATCH_REQUIRE(file.size() == 11);
+        CATCH_CHECK(std::string(reinterpret_cast<const char*>(file.data()), file.size()) == "hello world");
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE("MappedFile of empty file")
+{
+    const char* path = "mapped-file-test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+    }
+
+    {
+        io::MappedFile file(path);
+
+        CATCH_CHECK(file.size() == 0);
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE("file_exists")
+{
+    const char* path = "mapped-file-test.bin";
+    std::remove(path);
+
+    CATCH_CHECK(!io::file_exists(path));
+    {
+        std::ofstream out(path, std::ios::binary);
+    }
+    CATCH_CHECK(io::file_exists(path));
+
+    std::remove(path);
+}
+
+TEST_CASE("replace_file leaves existing mappings alone")
+{
+    const char* path = "mapped-file-test.bin";
+    const uint8_t old_data[] = { 'o', 'l', 'd', ' ', 'd', 'a', 't', 'a' };
+    const uint8_t new_data[] = { 'n', 'e', 'w' };
+
+    CATCH_REQUIRE(io::replace_file(path, old_data, sizeof(old_data)));
+
+    bool replaced;
+    {
+        io::MappedFile mapped(path);
+
+        // Windows does not replace files that are mapped
+        replaced = io::replace_file(path, new_data, sizeof(new_data));
+
+        CATCH_REQUIRE(mapped.size() == sizeof(old_data));
+        CATCH_CHECK(std::string(reinterpret_cast<const char*>(mapped.data()), mapped.size()) == "old data");
+    }
+
+    {
+        io::MappedFile file(path);
+        CATCH_CHECK(file.size() == (replaced ? sizeof(new_data) : sizeof(old_data)));
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE("FileLock")
+{
+    const char* path = "mapped-file-test.lock";
+
+    {
+        io::FileLock lock(path);
+        CATCH_CHECK(lock.locked());
+    }
+
+    // Released again, so it can be taken once more
+    {
+        io::FileLock lock(path);
+        CATCH_CHECK(lock.locked());
+    }
+
+    CATCH_CHECK(!io::FileLock("no-such-directory/mapped-file-test.lock").locked());
+
+    std::remove(path);
+}
+
+TEST_CASE("MemoryBuffer supports read and putback")
+{
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    io::MemoryBuffer buffer(data, sizeof(data));
+    std::istream in(&buffer);
+
+    CATCH_CHECK(io::read<uint8_t>(in) == 1);
+    CATCH_CHECK(io::read<uint8_t>(in) == 2);
+    in.putback(2);
+    CATCH_CHECK(io::read<uint16_t>(in) == 0x0302);
+    CATCH_CHECK(io::read<uint8_t>(in) == 4);
+    CATCH_CHECK(in.peek() == std::char_traits<char>::eof());
+}
+
+#endif
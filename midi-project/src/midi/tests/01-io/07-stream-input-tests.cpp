@@ -0,0 +1,38 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "io/stream-input.h"
+#include "Catch.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+TEST_CASE("StreamInput reads a file up to its end")
+{
+    const char* path = "stream-input-test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "hello world";
+    }
+
+    {
+        io::StreamInput input(path);
+        std::string result;
+        uint8_t buffer[4];
+
+        while (size_t count = input.read(buffer, sizeof(buffer)))
+        {
+            CATCH_CHECK(count <= sizeof(buffer));
+            result.append(reinterpret_cast<const char*>(buffer), count);
+        }
+
+        CATCH_CHECK(result == "hello world");
+        CATCH_CHECK(input.read(buffer, sizeof(buffer)) == 0);
+    }
+
+    std::remove(path);
+}
+
+#endif
@@ -0,0 +1,238 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "tests/tests-util.h"
+#include "io/read.h"
+#include "io/vli.h"
+#include <sstream>
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    // read_mtrk as it was before the status table: classifies each status byte
+    // through the is_* predicates. Only used as a benchmark baseline.
+    void read_mtrk_with_predicates(std::istream& in, midi::EventReceiver& receiver)
+    {
+        midi::CHUNK_HEADER header;
+        midi::read_chunk_header(in, &header);
+        bool end_reached = false;
+        uint8_t previous = 0;
+
+        while (!end_reached)
+        {
+            midi::Duration duration(io::read_variable_length_integer(in));
+            uint8_t identifier = io::read<uint8_t>(in);
+            uint8_t first_data;
+
+            if (midi::is_running_status(identifier))
+            {
+                first_data = identifier;
+                identifier = previous;
+            }
+            else
+            {
+                first_data = io::read<uint8_t>(in);
+            }
+
+            if (midi::is_meta_event(identifier))
+            {
+                uint64_t length = io::read_variable_length_integer(in);
+                auto data = io::read_array<uint8_t>(in, length);
+                receiver.meta(duration, first_data, std::move(data), length);
+                end_reached = first_data == 0x2F;
+            }
+            else if (midi::is_sysex_event(identifier))
+            {
+                in.putback(first_data);
+                uint64_t length = io::read_variable_length_integer(in);
+                auto data = io::read_array<uint8_t>(in, length);
+                receiver.sysex(duration, std::move(data), length);
+            }
+            else if (midi::is_midi_event(identifier))
+            {
+                uint8_t type = midi::extract_midi_event_type(identifier);
+                midi::Channel channel = midi::extract_midi_event_channel(identifier);
+
+                if (midi::is_note_off(type))
+                {
+                    receiver.note_off(duration, channel, midi::NoteNumber(first_data), io::read<uint8_t>(in));
+                }
+                else if (midi::is_note_on(type))
+                {
+                    receiver.note_on(duration, channel, midi::NoteNumber(first_data), io::read<uint8_t>(in));
+                }
+                else if (midi::is_polyphonic_key_pressure(type))
+                {
+                    receiver.polyphonic_key_pressure(duration, channel, midi::NoteNumber(first_data), io::read<uint8_t>(in));
+                }
+                else if (midi::is_control_change(type))
+                {
+                    receiver.control_change(duration, channel, first_data, io::read<uint8_t>(in));
+                }
+                else if (midi::is_program_change(type))
+                {
+                    receiver.program_change(duration, channel, midi::Instrument(first_data));
+                }
+                else if (midi::is_channel_pressure(type))
+                {
+                    receiver.channel_pressure(duration, channel, first_data);
+                }
+                else if (midi::is_pitch_wheel_change(type))
+                {
+                    uint8_t upper = io::read<uint8_t>(in);
+                    receiver.pitch_wheel_change(duration, channel, uint16_t(upper << 7 | first_data));
+                }
+            }
+
+            previous = identifier;
+        }
+    }
+
+    struct CountingReceiver : public midi::EventReceiver
+    {
+        uint64_t events = 0;
+        uint64_t checksum = 0;
+
+        void note_on(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t velocity) override { count(dt, value(note) + velocity); }
+        void note_off(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t velocity) override { count(dt, value(note) + velocity); }
+        void polyphonic_key_pressure(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t pressure) override { count(dt, pressure); }
+        void control_change(midi::Duration dt, midi::Channel channel, uint8_t controller, uint8_t value) override { count(dt, controller + value); }
+        void program_change(midi::Duration dt, midi::Channel channel, midi::Instrument program) override { count(dt, value(program)); }
+        void channel_pressure(midi::Duration dt, midi::Channel channel, uint8_t pressure) override { count(dt, pressure); }
+        void pitch_wheel_change(midi::Duration dt, midi::Channel channel, uint16_t value) override { count(dt, value); }
+        void meta(midi::Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override { count(dt, type); }
+        void sysex(midi::Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override { count(dt, data_size); }
+
+        void count(midi::Duration dt, uint64_t x)
+        {
+            ++events;
+            checksum = checksum * 31 + value(dt) + x;
+        }
+    };
+
+    // Builds a single MTrk chunk containing n events of mixed kinds, mostly with running status.
+    std::string build_dense_track(int n)
+    {
+        std::vector<char> body;
+
+        for (int i = 0; i != n; ++i)
+        {
+            const char dt = char(i % 3);
+            const int channel = (i / 64) % 16;
+            const int note = i % 128;
+
+            switch (i % 8)
+            {
+            case 0: { const char bytes[] = { dt, NOTE_ON(channel, note, 100) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 1: { const char bytes[] = { dt, NOTE_ON_RS(note, 90) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 2: { const char bytes[] = { dt, NOTE_OFF(channel, note, 0) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 3: { const char bytes[] = { dt, NOTE_OFF_RS(note, 0) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 4: { const char bytes[] = { dt, CONTROL_CHANGE(channel, 7, note) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 5: { const char bytes[] = { dt, PITCH_WHEEL_CHANGE(channel, 0x1234) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 6: { const char bytes[] = { dt, PROGRAM_CHANGE(channel, note) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            case 7: { const char bytes[] = { dt, CHANNEL_PRESSURE(channel, note) }; body.insert(body.end(), bytes, bytes + sizeof(bytes)); break; }
+            }
+        }
+
+        const char end_of_track[] = { END_OF_TRACK };
+        body.insert(body.end(), end_of_track, end_of_track + sizeof(end_of_track));
+
+        const uint32_t size = uint32_t(body.size());
+        const char header[] = { MTRK, char(size >> 24), char(size >> 16), char(size >> 8), char(size) };
+
+        return std::string(header, sizeof(header)) + std::string(body.begin(), body.end());
+    }
+}
+
+TEST_CASE("Status table agrees with predicates")
+{
+    for (int i = 0; i != 256; ++i)
+    {
+        const uint8_t status = uint8_t(i);
+        const midi::STATUS_INFO& info = midi::status_table[status];
+
+        CATCH_CHECK((info.kind == midi::EventKind::running_status) == midi::is_running_status(status));
+        CATCH_CHECK((info.kind == midi::EventKind::meta) == midi::is_meta_event(status));
+        CATCH_CHECK((info.kind == midi::EventKind::sysex) == midi::is_sysex_event(status));
+        CATCH_CHECK(info.running_status == midi::is_midi_event(status));
+
+        if (midi::is_midi_event(status))
+        {
+            const uint8_t type = midi::extract_midi_event_type(status);
+
+            CATCH_CHECK(midi::Channel(info.channel) == midi::extract_midi_event_channel(status));
+            CATCH_CHECK((info.kind == midi::EventKind::note_off) == midi::is_note_off(type));
+            CATCH_CHECK((info.kind == midi::EventKind::note_on) == midi::is_note_on(type));
+            CATCH_CHECK((info.kind == midi::EventKind::polyphonic_key_pressure) == midi::is_polyphonic_key_pressure(type));
+            CATCH_CHECK((info.kind == midi::EventKind::control_change) == midi::is_control_change(type));
+            CATCH_CHECK((info.kind == midi::EventKind::program_change) == midi::is_program_change(type));
+            CATCH_CHECK((info.kind == midi::EventKind::channel_pressure) == midi::is_channel_pressure(type));
+            CATCH_CHECK((info.kind == midi::EventKind::pitch_wheel_change) == midi::is_pitch_wheel_change(type));
+            CATCH_CHECK(info.data_bytes == (midi::is_program_change(type) || midi::is_channel_pressure(type) ? 1 : 2));
+        }
+    }
+}
+
+TEST_CASE("Reading MTrk, running status survives meta events")
+{
+    auto receiver = Builder()
+        .note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(5), 10)
+        .meta(midi::Duration(1), 0x01, "abc")
+        .note_on(midi::Duration(2), midi::Channel(3), midi::NoteNumber(6), 11)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+    const char bytes[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 18,
+        0, NOTE_ON(3, 5, 10),
+        1, char(0xFF), 0x01, 3, 'a', 'b', 'c',
+        2, NOTE_ON_RS(6, 11),
+        END_OF_TRACK
+    };
+    std::stringstream ss(std::string(bytes, sizeof(bytes)));
+
+    midi::read_mtrk(ss, *receiver);
+
+    receiver->check_finished();
+}
+
+TEST_CASE("Status table decoder matches predicate decoder on dense track")
+{
+    const std::string track = build_dense_track(10000);
+
+    CountingReceiver expected;
+    std::stringstream ss1(track);
+    read_mtrk_with_predicates(ss1, expected);
+
+    CountingReceiver actual;
+    std::stringstream ss2(track);
+    midi::read_mtrk(ss2, actual);
+
+    CATCH_CHECK(actual.events == expected.events);
+    CATCH_CHECK(actual.checksum == expected.checksum);
+}
+
+TEST_CASE("Status table decoder versus predicate decoder", "[.][benchmark]")
+{
+    const std::string track = build_dense_track(1000000);
+
+    BENCHMARK("read_mtrk, predicate chain")
+    {
+        CountingReceiver receiver;
+        std::stringstream ss(track);
+        read_mtrk_with_predicates(ss, receiver);
+    }
+
+    BENCHMARK("read_mtrk, status table")
+    {
+        CountingReceiver receiver;
+        std::stringstream ss(track);
+        midi::read_mtrk(ss, receiver);
+    }
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "tests/tests-util.h"
+#include <vector>
+#include <string>
+
+using namespace testutils;
+
+
+namespace
+{
+    std::unique_ptr<uint8_t[]> to_char_array(const std::string& string)
+    {
+        auto result = std::make_unique<uint8_t[]>(string.size());
+
+        for (size_t i = 0; i != string.size(); ++i)
+        {
+            result[i] = string[i];
+        }
+
+        return result;
+    }
+}
+
+TEST_CASE("Fanout test, no receivers")
+{
+    midi::EventFanout<> fanout;
+
+    fanout.note_on(midi::Duration(1), midi::Channel(2), midi::NoteNumber(3), 4);
+    fanout.meta(midi::Duration(1), 5, to_char_array("abc"), 3);
+    fanout.sysex(midi::Duration(1), to_char_array("abc"), 3);
+}
+
+TEST_CASE("Fanout test, one receiver, one event (note on)")
+{
+    auto receiver = Builder().note_on(midi::Duration(1), midi::Channel(2), midi::NoteNumber(3), 4).build();
+    midi::EventFanout<> fanout({ receiver.get() });
+
+    fanout.note_on(midi::Duration(1), midi::Channel(2), midi::NoteNumber(3), 4);
+
+    receiver->check_finished();
+}
+
+TEST_CASE("Fanout test, three receivers, all event kinds")
+{
+    auto create_receiver = []() {
+        return Builder()
+            .note_on(midi::Duration(1), midi::Channel(2), midi::NoteNumber(3), 4)
+            .note_off(midi::Duration(5), midi::Channel(2), midi::NoteNumber(3), 0)
+            .polyphonic_key_pressure(midi::Duration(6), midi::Channel(7), midi::NoteNumber(8), 9)
+            .control_change(midi::Duration(10), midi::Channel(11), 12, 13)
+            .program_change(midi::Duration(14), midi::Channel(15), midi::Instrument(16))
+            .channel_pressure(midi::Duration(17), midi::Channel(1), 18)
+            .pitch_wheel_change(midi::Duration(19), midi::Channel(3), 0x1234)
+            .meta(midi::Duration(20), 0x51, "xyz")
+            .sysex(midi::Duration(21), "hello")
+            .build();
+    };
+
+    std::vector<std::unique_ptr<TestEventReceiver>> receivers;
+    receivers.push_back(create_receiver());
+    receivers.push_back(create_receiver());
+    receivers.push_back(create_receiver());
+
+    midi::EventFanout<TestEventReceiver> fanout({ receivers[0].get(), receivers[1].get(), receivers[2].get() });
+
+    fanout.note_on(midi::Duration(1), midi::Channel(2), midi::NoteNumber(3), 4);
+    fanout.note_off(midi::Duration(5), midi::Channel(2), midi::NoteNumber(3), 0);
+    fanout.polyphonic_key_pressure(midi::Duration(6), midi::Channel(7), midi::NoteNumber(8), 9);
+    fanout.control_change(midi::Duration(10), midi::Channel(11), 12, 13);
+    fanout.program_change(midi::Duration(14), midi::Channel(15), midi::Instrument(16));
+    fanout.channel_pressure(midi::Duration(17), midi::Channel(1), 18);
+    fanout.pitch_wheel_change(midi::Duration(19), midi::Channel(3), 0x1234);
+    fanout.meta(midi::Duration(20), 0x51, to_char_array("xyz"), 3);
+    fanout.sysex(midi::Duration(21), to_char_array("hello"), 5);
+
+    for (auto& receiver : receivers)
+    {
+        receiver->check_finished();
+    }
+}
+
+TEST_CASE("Fanout test, channel note collectors")
+{
+    std::vector<midi::NOTE> notes;
+    auto receiver = [&notes](const midi::NOTE& note) { notes.push_back(note); };
+    midi::ChannelNoteCollector first(midi::Channel(0), receiver);
+    midi::ChannelNoteCollector second(midi::Channel(1), receiver);
+    midi::EventFanout<midi::ChannelNoteCollector> fanout({ &first, &second });
+
+    fanout.note_on(midi::Duration(0), midi::Channel(1), midi::NoteNumber(5), 11);
+    fanout.note_on(midi::Duration(10), midi::Channel(0), midi::NoteNumber(6), 12);
+    fanout.note_off(midi::Duration(100), midi::Channel(1), midi::NoteNumber(5), 0);
+    fanout.note_off(midi::Duration(5), midi::Channel(0), midi::NoteNumber(6), 0);
+
+    CATCH_REQUIRE(notes.size() == 2);
+    CATCH_CHECK(notes[0] == midi::NOTE(midi::NoteNumber(5), midi::Time(0), midi::Duration(110), 11, midi::Instrument(0)));
+    CATCH_CHECK(notes[1] == midi::NOTE(midi::NoteNumber(6), midi::Time(10), midi::Duration(105), 12, midi::Instrument(0)));
+}
+
+#endif
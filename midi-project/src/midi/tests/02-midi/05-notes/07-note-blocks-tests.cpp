@@ -0,0 +1,154 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/midi.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <vector>
+#include <sstream>
+
+
+namespace
+{
+    struct BlockRecorder : public midi::NoteSink
+    {
+        std::vector<std::vector<midi::NOTE>> blocks;
+
+        void receive(const midi::NOTE* notes, size_t count) override
+        {
+            blocks.push_back(std::vector<midi::NOTE>(notes, notes + count));
+        }
+    };
+
+    midi::NOTE make_note(int i)
+    {
+        return midi::NOTE(midi::NoteNumber(i), midi::Time(10 * i), midi::Duration(i + 1), uint8_t(i), midi::Instrument(i % 3));
+    }
+}
+
+TEST_CASE("NoteBlockBuffer, no notes")
+{
+    BlockRecorder recorder;
+    midi::NoteBlockBuffer buffer(recorder, 4);
+
+    buffer.flush();
+
+    CATCH_CHECK(recorder.blocks.size() == 0);
+}
+
+TEST_CASE("NoteBlockBuffer, full blocks are passed on immediately")
+{
+    BlockRecorder recorder;
+    midi::NoteBlockBuffer buffer(recorder, 4);
+
+    for (int i = 0; i != 10; ++i)
+    {
+        buffer.push_back(make_note(i));
+    }
+
+    CATCH_REQUIRE(recorder.blocks.size() == 2);
+    CATCH_CHECK(recorder.blocks[0].size() == 4);
+    CATCH_CHECK(recorder.blocks[1].size() == 4);
+
+    buffer.flush();
+
+    CATCH_REQUIRE(recorder.blocks.size() == 3);
+    CATCH_REQUIRE(recorder.blocks[2].size() == 2);
+    CATCH_CHECK(recorder.blocks[0][0] == make_note(0));
+    CATCH_CHECK(recorder.blocks[1][3] == make_note(7));
+    CATCH_CHECK(recorder.blocks[2][1] == make_note(9));
+}
+
+TEST_CASE("NoteColumns, push_back and indexing")
+{
+    midi::NoteColumns columns;
+
+    for (int i = 0; i != 5; ++i)
+    {
+        columns.push_back(make_note(i));
+    }
+
+    CATCH_REQUIRE(columns.size() == 5);
+    CATCH_CHECK(columns.note_numbers[3] == midi::NoteNumber(3));
+    CATCH_CHECK(columns.starts[3] == midi::Time(30));
+    CATCH_CHECK(columns.durations[3] == midi::Duration(4));
+    CATCH_CHECK(columns.velocities[3] == 3);
+    CATCH_CHECK(columns.instruments[3] == midi::Instrument(0));
+
+    for (int i = 0; i != 5; ++i)
+    {
+        CATCH_CHECK(columns[i] == make_note(i));
+    }
+
+    columns.clear();
+
+    CATCH_CHECK(columns.size() == 0);
+}
+
+TEST_CASE("ChannelNoteCollector with block buffer")
+{
+    BlockRecorder recorder;
+    midi::NoteBlockBuffer buffer(recorder, 2);
+    midi::ChannelNoteCollector collector(midi::Channel(1), buffer);
+
+    collector.note_on(midi::Duration(0), midi::Channel(1), midi::NoteNumber(5), 11);
+    collector.note_off(midi::Duration(100), midi::Channel(1), midi::NoteNumber(5), 0);
+    collector.note_on(midi::Duration(0), midi::Channel(2), midi::NoteNumber(5), 11);
+    collector.note_off(midi::Duration(100), midi::Channel(2), midi::NoteNumber(5), 0);
+
+    CATCH_CHECK(recorder.blocks.size() == 0);
+
+    buffer.flush();
+
+    CATCH_REQUIRE(recorder.blocks.size() == 1);
+    CATCH_REQUIRE(recorder.blocks[0].size() == 1);
+    CATCH_CHECK(recorder.blocks[0][0] == midi::NOTE(midi::NoteNumber(5), midi::Time(0), midi::Duration(100), 11, midi::Instrument(0)));
+}
+
+TEST_CASE("read_notes into columns matches read_notes into vector")
+{
+    char buffer[] = {
+        MTHD,
+        0x00, 0x00, 0x00, 0x06, // MThd size
+        0x00, 0x01, // Type
+        0x00, 0x02, // Number of tracks
+        0x01, 0x00, // Division
+        MTRK,
+        0x00, 0x00, 0x00, 31, // MTrk size
+        0, NOTE_ON(0, 5, 120),
+        0, NOTE_ON(1, 6, 110),
+        100, NOTE_OFF(0, 5, 0),
+        0, PROGRAM_CHANGE(1, 8),
+        10, NOTE_OFF(1, 6, 0),
+        0, NOTE_ON(1, 6, 100),
+        5, NOTE_OFF(1, 6, 0),
+        END_OF_TRACK,
+        MTRK,
+        0x00, 0x00, 0x00, 12, // MTrk size
+        7, NOTE_ON(3, 60, 90),
+        3, NOTE_OFF(3, 60, 0),
+        END_OF_TRACK
+    };
+    std::string data(buffer, sizeof(buffer));
+
+    std::stringstream ss1(data);
+    std::vector<midi::NOTE> expected = midi::read_notes(ss1);
+
+    for (size_t block_size = 1; block_size != 6; ++block_size)
+    {
+        std::stringstream ss2(data);
+        midi::NoteColumns columns;
+        midi::read_notes(ss2, columns, block_size);
+
+        CATCH_REQUIRE(expected.size() == 4);
+        CATCH_REQUIRE(columns.size() == expected.size());
+
+        for (size_t i = 0; i != expected.size(); ++i)
+        {
+            CATCH_CHECK(columns[i] == expected[i]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/note-cache.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    // Single track file with three notes and a tempo change. The note_offset
+    // shifts all note numbers so that different files can be generated.
+    std::string build_file(int note_offset)
+    {
+        const char bytes[] = {
+            MTHD,
+            0x00, 0x00, 0x00, 0x06, // MThd size
+            0x00, 0x01, // Type
+            0x00, 0x01, // Number of tracks
+            0x01, 0x00, // Division
+            MTRK,
+            0x00, 0x00, 0x00, 35, // MTrk size
+            0, char(0xFF), 0x51, 3, 0x07, char(0xA1), 0x20,
+            0, NOTE_ON(0, 60 + note_offset, 100),
+            10, NOTE_ON(1, 40 + note_offset, 90),
+            90, NOTE_OFF(0, 60 + note_offset, 0),
+            5, char(0xFF), 0x51, 3, 0x0F, 0x42, 0x40,
+            20, NOTE_OFF(1, 40 + note_offset, 0),
+            0, PROGRAM_CHANGE(2, 7),
+            0, NOTE_ON(2, 70 + note_offset, 80),
+            50, NOTE_OFF(2, 70 + note_offset, 0),
+            END_OF_TRACK
+        };
+
+        return std::string(bytes, sizeof(bytes));
+    }
+
+    void write_file(const std::string& path, const std::string& contents)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    const uint8_t* bytes_of(const std::string& s)
+    {
+        return reinterpret_cast<const uint8_t*>(s.data());
+    }
+
+    void remove_cache(const std::vector<std::string>& files)
+    {
+        midi::NoteCache cache(".", 0);
+        for (auto& file : files)
+        {
+            // With a maximum size of zero, every stored entry is evicted immediately
+            cache.load(file);
+            std::remove(file.c_str());
+        }
+        std::remove("./notes.index");
+        std::remove("./notes.lock");
+    }
+}
+
+TEST_CASE("content_hash")
+{
+    const std::string a = build_file(0);
+    std::string b = a;
+    b[b.size() - 5] ^= 1;
+
+    CATCH_CHECK(midi::content_hash(bytes_of(a), a.size()) == midi::content_hash(bytes_of(a), a.size()));
+    CATCH_CHECK(midi::content_hash(bytes_of(a), a.size()) != midi::content_hash(bytes_of(b), b.size()));
+    CATCH_CHECK(midi::content_hash(bytes_of(a), a.size()) != midi::content_hash(bytes_of(a), a.size() - 1));
+    CATCH_CHECK(midi::content_hash(nullptr, 0) != midi::content_hash(bytes_of(a), 1));
+}
+
+TEST_CASE("CachedNotes::parse agrees with read_notes")
+{
+    const std::string data = build_file(0);
+    std::stringstream ss(data);
+    std::vector<midi::NOTE> expected = midi::read_notes(ss);
+
+    auto cached = midi::CachedNotes::parse(bytes_of(data), data.size());
+
+    CATCH_REQUIRE(cached != nullptr);
+    CATCH_REQUIRE(cached->size() == 3);
+    CATCH_CHECK(cached->notes() == expected);
+    CATCH_CHECK(cached->hash() == midi::content_hash(bytes_of(data), data.size()));
+    CATCH_CHECK(cached->source_size() == data.size());
+
+    CATCH_CHECK(cached->stats().note_count == 3);
+    CATCH_CHECK(cached->stats().end == midi::Time(175));
+    CATCH_CHECK(cached->stats().lowest == midi::NoteNumber(40));
+    CATCH_CHECK(cached->stats().highest == midi::NoteNumber(70));
+
+    CATCH_REQUIRE(cached->tempo_count() == 2);
+    CATCH_CHECK(cached->tempo(0).time == midi::Time(0));
+    CATCH_CHECK(cached->tempo(0).microseconds_per_quarter == 500000);
+    CATCH_CHECK(cached->tempo(1).time == midi::Time(105));
+    CATCH_CHECK(cached->tempo(1).microseconds_per_quarter == 1000000);
+}
+
+TEST_CASE("CachedNotes::from_image rejects invalid images")
+{
+    const std::string data = build_file(0);
+    auto cached = midi::CachedNotes::parse(bytes_of(data), data.size());
+    std::vector<uint8_t> image(cached->image(), cached->image() + cached->image_size());
+
+    CATCH_CHECK(midi::CachedNotes::from_image(nullptr, image.data(), image.size()) != nullptr);
+    CATCH_CHECK(midi::CachedNotes::from_image(nullptr, image.data(), image.size() - 8) == nullptr);
+    CATCH_CHECK(midi::CachedNotes::from_image(nullptr, image.data(), 10) == nullptr);
+
+    image[0] = 'X';
+    CATCH_CHECK(midi::CachedNotes::from_image(nullptr, image.data(), image.size()) == nullptr);
+}
+
+TEST_CASE("NoteCache, miss then hit")
+{
+    write_file("note-cache-test-1.mid", build_file(0));
+
+    {
+        midi::NoteCache cache(".", 1 << 20);
+        auto notes = cache.load("note-cache-test-1.mid");
+
+        CATCH_CHECK(cache.hits() == 0);
+        CATCH_CHECK(cache.misses() == 1);
+        CATCH_CHECK(notes->size() == 3);
+    }
+
+    {
+        midi::NoteCache cache(".", 1 << 20);
+        auto notes = cache.load("note-cache-test-1.mid");
+
+        CATCH_CHECK(cache.hits() == 1);
+        CATCH_CHECK(cache.misses() == 0);
+        CATCH_REQUIRE(notes->size() == 3);
+        CATCH_CHECK(notes->stats().highest == midi::NoteNumber(70));
+        CATCH_CHECK(notes->tempo_count() == 2);
+    }
+
+    remove_cache({ "note-cache-test-1.mid" });
+}
+
+TEST_CASE("NoteCache, changed file is a miss")
+{
+    write_file("note-cache-test-1.mid", build_file(0));
+    {
+        midi::NoteCache cache(".", 1 << 20);
+        cache.load("note-cache-test-1.mid");
+    }
+
+    write_file("note-cache-test-1.mid", build_file(1));
+    {
+        midi::NoteCache cache(".", 1 << 20);
+        auto notes = cache.load("note-cache-test-1.mid");
+
+        CATCH_CHECK(cache.misses() == 1);
+        CATCH_CHECK(notes->stats().highest == midi::NoteNumber(71));
+    }
+
+    write_file("note-cache-test-2.mid", build_file(0));
+    remove_cache({ "note-cache-test-1.mid", "note-cache-test-2.mid" });
+}
+
+TEST_CASE("NoteCache, least recently used entry is evicted")
+{
+    write_file("note-cache-test-1.mid", build_file(0));
+    write_file("note-cache-test-2.mid", build_file(1));
+    write_file("note-cache-test-3.mid", build_file(2));
+
+    uint64_t entry_size;
+    {
+        const std::string data = build_file(0);
+        entry_size = midi::CachedNotes::parse(bytes_of(data), data.size())->image_size();
+    }
+
+    {
+        midi::NoteCache cache(".", 2 * entry_size);
+        cache.load("note-cache-test-1.mid");
+        cache.load("note-cache-test-2.mid");
+        cache.load("note-cache-test-1.mid");
+        cache.load("note-cache-test-3.mid");
+
+        CATCH_CHECK(cache.hits() == 1);
+        CATCH_CHECK(cache.misses() == 3);
+        CATCH_CHECK(cache.total_size() == 2 * entry_size);
+    }
+
+    {
+        midi::NoteCache cache(".", 2 * entry_size);
+        cache.load("note-cache-test-1.mid");
+        cache.load("note-cache-test-3.mid");
+        cache.load("note-cache-test-2.mid");
+
+        CATCH_CHECK(cache.hits() == 2);
+        CATCH_CHECK(cache.misses() == 1);
+    }
+
+    remove_cache({ "note-cache-test-1.mid", "note-cache-test-2.mid", "note-cache-test-3.mid" });
+}
+
+TEST_CASE("NoteCache, caches sharing a directory keep each other's entries")
+{
+    write_file("note-cache-test-1.mid", build_file(0));
+    write_file("note-cache-test-2.mid", build_file(1));
+    write_file("note-cache-test-3.mid", build_file(2));
+
+    uint64_t entry_size;
+    {
+        const std::string data = build_file(0);
+        entry_size = midi::CachedNotes::parse(bytes_of(data), data.size())->image_size();
+    }
+
+    {
+        // Both read the empty index before either stores anything
+        midi::NoteCache first(".", 2 * entry_size);
+        midi::NoteCache second(".", 2 * entry_size);
+
+        first.load("note-cache-test-1.mid");
+        second.load("note-cache-test-2.mid");
+
+        CATCH_CHECK(second.total_size() == 2 * entry_size);
+
+        // Over the limit with the entries of both, so the oldest, stored by first, goes
+        second.load("note-cache-test-3.mid");
+
+        CATCH_CHECK(second.total_size() == 2 * entry_size);
+    }
+
+    {
+        midi::NoteCache cache(".", 2 * entry_size);
+        cache.load("note-cache-test-2.mid");
+        cache.load("note-cache-test-3.mid");
+        cache.load("note-cache-test-1.mid");
+
+        CATCH_CHECK(cache.hits() == 2);
+        CATCH_CHECK(cache.misses() == 1);
+    }
+
+    remove_cache({ "note-cache-test-1.mid", "note-cache-test-2.mid", "note-cache-test-3.mid" });
+}
+
+#endif
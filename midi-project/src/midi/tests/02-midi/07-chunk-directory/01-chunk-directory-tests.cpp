@@ -0,0 +1,109 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/chunk-directory.h"
+#include "io/memory-buffer.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    // Three tracks and an unknown chunk. The body of the unknown chunk and
+    // of the second track is garbage, which read_mtrk cannot decode.
+    std::string build_file()
+    {
+        const char bytes[] = {
+            MTHD,
+            0x00, 0x00, 0x00, 0x06, // MThd size
+            0x00, 0x01, // Type
+            0x00, 0x03, // Number of tracks
+            0x01, 0x00, // Division
+            MTRK,
+            0x00, 0x00, 0x00, 16, // MTrk size
+            0, NOTE_ON(0, 60, 100),
+            10, NOTE_ON(1, 61, 90),
+            90, NOTE_OFF(0, 60, 0),
+            END_OF_TRACK,
+            'X', 'Y', 'Z', 'W',
+            0x00, 0x00, 0x00, 3,
+            char(0xF1), char(0xF2), char(0xF3),
+            MTRK,
+            0x00, 0x00, 0x00, 4, // MTrk size
+            char(0x80), char(0x80), char(0x80), char(0x80),
+            MTRK,
+            0x00, 0x00, 0x00, 16, // MTrk size
+            5, NOTE_ON(2, 70, 80),
+            50, NOTE_OFF(2, 70, 0),
+            0, CONTROL_CHANGE(1, 7, 0),
+            END_OF_TRACK
+        };
+
+        return std::string(bytes, sizeof(bytes));
+    }
+}
+
+TEST_CASE("ChunkDirectory lists chunks without decoding them")
+{
+    std::stringstream ss(build_file());
+    midi::ChunkDirectory directory(ss);
+
+    CATCH_CHECK(directory.mthd().ntracks == 3);
+    CATCH_REQUIRE(directory.chunks().size() == 4);
+    CATCH_CHECK(midi::header_id(directory.chunks()[1].header) == "XYZW");
+    CATCH_CHECK(directory.chunks()[1].header.size == 3);
+
+    CATCH_REQUIRE(directory.track_count() == 3);
+    CATCH_CHECK(directory.track(0).offset == 14);
+    CATCH_CHECK(directory.track(0).header.size == 16);
+    CATCH_CHECK(directory.track(1).offset == 14 + 8 + 16 + 8 + 3);
+    CATCH_CHECK(directory.track(2).offset == 14 + 8 + 16 + 8 + 3 + 8 + 4);
+}
+
+TEST_CASE("ChunkDirectory reads selected tracks only")
+{
+    std::stringstream ss(build_file());
+    midi::ChunkDirectory directory(ss);
+
+    std::vector<midi::NOTE> notes = directory.read_notes({ 2 });
+
+    CATCH_REQUIRE(notes.size() == 1);
+    CATCH_CHECK(notes[0] == midi::NOTE(midi::NoteNumber(70), midi::Time(5), midi::Duration(50), 80, midi::Instrument(0)));
+
+    notes = directory.read_notes({ 0, 2 });
+
+    CATCH_CHECK(notes.size() == 2);
+}
+
+TEST_CASE("ChunkDirectory reads selected channels only")
+{
+    std::stringstream ss(build_file());
+    midi::ChunkDirectory directory(ss);
+
+    std::vector<midi::NOTE> notes = directory.read_notes({ 0, 2 }, { midi::Channel(0), midi::Channel(2) });
+
+    CATCH_REQUIRE(notes.size() == 2);
+    CATCH_CHECK(notes[0] == midi::NOTE(midi::NoteNumber(60), midi::Time(0), midi::Duration(100), 100, midi::Instrument(0)));
+    CATCH_CHECK(notes[1] == midi::NOTE(midi::NoteNumber(70), midi::Time(5), midi::Duration(50), 80, midi::Instrument(0)));
+}
+
+TEST_CASE("ChunkDirectory on memory buffer")
+{
+    const std::string data = build_file();
+    io::MemoryBuffer buffer(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    std::istream in(&buffer);
+    midi::ChunkDirectory directory(in);
+
+    CATCH_REQUIRE(directory.track_count() == 3);
+
+    std::vector<midi::NOTE> notes = directory.read_notes({ 2, 0 });
+
+    CATCH_REQUIRE(notes.size() == 2);
+    CATCH_CHECK(notes[0].note_number == midi::NoteNumber(70));
+    CATCH_CHECK(notes[1].note_number == midi::NoteNumber(60));
+}
+
+#endif
@@ -0,0 +1,226 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/track-index.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    // Builds an MTrk chunk of n channel events with overlapping notes, program
+    // changes and running status. Notes are only turned off while sounding.
+    std::string build_track(int n)
+    {
+        std::vector<char> body;
+        bool sounding[16][128] = { };
+        uint32_t random = 12345;
+        uint8_t previous_status = 0;
+
+        for (int i = 0; i != n; ++i)
+        {
+            random = random * 1103515245 + 12345;
+            const uint32_t r = random >> 8;
+            const int channel = r % 3;
+            const int note = 30 + (r / 3) % 20;
+            uint8_t status;
+            uint8_t data[2];
+            int data_size = 2;
+
+            body.push_back(char((r / 7) % 4 * 3));
+
+            if (r % 10 == 0)
+            {
+                status = uint8_t(0xC0 | channel);
+                data[0] = uint8_t(r % 100);
+                data_size = 1;
+            }
+            else if (r % 10 < 5)
+            {
+                status = uint8_t(0x90 | channel);
+                data[0] = uint8_t(note);
+                data[1] = uint8_t(1 + r % 120);
+                sounding[channel][note] = true;
+            }
+            else
+            {
+                int off = -1;
+                for (int k = 0; k != 128 && off == -1; ++k)
+                {
+                    if (sounding[channel][k]) off = k;
+                }
+
+                if (off != -1)
+                {
+                    status = uint8_t(0x80 | channel);
+                    data[0] = uint8_t(off);
+                    data[1] = 0;
+                    sounding[channel][off] = false;
+                }
+                else
+                {
+                    status = uint8_t(0xB0 | channel);
+                    data[0] = 7;
+                    data[1] = uint8_t(r % 128);
+                }
+            }
+
+            if (status != previous_status)
+            {
+                body.push_back(char(status));
+                previous_status = status;
+            }
+            body.insert(body.end(), data, data + data_size);
+        }
+
+        const char end_of_track[] = { END_OF_TRACK };
+        body.insert(body.end(), end_of_track, end_of_track + sizeof(end_of_track));
+
+        const uint32_t size = uint32_t(body.size());
+        const char header[] = { MTRK, char(size >> 24), char(size >> 16), char(size >> 8), char(size) };
+
+        return std::string(header, sizeof(header)) + std::string(body.begin(), body.end());
+    }
+
+    std::vector<midi::NOTE> read_all_notes(const std::string& track)
+    {
+        std::vector<midi::NOTE> notes;
+        midi::NoteCollector collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+        std::stringstream ss(track);
+        midi::read_mtrk(ss, collector);
+
+        return notes;
+    }
+
+    std::vector<midi::NOTE> notes_from(const std::vector<midi::NOTE>& notes, midi::Time time)
+    {
+        std::vector<midi::NOTE> result;
+
+        for (const midi::NOTE& note : notes)
+        {
+            if (note.start + note.duration > time || note.start >= time)
+            {
+                result.push_back(note);
+            }
+        }
+        return result;
+    }
+}
+
+TEST_CASE("TrackIndex, checkpoint every interval events")
+{
+    const std::string track = build_track(100);
+    std::stringstream ss(track);
+    midi::TrackIndex index(ss, 10);
+
+    // 100 events and End of Track
+    CATCH_REQUIRE(index.checkpoints().size() == 11);
+    CATCH_CHECK(index.checkpoints()[0].offset == 8);
+    CATCH_CHECK(index.checkpoints()[0].time == midi::Time(0));
+    CATCH_CHECK(index.checkpoints()[0].running_status == 0);
+    CATCH_CHECK(index.checkpoints()[0].sounding_notes.empty());
+
+    for (size_t i = 1; i != index.checkpoints().size(); ++i)
+    {
+        CATCH_CHECK(index.checkpoints()[i - 1].offset < index.checkpoints()[i].offset);
+        CATCH_CHECK(index.checkpoints()[i - 1].time <= index.checkpoints()[i].time);
+        CATCH_CHECK(index.checkpoints()[i].running_status >= 0x80);
+    }
+}
+
+TEST_CASE("TrackIndex, events are passed on while indexing")
+{
+    auto receiver = testutils::Builder()
+        .note_on(midi::Duration(0), midi::Channel(1), midi::NoteNumber(5), 10)
+        .note_on(midi::Duration(20), midi::Channel(1), midi::NoteNumber(5), 0)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+    const char bytes[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 11,
+        0, NOTE_ON(1, 5, 10),
+        20, NOTE_ON_RS(5, 0),
+        END_OF_TRACK
+    };
+    std::stringstream ss(std::string(bytes, sizeof(bytes)));
+
+    midi::TrackIndex index(ss, *receiver, 1);
+
+    receiver->check_finished();
+    CATCH_REQUIRE(index.checkpoints().size() == 3);
+    CATCH_CHECK(index.checkpoints()[1].time == midi::Time(0));
+    CATCH_CHECK(index.checkpoints()[1].running_status == 0x91);
+    CATCH_REQUIRE(index.checkpoints()[1].sounding_notes.size() == 1);
+    CATCH_CHECK(index.checkpoints()[1].sounding_notes[0].channel == midi::Channel(1));
+    CATCH_CHECK(index.checkpoints()[1].sounding_notes[0].note_number == midi::NoteNumber(5));
+    CATCH_CHECK(index.checkpoints()[1].sounding_notes[0].velocity == 10);
+    CATCH_CHECK(index.checkpoints()[2].time == midi::Time(20));
+    CATCH_CHECK(index.checkpoints()[2].sounding_notes.empty());
+}
+
+TEST_CASE("TrackIndex, find")
+{
+    const std::string track = build_track(1000);
+    std::stringstream ss(track);
+    midi::TrackIndex index(ss, 16);
+
+    CATCH_CHECK(&index.find(midi::Time(0)) == &index.checkpoints()[0]);
+
+    for (uint64_t t = 0; t < 3000; t += 7)
+    {
+        const midi::CHECKPOINT& checkpoint = index.find(midi::Time(t));
+
+        CATCH_CHECK((checkpoint.time < midi::Time(t) || &checkpoint == &index.checkpoints()[0]));
+        if (&checkpoint != &index.checkpoints().back())
+        {
+            CATCH_CHECK(!((&checkpoint + 1)->time < midi::Time(t)));
+        }
+    }
+}
+
+TEST_CASE("TrackIndex, read_notes_from agrees with a full read")
+{
+    const std::string track = build_track(2000);
+    const std::vector<midi::NOTE> all = read_all_notes(track);
+
+    for (size_t interval : { 1, 3, 64, 5000 })
+    {
+        std::stringstream ss(track);
+        midi::TrackIndex index(ss, interval);
+
+        for (uint64_t t = 0; t < 6000; t += 97)
+        {
+            std::vector<midi::NOTE> expected = notes_from(all, midi::Time(t));
+            std::vector<midi::NOTE> actual = index.read_notes_from(ss, midi::Time(t));
+
+            CATCH_REQUIRE(actual.size() == expected.size());
+            for (size_t i = 0; i != expected.size(); ++i)
+            {
+                CATCH_CHECK(actual[i] == expected[i]);
+            }
+        }
+    }
+}
+
+TEST_CASE("TrackIndex, seeking versus reading from the start", "[.][benchmark]")
+{
+    const std::string track = build_track(1000000);
+    std::stringstream ss(track);
+    midi::TrackIndex index(ss, 1024);
+    const midi::Time late = index.checkpoints().back().time;
+
+    BENCHMARK("Full read, then filter")
+    {
+        notes_from(read_all_notes(track), late);
+    }
+
+    BENCHMARK("read_notes_from checkpoint")
+    {
+        index.read_notes_from(ss, late);
+    }
+}
+
+#endif
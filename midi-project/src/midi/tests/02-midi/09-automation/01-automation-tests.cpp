@@ -0,0 +1,221 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/automation.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    midi::AUTOMATION_POINT point(int channel, int lane, uint64_t time, int value)
+    {
+        return midi::AUTOMATION_POINT{ midi::Channel(uint8_t(channel)), uint16_t(lane), midi::Time(time), uint16_t(value) };
+    }
+
+    // Value of the last point at or before time, by scanning all points
+    uint16_t scan(const std::vector<midi::AUTOMATION_POINT>& points, uint64_t time)
+    {
+        uint16_t result = midi::default_value(7);
+
+        for (const midi::AUTOMATION_POINT& p : points)
+        {
+            if (value(p.time) <= time)
+            {
+                result = p.value;
+            }
+        }
+        return result;
+    }
+
+    // A volume sweep on channel 0: n points at irregular, increasing times
+    std::vector<midi::AUTOMATION_POINT> sweep(int n)
+    {
+        std::vector<midi::AUTOMATION_POINT> points;
+        uint64_t time = 0;
+        uint32_t random = 12345;
+
+        for (int i = 0; i != n; ++i)
+        {
+            random = random * 1103515245 + 12345;
+            time += (random >> 8) % 300;
+            points.push_back(point(0, 7, time, (random >> 16) % 128));
+        }
+        return points;
+    }
+}
+
+TEST_CASE("Automation, default values")
+{
+    midi::Automation automation;
+
+    CATCH_CHECK(automation.find(midi::Channel(0), 7) == nullptr);
+    CATCH_CHECK(automation.cursor(midi::Channel(0), 7).at(midi::Time(1000)) == 100);
+    CATCH_CHECK(automation.cursor(midi::Channel(3), 10).at(midi::Time(0)) == 64);
+    CATCH_CHECK(automation.cursor(midi::Channel(3), 11).at(midi::Time(0)) == 127);
+    CATCH_CHECK(automation.cursor(midi::Channel(3), 1).at(midi::Time(0)) == 0);
+    CATCH_CHECK(automation.cursor(midi::Channel(3), midi::PITCH_WHEEL_LANE).at(midi::Time(0)) == 0x2000);
+    CATCH_CHECK(automation.cursor(midi::Channel(3), midi::PITCH_WHEEL_LANE).interpolated(midi::Time(0)) == 0x2000);
+}
+
+TEST_CASE("AutomationLane, delta encoding")
+{
+    midi::AutomationLane lane;
+
+    lane.add(midi::Time(0), 5);
+    lane.add(midi::Time(100), 127);
+    lane.add(midi::Time(300), 0x2000);
+    lane.add(midi::Time(300), 1);
+
+    const std::vector<uint8_t> expected = {
+        0, 5,
+        100, 127,
+        0x81, 0x48, 0xC0, 0x00,
+        0, 1
+    };
+    CATCH_CHECK(lane.size() == 4);
+    CATCH_CHECK(lane.data() == expected);
+}
+
+TEST_CASE("AutomationCursor, step values")
+{
+    midi::Automation automation({ point(2, 7, 10, 50), point(2, 7, 20, 60), point(2, 7, 20, 70), point(2, 7, 40, 80) });
+    midi::AutomationCursor cursor = automation.cursor(midi::Channel(2), 7);
+
+    CATCH_CHECK(cursor.at(midi::Time(0)) == 100);
+    CATCH_CHECK(cursor.at(midi::Time(9)) == 100);
+    CATCH_CHECK(cursor.at(midi::Time(10)) == 50);
+    CATCH_CHECK(cursor.at(midi::Time(19)) == 50);
+    CATCH_CHECK(cursor.at(midi::Time(20)) == 70);
+    CATCH_CHECK(cursor.at(midi::Time(20)) == 70);
+    CATCH_CHECK(cursor.at(midi::Time(39)) == 70);
+    CATCH_CHECK(cursor.at(midi::Time(1000)) == 80);
+}
+
+TEST_CASE("AutomationCursor, interpolation")
+{
+    midi::Automation automation({ point(0, 1, 100, 0), point(0, 1, 200, 100), point(0, 1, 200, 50), point(0, 1, 300, 150) });
+    midi::AutomationCursor cursor = automation.cursor(midi::Channel(0), 1);
+
+    CATCH_CHECK(cursor.interpolated(midi::Time(50)) == 0);
+    CATCH_CHECK(cursor.interpolated(midi::Time(100)) == 0);
+    CATCH_CHECK(cursor.interpolated(midi::Time(150)) == Approx(50));
+    CATCH_CHECK(cursor.interpolated(midi::Time(200)) == Approx(50));
+    CATCH_CHECK(cursor.interpolated(midi::Time(275)) == Approx(125));
+    CATCH_CHECK(cursor.interpolated(midi::Time(300)) == 150);
+    CATCH_CHECK(cursor.interpolated(midi::Time(400)) == 150);
+}
+
+TEST_CASE("AutomationCursor agrees with scanning all points")
+{
+    const std::vector<midi::AUTOMATION_POINT> points = sweep(1000);
+    midi::Automation automation(points);
+    midi::AutomationCursor cursor = automation.cursor(midi::Channel(0), 7);
+
+    for (uint64_t t = 0; t < value(points.back().time) + 10; t += 37)
+    {
+        CATCH_INFO("t = " << t);
+        CATCH_REQUIRE(cursor.at(midi::Time(t)) == scan(points, t));
+    }
+}
+
+TEST_CASE("Automation, points in any order are sorted per lane")
+{
+    midi::Automation automation({ point(1, 7, 30, 3), point(0, 7, 20, 2), point(1, 7, 10, 1), point(1, 10, 0, 9), point(1, 7, 30, 4) });
+
+    CATCH_CHECK(automation.lane_count() == 3);
+    CATCH_CHECK(automation.point_count() == 5);
+    CATCH_CHECK(automation.byte_count() == 10);
+
+    midi::AutomationCursor cursor = automation.cursor(midi::Channel(1), 7);
+    CATCH_CHECK(cursor.at(midi::Time(10)) == 1);
+    CATCH_CHECK(cursor.at(midi::Time(30)) == 4);
+    CATCH_CHECK(automation.cursor(midi::Channel(0), 7).at(midi::Time(20)) == 2);
+    CATCH_CHECK(automation.cursor(midi::Channel(1), 10).at(midi::Time(0)) == 9);
+}
+
+TEST_CASE("read_automation merges tracks")
+{
+    char buffer[] = {
+        MTHD,
+        0x00, 0x00, 0x00, 0x06, // MThd size
+        0x00, 0x01, // Type
+        0x00, 0x02, // Number of tracks
+        0x01, 0x00, // Division
+        MTRK,
+        0x00, 0x00, 0x00, 27, // MTrk size
+        0, NOTE_ON(0, 60, 100),
+        10, CONTROL_CHANGE(0, 7, 80),
+        10, PITCH_WHEEL_CHANGE(0, 0x3000),
+        10, CHANNEL_PRESSURE(0, 40),
+        10, NOTE_OFF(0, 60, 0),
+        10, CONTROL_CHANGE(0, 7, 20),
+        END_OF_TRACK,
+        MTRK,
+        0x00, 0x00, 0x00, 12, // MTrk size
+        25, CONTROL_CHANGE(0, 7, 50),
+        0, POLYPHONIC_KEY_PRESSURE(0, 60, 30),
+        END_OF_TRACK
+    };
+    std::stringstream ss(std::string(buffer, sizeof(buffer)));
+
+    midi::Automation automation = midi::read_automation(ss);
+
+    CATCH_CHECK(automation.point_count() == 6);
+
+    midi::AutomationCursor volume = automation.cursor(midi::Channel(0), 7);
+    CATCH_CHECK(volume.at(midi::Time(9)) == 100);
+    CATCH_CHECK(volume.at(midi::Time(10)) == 80);
+    CATCH_CHECK(volume.at(midi::Time(25)) == 50);
+    CATCH_CHECK(volume.at(midi::Time(50)) == 20);
+
+    CATCH_CHECK(automation.cursor(midi::Channel(0), midi::PITCH_WHEEL_LANE).at(midi::Time(20)) == 0x3000);
+    CATCH_CHECK(automation.cursor(midi::Channel(0), midi::CHANNEL_PRESSURE_LANE).at(midi::Time(30)) == 40);
+    CATCH_CHECK(automation.cursor(midi::Channel(0), midi::KEY_PRESSURE_LANE + 60).at(midi::Time(25)) == 30);
+    CATCH_CHECK(automation.find(midi::Channel(0), midi::KEY_PRESSURE_LANE + 61) == nullptr);
+}
+
+TEST_CASE("AutomationCursor versus scanning events", "[.][benchmark]")
+{
+    const std::vector<midi::AUTOMATION_POINT> points = sweep(100000);
+    midi::Automation automation(points);
+    const uint64_t end = value(points.back().time);
+    const uint64_t step = end / 1000;
+
+    BENCHMARK("Scan all points, 1000 queries")
+    {
+        uint64_t sum = 0;
+        for (uint64_t t = 0; t < end; t += step)
+        {
+            sum += scan(points, t);
+        }
+        CATCH_CHECK(sum > 0);
+    }
+
+    BENCHMARK("AutomationCursor, 1000 queries")
+    {
+        uint64_t sum = 0;
+        midi::AutomationCursor cursor = automation.cursor(midi::Channel(0), 7);
+        for (uint64_t t = 0; t < end; t += step)
+        {
+            sum += cursor.at(midi::Time(t));
+        }
+        CATCH_CHECK(sum > 0);
+    }
+
+    BENCHMARK("AutomationCursor, every tick")
+    {
+        uint64_t sum = 0;
+        midi::AutomationCursor cursor = automation.cursor(midi::Channel(0), 7);
+        for (uint64_t t = 0; t < end; ++t)
+        {
+            sum += cursor.at(midi::Time(t));
+        }
+        CATCH_CHECK(sum > 0);
+    }
+}
+
+#endif
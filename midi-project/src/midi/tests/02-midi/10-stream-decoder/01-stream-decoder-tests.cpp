@@ -0,0 +1,115 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/stream-decoder.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <vector>
+
+
+namespace
+{
+    // Decodes bytes in pieces of the given size
+    std::vector<midi::MESSAGE> decode(const std::vector<char>& bytes, size_t piece = 1000)
+    {
+        midi::StreamDecoder decoder;
+        std::vector<midi::MESSAGE> result;
+        std::vector<midi::MESSAGE> out(bytes.size());
+
+        for (size_t i = 0; i < bytes.size(); i += piece)
+        {
+            const size_t count = std::min(piece, bytes.size() - i);
+            const size_t n = decoder.decode(reinterpret_cast<const uint8_t*>(bytes.data() + i), count, out.data());
+            result.insert(result.end(), out.begin(), out.begin() + n);
+        }
+        return result;
+    }
+
+    bool is(const midi::MESSAGE& message, int status, int data1, int data2)
+    {
+        return message.status == status && message.data1 == data1 && message.data2 == data2;
+    }
+}
+
+TEST_CASE("StreamDecoder, channel messages")
+{
+    const std::vector<midi::MESSAGE> messages = decode({
+        NOTE_ON(1, 60, 100),
+        PROGRAM_CHANGE(2, 5),
+        PITCH_WHEEL_CHANGE(3, 0x2001),
+        NOTE_OFF(1, 60, 64)
+    });
+
+    CATCH_REQUIRE(messages.size() == 4);
+    CATCH_CHECK(is(messages[0], 0x91, 60, 100));
+    CATCH_CHECK(is(messages[1], 0xC2, 5, 0));
+    CATCH_CHECK(is(messages[2], 0xE3, 1, 0x40));
+    CATCH_CHECK(is(messages[3], 0x81, 60, 64));
+}
+
+TEST_CASE("StreamDecoder, running status")
+{
+    const std::vector<midi::MESSAGE> messages = decode({
+        NOTE_ON(0, 60, 100), NOTE_ON_RS(64, 90), NOTE_ON_RS(60, 0),
+        CHANNEL_PRESSURE(5, 10), CHANNEL_PRESSURE_RS(20)
+    });
+
+    CATCH_REQUIRE(messages.size() == 5);
+    CATCH_CHECK(is(messages[1], 0x90, 64, 90));
+    CATCH_CHECK(is(messages[2], 0x90, 60, 0));
+    CATCH_CHECK(is(messages[4], 0xD5, 20, 0));
+}
+
+TEST_CASE("StreamDecoder, messages split over several reads")
+{
+    const std::vector<char> bytes = { NOTE_ON(0, 60, 100), NOTE_ON_RS(64, 90), CONTROL_CHANGE(0, 7, 80), NOTE_OFF(0, 60, 0) };
+    const std::vector<midi::MESSAGE> whole = decode(bytes);
+
+    for (size_t piece = 1; piece != 5; ++piece)
+    {
+        const std::vector<midi::MESSAGE> pieces = decode(bytes, piece);
+
+        CATCH_INFO("Pieces of " << piece);
+        CATCH_REQUIRE(pieces.size() == whole.size());
+        for (size_t i = 0; i != whole.size(); ++i)
+        {
+            CATCH_CHECK(is(pieces[i], whole[i].status, whole[i].data1, whole[i].data2));
+        }
+    }
+}
+
+TEST_CASE("StreamDecoder, real-time bytes in between data bytes")
+{
+    const std::vector<midi::MESSAGE> messages = decode({
+        char(0xF8), char(0x90), char(0xFE), 60, char(0xF8), 100, char(0xFF), 64, 90
+    });
+
+    CATCH_REQUIRE(messages.size() == 2);
+    CATCH_CHECK(is(messages[0], 0x90, 60, 100));
+    CATCH_CHECK(is(messages[1], 0x90, 64, 90));
+}
+
+TEST_CASE("StreamDecoder, system exclusive and system common messages")
+{
+    midi::StreamDecoder decoder;
+    const std::vector<char> bytes = {
+        NOTE_ON(0, 60, 100),
+        char(0xF0), 0x7E, 0x7F, 0x09, 0x01, char(0xF7),
+        // Running status was cancelled, so these are dropped
+        64, 90,
+        char(0xF2), 0x10, 0x20,
+        char(0xF1), 0x30,
+        NOTE_OFF(0, 60, 0)
+    };
+    std::vector<midi::MESSAGE> out(bytes.size());
+
+    const size_t count = decoder.decode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), out.data());
+
+    CATCH_REQUIRE(count == 2);
+    CATCH_CHECK(is(out[0], 0x90, 60, 100));
+    CATCH_CHECK(is(out[1], 0x80, 60, 0));
+    CATCH_CHECK(decoder.dropped() == 2);
+}
+
+#endif
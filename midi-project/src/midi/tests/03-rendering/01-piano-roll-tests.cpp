@@ -0,0 +1,140 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/piano-roll.h"
+#include "imaging/bmp-format.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    midi::NOTE note(int number, uint64_t start, uint64_t duration)
+    {
+        return midi::NOTE(midi::NoteNumber(number), midi::Time(start), midi::Duration(duration), 100, midi::Instrument(0));
+    }
+
+    // Overlapping notes of the same pitch, notes longer than a frame and
+    // notes shorter than a pixel
+    std::vector<midi::NOTE> build_notes(int n)
+    {
+        std::vector<midi::NOTE> notes;
+        uint32_t random = 4321;
+
+        for (int i = 0; i != n; ++i)
+        {
+            random = random * 1103515245 + 12345;
+            const uint32_t r = random >> 8;
+
+            notes.push_back(note(40 + r % 12, (r / 12) % 5000, (r / 7) % 10 == 0 ? 900 : (r / 3) % 150));
+        }
+        return notes;
+    }
+
+    std::string to_bmp(const imaging::Bitmap& bitmap)
+    {
+        std::stringstream ss;
+        imaging::save_as_bmp(ss, bitmap);
+        return ss.str();
+    }
+}
+
+TEST_CASE("PianoRoll, dimensions")
+{
+    std::vector<midi::NOTE> notes = { note(60, 0, 100), note(62, 50, 250), note(58, 10, 20) };
+    rendering::PianoRoll roll(notes, 10, 4, 8, 3);
+
+    CATCH_CHECK(roll.width() == 30);
+    CATCH_CHECK(roll.height() == 5 * 4);
+    CATCH_CHECK(roll.frame_width() == 8);
+    CATCH_CHECK(roll.frame_count() == 8);
+}
+
+TEST_CASE("PianoRoll, frame width 0 means a single frame")
+{
+    std::vector<midi::NOTE> notes = { note(60, 0, 100) };
+    rendering::PianoRoll roll(notes, 10, 4, 0, 3);
+
+    CATCH_CHECK(roll.frame_width() == 10);
+    CATCH_CHECK(roll.frame_count() == 1);
+}
+
+TEST_CASE("PianoRoll, rectangles")
+{
+    std::vector<midi::NOTE> notes = { note(61, 20, 40), note(60, 0, 30) };
+    rendering::PianoRoll roll(notes, 10, 3, 0, 1);
+    imaging::Bitmap bitmap = roll.render();
+
+    CATCH_REQUIRE(bitmap.width() == 6);
+    CATCH_REQUIRE(bitmap.height() == 6);
+
+    // Note 61 occupies rows 0-2 from x = 2 to 5
+    CATCH_CHECK(bitmap[Position(1, 1)] == imaging::colors::black());
+    CATCH_CHECK(bitmap[Position(2, 1)] == imaging::colors::white());
+    CATCH_CHECK(bitmap[Position(3, 1)] == imaging::colors::blue());
+    CATCH_CHECK(bitmap[Position(4, 1)] == imaging::colors::blue());
+    CATCH_CHECK(bitmap[Position(5, 1)] == imaging::colors::white());
+    CATCH_CHECK(bitmap[Position(3, 0)] == imaging::colors::white());
+    CATCH_CHECK(bitmap[Position(3, 2)] == imaging::colors::white());
+
+    // Note 60 occupies rows 3-5 from x = 0 to 2
+    CATCH_CHECK(bitmap[Position(1, 4)] == imaging::colors::blue());
+    CATCH_CHECK(bitmap[Position(3, 4)] == imaging::colors::black());
+}
+
+TEST_CASE("PianoRoll, frames match slices of the full render")
+{
+    std::vector<midi::NOTE> notes = build_notes(300);
+
+    for (unsigned frame_width : { 1, 7, 64, 500 })
+    {
+        rendering::PianoRoll roll(notes, 3, 2, frame_width, 5);
+        imaging::Bitmap full = roll.render();
+
+        CATCH_REQUIRE(roll.frame_count() > 0);
+
+        for (unsigned k = 0; k < roll.frame_count(); k += 3)
+        {
+            imaging::Bitmap expected = *full.slice(k * 5, 0, frame_width, roll.height());
+            imaging::Bitmap actual = roll.render_frame(k);
+
+            CATCH_REQUIRE(to_bmp(actual) == to_bmp(expected));
+        }
+    }
+}
+
+TEST_CASE("PianoRoll, rendering into a reused frame")
+{
+    std::vector<midi::NOTE> notes = build_notes(300);
+    rendering::PianoRoll roll(notes, 3, 2, 64, 5);
+    imaging::Bitmap frame(roll.frame_width(), roll.height());
+
+    // Frames are visited out of order, so that leftovers of the previous frame would show
+    for (unsigned k : { 40u, 3u, 41u, 0u, roll.frame_count() - 1 })
+    {
+        roll.render_frame(k, frame);
+
+        CATCH_REQUIRE(to_bmp(frame) == to_bmp(roll.render_frame(k)));
+    }
+}
+
+TEST_CASE("PianoRoll, full render versus single frame", "[.][benchmark]")
+{
+    std::vector<midi::NOTE> notes = build_notes(20000);
+    rendering::PianoRoll roll(notes, 1, 4, 200, 10);
+
+    BENCHMARK("Full render, then slice last frame")
+    {
+        imaging::Bitmap full = roll.render();
+        full.slice((roll.frame_count() - 1) * 10, 0, 200, roll.height());
+    }
+
+    BENCHMARK("render_frame")
+    {
+        roll.render_frame(roll.frame_count() - 1);
+    }
+}
+
+#endif
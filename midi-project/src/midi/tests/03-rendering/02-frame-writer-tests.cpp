@@ -0,0 +1,178 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/frame-writer.h"
+#include "Catch.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    // Keeps frames in memory and remembers which ones were repeats
+    struct MemoryOutput : public rendering::FrameOutput
+    {
+        std::map<std::string, std::string> frames;
+        std::map<std::string, std::string> repeats;
+        bool supports_repeats = true;
+
+        void write(const std::string& name, BufferPool::Buffer data) override
+        {
+            frames[name] = std::string(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+
+        bool repeat(const std::string& name, const std::string& original) override
+        {
+            if (supports_repeats)
+            {
+                repeats[name] = original;
+            }
+            return supports_repeats;
+        }
+    };
+
+    imaging::Bitmap frame(unsigned k)
+    {
+        return imaging::Bitmap(16, 8, [k](const Position& p) {
+            return p.x == k ? imaging::colors::white() : imaging::colors::black();
+        });
+    }
+
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST_CASE("content_hash and same_pixels")
+{
+    CATCH_CHECK(imaging::content_hash(frame(3)) == imaging::content_hash(frame(3)));
+    CATCH_CHECK(imaging::content_hash(frame(3)) != imaging::content_hash(frame(4)));
+    CATCH_CHECK(imaging::same_pixels(frame(3), frame(3)));
+    CATCH_CHECK(!imaging::same_pixels(frame(3), frame(4)));
+    CATCH_CHECK(!imaging::same_pixels(frame(3), imaging::Bitmap(8, 16)));
+
+    // Equal once written, although the doubles are not bit for bit the same
+    const imaging::Bitmap negative_zero(16, 8, [](const Position&) { return imaging::Color(-0.0, 0, 0); });
+    CATCH_CHECK(imaging::content_hash(negative_zero) == imaging::content_hash(imaging::Bitmap(16, 8)));
+    CATCH_CHECK(imaging::same_pixels(negative_zero, imaging::Bitmap(16, 8)));
+}
+
+TEST_CASE("FrameWriter, consecutive duplicates are elided")
+{
+    MemoryOutput output;
+    rendering::FrameWriter writer(output, rendering::FrameFormat::bmp, {});
+    const unsigned ks[] = { 0, 0, 0, 1, 2, 2, 0 };
+
+    for (int i = 0; i != 7; ++i)
+    {
+        writer.write(std::to_string(i), frame(ks[i]));
+    }
+
+    CATCH_CHECK(writer.written() == 4);
+    CATCH_CHECK(writer.elided() == 3);
+    CATCH_CHECK(output.frames.size() == 4);
+    CATCH_CHECK(output.repeats["1"] == "0");
+    CATCH_CHECK(output.repeats["2"] == "0");
+    CATCH_CHECK(output.repeats["5"] == "4");
+
+    std::ostringstream expected;
+    rendering::encode_frame(expected, frame(2), rendering::FrameFormat::bmp, {});
+    CATCH_CHECK(output.frames["4"] == expected.str());
+}
+
+TEST_CASE("FrameWriter, output without repeats gets full copies")
+{
+    MemoryOutput output;
+    output.supports_repeats = false;
+    rendering::FrameWriter writer(output, rendering::FrameFormat::qoi, {});
+
+    CATCH_CHECK(!writer.write("a", frame(5)));
+    CATCH_CHECK(!writer.write("b", frame(5)));
+    CATCH_CHECK(!writer.write("c", frame(5)));
+
+    CATCH_CHECK(writer.written() == 3);
+    CATCH_CHECK(writer.elided() == 0);
+    CATCH_REQUIRE(output.frames.size() == 3);
+    CATCH_CHECK(output.frames["a"] == output.frames["b"]);
+    CATCH_CHECK(output.frames["a"] == output.frames["c"]);
+}
+
+TEST_CASE("FrameWriter, elision disabled")
+{
+    MemoryOutput output;
+    rendering::FrameWriter writer(output, rendering::FrameFormat::bmp, {}, false);
+
+    writer.write("a", frame(5));
+    writer.write("b", frame(5));
+
+    CATCH_CHECK(writer.written() == 2);
+    CATCH_CHECK(writer.elided() == 0);
+    CATCH_CHECK(output.repeats.empty());
+}
+
+TEST_CASE("FrameNames")
+{
+    rendering::FrameNames names("frames/f%d.bmp");
+
+    CATCH_CHECK(names[0] == "frames/f00000.bmp");
+    CATCH_CHECK(names[42] == "frames/f00042.bmp");
+    CATCH_CHECK(names[123456] == "frames/f123456.bmp");
+    CATCH_CHECK(names[7] == "frames/f00007.bmp");
+}
+
+TEST_CASE("FileOutput, repeats are hard links with the same content")
+{
+    rendering::FileOutput output;
+    rendering::FrameWriter writer(output, rendering::FrameFormat::rle_bmp,
+        { imaging::colors::black(), imaging::colors::white() });
+
+    writer.write("frame-writer-test-0.bmp", frame(1));
+    CATCH_CHECK(writer.write("frame-writer-test-1.bmp", frame(1)));
+
+    const std::string original = read_file("frame-writer-test-0.bmp");
+    CATCH_CHECK(!original.empty());
+    CATCH_CHECK(read_file("frame-writer-test-1.bmp") == original);
+
+    std::remove("frame-writer-test-0.bmp");
+    std::remove("frame-writer-test-1.bmp");
+}
+
+TEST_CASE("FileOutput, writing over a hard link leaves the other names alone")
+{
+    rendering::FileOutput output;
+    const std::vector<imaging::Color> palette = { imaging::colors::black(), imaging::colors::white() };
+    {
+        rendering::FrameWriter writer(output, rendering::FrameFormat::rle_bmp, palette);
+
+        writer.write("frame-writer-test-0.bmp", frame(1));
+        CATCH_CHECK(writer.write("frame-writer-test-1.bmp", frame(1)));
+        CATCH_CHECK(writer.write("frame-writer-test-2.bmp", frame(1)));
+    }
+    const std::string original = read_file("frame-writer-test-0.bmp");
+
+    // Rendering again over the same files, as with --frames, without elision
+    {
+        rendering::FrameWriter writer(output, rendering::FrameFormat::rle_bmp, palette, false);
+
+        writer.write("frame-writer-test-1.bmp", frame(2));
+    }
+
+    std::ostringstream expected;
+    rendering::encode_frame(expected, frame(2), rendering::FrameFormat::rle_bmp, palette);
+    CATCH_CHECK(read_file("frame-writer-test-1.bmp") == expected.str());
+    CATCH_CHECK(read_file("frame-writer-test-0.bmp") == original);
+    CATCH_CHECK(read_file("frame-writer-test-2.bmp") == original);
+
+    std::remove("frame-writer-test-0.bmp");
+    std::remove("frame-writer-test-1.bmp");
+    std::remove("frame-writer-test-2.bmp");
+}
+
+#endif
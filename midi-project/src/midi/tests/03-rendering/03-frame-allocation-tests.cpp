@@ -0,0 +1,146 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/piano-roll.h"
+#include "rendering/frame-writer.h"
+#include "Catch.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+
+// Counts every heap allocation made by the test program
+namespace
+{
+    std::atomic<size_t> allocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+
+namespace
+{
+    // Looks at every frame, but keeps none of them
+    struct DiscardingOutput : public rendering::FrameOutput
+    {
+        size_t bytes = 0;
+        size_t repeats = 0;
+
+        void write(const std::string& name, BufferPool::Buffer data) override
+        {
+            bytes += data.size();
+        }
+
+        bool repeat(const std::string& name, const std::string& original) override
+        {
+            ++repeats;
+            return true;
+        }
+    };
+
+    std::vector<midi::NOTE> build_notes(int n)
+    {
+        std::vector<midi::NOTE> notes;
+
+        for (int i = 0; i != n; ++i)
+        {
+            // A rest halfway, so that some frames are repeats
+            const uint64_t start = 37 * i + (i < n / 2 ? 0 : 3000);
+
+            notes.push_back(midi::NOTE(midi::NoteNumber(40 + i % 24), midi::Time(start), midi::Duration(20 + i % 300), 100, midi::Instrument(0)));
+        }
+
+        return notes;
+    }
+
+    // Renders and writes frames [first, last) the way the application does, and
+    // returns the number of allocations made while doing so
+    size_t produce_frames(rendering::FrameFormat format, rendering::FrameOutput& output, unsigned first, unsigned last)
+    {
+        rendering::PianoRoll roll(build_notes(200), 5, 4, 200, 10);
+        BufferPool pool;
+        BufferPool::Buffer pixels = pool.borrow(sizeof(imaging::Color) * roll.frame_width() * roll.height());
+        imaging::Bitmap frame(std::make_shared<BufferGrid<imaging::Color>>(pixels.as<imaging::Color>(), roll.frame_width(), roll.height()));
+        rendering::FrameWriter writer(output, format, roll.palette(), true, pool);
+        rendering::FrameNames names("frame-allocation-test-%d.bmp");
+
+        // Warm up: the pools see every buffer size once
+        for (unsigned i = 0; i != first; ++i)
+        {
+            roll.render_frame(i, frame);
+            writer.write(names[i], frame);
+        }
+
+        const size_t before = allocations;
+
+        for (unsigned i = first; i != last; ++i)
+        {
+            roll.render_frame(i, frame);
+            writer.write(names[i], frame);
+        }
+
+        return allocations - before;
+    }
+}
+
+TEST_CASE("Steady-state frame production does not allocate")
+{
+    for (auto format : { rendering::FrameFormat::bmp, rendering::FrameFormat::indexed_bmp, rendering::FrameFormat::rle_bmp, rendering::FrameFormat::qoi })
+    {
+        DiscardingOutput output;
+
+        CATCH_CHECK(produce_frames(format, output, 20, 150) == 0);
+        CATCH_CHECK(output.bytes > 0);
+        CATCH_CHECK(output.repeats > 0);
+    }
+}
+
+TEST_CASE("Writing frames to files does not allocate")
+{
+    rendering::FileOutput output;
+
+    CATCH_CHECK(produce_frames(rendering::FrameFormat::rle_bmp, output, 5, 10) == 0);
+
+    for (unsigned i = 0; i != 10; ++i)
+    {
+        std::remove(rendering::FrameNames("frame-allocation-test-%d.bmp")[i].c_str());
+    }
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/async-output.h"
+#include "io/mapped-file.h"
+#include "Catch.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::string name(const std::string& directory, unsigned i)
+    {
+        return directory + "/async-output-test-" + std::to_string(i) + ".bin";
+    }
+
+    // Frame i is size bytes of a pattern that depends on i
+    BufferPool::Buffer make_frame(BufferPool& pool, unsigned i, size_t size)
+    {
+        BufferPool::Buffer buffer = pool.borrow(size);
+        for (size_t j = 0; j != size; ++j)
+        {
+            buffer.data()[j] = uint8_t(i * 31 + j);
+        }
+        buffer.resize(size);
+        return buffer;
+    }
+
+    std::vector<std::unique_ptr<rendering::FrameOutput>> all_outputs()
+    {
+        std::vector<std::unique_ptr<rendering::FrameOutput>> outputs;
+
+        outputs.push_back(std::make_unique<rendering::FileOutput>());
+        outputs.push_back(std::make_unique<rendering::ThreadedFileOutput>(1, 1));
+        outputs.push_back(std::make_unique<rendering::ThreadedFileOutput>(4, 8));
+        if (io::IoUring::supported())
+        {
+            outputs.push_back(std::make_unique<rendering::UringFileOutput>(1));
+            outputs.push_back(std::make_unique<rendering::UringFileOutput>(8));
+        }
+
+        return outputs;
+    }
+
+    // Writes count copies of frame to directory
+    void write_frames(rendering::FrameOutput& output, BufferPool& pool, const std::string& directory, unsigned count, const std::vector<uint8_t>& frame)
+    {
+        for (unsigned i = 0; i != count; ++i)
+        {
+            BufferPool::Buffer buffer = pool.borrow(frame.size());
+            memcpy(buffer.data(), frame.data(), frame.size());
+            buffer.resize(frame.size());
+            output.write(name(directory, i), std::move(buffer));
+        }
+        output.flush();
+    }
+}
+
+TEST_CASE("File outputs write every frame and return the buffers")
+{
+    for (auto& output : all_outputs())
+    {
+        BufferPool pool;
+
+        // Sizes include an empty frame
+        for (unsigned i = 0; i != 40; ++i)
+        {
+            output->write(name(".", i), make_frame(pool, i, i * 1000));
+        }
+        output->flush();
+
+        CATCH_CHECK(pool.available() == pool.blocks());
+
+        for (unsigned i = 0; i != 40; ++i)
+        {
+            BufferPool::Buffer expected = make_frame(pool, i, i * 1000);
+            const std::string actual = read_file(name(".", i));
+
+            CATCH_REQUIRE(actual.size() == expected.size());
+            CATCH_CHECK(memcmp(actual.data(), expected.data(), expected.size()) == 0);
+            std::remove(name(".", i).c_str());
+        }
+    }
+}
+
+TEST_CASE("File outputs, repeats link to frames that are still being written")
+{
+    for (auto& output : all_outputs())
+    {
+        BufferPool pool;
+
+        output->write(name(".", 0), make_frame(pool, 7, 100000));
+        CATCH_CHECK(output->repeat(name(".", 1), name(".", 0)));
+        output->flush();
+
+        CATCH_CHECK(read_file(name(".", 1)).size() == 100000);
+        CATCH_CHECK(read_file(name(".", 1)) == read_file(name(".", 0)));
+        std::remove(name(".", 0).c_str());
+        std::remove(name(".", 1).c_str());
+    }
+}
+
+TEST_CASE("File outputs, writing over a hard link leaves the other names alone")
+{
+    for (auto& output : all_outputs())
+    {
+        BufferPool pool;
+
+        output->write(name(".", 0), make_frame(pool, 7, 1000));
+        CATCH_CHECK(output->repeat(name(".", 1), name(".", 0)));
+        output->flush();
+
+        // A second render over the same files
+        output->write(name(".", 1), make_frame(pool, 8, 500));
+        output->flush();
+
+        BufferPool::Buffer original = make_frame(pool, 7, 1000);
+        BufferPool::Buffer rewritten = make_frame(pool, 8, 500);
+        CATCH_CHECK(read_file(name(".", 0)) == std::string(reinterpret_cast<const char*>(original.data()), original.size()));
+        CATCH_CHECK(read_file(name(".", 1)) == std::string(reinterpret_cast<const char*>(rewritten.data()), rewritten.size()));
+        std::remove(name(".", 0).c_str());
+        std::remove(name(".", 1).c_str());
+    }
+}
+
+TEST_CASE("create_file_output falls back when io_uring is missing")
+{
+    auto output = rendering::create_file_output(rendering::WriteMode::io_uring, 4);
+
+    CATCH_CHECK(output != nullptr);
+    CATCH_CHECK((dynamic_cast<rendering::UringFileOutput*>(output.get()) != nullptr) == io::IoUring::supported());
+}
+
+TEST_CASE("File outputs on tmpfs and on disk", "[.][benchmark]")
+{
+    // 200 frames of 1 MB, about a 512x512 32-bit BMP each
+    const unsigned count = 200;
+    const std::vector<uint8_t> frame(1 << 20, 0x55);
+
+    for (const std::string directory : { "/dev/shm", "." })
+    {
+        if (!io::file_exists(directory))
+        {
+            continue;
+        }
+
+        BufferPool pool;
+        rendering::FileOutput sync;
+        rendering::ThreadedFileOutput threaded(2, 32);
+
+        BENCHMARK("sync, " + directory)
+        {
+            write_frames(sync, pool, directory, count, frame);
+        }
+
+        BENCHMARK("thread, " + directory)
+        {
+            write_frames(threaded, pool, directory, count, frame);
+        }
+
+        if (io::IoUring::supported())
+        {
+            rendering::UringFileOutput uring(32);
+
+            BENCHMARK("io_uring, " + directory)
+            {
+                write_frames(uring, pool, directory, count, frame);
+            }
+        }
+
+        for (unsigned i = 0; i != count; ++i)
+        {
+            std::remove(name(directory, i).c_str());
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/tar-output.h"
+#include "Catch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    struct ENTRY
+    {
+        std::string name;
+        char type;
+        std::string link;
+        std::string data;
+    };
+
+    std::string field(const std::string& archive, size_t offset, size_t width)
+    {
+        std::string s = archive.substr(offset, width);
+        return s.substr(0, s.find('\0'));
+    }
+
+    // Reads back the archive, checking the header checksums and the end marker
+    std::vector<ENTRY> read_tar(const std::string& archive)
+    {
+        std::vector<ENTRY> entries;
+        size_t offset = 0;
+
+        CATCH_REQUIRE(archive.size() % 512 == 0);
+
+        while (archive.compare(offset, 512, std::string(512, '\0')) != 0)
+        {
+            unsigned checksum = 0;
+            for (size_t i = 0; i != 512; ++i)
+            {
+                checksum += i >= 148 && i < 156 ? ' ' : uint8_t(archive[offset + i]);
+            }
+            CATCH_CHECK(std::strtoul(field(archive, offset + 148, 8).c_str(), nullptr, 8) == checksum);
+            CATCH_CHECK(field(archive, offset + 257, 6) == "ustar");
+
+            ENTRY entry;
+            const std::string prefix = field(archive, offset + 345, 155);
+            entry.name = (prefix.empty() ? "" : prefix + "/") + field(archive, offset, 100);
+            entry.type = archive[offset + 156];
+            entry.link = field(archive, offset + 157, 100);
+            const size_t size = std::strtoul(field(archive, offset + 124, 12).c_str(), nullptr, 8);
+            entry.data = archive.substr(offset + 512, size);
+            entries.push_back(entry);
+
+            offset += 512 + (size + 511) / 512 * 512;
+        }
+
+        CATCH_CHECK(archive.size() == offset + 1024);
+        return entries;
+    }
+
+    BufferPool::Buffer make_data(const std::string& s)
+    {
+        BufferPool::Buffer buffer = BufferPool::shared().borrow(s.size());
+        memcpy(buffer.data(), s.data(), s.size());
+        buffer.resize(s.size());
+        return buffer;
+    }
+}
+
+TEST_CASE("TarOutput, frames and repeats")
+{
+    std::stringstream ss;
+    const std::string big(1300, 'x');
+
+    {
+        rendering::TarOutput output(ss);
+
+        output.write("frames/f00000.bmp", make_data("first"));
+        output.write("frames/f00001.bmp", make_data(big));
+        CATCH_CHECK(output.repeat("frames/f00002.bmp", "frames/f00001.bmp"));
+        output.write("frames/f00003.bmp", make_data(""));
+    }
+
+    std::vector<ENTRY> entries = read_tar(ss.str());
+
+    CATCH_REQUIRE(entries.size() == 4);
+    CATCH_CHECK(entries[0].name == "frames/f00000.bmp");
+    CATCH_CHECK(entries[0].type == '0');
+    CATCH_CHECK(entries[0].data == "first");
+    CATCH_CHECK(entries[1].data == big);
+    CATCH_CHECK(entries[2].name == "frames/f00002.bmp");
+    CATCH_CHECK(entries[2].type == '1');
+    CATCH_CHECK(entries[2].link == "frames/f00001.bmp");
+    CATCH_CHECK(entries[2].data.empty());
+    CATCH_CHECK(entries[3].data.empty());
+}
+
+TEST_CASE("TarOutput, long names are split over prefix and name")
+{
+    std::stringstream ss;
+    const std::string directory(120, 'd');
+
+    {
+        rendering::TarOutput output(ss);
+        output.write(directory + "\\frame00000.bmp", make_data("abc"));
+    }
+
+    std::vector<ENTRY> entries = read_tar(ss.str());
+
+    CATCH_REQUIRE(entries.size() == 1);
+    CATCH_CHECK(entries[0].name == directory + "/frame00000.bmp");
+    CATCH_CHECK(entries[0].data == "abc");
+}
+
+TEST_CASE("TarOutput, no links to names that do not fit the link field")
+{
+    std::stringstream ss;
+    const std::string directory(120, 'd');
+
+    {
+        rendering::TarOutput output(ss);
+        output.write(directory + "/f00000.bmp", make_data("abc"));
+        CATCH_CHECK(!output.repeat(directory + "/f00001.bmp", directory + "/f00000.bmp"));
+    }
+
+    std::vector<ENTRY> entries = read_tar(ss.str());
+
+    CATCH_REQUIRE(entries.size() == 1);
+    CATCH_CHECK(entries[0].name == directory + "/f00000.bmp");
+}
+
+TEST_CASE("TarOutput, to a file")
+{
+    {
+        rendering::TarOutput output("tar-output-test.tar");
+        output.write("a.bmp", make_data("a"));
+        output.repeat("b.bmp", "a.bmp");
+    }
+
+    std::ifstream in("tar-output-test.tar", std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    in.close();
+    std::remove("tar-output-test.tar");
+
+    std::vector<ENTRY> entries = read_tar(ss.str());
+    CATCH_REQUIRE(entries.size() == 2);
+    CATCH_CHECK(entries[1].link == "a.bmp");
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/spectrogram.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <cmath>
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    // A4 (440 Hz) as a sine from tick 96 (0.5 s) to tick 960 (5 s)
+    audio::Score a4()
+    {
+        return make_score({ 0, PROGRAM_CHANGE(0, 0), 96, NOTE_ON(0, 69, 100), char(0x86), 0x60, NOTE_OFF(0, 69, 0) });
+    }
+
+    // Chords on several channels and programs
+    audio::Score busy(int bars)
+    {
+        std::vector<char> track;
+
+        for (int i = 0; i != bars; ++i)
+        {
+            const int channel = i % 3;
+            const char bytes[] = {
+                0, PROGRAM_CHANGE(channel, (i * 8) % 128),
+                0, NOTE_ON(channel, 48 + i % 12, 100),
+                0, NOTE_ON(channel, 55 + i % 12, 90),
+                0, NOTE_ON(channel, 64 + i % 12, 80),
+                96, NOTE_OFF(channel, 48 + i % 12, 0),
+                0, NOTE_OFF(channel, 55 + i % 12, 0),
+                0, NOTE_OFF(channel, 64 + i % 12, 0)
+            };
+            track.insert(track.end(), bytes, bytes + sizeof(bytes));
+        }
+        return make_score(track);
+    }
+
+    unsigned loudest_row(const imaging::Bitmap& frame, unsigned x, const std::vector<imaging::Color>& palette)
+    {
+        unsigned row = 0;
+        size_t best = 0;
+
+        for (unsigned y = 0; y != frame.height(); ++y)
+        {
+            size_t level = 0;
+            while (palette[level] != frame[Position(x, y)])
+            {
+                ++level;
+            }
+
+            if (level > best)
+            {
+                best = level;
+                row = y;
+            }
+        }
+        return row;
+    }
+}
+
+TEST_CASE("Spectrogram, a sine shows up in its row")
+{
+    audio::Score score = a4();
+    audio::Synth synth(score, 8000, 64);
+    rendering::Spectrogram spectrogram(synth, score.tempo_map(), 4, 64, 50, 10, 512);
+    imaging::Bitmap frame(50, 64);
+
+    // Columns 50 to 99 are ticks 200 to 399: the note is sounding
+    spectrogram.render_frame(5, frame);
+
+    // Rows are spaced logarithmically from 4000 Hz at the top down to 30 Hz
+    const unsigned expected = unsigned(64 * std::log(4000 / 440.0) / std::log(4000 / 30.0));
+
+    for (unsigned x = 0; x != 50; ++x)
+    {
+        CATCH_INFO("x = " << x);
+        CATCH_CHECK(loudest_row(frame, x, spectrogram.palette()) == expected);
+    }
+}
+
+TEST_CASE("Spectrogram, silence is black")
+{
+    audio::Score score = a4();
+    audio::Synth synth(score, 8000, 64);
+    rendering::Spectrogram spectrogram(synth, score.tempo_map(), 1, 32, 20, 5, 256);
+    imaging::Bitmap frame(20, 32);
+
+    // Ticks 0 to 19 end well before the note starts, even counting the window
+    spectrogram.render_frame(0, frame);
+
+    for (unsigned y = 0; y != 32; ++y)
+    {
+        for (unsigned x = 0; x != 20; ++x)
+        {
+            CATCH_CHECK(frame[Position(x, y)] == imaging::colors::black());
+        }
+    }
+}
+
+TEST_CASE("Spectrogram, frames reuse the columns of the previous frame")
+{
+    audio::Score score = busy(8);
+    audio::Synth synth(score, 8000, 64);
+    rendering::Spectrogram spectrogram(synth, score.tempo_map(), 4, 48, 40, 6, 256);
+    imaging::Bitmap frame(40, 48);
+    std::vector<uint64_t> hashes;
+
+    for (unsigned i = 0; i != 20; ++i)
+    {
+        spectrogram.render_frame(i, frame);
+        hashes.push_back(imaging::content_hash(frame));
+    }
+
+    CATCH_CHECK(spectrogram.columns_computed() == 40 + 19 * 6);
+
+    // Starting at a later frame gives the same pixels
+    for (unsigned first : { 1u, 7u, 19u })
+    {
+        CATCH_INFO("first = " << first);
+
+        audio::Synth fresh_synth(score, 8000, 64);
+        rendering::Spectrogram fresh(fresh_synth, score.tempo_map(), 4, 48, 40, 6, 256);
+
+        for (unsigned i = first; i < 20; i += 3)
+        {
+            fresh.render_frame(i, frame);
+            CATCH_CHECK(imaging::content_hash(frame) == hashes[i]);
+        }
+    }
+}
+
+TEST_CASE("Spectrogram frame rate", "[.][benchmark]")
+{
+    audio::Score score = busy(200);
+
+    BENCHMARK("Spectrogram, 2048 point FFT, 1000 frames of 400 x 256, step 4")
+    {
+        audio::Synth synth(score, 44100, 256);
+        rendering::Spectrogram spectrogram(synth, score.tempo_map(), 10, 256, 400, 4);
+        imaging::Bitmap frame(400, 256);
+
+        for (unsigned i = 0; i != 1000; ++i)
+        {
+            spectrogram.render_frame(i, frame);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/timeline.h"
+#include "Catch.h"
+
+
+TEST_CASE("Timeline, whole frame rate")
+{
+    rendering::Timeline timeline(audio::TempoMap(96), 44100, 30);
+
+    CATCH_CHECK(timeline.first_sample(0) == 0);
+    CATCH_CHECK(timeline.first_sample(1) == 1470);
+    CATCH_CHECK(timeline.samples(0) == 1470);
+    CATCH_CHECK(timeline.seconds(15) == Approx(0.5));
+    CATCH_CHECK(timeline.tick(15) == Approx(96));
+    CATCH_CHECK(timeline.frame_count(0) == 0);
+    CATCH_CHECK(timeline.frame_count(1) == 1);
+    CATCH_CHECK(timeline.frame_count(1470) == 1);
+    CATCH_CHECK(timeline.frame_count(1471) == 2);
+}
+
+TEST_CASE("Timeline, fractional frame rate does not drift")
+{
+    rendering::Timeline timeline(audio::TempoMap(96), 44100, 30000, 1001);
+    uint64_t total = 0;
+
+    // 1001 * 44100 / 30000 = 1471.47 samples per frame
+    for (uint64_t frame = 0; frame != 30000; ++frame)
+    {
+        CATCH_REQUIRE(timeline.first_sample(frame) == total);
+        CATCH_REQUIRE((timeline.samples(frame) == 1471 || timeline.samples(frame) == 1472));
+        total += timeline.samples(frame);
+    }
+
+    // 30000 frames last exactly 1001 s
+    CATCH_CHECK(total == 1001 * 44100);
+    CATCH_CHECK(timeline.frame_count(total) == 30000);
+}
+
+TEST_CASE("Timeline, ticks follow tempo changes")
+{
+    audio::TempoMap map(100);
+    map.set_tempo(midi::Time(0), 1000000);
+    map.set_tempo(midi::Time(200), 250000);
+
+    rendering::Timeline timeline(map, 1000, 4);
+
+    CATCH_CHECK(timeline.tick(4) == Approx(100));
+    CATCH_CHECK(timeline.tick(8) == Approx(200));
+    CATCH_CHECK(timeline.tick(9) == Approx(300));
+    CATCH_CHECK(timeline.first_sample(9) == map.frame(midi::Time(300), 1000));
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/y4m-writer.h"
+#include "Catch.h"
+#include <sstream>
+#include <string>
+
+
+using namespace imaging;
+
+
+TEST_CASE("Y4mWriter, header")
+{
+    std::stringstream out;
+    rendering::Y4mWriter writer(out, 3, 2, 30000, 1001);
+
+    CATCH_CHECK(out.str() == "YUV4MPEG2 W3 H2 F30000:1001 Ip A1:1 C444\n");
+    CATCH_CHECK(writer.frames() == 0);
+}
+
+TEST_CASE("Y4mWriter, planes")
+{
+    std::stringstream out;
+    rendering::Y4mWriter writer(out, 2, 2, 25);
+    const std::string header = out.str();
+
+    Bitmap frame(2, 2);
+    frame[Position(0, 0)] = colors::black();
+    frame[Position(1, 0)] = colors::white();
+    frame[Position(0, 1)] = colors::red();
+    frame[Position(1, 1)] = colors::red();
+
+    writer.write(frame);
+    writer.write(frame);
+
+    const std::string data = out.str().substr(header.size());
+    const std::string expected =
+        "FRAME\n"
+        "\x10\xEB\x52\x52"  // Y
+        "\x80\x80\x5A\x5A"  // U
+        "\x80\x80\xF0\xF0"; // V
+
+    CATCH_CHECK(writer.frames() == 2);
+    CATCH_CHECK(data == expected + expected);
+}
+
+#endif
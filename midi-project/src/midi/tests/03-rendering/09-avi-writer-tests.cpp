@@ -0,0 +1,190 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/avi-writer.h"
+#include "Catch.h"
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace imaging;
+
+
+namespace
+{
+    uint32_t read32(const std::string& data, size_t offset)
+    {
+        uint32_t result;
+        memcpy(&result, data.data() + offset, 4);
+        return result;
+    }
+
+    uint16_t read16(const std::string& data, size_t offset)
+    {
+        uint16_t result;
+        memcpy(&result, data.data() + offset, 2);
+        return result;
+    }
+
+    // Offset of the first chunk or list with the given id or list type at or after offset
+    size_t find(const std::string& data, const char* id, size_t offset = 0)
+    {
+        const size_t position = data.find(id, offset);
+        CATCH_REQUIRE(position != std::string::npos);
+        return position;
+    }
+
+    struct CHUNK
+    {
+        std::string id;
+        uint32_t size;
+        size_t offset;
+    };
+
+    // Chunks of the movi list, in order
+    std::vector<CHUNK> movi_chunks(const std::string& data)
+    {
+        const size_t movi = find(data, "movi");
+        const size_t end = movi + read32(data, movi - 4);
+        std::vector<CHUNK> chunks;
+
+        for (size_t offset = movi + 4; offset < end; )
+        {
+            const uint32_t size = read32(data, offset + 4);
+            chunks.push_back(CHUNK{ data.substr(offset, 4), size, offset });
+            offset += 8 + size + (size & 1);
+        }
+        return chunks;
+    }
+
+    Bitmap frame(const Color& color)
+    {
+        Bitmap bitmap(3, 2);
+        bitmap.clear(color);
+        return bitmap;
+    }
+}
+
+TEST_CASE("AviWriter, headers")
+{
+    std::stringstream out;
+    {
+        rendering::AviWriter writer(out, 3, 2, 30000, 1001, 44100);
+        const std::vector<float> audio(2 * 1471, 0.5f);
+
+        writer.write_frame(frame(colors::red()));
+        writer.write_audio(audio.data(), 1471);
+        writer.write_frame(frame(colors::blue()));
+        writer.write_audio(audio.data(), 1472);
+    }
+    const std::string data = out.str();
+
+    CATCH_CHECK(data.substr(0, 4) == "RIFF");
+    CATCH_CHECK(read32(data, 4) == data.size() - 8);
+    CATCH_CHECK(data.substr(8, 4) == "AVI ");
+
+    const size_t avih = find(data, "avih") + 8;
+    CATCH_CHECK(read32(data, avih) == 33366);
+    CATCH_CHECK(read32(data, avih + 16) == 2);
+    CATCH_CHECK(read32(data, avih + 24) == 2);
+    CATCH_CHECK(read32(data, avih + 32) == 3);
+    CATCH_CHECK(read32(data, avih + 36) == 2);
+
+    const size_t video = find(data, "vids");
+    CATCH_CHECK(read32(data, video + 20) == 1001);
+    CATCH_CHECK(read32(data, video + 24) == 30000);
+    CATCH_CHECK(read32(data, video + 32) == 2);
+
+    const size_t bitmap_info = find(data, "strf", video) + 8;
+    CATCH_CHECK(read32(data, bitmap_info) == 40);
+    CATCH_CHECK(read32(data, bitmap_info + 4) == 3);
+    CATCH_CHECK(read32(data, bitmap_info + 8) == 2);
+    CATCH_CHECK(read16(data, bitmap_info + 14) == 24);
+    CATCH_CHECK(read32(data, bitmap_info + 20) == 24);
+
+    const size_t audio = find(data, "auds");
+    CATCH_CHECK(read32(data, audio + 24) == 44100);
+    CATCH_CHECK(read32(data, audio + 32) == 1471 + 1472);
+    CATCH_CHECK(read32(data, audio + 44) == 4);
+
+    const size_t wave_format = find(data, "strf", audio) + 8;
+    CATCH_CHECK(read32(data, wave_format - 4) == 18);
+    CATCH_CHECK(read16(data, wave_format) == 1);
+    CATCH_CHECK(read16(data, wave_format + 2) == 2);
+    CATCH_CHECK(read32(data, wave_format + 4) == 44100);
+    CATCH_CHECK(read16(data, wave_format + 14) == 16);
+}
+
+TEST_CASE("AviWriter, chunks and index")
+{
+    std::stringstream out;
+    rendering::AviWriter writer(out, 3, 2, 25, 1, 8000);
+    const std::vector<float> audio = { 1.0f, -1.0f, 0.5f, 0.0f };
+
+    CATCH_CHECK(!writer.write_frame(frame(colors::red())));
+    writer.write_audio(audio.data(), 2);
+    CATCH_CHECK(writer.write_frame(frame(colors::red())));
+    writer.write_audio(audio.data(), 2);
+    CATCH_CHECK(!writer.write_frame(frame(colors::white())));
+    writer.close();
+
+    CATCH_CHECK(writer.frames() == 3);
+    CATCH_CHECK(writer.elided() == 1);
+    CATCH_CHECK(writer.audio_frames() == 4);
+
+    const std::string data = out.str();
+    const std::vector<CHUNK> chunks = movi_chunks(data);
+
+    CATCH_REQUIRE(chunks.size() == 5);
+    CATCH_CHECK(chunks[0].id == "00db");
+    CATCH_CHECK(chunks[0].size == 24);
+    CATCH_CHECK(chunks[1].id == "01wb");
+    CATCH_CHECK(chunks[1].size == 8);
+    CATCH_CHECK(chunks[2].id == "00db");
+    CATCH_CHECK(chunks[2].size == 0);
+    CATCH_CHECK(chunks[3].id == "01wb");
+    CATCH_CHECK(chunks[4].size == 24);
+
+    // Rows are bottom-up BGR, padded to 4 bytes
+    const std::string red_row("\x00\x00\xFF\x00\x00\xFF\x00\x00\xFF\x00\x00\x00", 12);
+    CATCH_CHECK(data.substr(chunks[0].offset + 8, 24) == red_row + red_row);
+    const std::string pcm("\xFF\x7F\x01\x80\x00\x40\x00\x00", 8);
+    CATCH_CHECK(data.substr(chunks[1].offset + 8, 8) == pcm);
+
+    const size_t movi = find(data, "movi");
+    const size_t index = chunks.back().offset + 8 + chunks.back().size;
+    CATCH_CHECK(data.substr(index, 4) == "idx1");
+    CATCH_CHECK(read32(data, index + 4) == 5 * 16);
+    CATCH_CHECK(index + 8 + 5 * 16 == data.size());
+
+    for (size_t i = 0; i != chunks.size(); ++i)
+    {
+        const size_t entry = index + 8 + 16 * i;
+
+        CATCH_INFO("Chunk " << i);
+        CATCH_CHECK(data.substr(entry, 4) == chunks[i].id);
+        CATCH_CHECK(read32(data, entry + 4) == (i == 2 ? 0 : 0x10));
+        CATCH_CHECK(read32(data, entry + 8) == chunks[i].offset - movi);
+        CATCH_CHECK(read32(data, entry + 12) == chunks[i].size);
+    }
+}
+
+TEST_CASE("AviWriter, keeping duplicates")
+{
+    std::stringstream out;
+    rendering::AviWriter writer(out, 3, 2, 25, 1, 8000, false);
+
+    writer.write_frame(frame(colors::red()));
+    CATCH_CHECK(!writer.write_frame(frame(colors::red())));
+    writer.close();
+
+    CATCH_CHECK(writer.elided() == 0);
+    const std::vector<CHUNK> chunks = movi_chunks(out.str());
+    CATCH_REQUIRE(chunks.size() == 2);
+    CATCH_CHECK(chunks[1].size == 24);
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/live-roll.h"
+#include "Catch.h"
+#include <string>
+
+
+using namespace imaging;
+
+
+namespace
+{
+    // One character per pixel of a row: . background, # fill, + border
+    std::string row(const Bitmap& frame, unsigned y)
+    {
+        std::string result;
+
+        for (unsigned x = 0; x != frame.width(); ++x)
+        {
+            const Color& c = frame[Position(x, y)];
+            result += c == colors::black() ? '.' : c == colors::blue() ? '#' : '+';
+        }
+        return result;
+    }
+
+    midi::MESSAGE note_on(int channel, int note, int velocity = 100)
+    {
+        return midi::MESSAGE{ uint8_t(0x90 | channel), uint8_t(note), uint8_t(velocity) };
+    }
+
+    midi::MESSAGE note_off(int channel, int note)
+    {
+        return midi::MESSAGE{ uint8_t(0x80 | channel), uint8_t(note), 0 };
+    }
+}
+
+TEST_CASE("LiveRoll scrolls notes to the left")
+{
+    // Notes 60 and 61, 3 pixels high: row 1 is the middle of note 61, row 4 of note 60
+    rendering::LiveRoll roll(8, 3, 1, 60, 61);
+    Bitmap frame(roll.width(), roll.height());
+    CATCH_REQUIRE(roll.height() == 6);
+
+    roll.advance();
+    roll.apply(note_on(0, 60));
+    roll.advance();
+    roll.advance();
+    roll.advance();
+    roll.apply(note_on(2, 61));
+    roll.apply(note_off(0, 60));
+    roll.advance();
+    roll.advance();
+    roll.render(frame);
+
+    CATCH_CHECK(row(frame, 0) == "......++");
+    CATCH_CHECK(row(frame, 1) == "......+#");
+    CATCH_CHECK(row(frame, 3) == "...+++..");
+    CATCH_CHECK(row(frame, 4) == "...+#+..");
+    CATCH_CHECK(roll.sounding() == 1);
+
+    // Note on with velocity 0 releases
+    roll.apply(note_on(2, 61, 0));
+    CATCH_CHECK(roll.sounding() == 0);
+    roll.advance();
+    roll.render(frame);
+    CATCH_CHECK(row(frame, 1) == ".....++.");
+}
+
+TEST_CASE("LiveRoll, short notes are drawn one column wide")
+{
+    rendering::LiveRoll roll(4, 3, 2, 60, 60);
+    Bitmap frame(roll.width(), roll.height());
+
+    roll.apply(note_on(0, 60));
+    roll.apply(note_off(0, 60));
+    roll.advance();
+    roll.render(frame);
+
+    CATCH_CHECK(row(frame, 1) == "..+.");
+}
+
+TEST_CASE("LiveRoll, a key held on two channels sounds until both release it")
+{
+    rendering::LiveRoll roll(4, 1, 1, 60, 60);
+
+    roll.apply(note_on(0, 60));
+    roll.apply(note_on(1, 60));
+    roll.apply(note_off(0, 60));
+    CATCH_CHECK(roll.sounding() == 1);
+
+    // All Notes Off
+    roll.apply(midi::MESSAGE{ 0xB1, 123, 0 });
+    CATCH_CHECK(roll.sounding() == 0);
+}
+
+#endif
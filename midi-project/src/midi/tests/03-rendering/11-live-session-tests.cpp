@@ -0,0 +1,84 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/live-session.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+using namespace imaging;
+
+
+TEST_CASE("LatencyHistogram percentiles")
+{
+    rendering::LatencyHistogram histogram;
+
+    for (int64_t i = 1; i <= 100; ++i)
+    {
+        histogram.add(i * 100000);
+    }
+
+    CATCH_CHECK(histogram.count() == 100);
+    CATCH_CHECK(histogram.max() == 10000000);
+    CATCH_CHECK(histogram.percentile(0.5) == 5000000 + 10000);
+    CATCH_CHECK(histogram.percentile(0.99) == 9900000 + 10000);
+    CATCH_CHECK(histogram.percentile(1) == 10000000);
+
+    // Longer than the histogram goes
+    histogram.add(5000000000);
+    CATCH_CHECK(histogram.max() == 5000000000);
+    CATCH_CHECK(histogram.percentile(1) == 5000000000);
+}
+
+TEST_CASE("LiveSession shows every message that arrives")
+{
+    rendering::LiveRoll roll(16, 1, 1, 60, 62);
+    std::stringstream out;
+    rendering::Y4mWriter writer(out, roll.width(), roll.height(), 200);
+    rendering::LiveSession session(roll, writer, 200);
+
+    // Bytes arrive in pieces, some of them splitting a message, a few frame periods apart
+    const std::vector<std::vector<char>> pieces = {
+        { NOTE_ON(0, 60, 100), char(0x90) },
+        { 62, 100 },
+        { NOTE_OFF_RS(60, 0) }
+    };
+    size_t next = 0;
+
+    session.run([&pieces, &next](uint8_t* buffer, size_t size) -> size_t {
+        if (next == pieces.size())
+        {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        const std::vector<char>& piece = pieces[next++];
+        CATCH_REQUIRE(piece.size() <= size);
+        memcpy(buffer, piece.data(), piece.size());
+        return piece.size();
+    });
+
+    CATCH_CHECK(session.messages() == 3);
+    CATCH_CHECK(session.latency().count() == 3);
+    CATCH_CHECK(session.frames() >= 2);
+    CATCH_CHECK(roll.sounding() == 1);
+
+    // Every frame went out, each one a header line and three planes of 16 x 3
+    const std::string header = "YUV4MPEG2 W16 H3 F200:1 Ip A1:1 C444\n";
+    CATCH_CHECK(writer.frames() == session.frames());
+    CATCH_CHECK(out.str().size() == header.size() + session.frames() * (6 + 3 * 16 * 3));
+
+    // The last frame shows note 62 still sounding at the right edge
+    Bitmap frame(roll.width(), roll.height());
+    roll.render(frame);
+    CATCH_CHECK(frame[Position(15, 0)] != colors::black());
+    CATCH_CHECK(frame[Position(15, 2)] == colors::black());
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/tiled-grid.h"
+#include "imaging/bitmap.h"
+#include "imaging/bmp-format.h"
+#include "Catch.h"
+#include <sstream>
+
+
+TEST_CASE("TiledGrid, untouched grid reads as background")
+{
+    const TiledGrid<int> grid(100, 50, 7, 16);
+
+    CATCH_CHECK(grid.width() == 100);
+    CATCH_CHECK(grid.height() == 50);
+    CATCH_CHECK(grid[Position(0, 0)] == 7);
+    CATCH_CHECK(grid[Position(99, 49)] == 7);
+    CATCH_CHECK(grid.allocated_tiles() == 0);
+}
+
+TEST_CASE("TiledGrid, writing allocates a single tile")
+{
+    TiledGrid<int> grid(100, 50, 7, 16);
+
+    grid[Position(20, 40)] = 3;
+
+    CATCH_CHECK(grid.allocated_tiles() == 1);
+    CATCH_CHECK(grid[Position(20, 40)] == 3);
+    CATCH_CHECK(grid[Position(21, 40)] == 7);
+    CATCH_CHECK(grid[Position(16, 32)] == 7);
+    CATCH_CHECK(grid.allocated_tiles() == 1);
+
+    grid[Position(99, 49)] = 4;
+
+    CATCH_CHECK(grid.allocated_tiles() == 2);
+    CATCH_CHECK(grid[Position(99, 49)] == 4);
+}
+
+TEST_CASE("TiledGrid, behaves like ConcreteGrid")
+{
+    ConcreteGrid<int> concrete(37, 21, 0);
+    TiledGrid<int> tiled(37, 21, 0, 8);
+
+    for (unsigned i = 0; i != 100; ++i)
+    {
+        Position p((i * 17) % 37, (i * 5) % 21);
+
+        concrete[p] = int(i + 1);
+        tiled[p] = int(i + 1);
+    }
+
+    concrete.for_each_position([&](const Position& p) {
+        CATCH_CHECK(static_cast<const Grid<int>&>(tiled)[p] == concrete[p]);
+    });
+}
+
+TEST_CASE("TiledGrid, read_row")
+{
+    ConcreteGrid<int> concrete(100, 3, 5);
+    auto shared = std::make_shared<TiledGrid<int>>(100, 3, 5, 16);
+    TiledGrid<int>& tiled = *shared;
+    concrete[Position(40, 1)] = tiled[Position(40, 1)] = 1;
+    concrete[Position(99, 1)] = tiled[Position(99, 1)] = 2;
+
+    auto sub = subgrid(std::shared_ptr<Grid<int>>(shared), Position(30, 1), 70, 1);
+    int expected[100], actual[100], from_sub[70];
+    concrete.read_row(Position(3, 1), 97, expected);
+    tiled.read_row(Position(3, 1), 97, actual);
+    sub->read_row(Position(0, 0), 70, from_sub);
+
+    for (unsigned i = 0; i != 97; ++i)
+    {
+        CATCH_CHECK(actual[i] == expected[i]);
+    }
+    for (unsigned i = 0; i != 70; ++i)
+    {
+        CATCH_CHECK(from_sub[i] == concrete[Position(30 + i, 1)]);
+    }
+}
+
+TEST_CASE("TiledGrid, BMP output matches ConcreteGrid")
+{
+    imaging::Bitmap concrete(150, 70);
+    imaging::Bitmap tiled(std::make_shared<TiledGrid<imaging::Color>>(150, 70, imaging::colors::black(), 32));
+
+    for (unsigned x = 40; x != 90; ++x)
+    {
+        concrete[Position(x, 33)] = imaging::colors::blue();
+        tiled[Position(x, 33)] = imaging::colors::blue();
+    }
+
+    std::stringstream expected, actual;
+    imaging::save_as_bmp(expected, concrete);
+    imaging::save_as_bmp(actual, tiled);
+    CATCH_CHECK(actual.str() == expected.str());
+
+    std::stringstream expected_slice, actual_slice;
+    imaging::save_as_bmp(expected_slice, *concrete.slice(30, 20, 100, 30));
+    imaging::save_as_bmp(actual_slice, *tiled.slice(30, 20, 100, 30));
+    CATCH_CHECK(actual_slice.str() == expected_slice.str());
+}
+
+TEST_CASE("TiledGrid versus ConcreteGrid, sparse bitmap", "[.][benchmark]")
+{
+    const unsigned width = 20000;
+    const unsigned height = 512;
+
+    BENCHMARK("ConcreteGrid, draw and encode")
+    {
+        imaging::Bitmap bitmap(width, height);
+        for (unsigned x = 0; x < width; x += 1000)
+        {
+            bitmap[Position(x, x % height)] = imaging::colors::blue();
+        }
+        std::stringstream ss;
+        imaging::save_as_bmp(ss, bitmap);
+    }
+
+    BENCHMARK("TiledGrid, draw and encode")
+    {
+        imaging::Bitmap bitmap(std::make_shared<TiledGrid<imaging::Color>>(width, height, imaging::colors::black()));
+        for (unsigned x = 0; x < width; x += 1000)
+        {
+            bitmap[Position(x, x % height)] = imaging::colors::blue();
+        }
+        std::stringstream ss;
+        imaging::save_as_bmp(ss, bitmap);
+    }
+}
+
+#endif
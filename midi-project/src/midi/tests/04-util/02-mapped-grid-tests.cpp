@@ -0,0 +1,111 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/mapped-grid.h"
+#include "io/mapped-file.h"
+#include "imaging/bitmap.h"
+#include "imaging/bmp-format.h"
+#include "rendering/piano-roll.h"
+#include "Catch.h"
+#include <sstream>
+
+
+TEST_CASE("MappedScratchFile is writable and removed afterwards")
+{
+    const char* path = "mapped-scratch-test.bin";
+    {
+        io::MappedScratchFile file(path, 10000);
+
+        CATCH_REQUIRE(file.size() == 10000);
+        CATCH_CHECK(file.data()[0] == 0);
+        CATCH_CHECK(file.data()[9999] == 0);
+
+        file.data()[1234] = 56;
+        CATCH_CHECK(file.data()[1234] == 56);
+    }
+
+    CATCH_CHECK(!io::file_exists(path));
+}
+
+TEST_CASE("MappedGrid, untouched grid reads as background")
+{
+    const MappedGrid<int> grid("mapped-grid-test.bin", 100, 50, 7, 16);
+
+    CATCH_CHECK(grid.width() == 100);
+    CATCH_CHECK(grid.height() == 50);
+    CATCH_CHECK(grid[Position(0, 0)] == 7);
+    CATCH_CHECK(grid[Position(99, 49)] == 7);
+    CATCH_CHECK(grid.reserved_size() == 7 * 4 * 16 * 16 * sizeof(int));
+}
+
+TEST_CASE("MappedGrid, behaves like ConcreteGrid")
+{
+    ConcreteGrid<int> concrete(37, 21, 3);
+    MappedGrid<int> mapped("mapped-grid-test.bin", 37, 21, 3, 8);
+
+    for (unsigned i = 0; i != 100; ++i)
+    {
+        Position p((i * 17) % 37, (i * 5) % 21);
+
+        concrete[p] = int(i + 1);
+        mapped[p] = int(i + 1);
+    }
+
+    concrete.for_each_position([&](const Position& p) {
+        CATCH_CHECK(static_cast<const Grid<int>&>(mapped)[p] == concrete[p]);
+    });
+}
+
+TEST_CASE("MappedGrid, read_row")
+{
+    ConcreteGrid<int> concrete(100, 3, 5);
+    MappedGrid<int> mapped("mapped-grid-test.bin", 100, 3, 5, 16);
+    concrete[Position(40, 1)] = mapped[Position(40, 1)] = 1;
+    concrete[Position(99, 1)] = mapped[Position(99, 1)] = 2;
+
+    int expected[100], actual[100];
+    concrete.read_row(Position(3, 1), 97, expected);
+    mapped.read_row(Position(3, 1), 97, actual);
+
+    for (unsigned i = 0; i != 97; ++i)
+    {
+        CATCH_CHECK(actual[i] == expected[i]);
+    }
+}
+
+TEST_CASE("MappedGrid, more than 2^32 elements")
+{
+    // 70000 x 70000 bytes is about 4.9 GB of address space; only two tiles are ever written
+    MappedGrid<uint8_t> grid("mapped-grid-test.bin", 70000, 70000, 0, 64);
+
+    CATCH_CHECK(grid.reserved_size() > (uint64_t(1) << 32));
+
+    grid[Position(3, 2)] = 11;
+    grid[Position(69999, 69998)] = 22;
+
+    const Grid<uint8_t>& readonly = grid;
+    CATCH_CHECK(readonly[Position(3, 2)] == 11);
+    CATCH_CHECK(readonly[Position(69999, 69998)] == 22);
+    CATCH_CHECK(readonly[Position(69998, 69998)] == 0);
+    CATCH_CHECK(readonly[Position(35000, 35000)] == 0);
+}
+
+TEST_CASE("PianoRoll, render onto a MappedGrid")
+{
+    std::vector<midi::NOTE> notes;
+    for (int i = 0; i != 50; ++i)
+    {
+        notes.push_back(midi::NOTE(midi::NoteNumber(50 + i % 7), midi::Time(i * 30), midi::Duration(45), 100, midi::Instrument(0)));
+    }
+    rendering::PianoRoll roll(notes, 2, 3, 100, 10);
+
+    auto canvas = std::make_shared<MappedGrid<imaging::Color>>("mapped-grid-test.bin", roll.width(), roll.height(), imaging::colors::black(), 16);
+    std::stringstream expected, actual;
+    imaging::save_as_bmp(expected, roll.render());
+    imaging::save_as_bmp(actual, roll.render(canvas));
+
+    CATCH_CHECK(actual.str() == expected.str());
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/buffer-pool.h"
+#include "Catch.h"
+#include <cstdint>
+
+
+TEST_CASE("BufferPool, returned buffers are reused")
+{
+    BufferPool pool;
+    uint8_t* data;
+
+    {
+        BufferPool::Buffer buffer = pool.borrow(1000);
+        CATCH_REQUIRE(buffer);
+        CATCH_CHECK(buffer.capacity() >= 1000);
+        CATCH_CHECK(buffer.size() == 0);
+        CATCH_CHECK(pool.available() == 0);
+        data = buffer.data();
+    }
+
+    CATCH_CHECK(pool.available() == 1);
+
+    BufferPool::Buffer buffer = pool.borrow(500);
+    CATCH_CHECK(buffer.data() == data);
+    CATCH_CHECK(pool.blocks() == 1);
+}
+
+TEST_CASE("BufferPool, buffers that are too small are not reused")
+{
+    BufferPool pool;
+
+    pool.borrow(100);
+    BufferPool::Buffer buffer = pool.borrow(10000);
+
+    CATCH_CHECK(buffer.capacity() >= 10000);
+    CATCH_CHECK(pool.blocks() == 2);
+    CATCH_CHECK(pool.available() == 1);
+}
+
+TEST_CASE("BufferPool, smallest fitting buffer is chosen")
+{
+    BufferPool pool;
+    uint8_t* small;
+
+    {
+        BufferPool::Buffer a = pool.borrow(100000);
+        BufferPool::Buffer b = pool.borrow(1000);
+        small = b.data();
+    }
+
+    CATCH_CHECK(pool.borrow(500).data() == small);
+}
+
+TEST_CASE("BufferPool, alignment")
+{
+    for (size_t alignment : { 16, 64, 4096 })
+    {
+        BufferPool pool(alignment);
+
+        for (size_t size : { 1, 100, 5000 })
+        {
+            BufferPool::Buffer buffer = pool.borrow(size);
+
+            CATCH_CHECK(reinterpret_cast<uintptr_t>(buffer.data()) % alignment == 0);
+        }
+    }
+}
+
+TEST_CASE("BufferPool, huge pages fall back to ordinary memory")
+{
+    BufferPool pool(64, true);
+    BufferPool::Buffer buffer = pool.borrow(3000);
+
+    CATCH_REQUIRE(buffer);
+    CATCH_CHECK(buffer.capacity() >= 3000);
+    buffer.data()[buffer.capacity() - 1] = 1;
+}
+
+TEST_CASE("BufferPool, moving and releasing")
+{
+    BufferPool pool;
+    BufferPool::Buffer a = pool.borrow(10);
+    a.resize(5);
+    BufferPool::Buffer b = std::move(a);
+
+    CATCH_CHECK(!a);
+    CATCH_CHECK(b.size() == 5);
+
+    b.release();
+
+    CATCH_CHECK(!b);
+    CATCH_CHECK(pool.available() == 1);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/worker-pool.h"
+#include "Catch.h"
+#include <atomic>
+#include <vector>
+
+
+TEST_CASE("WorkerPool runs every task once")
+{
+    for (unsigned threads : { 1u, 2u, 5u })
+    {
+        WorkerPool pool(threads);
+        CATCH_CHECK(pool.threads() == threads);
+
+        for (unsigned count : { 0u, 1u, 3u, 100u })
+        {
+            std::vector<std::atomic<int>> runs(count);
+            for (auto& run : runs)
+            {
+                run = 0;
+            }
+
+            auto task = [&runs](unsigned i) { ++runs[i]; };
+            pool.run(count, task);
+
+            for (auto& run : runs)
+            {
+                CATCH_CHECK(run == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("WorkerPool, consecutive batches")
+{
+    WorkerPool pool(4);
+    std::atomic<uint64_t> sum(0);
+
+    for (unsigned batch = 0; batch != 1000; ++batch)
+    {
+        auto task = [&sum, batch](unsigned i) { sum += batch * 16 + i; };
+        pool.run(16, task);
+    }
+
+    // Sum of 0 .. 15999
+    CATCH_CHECK(sum == 15999ull * 16000 / 2);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/spsc-queue.h"
+#include "util/buffer-pool.h"
+#include "Catch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    // Sends count numbers through a queue, batch at a time on both sides,
+    // and returns whether they all came out in order
+    bool send(SpscQueue<uint64_t>& queue, uint64_t count, size_t batch)
+    {
+        std::thread producer([&queue, count, batch]() {
+            std::vector<uint64_t> items(batch);
+            uint64_t next = 0;
+
+            while (next != count)
+            {
+                const size_t n = size_t(std::min<uint64_t>(batch, count - next));
+                for (size_t i = 0; i != n; ++i)
+                {
+                    items[i] = next + i;
+                }
+
+                // The queue never waits, so a full queue is the caller's to wait out
+                size_t pushed = 0;
+                while ((pushed += queue.push(items.data() + pushed, n - pushed)) != n)
+                {
+                    std::this_thread::yield();
+                }
+                next += n;
+            }
+        });
+
+        std::vector<uint64_t> items(batch);
+        uint64_t expected = 0;
+        bool in_order = true;
+
+        while (expected != count)
+        {
+            const size_t n = queue.pop(items.data(), items.size());
+            if (n == 0)
+            {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i != n; ++i)
+            {
+                in_order = in_order && items[i] == expected;
+                ++expected;
+            }
+        }
+
+        producer.join();
+        return in_order;
+    }
+
+    // Same as send, through a deque guarded by a mutex
+    void send_locked(uint64_t count, size_t batch)
+    {
+        std::mutex mutex;
+        std::deque<uint64_t> queue;
+
+        std::thread producer([&mutex, &queue, count, batch]() {
+            for (uint64_t next = 0; next < count; next += batch)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint64_t i = next; i != std::min<uint64_t>(next + batch, count); ++i)
+                {
+                    queue.push_back(i);
+                }
+            }
+        });
+
+        uint64_t received = 0;
+        while (received != count)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (!queue.empty())
+                {
+                    queue.pop_front();
+                    ++received;
+                }
+            }
+            std::this_thread::yield();
+        }
+
+        producer.join();
+    }
+}
+
+TEST_CASE("SpscQueue, capacity is rounded up to a power of two")
+{
+    CATCH_CHECK(SpscQueue<int>(1).capacity() == 1);
+    CATCH_CHECK(SpscQueue<int>(5).capacity() == 8);
+    CATCH_CHECK(SpscQueue<int>(64).capacity() == 64);
+}
+
+TEST_CASE("SpscQueue, single items")
+{
+    SpscQueue<int> queue(4);
+    int item = 0;
+
+    CATCH_CHECK(!queue.try_pop(item));
+
+    for (int i = 0; i != 4; ++i)
+    {
+        CATCH_CHECK(queue.try_push(i));
+    }
+    CATCH_CHECK(!queue.try_push(4));
+    CATCH_CHECK(queue.size() == 4);
+
+    // Around the end of the ring several times
+    for (int i = 0; i != 10; ++i)
+    {
+        CATCH_REQUIRE(queue.try_pop(item));
+        CATCH_CHECK(item == i);
+        CATCH_CHECK(queue.try_push(i + 4));
+    }
+    CATCH_CHECK(queue.size() == 4);
+}
+
+TEST_CASE("SpscQueue, batches")
+{
+    SpscQueue<int> queue(8);
+    const int items[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    int out[10] = { };
+
+    CATCH_CHECK(queue.push(items, 5) == 5);
+    CATCH_CHECK(queue.pop(out, 3) == 3);
+    CATCH_CHECK(out[0] == 0);
+    CATCH_CHECK(out[2] == 2);
+
+    // Only 6 slots are free; the batch wraps around the end
+    CATCH_CHECK(queue.push(items + 5, 5) == 5);
+    CATCH_CHECK(queue.push(items, 10) == 1);
+    CATCH_CHECK(queue.push(items, 10) == 0);
+
+    CATCH_CHECK(queue.pop(out, 10) == 8);
+    const int expected[] = { 3, 4, 5, 6, 7, 8, 9, 0 };
+    CATCH_CHECK(std::equal(expected, expected + 8, out));
+    CATCH_CHECK(queue.pop(out, 10) == 0);
+}
+
+TEST_CASE("SpscQueue, move-only items")
+{
+    BufferPool pool(64);
+    SpscQueue<BufferPool::Buffer> queue(2);
+
+    BufferPool::Buffer block = pool.borrow(1024);
+    block.data()[0] = 42;
+    CATCH_CHECK(queue.try_push(std::move(block)));
+
+    BufferPool::Buffer received;
+    CATCH_REQUIRE(queue.try_pop(received));
+    CATCH_CHECK(received.data()[0] == 42);
+    CATCH_CHECK(received.capacity() >= 1024);
+}
+
+TEST_CASE("SpscQueue, items arrive in order across threads")
+{
+    for (size_t batch : { 1u, 7u, 64u })
+    {
+        SpscQueue<uint64_t> queue(32);
+
+        CATCH_INFO("Batch " << batch);
+        CATCH_CHECK(send(queue, 200000, batch));
+    }
+}
+
+TEST_CASE("SpscQueue throughput", "[.][benchmark]")
+{
+    const uint64_t count = 10000000;
+
+    BENCHMARK("SpscQueue, 10M items one at a time")
+    {
+        SpscQueue<uint64_t> queue(1024);
+        CATCH_CHECK(send(queue, count, 1));
+    }
+
+    BENCHMARK("SpscQueue, 10M items in batches of 64")
+    {
+        SpscQueue<uint64_t> queue(1024);
+        CATCH_CHECK(send(queue, count, 64));
+    }
+
+    BENCHMARK("Mutex and deque, 10M items in batches of 64")
+    {
+        send_locked(count, 64);
+    }
+}
+
+TEST_CASE("SpscQueue latency", "[.][benchmark]")
+{
+    typedef std::chrono::steady_clock Clock;
+    const size_t count = 1000000;
+
+    // The producer stamps every item with the time it was pushed, and the consumer
+    // measures how long it took to come out, while both threads spin on the queue
+    SpscQueue<Clock::time_point> queue(256);
+    std::vector<int64_t> latencies;
+    latencies.reserve(count);
+
+    std::thread producer([&queue, count]() {
+        for (size_t i = 0; i != count; ++i)
+        {
+            while (!queue.try_push(Clock::now()))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    Clock::time_point sent;
+    while (latencies.size() != count)
+    {
+        if (queue.try_pop(sent))
+        {
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count());
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    CATCH_WARN("Latency in ns: median " << latencies[count / 2]
+        << ", 99% " << latencies[count * 99 / 100]
+        << ", 99.9% " << latencies[count * 999 / 1000]
+        << ", 99.99% " << latencies[count * 9999 / 10000]
+        << ", max " << latencies.back());
+}
+
+#endif
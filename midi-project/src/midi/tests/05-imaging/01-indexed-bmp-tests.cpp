@@ -0,0 +1,200 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/bmp-format.h"
+#include "rendering/piano-roll.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    uint32_t read_u32(const std::string& data, size_t offset)
+    {
+        return uint32_t(uint8_t(data[offset])) | uint32_t(uint8_t(data[offset + 1])) << 8 |
+            uint32_t(uint8_t(data[offset + 2])) << 16 | uint32_t(uint8_t(data[offset + 3])) << 24;
+    }
+
+    uint16_t read_u16(const std::string& data, size_t offset)
+    {
+        return uint16_t(uint8_t(data[offset]) | uint8_t(data[offset + 1]) << 8);
+    }
+
+    uint32_t rgb(const imaging::Color& c)
+    {
+        return uint32_t(uint8_t(c.r * 255)) << 16 | uint32_t(uint8_t(c.g * 255)) << 8 | uint8_t(c.b * 255);
+    }
+
+    // Decodes an 8-bit BMP (uncompressed or RLE8) to 0xRRGGBB values, top row first
+    std::vector<uint32_t> decode_indexed_bmp(const std::string& data, unsigned& width, unsigned& height)
+    {
+        CATCH_REQUIRE(read_u16(data, 0) == 0x4D42);
+        CATCH_REQUIRE(read_u32(data, 2) == data.size());
+        CATCH_REQUIRE(read_u16(data, 28) == 8);
+
+        const uint32_t pixel_offset = read_u32(data, 10);
+        const uint32_t compression = read_u32(data, 30);
+        const uint32_t colors_used = read_u32(data, 46);
+        const size_t palette_offset = 14 + read_u32(data, 14);
+        width = read_u32(data, 18);
+        height = read_u32(data, 22);
+
+        CATCH_REQUIRE(palette_offset + 4 * colors_used == pixel_offset);
+        CATCH_REQUIRE(read_u32(data, 34) == data.size() - pixel_offset);
+
+        std::vector<uint32_t> palette;
+        for (uint32_t i = 0; i != colors_used; ++i)
+        {
+            palette.push_back(read_u32(data, palette_offset + 4 * i) & 0xFFFFFF);
+        }
+
+        std::vector<uint8_t> indices(size_t(width) * height, 0);
+        size_t p = pixel_offset;
+
+        if (compression == 0)
+        {
+            const unsigned stride = (width + 3) & ~3u;
+            for (unsigned row = 0; row != height; ++row)
+            {
+                for (unsigned x = 0; x != width; ++x)
+                {
+                    indices[size_t(height - 1 - row) * width + x] = uint8_t(data[p + x]);
+                }
+                p += stride;
+            }
+        }
+        else
+        {
+            CATCH_REQUIRE(compression == 1);
+            unsigned x = 0, row = 0;
+            bool done = false;
+
+            while (!done)
+            {
+                const uint8_t count = uint8_t(data[p++]);
+                const uint8_t value = uint8_t(data[p++]);
+
+                if (count != 0)
+                {
+                    for (unsigned i = 0; i != count; ++i)
+                    {
+                        indices[size_t(height - 1 - row) * width + x++] = value;
+                    }
+                }
+                else if (value == 0)
+                {
+                    CATCH_REQUIRE(x == width);
+                    x = 0;
+                    ++row;
+                }
+                else
+                {
+                    CATCH_REQUIRE(value == 1);
+                    done = true;
+                }
+            }
+            CATCH_REQUIRE(row == height);
+            CATCH_REQUIRE(p == data.size());
+        }
+
+        std::vector<uint32_t> result;
+        for (uint8_t index : indices)
+        {
+            CATCH_REQUIRE(index < palette.size());
+            result.push_back(palette[index]);
+        }
+        return result;
+    }
+
+    void check_round_trip(const imaging::Bitmap& bitmap, const std::string& data)
+    {
+        unsigned width, height;
+        std::vector<uint32_t> pixels = decode_indexed_bmp(data, width, height);
+
+        CATCH_REQUIRE(width == bitmap.width());
+        CATCH_REQUIRE(height == bitmap.height());
+
+        unsigned mismatches = 0;
+
+        for (unsigned y = 0; y != height; ++y)
+        {
+            for (unsigned x = 0; x != width; ++x)
+            {
+                if (pixels[size_t(y) * width + x] != rgb(bitmap[Position(x, y)]))
+                {
+                    ++mismatches;
+                }
+            }
+        }
+
+        CATCH_CHECK(mismatches == 0);
+    }
+
+    imaging::Bitmap build_bitmap(unsigned width, unsigned height)
+    {
+        return imaging::Bitmap(width, height, [](const Position& p) {
+            if ((p.x / 7 + p.y / 3) % 5 == 0) return imaging::colors::white();
+            if (p.x > 300 && p.y % 2 == 0) return imaging::colors::red();
+            return p.y % 4 == 1 ? imaging::colors::blue() : imaging::colors::black();
+        });
+    }
+}
+
+TEST_CASE("Indexed BMP, uncompressed round trip")
+{
+    for (unsigned width : { 1, 2, 3, 4, 5, 13, 600 })
+    {
+        imaging::Bitmap bitmap = build_bitmap(width, 9);
+        std::stringstream ss;
+        imaging::save_as_indexed_bmp(ss, bitmap, false);
+
+        check_round_trip(bitmap, ss.str());
+    }
+}
+
+TEST_CASE("Indexed BMP, RLE8 round trip")
+{
+    for (unsigned width : { 1, 2, 3, 13, 255, 256, 600 })
+    {
+        imaging::Bitmap bitmap = build_bitmap(width, 9);
+        std::stringstream ss;
+        imaging::save_as_indexed_bmp(ss, bitmap, true);
+
+        check_round_trip(bitmap, ss.str());
+    }
+}
+
+TEST_CASE("Indexed BMP, given palette")
+{
+    imaging::Bitmap bitmap = build_bitmap(40, 10);
+    std::vector<imaging::Color> palette = { imaging::colors::green(), imaging::colors::white(),
+        imaging::colors::blue(), imaging::colors::black() };
+    std::stringstream ss;
+    imaging::save_as_indexed_bmp(ss, bitmap, palette, true);
+
+    CATCH_CHECK(read_u32(ss.str(), 46) == 4);
+    check_round_trip(bitmap, ss.str());
+}
+
+TEST_CASE("Indexed BMP, piano roll frame compresses well")
+{
+    std::vector<midi::NOTE> notes;
+    for (int i = 0; i != 20; ++i)
+    {
+        notes.push_back(midi::NOTE(midi::NoteNumber(40 + i % 12), midi::Time(i * 100), midi::Duration(300), 100, midi::Instrument(0)));
+    }
+    rendering::PianoRoll roll(notes, 1, 16, 1000, 1);
+    imaging::Bitmap frame = roll.render_frame(0);
+
+    std::stringstream full, rle;
+    imaging::save_as_bmp(full, frame);
+    imaging::save_as_indexed_bmp(rle, frame, roll.palette(), true);
+
+    check_round_trip(frame, rle.str());
+    CATCH_CHECK(rle.str().size() * 50 < full.str().size());
+}
+
+#endif
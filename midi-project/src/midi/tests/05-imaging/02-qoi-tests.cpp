@@ -0,0 +1,163 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/qoi-format.h"
+#include "imaging/bmp-format.h"
+#include "rendering/piano-roll.h"
+#include "util/tiled-grid.h"
+#include "Catch.h"
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    uint8_t to_byte(double x)
+    {
+        return uint8_t(x * 255);
+    }
+
+    void check_same_pixels(const imaging::Bitmap& expected, const imaging::Bitmap& actual)
+    {
+        CATCH_REQUIRE(actual.width() == expected.width());
+        CATCH_REQUIRE(actual.height() == expected.height());
+
+        unsigned mismatches = 0;
+
+        for (unsigned y = 0; y != expected.height(); ++y)
+        {
+            for (unsigned x = 0; x != expected.width(); ++x)
+            {
+                const imaging::Color& e = expected[Position(x, y)];
+                const imaging::Color& a = actual[Position(x, y)];
+
+                if (std::lround(a.r * 255) != to_byte(e.r) || std::lround(a.g * 255) != to_byte(e.g) || std::lround(a.b * 255) != to_byte(e.b))
+                {
+                    ++mismatches;
+                }
+            }
+        }
+
+        CATCH_CHECK(mismatches == 0);
+    }
+
+    imaging::Bitmap round_trip(const imaging::Bitmap& bitmap)
+    {
+        std::stringstream ss;
+        imaging::save_as_qoi(ss, bitmap);
+
+        return imaging::load_qoi(ss);
+    }
+
+    imaging::Bitmap build_piano_roll_frame(unsigned width, unsigned height)
+    {
+        std::vector<midi::NOTE> notes;
+        for (int i = 0; i != 200; ++i)
+        {
+            notes.push_back(midi::NOTE(midi::NoteNumber(30 + (i * 7) % 40), midi::Time(i * 40), midi::Duration(90 + i % 50), 100, midi::Instrument(0)));
+        }
+        rendering::PianoRoll roll(notes, 1, height / 40, width, 1);
+
+        return roll.render_frame(0);
+    }
+}
+
+TEST_CASE("QOI, header")
+{
+    imaging::Bitmap bitmap(300, 2);
+    std::stringstream ss;
+    imaging::save_as_qoi(ss, bitmap);
+    const std::string data = ss.str();
+
+    CATCH_REQUIRE(data.size() >= 22);
+    CATCH_CHECK(data.substr(0, 4) == "qoif");
+    CATCH_CHECK(data.substr(4, 4) == std::string("\0\0\x01\x2C", 4));
+    CATCH_CHECK(data.substr(8, 4) == std::string("\0\0\0\x02", 4));
+    CATCH_CHECK(data[12] == 3);
+    CATCH_CHECK(data[13] == 0);
+    CATCH_CHECK(data.substr(data.size() - 8) == std::string("\0\0\0\0\0\0\0\x01", 8));
+}
+
+TEST_CASE("QOI, black bitmap is a sequence of runs")
+{
+    imaging::Bitmap bitmap(100, 10);
+    std::stringstream ss;
+    imaging::save_as_qoi(ss, bitmap);
+
+    // 1000 pixels are 16 runs of 62 and one of 8
+    CATCH_CHECK(ss.str().size() == 14 + 17 + 8);
+    check_same_pixels(bitmap, round_trip(bitmap));
+}
+
+TEST_CASE("QOI, round trip of all kinds of colors")
+{
+    imaging::Bitmap bitmap(97, 31, [](const Position& p) {
+        switch ((p.x + p.y) % 6)
+        {
+        case 0: return imaging::Color((p.x * 13 % 256) / 255.0, (p.y * 7 % 256) / 255.0, 0.5);
+        case 1: return imaging::colors::white();
+        case 2: return imaging::Color(0.01 * (p.x % 3), 0.02, 0.0);
+        case 3: return imaging::colors::orange();
+        default: return imaging::Color((p.x % 20) / 255.0, (p.x % 40) / 255.0, (p.y % 30) / 255.0);
+        }
+    });
+
+    check_same_pixels(bitmap, round_trip(bitmap));
+}
+
+TEST_CASE("QOI, sparse bitmap")
+{
+    imaging::Bitmap bitmap(std::make_shared<TiledGrid<imaging::Color>>(500, 70, imaging::colors::black(), 16));
+    for (unsigned x = 100; x != 300; ++x)
+    {
+        bitmap[Position(x, 40)] = imaging::colors::cyan();
+    }
+
+    check_same_pixels(bitmap, round_trip(bitmap));
+}
+
+TEST_CASE("QOI, piano roll frame is much smaller than BMP")
+{
+    imaging::Bitmap frame = build_piano_roll_frame(640, 360);
+    std::stringstream qoi, bmp;
+    imaging::save_as_qoi(qoi, frame);
+    imaging::save_as_bmp(bmp, frame);
+
+    CATCH_CHECK(qoi.str().size() * 20 < bmp.str().size());
+    check_same_pixels(frame, round_trip(frame));
+}
+
+TEST_CASE("QOI versus BMP encoding", "[.][benchmark]")
+{
+    imaging::Bitmap frame = build_piano_roll_frame(1920, 1080);
+
+    BENCHMARK("save_as_bmp, 1920x1080")
+    {
+        std::stringstream ss;
+        imaging::save_as_bmp(ss, frame);
+    }
+
+    BENCHMARK("save_as_qoi, 1920x1080")
+    {
+        std::stringstream ss;
+        imaging::save_as_qoi(ss, frame);
+    }
+
+    BENCHMARK("save_as_bmp to file, 1920x1080")
+    {
+        imaging::save_as_bmp("qoi-benchmark.bmp", frame);
+    }
+
+    BENCHMARK("save_as_qoi to file, 1920x1080")
+    {
+        imaging::save_as_qoi("qoi-benchmark.qoi", frame);
+    }
+
+    std::remove("qoi-benchmark.bmp");
+    std::remove("qoi-benchmark.qoi");
+}
+
+#endif
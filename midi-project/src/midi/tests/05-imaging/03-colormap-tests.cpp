@@ -0,0 +1,48 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/colormap.h"
+#include "Catch.h"
+
+
+TEST_CASE("Colormap, two stops")
+{
+    imaging::Colormap colormap({ imaging::colors::black(), imaging::Color(1, 0.5, 0) });
+
+    CATCH_CHECK(colormap.colors().size() == 256);
+    CATCH_CHECK(colormap[0] == imaging::colors::black());
+    CATCH_CHECK(colormap[255] == imaging::Color(1, 0.5, 0));
+    CATCH_CHECK(colormap[51].r == Approx(0.2));
+    CATCH_CHECK(colormap[51].g == Approx(0.1));
+    CATCH_CHECK(colormap[51].b == 0);
+}
+
+TEST_CASE("Colormap, stops are evenly spaced")
+{
+    imaging::Colormap colormap({ imaging::colors::black(), imaging::colors::red(), imaging::colors::white() });
+
+    CATCH_CHECK(colormap[0] == imaging::colors::black());
+    CATCH_CHECK(colormap[255] == imaging::colors::white());
+    CATCH_CHECK(colormap[127].r == Approx(254.0 / 255));
+    CATCH_CHECK(colormap[127].g == Approx(0));
+    CATCH_CHECK(colormap[128].r == 1);
+    CATCH_CHECK(colormap[128].g == Approx(1.0 / 255));
+}
+
+TEST_CASE("Colormap, heat gets brighter")
+{
+    imaging::Colormap colormap = imaging::Colormap::heat();
+
+    CATCH_CHECK(colormap[0] == imaging::colors::black());
+    CATCH_CHECK(colormap[255] == imaging::colors::white());
+
+    for (unsigned level = 1; level != 256; ++level)
+    {
+        const imaging::Color& a = colormap[uint8_t(level - 1)];
+        const imaging::Color& b = colormap[uint8_t(level)];
+        CATCH_CHECK(a.r + a.g + a.b <= b.r + b.g + b.b);
+    }
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/score.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <sstream>
+
+
+TEST_CASE("TempoMap, default tempo")
+{
+    audio::TempoMap map(96);
+
+    CATCH_CHECK(map.seconds(midi::Time(0)) == 0);
+    CATCH_CHECK(map.seconds(midi::Time(96)) == Approx(0.5));
+    CATCH_CHECK(map.seconds(midi::Time(960)) == Approx(5));
+    CATCH_CHECK(map.frame(midi::Time(96), 44100) == 22050);
+}
+
+TEST_CASE("TempoMap, tempo changes")
+{
+    audio::TempoMap map(100);
+
+    map.set_tempo(midi::Time(0), 1000000);
+    map.set_tempo(midi::Time(200), 250000);
+    map.set_tempo(midi::Time(300), 2000000);
+
+    CATCH_CHECK(map.seconds(midi::Time(100)) == Approx(1));
+    CATCH_CHECK(map.seconds(midi::Time(200)) == Approx(2));
+    CATCH_CHECK(map.seconds(midi::Time(250)) == Approx(2.125));
+    CATCH_CHECK(map.seconds(midi::Time(300)) == Approx(2.25));
+    CATCH_CHECK(map.seconds(midi::Time(350)) == Approx(3.25));
+    CATCH_CHECK(map.frame(midi::Time(300), 1000) == 2250);
+}
+
+TEST_CASE("TempoMap, ticks is the inverse of seconds")
+{
+    audio::TempoMap map(100);
+
+    map.set_tempo(midi::Time(0), 1000000);
+    map.set_tempo(midi::Time(200), 250000);
+    map.set_tempo(midi::Time(300), 2000000);
+
+    CATCH_CHECK(map.ticks(0) == 0);
+    CATCH_CHECK(map.ticks(1) == Approx(100));
+    CATCH_CHECK(map.ticks(2.125) == Approx(250));
+    CATCH_CHECK(map.ticks(3.25) == Approx(350));
+
+    for (uint64_t tick = 0; tick < 1000; tick += 7)
+    {
+        CATCH_CHECK(map.ticks(map.seconds(midi::Time(tick))) == Approx(double(tick)));
+    }
+}
+
+TEST_CASE("TempoMap, second change at the same time replaces the first")
+{
+    audio::TempoMap map(100);
+
+    map.set_tempo(midi::Time(100), 1000000);
+    map.set_tempo(midi::Time(100), 2000000);
+
+    CATCH_CHECK(map.seconds(midi::Time(100)) == Approx(0.5));
+    CATCH_CHECK(map.seconds(midi::Time(200)) == Approx(2.5));
+}
+
+TEST_CASE("TempoMap, SMPTE division ignores tempo")
+{
+    // 25 frames per second, 40 ticks per frame
+    audio::TempoMap map(uint16_t(0xE728));
+
+    map.set_tempo(midi::Time(0), 1000000);
+
+    CATCH_CHECK(map.seconds(midi::Time(1000)) == Approx(1));
+}
+
+TEST_CASE("Score merges tracks in order of time")
+{
+    char buffer[] = {
+        MTHD,
+        0x00, 0x00, 0x00, 0x06, // MThd size
+        0x00, 0x01, // Type
+        0x00, 0x02, // Number of tracks
+        0x00, 0x60, // Division
+        MTRK,
+        0x00, 0x00, 0x00, 23, // MTrk size
+        0, char(0xFF), 0x51, 0x03, 0x0F, 0x42, 0x40, // 1000000 us per quarter
+        0, NOTE_ON(0, 60, 100),
+        96, NOTE_ON(0, 60, 0),
+        0, PITCH_WHEEL_CHANGE(0, 0x3000),
+        END_OF_TRACK,
+        MTRK,
+        0x00, 0x00, 0x00, 15, // MTrk size
+        48, CONTROL_CHANGE(1, 7, 80),
+        48, PROGRAM_CHANGE(1, 5),
+        100, NOTE_OFF(1, 3, 0),
+        END_OF_TRACK
+    };
+    std::stringstream ss(std::string(buffer, sizeof(buffer)));
+
+    audio::Score score(ss);
+    const auto& events = score.events();
+
+    CATCH_REQUIRE(events.size() == 6);
+    CATCH_CHECK(events[0].type == audio::EventType::note_on);
+    CATCH_CHECK(events[1].type == audio::EventType::control_change);
+    CATCH_CHECK(events[1].time == midi::Time(48));
+    CATCH_CHECK(events[1].channel == 1);
+    CATCH_CHECK(events[1].data1 == 7);
+    CATCH_CHECK(events[1].data2 == 80);
+    // Velocity 0
+    CATCH_CHECK(events[2].type == audio::EventType::note_off);
+    CATCH_CHECK(events[2].time == midi::Time(96));
+    CATCH_CHECK(events[3].type == audio::EventType::pitch_wheel);
+    CATCH_CHECK(events[3].data2 == 0x3000);
+    CATCH_CHECK(events[4].type == audio::EventType::program_change);
+    CATCH_CHECK(events[5].time == midi::Time(196));
+    CATCH_CHECK(score.end() == midi::Time(196));
+    CATCH_CHECK(score.tempo_map().seconds(midi::Time(96)) == Approx(1));
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/synth.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    std::vector<float> render_all(audio::Synth& synth)
+    {
+        std::vector<float> result;
+        std::vector<float> block(2 * synth.block_size());
+
+        while (unsigned n = synth.render(block.data()))
+        {
+            result.insert(result.end(), block.begin(), block.begin() + 2 * n);
+        }
+        return result;
+    }
+
+    // Chords on several channels, with pitch bends, pedal and controller changes in between
+    std::vector<char> busy_track(int bars)
+    {
+        std::vector<char> track;
+
+        for (int i = 0; i != bars; ++i)
+        {
+            const int channel = i % 4 == 3 ? 9 : i % 4;
+            const char bytes[] = {
+                0, PROGRAM_CHANGE(channel, (i * 8) % 128),
+                0, NOTE_ON(channel, 48 + i % 12, 100),
+                0, NOTE_ON(channel, 52 + i % 12, 90),
+                0, NOTE_ON(channel, 55 + i % 12, 80),
+                7, CONTROL_CHANGE(channel, 64, 127),
+                5, PITCH_WHEEL_CHANGE(channel, 0x2000 + 37 * i),
+                13, CONTROL_CHANGE(channel, 10, (i * 17) % 128),
+                3, NOTE_OFF(channel, 48 + i % 12, 0),
+                11, CONTROL_CHANGE(channel, 11, 90),
+                1, NOTE_OFF(channel, 52 + i % 12, 0),
+                0, NOTE_OFF(channel, 55 + i % 12, 0),
+                9, CONTROL_CHANGE(channel, 64, 0),
+            };
+            track.insert(track.end(), bytes, bytes + sizeof(bytes));
+        }
+        return track;
+    }
+
+    // More voices on one channel than fit in one set of kernel lanes, with two of them
+    // fading out long before the others
+    std::vector<char> dense_chord_track()
+    {
+        std::vector<char> track;
+
+        for (int i = 0; i != 12; ++i)
+        {
+            const char bytes[] = { 0, NOTE_ON(0, 48 + 2 * i, 60 + 5 * i) };
+            track.insert(track.end(), bytes, bytes + sizeof(bytes));
+        }
+
+        const char bytes[] = {
+            20, NOTE_OFF(0, 50, 0),
+            0, NOTE_OFF(0, 60, 0),
+            char(0x82), 0x00, NOTE_OFF(0, 48, 0),
+        };
+        track.insert(track.end(), bytes, bytes + sizeof(bytes));
+
+        for (int i = 0; i != 12; ++i)
+        {
+            const char note_off[] = { 0, NOTE_OFF(0, 48 + 2 * i, 0) };
+            track.insert(track.end(), note_off, note_off + sizeof(note_off));
+        }
+        return track;
+    }
+}
+
+TEST_CASE("Synth, output does not depend on the block size")
+{
+    for (const std::vector<char>& track : { busy_track(24), dense_chord_track() })
+    {
+        audio::Score score = make_score(track);
+
+        audio::Synth reference_synth(score, 8000, 1);
+        const std::vector<float> reference = render_all(reference_synth);
+
+        for (unsigned block_size : { 64u, 100u, 256u, 1024u, 4096u })
+        {
+            audio::Synth synth(score, 8000, block_size);
+
+            CATCH_CHECK(render_all(synth) == reference);
+        }
+    }
+}
+
+TEST_CASE("Synth, notes start on the sample of their event")
+{
+    const std::vector<char> track = {
+        0, PROGRAM_CHANGE(0, 24), // Square wave, which starts at full amplitude
+        96, NOTE_ON(0, 69, 127),
+        96, NOTE_OFF(0, 69, 0)
+    };
+    audio::Score score = make_score(track);
+    audio::Synth synth(score, 1000, 64);
+
+    const std::vector<float> samples = render_all(synth);
+
+    // Tick 96 is 0.5 s
+    CATCH_REQUIRE(samples.size() > 2 * 501);
+    CATCH_CHECK(samples[2 * 499] == 0);
+    CATCH_CHECK(samples[2 * 499 + 1] == 0);
+    CATCH_CHECK(samples[2 * 500] != 0);
+    CATCH_CHECK(samples[2 * 500 + 1] != 0);
+}
+
+TEST_CASE("Synth, renders up to the end of the release")
+{
+    const std::vector<char> track = {
+        0, NOTE_ON(0, 60, 100),
+        char(0x81), 0x40, NOTE_OFF(0, 60, 0)
+    };
+    audio::Score score = make_score(track);
+    audio::Synth synth(score, 1000, 256);
+
+    const std::vector<float> samples = render_all(synth);
+
+    CATCH_CHECK(synth.finished());
+    CATCH_CHECK(synth.active_voices() == 0);
+    CATCH_CHECK(samples.size() == 2 * synth.length());
+    CATCH_CHECK(synth.length() > 1000);
+    CATCH_CHECK(samples[2 * 900] != 0);
+    CATCH_CHECK(samples[samples.size() - 1] == 0);
+
+    float block[512];
+    CATCH_CHECK(synth.render(block) == 0);
+}
+
+TEST_CASE("Synth, notes beyond the polyphony are dropped without stealing")
+{
+    const std::vector<char> track = {
+        0, NOTE_ON(0, 60, 100),
+        0, NOTE_ON(0, 64, 100),
+        0, NOTE_ON(0, 67, 100),
+        char(0x81), 0x40, NOTE_OFF(0, 60, 0)
+    };
+    audio::Score score = make_score(track);
+    audio::Synth synth(score, 1000, 16, 2, audio::StealPolicy::none);
+    float block[32];
+
+    synth.render(block);
+
+    CATCH_CHECK(synth.active_voices() == 2);
+    CATCH_CHECK(synth.stolen_voices() == 0);
+}
+
+TEST_CASE("Synth, notes beyond the polyphony steal a voice")
+{
+    const std::vector<char> track = {
+        0, NOTE_ON(0, 60, 100),
+        0, NOTE_ON(0, 64, 100),
+        0, NOTE_ON(0, 67, 100),
+        0, NOTE_ON(0, 72, 100),
+        char(0x81), 0x40, NOTE_OFF(0, 60, 0)
+    };
+    audio::Score score = make_score(track);
+
+    for (auto policy : { audio::StealPolicy::oldest, audio::StealPolicy::quietest })
+    {
+        audio::Synth synth(score, 1000, 16, 2, policy);
+        float block[32];
+
+        synth.render(block);
+
+        CATCH_CHECK(synth.active_voices() == 2);
+        CATCH_CHECK(synth.stolen_voices() == 2);
+    }
+}
+
+TEST_CASE("Synth, sustain pedal holds notes")
+{
+    const std::vector<char> track = {
+        0, CONTROL_CHANGE(0, 64, 127),
+        0, NOTE_ON(0, 60, 100),
+        10, NOTE_OFF(0, 60, 0),
+        char(0x81), 0x36, CONTROL_CHANGE(0, 64, 0)
+    };
+    audio::Score score = make_score(track);
+    audio::Synth synth(score, 1000, 500);
+    float block[1000];
+
+    // Note off at about 52 ms, pedal up at 1 s
+    synth.render(block);
+    CATCH_CHECK(synth.active_voices() == 1);
+
+    synth.render(block);
+    synth.render(block);
+    CATCH_CHECK(synth.active_voices() == 0);
+}
+
+TEST_CASE("Synth, pan")
+{
+    const std::vector<char> track = {
+        0, CONTROL_CHANGE(0, 10, 0),
+        0, NOTE_ON(0, 60, 100),
+        0, CONTROL_CHANGE(1, 10, 127),
+        0, NOTE_ON(1, 72, 100),
+        96, NOTE_OFF(0, 60, 0)
+    };
+    audio::Score score = make_score(track);
+    audio::Synth synth(score, 1000, 64);
+    const std::vector<float> samples = render_all(synth);
+
+    audio::Synth left_only(make_score({ 0, CONTROL_CHANGE(0, 10, 0), 0, NOTE_ON(0, 60, 100), 96, NOTE_OFF(0, 60, 0) }), 1000, 64);
+    const std::vector<float> left = render_all(left_only);
+
+    CATCH_REQUIRE(samples.size() >= left.size());
+    for (size_t i = 0; i < left.size(); i += 2)
+    {
+        CATCH_CHECK(left[i + 1] == Approx(0).margin(1e-7));
+        CATCH_CHECK(samples[i] == Approx(left[i]).margin(1e-6));
+    }
+}
+
+TEST_CASE("Synth, volume changes are ramped over a control period")
+{
+    const std::vector<char> note = { 0, NOTE_ON(0, 60, 100), char(0x81), 0x40, NOTE_OFF(0, 60, 0) };
+    std::vector<char> track = { 0, NOTE_ON(0, 60, 100), 96, CONTROL_CHANGE(0, 7, 0), 96, NOTE_OFF(0, 60, 0) };
+
+    audio::Synth steady(make_score(note), 1000, 64);
+    audio::Synth faded(make_score(track), 1000, 100);
+    const std::vector<float> expected = render_all(steady);
+    const std::vector<float> samples = render_all(faded);
+
+    // The change falls on frame 500, in the control period from 448 to 512
+    CATCH_REQUIRE(samples.size() == expected.size());
+    for (size_t frame = 0; frame != samples.size() / 2; ++frame)
+    {
+        CATCH_INFO("frame = " << frame);
+
+        if (frame < 448)
+        {
+            CATCH_CHECK(samples[2 * frame] == expected[2 * frame]);
+        }
+        else if (frame < 512)
+        {
+            const float gain = 1 - (frame - 448) / 64.0f;
+            CATCH_CHECK(samples[2 * frame] == Approx(expected[2 * frame] * gain).margin(1e-6));
+        }
+        else
+        {
+            CATCH_CHECK(samples[2 * frame] == 0);
+        }
+    }
+}
+
+TEST_CASE("Synth rendering speed", "[.][benchmark]")
+{
+    // About 100 seconds of audio
+    audio::Score score = make_score(busy_track(400));
+
+    BENCHMARK("Synth, 44100 Hz, 256 frames per block")
+    {
+        audio::Synth synth(score, 44100, 256);
+        std::vector<float> block(2 * synth.block_size());
+
+        while (synth.render(block.data()))
+        {
+            // NOP
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/synth.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <algorithm>
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    std::vector<unsigned> in_use(const audio::VoicePool& pool)
+    {
+        std::vector<unsigned> result;
+
+        for (unsigned i = 0; i != pool.size(); ++i)
+        {
+            result.push_back(pool[i]);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Starts a voice the way the synth does, at the given envelope level
+    unsigned start(audio::VoicePool& pool, float envelope, audio::EnvelopeStage stage = audio::EnvelopeStage::sustain)
+    {
+        const unsigned voice = pool.allocate();
+
+        if (voice != audio::VoicePool::NONE)
+        {
+            pool.envelopes[voice] = envelope;
+            pool.velocities[voice] = 1;
+            pool.stages[voice] = stage;
+        }
+        return voice;
+    }
+}
+
+TEST_CASE("VoicePool, allocate and release")
+{
+    audio::VoicePool pool(4);
+
+    CATCH_CHECK(pool.capacity() == 4);
+    CATCH_CHECK(pool.size() == 0);
+    CATCH_CHECK(pool.allocate() == 0);
+    CATCH_CHECK(pool.allocate() == 1);
+    CATCH_CHECK(pool.allocate() == 2);
+    CATCH_CHECK(pool.size() == 3);
+
+    pool.release(0);
+
+    CATCH_CHECK(in_use(pool) == (std::vector<unsigned>{ 1, 2 }));
+    // Last released, first reused
+    CATCH_CHECK(pool.allocate() == 0);
+    CATCH_CHECK(pool.allocate() == 3);
+    CATCH_CHECK(in_use(pool) == (std::vector<unsigned>{ 0, 1, 2, 3 }));
+    CATCH_CHECK(pool.stolen() == 0);
+
+    for (unsigned voice : { 3u, 1u, 0u, 2u })
+    {
+        pool.release(voice);
+    }
+    CATCH_CHECK(pool.size() == 0);
+}
+
+TEST_CASE("VoicePool, without stealing a full pool refuses")
+{
+    audio::VoicePool pool(2, audio::StealPolicy::none);
+
+    pool.allocate();
+    pool.allocate();
+
+    CATCH_CHECK(pool.allocate() == audio::VoicePool::NONE);
+    CATCH_CHECK(pool.size() == 2);
+    CATCH_CHECK(pool.stolen() == 0);
+}
+
+TEST_CASE("VoicePool, stealing the oldest voice")
+{
+    audio::VoicePool pool(3, audio::StealPolicy::oldest);
+    const unsigned first = start(pool, 1);
+    const unsigned second = start(pool, 1);
+    const unsigned third = start(pool, 1);
+
+    CATCH_CHECK(pool.allocate() == first);
+    CATCH_CHECK(pool.allocate() == second);
+    CATCH_CHECK(pool.size() == 3);
+    CATCH_CHECK(pool.stolen() == 2);
+
+    // Voices being released go first, even if they are younger
+    pool.stages[third] = audio::EnvelopeStage::sustain;
+    pool.stages[first] = audio::EnvelopeStage::sustain;
+    pool.stages[second] = audio::EnvelopeStage::release;
+
+    CATCH_CHECK(pool.allocate() == second);
+}
+
+TEST_CASE("VoicePool, stealing the quietest voice")
+{
+    audio::VoicePool pool(3, audio::StealPolicy::quietest);
+    start(pool, 0.5f);
+    const unsigned quiet = start(pool, 0.1f);
+    start(pool, 0.9f, audio::EnvelopeStage::release);
+
+    CATCH_CHECK(pool.allocate() == quiet);
+}
+
+TEST_CASE("VoicePool, quietest voice on a tie is the oldest")
+{
+    audio::VoicePool pool(3, audio::StealPolicy::quietest);
+    start(pool, 0.5f);
+    const unsigned oldest = start(pool, 0.2f);
+    const unsigned youngest = start(pool, 0.2f);
+
+    CATCH_CHECK(pool.allocate() == oldest);
+    pool.envelopes[oldest] = 0.9f;
+    CATCH_CHECK(pool.allocate() == youngest);
+}
+
+TEST_CASE("Synth polyphony cost", "[.][benchmark]")
+{
+    // 2000 notes of 4 seconds each, a new one every 5 ms: up to 800 overlap
+    std::vector<char> track;
+    for (int i = 0; i != 2000; ++i)
+    {
+        const char on[] = { 1, NOTE_ON(i % 16, 24 + i % 80, 100) };
+        track.insert(track.end(), on, on + sizeof(on));
+    }
+    for (int i = 0; i != 2000; ++i)
+    {
+        const char off[] = { 0, NOTE_OFF(i % 16, 24 + i % 80, 0) };
+        track.insert(track.end(), off, off + sizeof(off));
+    }
+    audio::Score score = make_score(track);
+
+    for (unsigned polyphony : { 32u, 64u, 256u })
+    {
+        BENCHMARK("Polyphony " + std::to_string(polyphony))
+        {
+            audio::Synth synth(score, 44100, 256, polyphony, audio::StealPolicy::oldest);
+            std::vector<float> block(2 * synth.block_size());
+
+            while (synth.render(block.data()))
+            {
+                // NOP
+            }
+        }
+    }
+}
+
+#endif
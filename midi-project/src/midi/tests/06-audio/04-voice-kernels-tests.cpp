@@ -0,0 +1,215 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/voice-kernels.h"
+#include "audio/synth.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    const audio::KernelIsa ALL_KERNELS[] = { audio::KernelIsa::scalar, audio::KernelIsa::sse2, audio::KernelIsa::avx2 };
+
+    const char* name(audio::KernelIsa isa)
+    {
+        switch (isa)
+        {
+        case audio::KernelIsa::avx2: return "avx2";
+        case audio::KernelIsa::sse2: return "sse2";
+        default: return "scalar";
+        }
+    }
+
+    // Voices in every stage of their envelope, some playing noise, with the last lane unused
+    audio::VOICE_LANES random_lanes(unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> unit(0, 1);
+        audio::VOICE_LANES lanes;
+        std::memset(&lanes, 0, sizeof(lanes));
+
+        for (unsigned k = 0; k != audio::KERNEL_WIDTH - 1; ++k)
+        {
+            lanes.phases[k] = uint32_t(random());
+            lanes.increments[k] = uint32_t(random()) >> 6;
+            lanes.tables[k] = (k % 4) * (audio::WAVETABLE_SIZE + 1);
+            lanes.noise_masks[k] = k % 3 == 0 ? ~0u : 0;
+            lanes.noise[k] = uint32_t(random()) | 1;
+            lanes.envelopes[k] = unit(random);
+            lanes.decay_rates[k] = -unit(random) / 100;
+            lanes.sustain_levels[k] = unit(random) * 0.5f;
+            lanes.left[k] = unit(random);
+            lanes.right[k] = unit(random);
+
+            switch (k % 4)
+            {
+            case 0: lanes.rates[k] = unit(random) / 100; lanes.targets[k] = 1; break;
+            case 1: lanes.rates[k] = lanes.decay_rates[k]; lanes.targets[k] = lanes.sustain_levels[k]; break;
+            case 2: lanes.rates[k] = 0; lanes.targets[k] = lanes.envelopes[k]; break;
+            case 3: lanes.rates[k] = -unit(random) / 1000; lanes.targets[k] = 0; break;
+            }
+        }
+        return lanes;
+    }
+
+    audio::Score chords(int count)
+    {
+        std::vector<char> track;
+        for (int i = 0; i != count; ++i)
+        {
+            const int channel = i % 11;
+            const char bytes[] = {
+                0, PROGRAM_CHANGE(channel, (i * 8) % 128),
+                0, NOTE_ON(channel, 40 + i % 40, 100),
+                3, NOTE_ON(channel, 47 + i % 40, 80),
+                2, PITCH_WHEEL_CHANGE(channel, 0x1000 + 64 * i),
+                40, NOTE_OFF(channel, 40 + i % 40, 0),
+                0, NOTE_OFF(channel, 47 + i % 40, 0)
+            };
+            track.insert(track.end(), bytes, bytes + sizeof(bytes));
+        }
+
+        return make_score(track);
+    }
+}
+
+TEST_CASE("Wavetables")
+{
+    const float* tables = audio::wavetables();
+    const unsigned size = audio::WAVETABLE_SIZE + 1;
+
+    CATCH_CHECK(tables[0] == 0);
+    CATCH_CHECK(tables[audio::WAVETABLE_SIZE / 4] == Approx(1));
+    CATCH_CHECK(tables[audio::WAVETABLE_SIZE] == tables[0]);
+    CATCH_CHECK(tables[size] == 1);
+    CATCH_CHECK(tables[size + audio::WAVETABLE_SIZE / 2] == -1);
+    CATCH_CHECK(tables[2 * size] == -1);
+    CATCH_CHECK(tables[3 * size] == 1);
+    CATCH_CHECK(tables[3 * size + audio::WAVETABLE_SIZE - 1] == -1);
+}
+
+TEST_CASE("Scalar kernel, envelope")
+{
+    audio::VOICE_LANES lanes;
+    std::memset(&lanes, 0, sizeof(lanes));
+    lanes.rates[0] = 0.25f;
+    lanes.targets[0] = 1;
+    lanes.decay_rates[0] = -0.125f;
+    lanes.sustain_levels[0] = 0.5f;
+    std::vector<float> out(2 * 16);
+
+    const float expected[] = { 0.25f, 0.5f, 0.75f, 1, 0.875f, 0.75f, 0.625f, 0.5f, 0.5f };
+    for (float level : expected)
+    {
+        audio::render_lanes(audio::KernelIsa::scalar, lanes, out.data(), 1);
+        CATCH_CHECK(lanes.envelopes[0] == level);
+    }
+    CATCH_CHECK(lanes.rates[0] == 0);
+
+    // Released
+    lanes.rates[0] = -0.2f;
+    lanes.targets[0] = 0;
+    audio::render_lanes(audio::KernelIsa::scalar, lanes, out.data(), 3);
+    CATCH_CHECK(lanes.envelopes[0] == 0);
+    CATCH_CHECK(lanes.rates[0] == 0);
+    CATCH_CHECK(lanes.targets[0] == 0);
+}
+
+TEST_CASE("Vectorized kernels match the scalar kernel bit for bit")
+{
+    for (unsigned seed = 0; seed != 20; ++seed)
+    {
+        audio::VOICE_LANES reference = random_lanes(seed);
+        std::vector<float> reference_out(2 * 1000, 0.125f);
+        audio::render_lanes(audio::KernelIsa::scalar, reference, reference_out.data(), 1000);
+
+        for (audio::KernelIsa isa : ALL_KERNELS)
+        {
+            if (!audio::is_supported(isa))
+            {
+                continue;
+            }
+
+            audio::VOICE_LANES lanes = random_lanes(seed);
+            std::vector<float> out(2 * 1000, 0.125f);
+            audio::render_lanes(isa, lanes, out.data(), 1000);
+
+            CATCH_INFO(name(isa) << ", seed " << seed);
+            CATCH_CHECK(std::memcmp(out.data(), reference_out.data(), out.size() * sizeof(float)) == 0);
+            CATCH_CHECK(std::memcmp(&lanes, &reference, sizeof(lanes)) == 0);
+        }
+    }
+}
+
+TEST_CASE("Synth renders the same samples with every kernel")
+{
+    audio::Score score = chords(60);
+
+    audio::Synth reference_synth(score, 8000, 128);
+    reference_synth.set_kernel(audio::KernelIsa::scalar);
+    std::vector<float> reference;
+    std::vector<float> block(2 * 128);
+    while (unsigned n = reference_synth.render(block.data()))
+    {
+        reference.insert(reference.end(), block.begin(), block.begin() + 2 * n);
+    }
+
+    for (audio::KernelIsa isa : ALL_KERNELS)
+    {
+        if (!audio::is_supported(isa))
+        {
+            continue;
+        }
+
+        audio::Synth synth(score, 8000, 128);
+        synth.set_kernel(isa);
+        std::vector<float> samples;
+        while (unsigned n = synth.render(block.data()))
+        {
+            samples.insert(samples.end(), block.begin(), block.begin() + 2 * n);
+        }
+
+        CATCH_INFO(name(isa));
+        CATCH_CHECK(samples == reference);
+    }
+}
+
+TEST_CASE("Voice kernels, voices per second", "[.][benchmark]")
+{
+    // 64 voices for one second at 44.1 kHz, in blocks of 256 frames
+    std::vector<audio::VOICE_LANES> voices;
+    for (unsigned i = 0; i != 64 / audio::KERNEL_WIDTH; ++i)
+    {
+        voices.push_back(random_lanes(i));
+    }
+    std::vector<float> out(2 * 256);
+
+    for (audio::KernelIsa isa : ALL_KERNELS)
+    {
+        if (!audio::is_supported(isa))
+        {
+            continue;
+        }
+
+        BENCHMARK(std::string("64 voice-seconds, ") + name(isa))
+        {
+            for (unsigned block = 0; block != 44100 / 256; ++block)
+            {
+                for (audio::VOICE_LANES& lanes : voices)
+                {
+                    audio::render_lanes(isa, lanes, out.data(), 256);
+                }
+            }
+        }
+    }
+}
+
+#endif
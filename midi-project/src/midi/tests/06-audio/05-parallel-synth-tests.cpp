@@ -0,0 +1,97 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/synth.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    // Notes on all 16 channels, several at a time on each, with controller changes in between
+    audio::Score all_channels(int rounds)
+    {
+        std::vector<char> track;
+        for (int i = 0; i != rounds; ++i)
+        {
+            for (int channel = 0; channel != 16; ++channel)
+            {
+                const int note = 36 + (i * 7 + channel * 5) % 60;
+                const char bytes[] = {
+                    0, PROGRAM_CHANGE(channel, (channel * 8 + i) % 128),
+                    0, NOTE_ON(channel, note, 60 + channel * 4),
+                    0, NOTE_ON(channel, note + 4, 50 + channel * 3),
+                    0, CONTROL_CHANGE(channel, 10, (i * 13 + channel * 8) % 128),
+                    1, NOTE_OFF(channel, note, 0)
+                };
+                track.insert(track.end(), bytes, bytes + sizeof(bytes));
+            }
+            for (int channel = 0; channel != 16; ++channel)
+            {
+                const int note = 36 + (i * 7 + channel * 5) % 60;
+                const char bytes[] = { 2, NOTE_OFF(channel, note + 4, 0) };
+                track.insert(track.end(), bytes, bytes + sizeof(bytes));
+            }
+        }
+
+        return make_score(track);
+    }
+
+    std::vector<float> render_all(audio::Synth& synth)
+    {
+        std::vector<float> result;
+        std::vector<float> block(2 * synth.block_size());
+
+        while (unsigned n = synth.render(block.data()))
+        {
+            result.insert(result.end(), block.begin(), block.begin() + 2 * n);
+        }
+        return result;
+    }
+}
+
+TEST_CASE("Synth, output does not depend on the number of threads")
+{
+    audio::Score score = all_channels(30);
+
+    audio::Synth reference_synth(score, 22050, 256, 128, audio::StealPolicy::oldest, 1);
+    const std::vector<float> reference = render_all(reference_synth);
+
+    for (unsigned threads : { 2u, 3u, 4u, 16u })
+    {
+        for (unsigned block_size : { 64u, 256u })
+        {
+            audio::Synth synth(score, 22050, block_size, 128, audio::StealPolicy::oldest, threads);
+
+            CATCH_INFO(threads << " threads, blocks of " << block_size);
+            CATCH_CHECK(synth.threads() == threads);
+            CATCH_CHECK(render_all(synth) == reference);
+        }
+    }
+}
+
+TEST_CASE("Synth thread scaling", "[.][benchmark]")
+{
+    // About 80 seconds with up to 32 notes on each of the 16 channels
+    audio::Score score = all_channels(200);
+
+    for (unsigned threads : { 1u, 2u, 4u, 8u, 16u })
+    {
+        BENCHMARK(std::to_string(threads) + " threads")
+        {
+            audio::Synth synth(score, 44100, 256, 512, audio::StealPolicy::oldest, threads);
+            std::vector<float> block(2 * synth.block_size());
+
+            while (synth.render(block.data()))
+            {
+                // NOP
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/wav-writer.h"
+#include "Catch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    uint32_t u32(const std::string& data, size_t offset)
+    {
+        uint32_t result;
+        memcpy(&result, data.data() + offset, 4);
+        return result;
+    }
+
+    uint16_t u16(const std::string& data, size_t offset)
+    {
+        uint16_t result;
+        memcpy(&result, data.data() + offset, 2);
+        return result;
+    }
+
+    std::vector<float> ramp(size_t count)
+    {
+        std::vector<float> samples(count);
+        for (size_t i = 0; i != count; ++i)
+        {
+            samples[i] = float(std::sin(i * 0.01)) * 1.25f;
+        }
+        return samples;
+    }
+
+    int16_t reference_pcm16(float sample)
+    {
+        if (std::isnan(sample))
+        {
+            return -32767;
+        }
+        const double clamped = std::max(-1.0, std::min(1.0, double(sample)));
+        return int16_t(std::nearbyint(float(clamped) * 32767.0f));
+    }
+}
+
+TEST_CASE("convert_to_pcm16, clamping and rounding")
+{
+    const float samples[] = {
+        0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 0.5f, -0.5f, 1.5f / 32767, 2.5f / 32767,
+        -1.5f / 32767, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), 0.25f
+    };
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+    int16_t out[count];
+
+    audio::convert_to_pcm16(samples, out, count);
+
+    for (size_t i = 0; i != count; ++i)
+    {
+        CATCH_INFO("sample " << i);
+        CATCH_CHECK(out[i] == reference_pcm16(samples[i]));
+    }
+    CATCH_CHECK(out[1] == 32767);
+    CATCH_CHECK(out[4] == -32767);
+}
+
+TEST_CASE("convert_to_pcm16, every length")
+{
+    const std::vector<float> samples = ramp(40);
+
+    for (size_t count = 0; count != samples.size(); ++count)
+    {
+        std::vector<int16_t> out(count + 1, 12345);
+        audio::convert_to_pcm16(samples.data(), out.data(), count);
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            CATCH_CHECK(out[i] == reference_pcm16(samples[i]));
+        }
+        CATCH_CHECK(out[count] == 12345);
+    }
+}
+
+TEST_CASE("WavWriter, 16-bit PCM header and data")
+{
+    std::stringstream ss;
+    const std::vector<float> samples = ramp(2 * 1000);
+
+    {
+        audio::WavWriter writer(ss, 22050, 2, audio::SampleFormat::pcm16);
+        writer.write(samples.data(), 300);
+        writer.write(samples.data() + 600, 700);
+        CATCH_CHECK(writer.frames() == 1000);
+    }
+
+    const std::string data = ss.str();
+    CATCH_REQUIRE(data.size() == 44 + 4000);
+    CATCH_CHECK(data.substr(0, 4) == "RIFF");
+    CATCH_CHECK(u32(data, 4) == 36 + 4000);
+    CATCH_CHECK(data.substr(8, 8) == "WAVEfmt ");
+    CATCH_CHECK(u32(data, 16) == 16);
+    CATCH_CHECK(u16(data, 20) == 1);
+    CATCH_CHECK(u16(data, 22) == 2);
+    CATCH_CHECK(u32(data, 24) == 22050);
+    CATCH_CHECK(u32(data, 28) == 22050 * 4);
+    CATCH_CHECK(u16(data, 32) == 4);
+    CATCH_CHECK(u16(data, 34) == 16);
+    CATCH_CHECK(data.substr(36, 4) == "data");
+    CATCH_CHECK(u32(data, 40) == 4000);
+
+    for (size_t i = 0; i != samples.size(); ++i)
+    {
+        CATCH_CHECK(int16_t(u16(data, 44 + 2 * i)) == reference_pcm16(samples[i]));
+    }
+}
+
+TEST_CASE("WavWriter, 32-bit float header and data")
+{
+    std::stringstream ss;
+    const std::vector<float> samples = ramp(777);
+
+    audio::WavWriter writer(ss, 48000, 1, audio::SampleFormat::float32);
+    writer.write(samples.data(), samples.size());
+    writer.close();
+
+    const std::string data = ss.str();
+    CATCH_REQUIRE(data.size() == 58 + 4 * 777);
+    CATCH_CHECK(u32(data, 4) == 50 + 4 * 777);
+    CATCH_CHECK(u32(data, 16) == 18);
+    CATCH_CHECK(u16(data, 20) == 3);
+    CATCH_CHECK(u16(data, 22) == 1);
+    CATCH_CHECK(u32(data, 28) == 48000 * 4);
+    CATCH_CHECK(u16(data, 34) == 32);
+    CATCH_CHECK(u16(data, 36) == 0);
+    CATCH_CHECK(data.substr(38, 4) == "fact");
+    CATCH_CHECK(u32(data, 42) == 4);
+    CATCH_CHECK(u32(data, 46) == 777);
+    CATCH_CHECK(data.substr(50, 4) == "data");
+    CATCH_CHECK(u32(data, 54) == 4 * 777);
+    CATCH_CHECK(memcmp(data.data() + 58, samples.data(), 4 * 777) == 0);
+}
+
+TEST_CASE("WavWriter, more samples than fit in the buffer")
+{
+    // Over 1 MiB of samples in uneven pieces
+    const std::vector<float> samples = ramp(2 * 300007);
+    std::stringstream whole;
+    std::stringstream pieces;
+
+    {
+        audio::WavWriter writer(whole, 44100);
+        writer.write(samples.data(), 300007);
+    }
+    {
+        audio::WavWriter writer(pieces, 44100);
+        for (size_t frame = 0; frame < 300007; frame += 1237)
+        {
+            writer.write(samples.data() + 2 * frame, std::min<size_t>(1237, 300007 - frame));
+        }
+    }
+
+    CATCH_CHECK(whole.str().size() == 44 + 4 * 300007);
+    CATCH_CHECK(whole.str() == pieces.str());
+}
+
+TEST_CASE("WavWriter after other data in the stream")
+{
+    std::stringstream ss;
+    ss << "prefix";
+    const float samples[] = { 0.5f, -0.5f };
+
+    {
+        audio::WavWriter writer(ss, 8000);
+        writer.write(samples, 1);
+    }
+
+    const std::string data = ss.str();
+    CATCH_CHECK(data.size() == 6 + 44 + 4);
+    CATCH_CHECK(data.substr(6, 4) == "RIFF");
+    CATCH_CHECK(u32(data, 6 + 40) == 4);
+}
+
+TEST_CASE("WavWriter, conversion speed", "[.][benchmark]")
+{
+    // A minute of stereo audio at 44.1 kHz
+    const std::vector<float> samples = ramp(2 * 44100 * 60);
+    std::vector<int16_t> out(samples.size());
+
+    BENCHMARK("convert_to_pcm16")
+    {
+        audio::convert_to_pcm16(samples.data(), out.data(), samples.size());
+    }
+
+    BENCHMARK("Scalar conversion")
+    {
+        for (size_t i = 0; i != samples.size(); ++i)
+        {
+            out[i] = reference_pcm16(samples[i]);
+        }
+    }
+
+    BENCHMARK("WavWriter, 16-bit PCM to memory")
+    {
+        std::stringstream ss;
+        audio::WavWriter writer(ss, 44100);
+        for (size_t frame = 0; frame < samples.size() / 2; frame += 256)
+        {
+            writer.write(samples.data() + 2 * frame, std::min<size_t>(256, samples.size() / 2 - frame));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/fft.h"
+#include "Catch.h"
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    std::vector<float> noise(unsigned n)
+    {
+        std::vector<float> samples;
+        uint32_t random = 777;
+
+        for (unsigned i = 0; i != n; ++i)
+        {
+            random = random * 1103515245 + 12345;
+            samples.push_back(float(int(random >> 16) % 2001 - 1000) / 1000);
+        }
+        return samples;
+    }
+
+    // Straight from the definition, in double precision
+    void dft(const std::vector<float>& samples, std::vector<double>& re, std::vector<double>& im)
+    {
+        const size_t n = samples.size();
+        re.assign(n / 2 + 1, 0);
+        im.assign(n / 2 + 1, 0);
+
+        for (size_t k = 0; k <= n / 2; ++k)
+        {
+            for (size_t t = 0; t != n; ++t)
+            {
+                const double angle = -2 * PI * double((k * t) % n) / n;
+                re[k] += samples[t] * std::cos(angle);
+                im[k] += samples[t] * std::sin(angle);
+            }
+        }
+    }
+}
+
+TEST_CASE("RealFft matches a direct DFT")
+{
+    // Sizes that take only radix 4 passes and sizes that need a radix 2 pass
+    for (unsigned size = 4; size <= 4096; size *= 2)
+    {
+        CATCH_INFO("size = " << size);
+
+        const std::vector<float> samples = noise(size);
+        audio::RealFft fft(size);
+        std::vector<float> re(fft.bins()), im(fft.bins());
+        std::vector<double> expected_re, expected_im;
+
+        fft.transform(samples.data(), re.data(), im.data());
+        dft(samples, expected_re, expected_im);
+
+        CATCH_REQUIRE(fft.bins() == size / 2 + 1);
+        // Rounding errors grow with the logarithm of the size; the values themselves with its square root
+        const double margin = 1e-5 * std::sqrt(double(size)) * std::log2(double(size));
+
+        for (unsigned k = 0; k != fft.bins(); ++k)
+        {
+            CATCH_INFO("bin " << k);
+            CATCH_REQUIRE(re[k] == Approx(expected_re[k]).margin(margin));
+            CATCH_REQUIRE(im[k] == Approx(expected_im[k]).margin(margin));
+        }
+    }
+}
+
+TEST_CASE("RealFft, a sine falls in its bin")
+{
+    const unsigned size = 256;
+    audio::RealFft fft(size);
+    std::vector<float> samples(size);
+    std::vector<float> power(fft.bins());
+
+    for (unsigned i = 0; i != size; ++i)
+    {
+        samples[i] = float(std::sin(2 * PI * 10 * i / size));
+    }
+    fft.power(samples.data(), power.data());
+
+    for (unsigned k = 0; k != fft.bins(); ++k)
+    {
+        CATCH_INFO("bin " << k);
+        CATCH_CHECK(power[k] == Approx(k == 10 ? (size / 2.0) * (size / 2.0) : 0).margin(1e-2));
+    }
+}
+
+TEST_CASE("RealFft, reuse gives the same result")
+{
+    audio::RealFft fft(1024);
+    const std::vector<float> a = noise(1024);
+    const std::vector<float> b(1024, 0.5f);
+    std::vector<float> first(fft.bins()), other(fft.bins()), again(fft.bins());
+
+    fft.power(a.data(), first.data());
+    fft.power(b.data(), other.data());
+    fft.power(a.data(), again.data());
+
+    CATCH_CHECK(first == again);
+    CATCH_CHECK(other[0] == Approx(512.0 * 512.0));
+}
+
+TEST_CASE("RealFft versus direct DFT", "[.][benchmark]")
+{
+    const std::vector<float> samples = noise(2048);
+    audio::RealFft fft(2048);
+    std::vector<float> power(fft.bins());
+    std::vector<double> re, im;
+
+    BENCHMARK("Direct DFT, 2048 samples")
+    {
+        dft(samples, re, im);
+    }
+
+    BENCHMARK("RealFft, 2048 samples, 1000 times")
+    {
+        for (int i = 0; i != 1000; ++i)
+        {
+            fft.power(samples.data(), power.data());
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "audio/synth-stream.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <vector>
+
+using namespace testutils;
+
+
+namespace
+{
+    // One note from tick 0 to 96
+    audio::Score one_note()
+    {
+        return make_score({ 0, NOTE_ON(0, 60, 100), 96, NOTE_OFF(0, 60, 0) });
+    }
+}
+
+TEST_CASE("SynthStream reads what the Synth renders, in spans of any length")
+{
+    const audio::Score score = one_note();
+
+    audio::Synth synth(score, 8000, 64);
+    std::vector<float> expected;
+    std::vector<float> block(2 * synth.block_size());
+    while (unsigned n = synth.render(block.data()))
+    {
+        expected.insert(expected.end(), block.begin(), block.begin() + 2 * n);
+    }
+
+    audio::Synth streamed(score, 8000, 64);
+    audio::SynthStream stream(streamed);
+    std::vector<float> result;
+    size_t span = 1;
+    while (result.size() < expected.size() + 1000)
+    {
+        const float* samples = stream.read(span);
+        result.insert(result.end(), samples, samples + 2 * span);
+        span = span * 7 % 311;
+    }
+
+    CATCH_CHECK(stream.position() == result.size() / 2);
+    CATCH_REQUIRE(result.size() > expected.size());
+    CATCH_CHECK(std::vector<float>(result.begin(), result.begin() + expected.size()) == expected);
+
+    // Past the end of the rendering is silence
+    for (size_t i = expected.size(); i != result.size(); ++i)
+    {
+        CATCH_REQUIRE(result[i] == 0);
+    }
+}
+
+#endif
@@ -3,9 +3,12 @@
 #define CATCH_CONFIG_PREFIX_ALL
 
 #include "Catch.h"
+#include "audio/score.h"
 #include "midi/midi.h"
 #include <cstdint>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <list>
 
@@ -37,6 +40,31 @@
 
 namespace testutils
 {
+    // Single track file, 96 ticks per quarter at the default tempo: a tick is 1/192 s.
+    // Delta times of 128 and up take two bytes, e.g. 192 is 0x81 0x40
+    inline audio::Score make_score(const std::vector<char>& track)
+    {
+        const char header[] = {
+            MTHD,
+            0x00, 0x00, 0x00, 0x06, // MThd size
+            0x00, 0x00, // Type
+            0x00, 0x01, // Number of tracks
+            0x00, 0x60, // Division
+            MTRK
+        };
+        const char end_of_track[] = { END_OF_TRACK };
+        const uint32_t size = uint32_t(track.size() + sizeof(end_of_track));
+        const char track_size[] = { char(size >> 24), char(size >> 16), char(size >> 8), char(size) };
+
+        std::string data(header, sizeof(header));
+        data.append(track_size, sizeof(track_size));
+        data.append(track.begin(), track.end());
+        data.append(end_of_track, sizeof(end_of_track));
+
+        std::stringstream ss(data);
+        return audio::Score(ss);
+    }
+
     struct Event
     {
         midi::Duration dt;
@@ -0,0 +1,223 @@
+#include "util/buffer-pool.h"
+#include "logging.h"
+#include <assert.h>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+namespace
+{
+    const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    size_t round_up(size_t size, size_t multiple)
+    {
+        return (size + multiple - 1) / multiple * multiple;
+    }
+
+    uint8_t* allocate_aligned(size_t size, size_t alignment)
+    {
+#if defined(_WIN32)
+        return static_cast<uint8_t*>(_aligned_malloc(size, alignment));
+#else
+        void* data = nullptr;
+        return posix_memalign(&data, alignment, size) == 0 ? static_cast<uint8_t*>(data) : nullptr;
+#endif
+    }
+
+    void free_aligned(uint8_t* data)
+    {
+#if defined(_WIN32)
+        _aligned_free(data);
+#else
+        free(data);
+#endif
+    }
+
+    // Explicit huge pages; these need to be reserved (Linux) or require a privilege (Windows),
+    // so failure is normal
+    uint8_t* map_huge_pages(size_t size)
+    {
+#if defined(_WIN32)
+        const size_t page = GetLargePageMinimum();
+        if (page == 0 || size % page != 0)
+        {
+            return nullptr;
+        }
+        return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+#elif defined(MAP_HUGETLB)
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return data == MAP_FAILED ? nullptr : static_cast<uint8_t*>(data);
+#else
+        return nullptr;
+#endif
+    }
+
+    void unmap_huge_pages(uint8_t* data, size_t size)
+    {
+#if defined(_WIN32)
+        VirtualFree(data, 0, MEM_RELEASE);
+#else
+        munmap(data, size);
+#endif
+    }
+}
+
+BufferPool::Buffer::Buffer(Buffer&& other)
+    : m_pool(other.m_pool), m_data(other.m_data), m_capacity(other.m_capacity), m_size(other.m_size)
+{
+    other.m_pool = nullptr;
+    other.m_data = nullptr;
+    other.m_capacity = 0;
+    other.m_size = 0;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator =(Buffer&& other)
+{
+    if (this != &other)
+    {
+        release();
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_data, other.m_data);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+    }
+
+    return *this;
+}
+
+void BufferPool::Buffer::resize(size_t size)
+{
+    assert(size <= m_capacity);
+
+    m_size = size;
+}
+
+void BufferPool::Buffer::release()
+{
+    if (m_data != nullptr)
+    {
+        m_pool->give_back(m_data);
+        m_pool = nullptr;
+        m_data = nullptr;
+        m_capacity = 0;
+        m_size = 0;
+    }
+}
+
+BufferPool::BufferPool(size_t alignment, bool huge_pages)
+    : m_alignment(alignment), m_huge_pages(huge_pages)
+{
+    CHECK(alignment != 0 && (alignment & (alignment - 1)) == 0) << "Alignment must be a power of two";
+}
+
+BufferPool::~BufferPool()
+{
+    assert(m_free.size() == m_blocks.size());
+
+    for (const BLOCK& block : m_blocks)
+    {
+        if (block.mapped)
+        {
+            unmap_huge_pages(block.data, block.capacity);
+        }
+        else
+        {
+            free_aligned(block.data);
+        }
+    }
+}
+
+BufferPool::Buffer BufferPool::borrow(size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Best fit, so that small requests do not take up large blocks
+    size_t best = m_free.size();
+    for (size_t i = 0; i != m_free.size(); ++i)
+    {
+        const BLOCK& block = m_blocks[m_free[i]];
+
+        if (block.capacity >= size && (best == m_free.size() || block.capacity < m_blocks[m_free[best]].capacity))
+        {
+            best = i;
+        }
+    }
+
+    if (best != m_free.size())
+    {
+        const BLOCK& block = m_blocks[m_free[best]];
+        m_free[best] = m_free.back();
+        m_free.pop_back();
+
+        return Buffer(this, block.data, block.capacity);
+    }
+
+    BLOCK block{ nullptr, round_up(size == 0 ? 1 : size, m_alignment), false };
+
+    if (m_huge_pages)
+    {
+        block.capacity = round_up(block.capacity, HUGE_PAGE_SIZE);
+        block.data = map_huge_pages(block.capacity);
+        block.mapped = block.data != nullptr;
+    }
+    if (block.data == nullptr)
+    {
+        block.data = allocate_aligned(block.capacity, m_huge_pages ? HUGE_PAGE_SIZE : m_alignment);
+        CHECK(block.data != nullptr) << "Could not allocate " << block.capacity << " bytes";
+#if defined(MADV_HUGEPAGE)
+        if (m_huge_pages)
+        {
+            // Transparent huge pages, if enabled
+            madvise(block.data, block.capacity, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    m_blocks.push_back(block);
+    m_free.reserve(m_blocks.size());
+
+    return Buffer(this, block.data, block.capacity);
+}
+
+void BufferPool::give_back(uint8_t* data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i != m_blocks.size(); ++i)
+    {
+        if (m_blocks[i].data == data)
+        {
+            m_free.push_back(i);
+            return;
+        }
+    }
+
+    assert(false);
+}
+
+size_t BufferPool::blocks() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_blocks.size();
+}
+
+size_t BufferPool::available() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_free.size();
+}
+
+BufferPool& BufferPool::shared()
+{
+    static BufferPool pool;
+
+    return pool;
+}
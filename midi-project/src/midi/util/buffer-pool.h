@@ -0,0 +1,98 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+
+// Hands out blocks of memory and takes them back for reuse. Once every
+// size a program asks for has been seen, borrowing no longer allocates,
+// which keeps the heap out of per-frame work.
+// Blocks are aligned to alignment bytes; with huge_pages, the pool asks the OS
+// for huge pages and falls back to ordinary pages if it gets none.
+// Borrowing and returning are thread-safe.
+class BufferPool
+{
+public:
+    // Move-only handle to a borrowed block; returns it to the pool when destroyed.
+    class Buffer
+    {
+    public:
+        Buffer() : m_pool(nullptr), m_data(nullptr), m_capacity(0), m_size(0) { }
+        Buffer(Buffer&& other);
+        Buffer& operator =(Buffer&& other);
+        ~Buffer() { release(); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator =(const Buffer&) = delete;
+
+        uint8_t* data() { return m_data; }
+        const uint8_t* data() const { return m_data; }
+
+        template<typename T>
+        T* as() { return reinterpret_cast<T*>(m_data); }
+
+        size_t capacity() const { return m_capacity; }
+
+        // Number of bytes in use; up to the user of the buffer
+        size_t size() const { return m_size; }
+        void resize(size_t size);
+
+        explicit operator bool() const { return m_data != nullptr; }
+
+        // Returns the block to the pool early
+        void release();
+
+    private:
+        friend class BufferPool;
+
+        Buffer(BufferPool* pool, uint8_t* data, size_t capacity)
+            : m_pool(pool), m_data(data), m_capacity(capacity), m_size(0) { }
+
+        BufferPool* m_pool;
+        uint8_t* m_data;
+        size_t m_capacity;
+        size_t m_size;
+    };
+
+    explicit BufferPool(size_t alignment = 64, bool huge_pages = false);
+
+    // All borrowed buffers must have been returned
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator =(const BufferPool&) = delete;
+
+    // Returns the smallest free block of at least size bytes, or a new one
+    Buffer borrow(size_t size);
+
+    // Number of blocks allocated so far
+    size_t blocks() const;
+
+    // Number of blocks waiting to be borrowed
+    size_t available() const;
+
+    // Pool for short-lived scratch memory, e.g. the scanlines of the encoders
+    static BufferPool& shared();
+
+private:
+    struct BLOCK
+    {
+        uint8_t* data;
+        size_t capacity;
+        bool mapped;
+    };
+
+    void give_back(uint8_t* data);
+
+    size_t m_alignment;
+    bool m_huge_pages;
+    mutable std::mutex m_mutex;
+    std::vector<BLOCK> m_blocks;
+    // Indices into m_blocks; has room for every block so that returning never allocates
+    std::vector<size_t> m_free;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "util/position.h"
 #include <memory>
 #include <functional>
+#include <algorithm>
 #include <assert.h>
 
 
@@ -24,6 +25,28 @@ public:
         return p.x < width() && p.y < height();
     }
 
+    // Copies count elements of row p.y, starting at column p.x, to out.
+    // Grids that store rows contiguously override this with a plain copy.
+    virtual void read_row(const Position& p, unsigned count, T* out) const
+    {
+        for (unsigned i = 0; i != count; ++i)
+        {
+            out[i] = (*this)[Position(p.x + i, p.y)];
+        }
+    }
+
+    // Sets every element to value
+    virtual void fill(const T& value)
+    {
+        for (unsigned y = 0; y != height(); ++y)
+        {
+            for (unsigned x = 0; x != width(); ++x)
+            {
+                (*this)[Position(x, y)] = value;
+            }
+        }
+    }
+
     void for_each_position(std::function<void(const Position&)> function) const
     {
         for (unsigned y = 0; y != height(); ++y)
@@ -61,7 +84,7 @@ public:
     }
 
     ConcreteGrid(unsigned width, unsigned height)
-        : m_elts(std::make_unique<T[]>(width * height)), m_width(width), m_height(height)
+        : m_elts(std::make_unique<T[]>(size_t(width) * height)), m_width(width), m_height(height)
     {
         // NOP
     }
@@ -76,14 +99,27 @@ public:
     {
         assert(this->is_inside(p));
 
-        return m_elts[p.x + p.y * m_width];
+        return m_elts[p.x + size_t(p.y) * m_width];
     }
 
     const T& operator [](const Position& p) const override
     {
         assert(this->is_inside(p));
 
-        return m_elts[p.x + p.y * m_width];
+        return m_elts[p.x + size_t(p.y) * m_width];
+    }
+
+    void read_row(const Position& p, unsigned count, T* out) const override
+    {
+        assert(count == 0 || this->is_inside(Position(p.x + count - 1, p.y)));
+
+        const T* row = &m_elts[p.x + size_t(p.y) * m_width];
+        std::copy(row, row + count, out);
+    }
+
+    void fill(const T& value) override
+    {
+        std::fill(m_elts.get(), m_elts.get() + size_t(m_width) * m_height, value);
     }
 
     unsigned width() const override
@@ -102,6 +138,58 @@ private:
     unsigned m_height;
 };
 
+// Grid over memory owned by someone else, e.g. a buffer borrowed from a BufferPool,
+// which must outlive the grid. Rows are stored one after the other.
+template<typename T>
+class BufferGrid : public Grid<T>
+{
+public:
+    BufferGrid(T* elements, unsigned width, unsigned height)
+        : m_elts(elements), m_width(width), m_height(height) { }
+
+    T& operator [](const Position& p) override
+    {
+        assert(this->is_inside(p));
+
+        return m_elts[p.x + size_t(p.y) * m_width];
+    }
+
+    const T& operator [](const Position& p) const override
+    {
+        assert(this->is_inside(p));
+
+        return m_elts[p.x + size_t(p.y) * m_width];
+    }
+
+    void read_row(const Position& p, unsigned count, T* out) const override
+    {
+        assert(count == 0 || this->is_inside(Position(p.x + count - 1, p.y)));
+
+        const T* row = &m_elts[p.x + size_t(p.y) * m_width];
+        std::copy(row, row + count, out);
+    }
+
+    void fill(const T& value) override
+    {
+        std::fill(m_elts, m_elts + size_t(m_width) * m_height, value);
+    }
+
+    unsigned width() const override
+    {
+        return m_width;
+    }
+
+    unsigned height() const override
+    {
+        return m_height;
+    }
+
+private:
+    T* m_elts;
+    unsigned m_width;
+    unsigned m_height;
+};
+
 template<typename T>
 class SubGrid : public Grid<T>
 {
@@ -119,6 +207,11 @@ public:
         return (*m_parent)[m_position + p];
     }
 
+    void read_row(const Position& p, unsigned count, T* out) const override
+    {
+        m_parent->read_row(m_position + p, count, out);
+    }
+
     unsigned width() const override
     {
         return m_width;
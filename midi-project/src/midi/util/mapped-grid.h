@@ -0,0 +1,122 @@
+#ifndef MAPPED_GRID_H
+#define MAPPED_GRID_H
+
+#include "util/grid.h"
+#include "util/tiled-grid.h"
+#include "io/mapped-file.h"
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <type_traits>
+#include <assert.h>
+
+
+// Grid whose tiles live in a memory-mapped scratch file instead of on the heap,
+// so that grids larger than physical memory can be used: the OS pages tiles in
+// and out as needed. All offsets are computed in 64 bits.
+// Like TiledGrid, a tile reads as the background value until it is first
+// accessed through the non-const operator[].
+template<typename T>
+class MappedGrid : public Grid<T>
+{
+    static_assert(std::is_trivially_copyable<T>::value, "MappedGrid elements are stored as raw bytes");
+
+public:
+    // tile_size must be a power of two. The scratch file is created at path and removed afterwards.
+    MappedGrid(const std::string& path, unsigned width, unsigned height, T background = T(), unsigned tile_size = 64)
+        : m_width(width), m_height(height), m_background(background), m_tile_size(tile_size), m_tile_shift(0),
+          m_tiles_across((width + tile_size - 1) / tile_size),
+          m_written(size_t(m_tiles_across) * ((height + tile_size - 1) / tile_size), false),
+          m_file(path, uint64_t(m_written.size()) * tile_size * tile_size * sizeof(T))
+    {
+        assert(tile_size != 0 && (tile_size & (tile_size - 1)) == 0);
+
+        while ((1u << m_tile_shift) != tile_size)
+        {
+            ++m_tile_shift;
+        }
+    }
+
+    T& operator [](const Position& p) override
+    {
+        assert(this->is_inside(p));
+
+        const uint64_t tile = tile_index(p);
+        T* elements = tile_elements(tile);
+
+        if (!m_written[size_t(tile)])
+        {
+            for (uint64_t i = 0; i != uint64_t(m_tile_size) * m_tile_size; ++i)
+            {
+                elements[i] = m_background;
+            }
+            m_written[size_t(tile)] = true;
+        }
+
+        return elements[offset_in_tile(p)];
+    }
+
+    const T& operator [](const Position& p) const override
+    {
+        assert(this->is_inside(p));
+
+        const uint64_t tile = tile_index(p);
+
+        return m_written[size_t(tile)] ? tile_elements(tile)[offset_in_tile(p)] : m_background;
+    }
+
+    unsigned width() const override
+    {
+        return m_width;
+    }
+
+    unsigned height() const override
+    {
+        return m_height;
+    }
+
+    void read_row(const Position& p, unsigned count, T* out) const override
+    {
+        read_tiled_row(p, count, out, m_tile_size, m_background, [this](const Position& position) -> const T*
+        {
+            const uint64_t tile = tile_index(position);
+
+            return m_written[size_t(tile)] ? tile_elements(tile) + offset_in_tile(position) : nullptr;
+        });
+    }
+
+    // Size of the scratch file in bytes; only written tiles occupy disk space
+    uint64_t reserved_size() const
+    {
+        return m_file.size();
+    }
+
+private:
+    uint64_t tile_index(const Position& p) const
+    {
+        return uint64_t(p.y >> m_tile_shift) * m_tiles_across + (p.x >> m_tile_shift);
+    }
+
+    uint64_t offset_in_tile(const Position& p) const
+    {
+        return uint64_t(p.y & (m_tile_size - 1)) * m_tile_size + (p.x & (m_tile_size - 1));
+    }
+
+    // Tiles are stored contiguously, so each one is a few consecutive pages of the file
+    T* tile_elements(uint64_t tile) const
+    {
+        return reinterpret_cast<T*>(m_file.data()) + tile * m_tile_size * m_tile_size;
+    }
+
+    unsigned m_width;
+    unsigned m_height;
+    T m_background;
+    unsigned m_tile_size;
+    unsigned m_tile_shift;
+    unsigned m_tiles_across;
+    std::vector<bool> m_written;
+    io::MappedScratchFile m_file;
+};
+
+#endif
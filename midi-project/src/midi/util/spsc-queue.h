@@ -0,0 +1,164 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "logging.h"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Fixed-size ring buffer between exactly one producer thread and one consumer
+// thread. Neither side ever blocks or retries: a push into a full queue and a pop
+// from an empty one return straight away, so every call is wait-free.
+// Items must be default constructible and movable; move-only items such as
+// BufferPool::Buffer can be passed through with the single item calls.
+//
+// The producer owns m_tail and the consumer m_head. Each side keeps its own copy
+// of the other side's index and only reloads it when the copy says the queue is
+// full or empty, so in the common case a call touches no cache line the other
+// thread writes to. Each side's index and copy share a cache line of their own.
+template<typename T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+        : m_mask(0), m_head(0), m_cached_tail(0), m_tail(0), m_cached_head(0)
+    {
+        CHECK(capacity > 0) << "Queue capacity must be positive";
+
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator =(const SpscQueue&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Only a snapshot when the other thread is running
+    size_t size() const
+    {
+        // The head is loaded first: the tail never falls behind it, while a head loaded
+        // after the tail may have moved past it, making the difference wrap around
+        const size_t head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    // Producer only. Returns false if the queue is full, in which case item is left alone
+    bool try_push(T&& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_cached_head == capacity())
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == capacity())
+            {
+                return false;
+            }
+        }
+
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& item)
+    {
+        T copy(item);
+        return try_push(std::move(copy));
+    }
+
+    // Producer only. Copies as many of the count items as fit and publishes them
+    // all at once; returns how many that was
+    size_t push(const T* items, size_t count)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t free = capacity() - (tail - m_cached_head);
+
+        if (free < count)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            free = capacity() - (tail - m_cached_head);
+        }
+
+        const size_t n = count < free ? count : free;
+        for (size_t i = 0; i != n; ++i)
+        {
+            m_slots[(tail + i) & m_mask] = items[i];
+        }
+
+        if (n != 0)
+        {
+            m_tail.store(tail + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Consumer only. Returns false if the queue is empty
+    bool try_pop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_cached_tail)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+            {
+                return false;
+            }
+        }
+
+        item = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves up to count items into out and frees their slots
+    // all at once; returns how many there were
+    size_t pop(T* out, size_t count)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t available = m_cached_tail - head;
+
+        if (available < count)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            available = m_cached_tail - head;
+        }
+
+        const size_t n = count < available ? count : available;
+        for (size_t i = 0; i != n; ++i)
+        {
+            out[i] = std::move(m_slots[(head + i) & m_mask]);
+        }
+
+        if (n != 0)
+        {
+            m_head.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+private:
+    // Read by both sides, written by neither after construction
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    // Consumer's line: its index and its copy of the producer's
+    alignas(64) std::atomic<size_t> m_head;
+    size_t m_cached_tail;
+
+    // Producer's line; the alignment also pads the end of the queue out to a whole line
+    alignas(64) std::atomic<size_t> m_tail;
+    size_t m_cached_head;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef TILED_GRID_H
+#define TILED_GRID_H
+
+#include "util/grid.h"
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <assert.h>
+
+
+// read_row for grids made of square tiles of tile_size elements across, tile_size being a power of two.
+// tile_row(position) returns the elements of the tile from position to the end of its row,
+// or nullptr if the tile was never written, in which case they read as background.
+template<typename T, typename TILE_ROW>
+void read_tiled_row(const Position& p, unsigned count, T* out, unsigned tile_size, const T& background, TILE_ROW tile_row)
+{
+    // One tile at a time
+    for (unsigned done = 0; done != count; )
+    {
+        Position position(p.x + done, p.y);
+        unsigned to_tile_edge = tile_size - (position.x & (tile_size - 1));
+        unsigned chunk = to_tile_edge < count - done ? to_tile_edge : count - done;
+        const T* row = tile_row(position);
+
+        if (row != nullptr)
+        {
+            std::copy(row, row + chunk, out + done);
+        }
+        else
+        {
+            std::fill(out + done, out + done + chunk, background);
+        }
+        done += chunk;
+    }
+}
+
+// Grid that is divided in square tiles of tile_size x tile_size elements.
+// A tile is only allocated when one of its elements is accessed through the
+// non-const operator[]; until then, all its elements read as the background value.
+// Memory use is proportional to the area that has actually been written to.
+template<typename T>
+class TiledGrid : public Grid<T>
+{
+public:
+    // tile_size must be a power of two
+    TiledGrid(unsigned width, unsigned height, T background = T(), unsigned tile_size = 64)
+        : m_width(width), m_height(height), m_background(background), m_tile_size(tile_size), m_tile_shift(0)
+    {
+        assert(tile_size != 0 && (tile_size & (tile_size - 1)) == 0);
+
+        while ((1u << m_tile_shift) != tile_size)
+        {
+            ++m_tile_shift;
+        }
+
+        m_tiles_across = (width + tile_size - 1) >> m_tile_shift;
+        m_tiles.resize(size_t(m_tiles_across) * ((height + tile_size - 1) >> m_tile_shift));
+    }
+
+    T& operator [](const Position& p) override
+    {
+        assert(this->is_inside(p));
+
+        std::unique_ptr<T[]>& tile = m_tiles[tile_index(p)];
+
+        if (!tile)
+        {
+            tile = std::make_unique<T[]>(size_t(m_tile_size) * m_tile_size);
+
+            for (size_t i = 0; i != size_t(m_tile_size) * m_tile_size; ++i)
+            {
+                tile[i] = m_background;
+            }
+        }
+
+        return tile[offset_in_tile(p)];
+    }
+
+    const T& operator [](const Position& p) const override
+    {
+        assert(this->is_inside(p));
+
+        const std::unique_ptr<T[]>& tile = m_tiles[tile_index(p)];
+
+        return tile ? tile[offset_in_tile(p)] : m_background;
+    }
+
+    unsigned width() const override
+    {
+        return m_width;
+    }
+
+    unsigned height() const override
+    {
+        return m_height;
+    }
+
+    void read_row(const Position& p, unsigned count, T* out) const override
+    {
+        read_tiled_row(p, count, out, m_tile_size, m_background, [this](const Position& position) -> const T*
+        {
+            const std::unique_ptr<T[]>& tile = m_tiles[tile_index(position)];
+
+            return tile ? tile.get() + offset_in_tile(position) : nullptr;
+        });
+    }
+
+    unsigned tile_size() const
+    {
+        return m_tile_size;
+    }
+
+    size_t allocated_tiles() const
+    {
+        size_t result = 0;
+
+        for (const std::unique_ptr<T[]>& tile : m_tiles)
+        {
+            if (tile)
+            {
+                ++result;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    size_t tile_index(const Position& p) const
+    {
+        return size_t(p.y >> m_tile_shift) * m_tiles_across + (p.x >> m_tile_shift);
+    }
+
+    size_t offset_in_tile(const Position& p) const
+    {
+        return size_t(p.y & (m_tile_size - 1)) * m_tile_size + (p.x & (m_tile_size - 1));
+    }
+
+    unsigned m_width;
+    unsigned m_height;
+    T m_background;
+    unsigned m_tile_size;
+    unsigned m_tile_shift;
+    unsigned m_tiles_across;
+    std::vector<std::unique_ptr<T[]>> m_tiles;
+};
+
+#endif
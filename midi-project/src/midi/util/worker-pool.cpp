@@ -0,0 +1,92 @@
+#include "util/worker-pool.h"
+#include "logging.h"
+
+
+WorkerPool::WorkerPool(unsigned threads)
+    : m_trampoline(nullptr), m_task(nullptr), m_count(0), m_next(0), m_busy(0), m_batch(0), m_stopping(false)
+{
+    CHECK(threads > 0) << "Need at least one thread";
+
+    for (unsigned i = 1; i < threads; ++i)
+    {
+        m_workers.emplace_back([this]() { work(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_start.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(unsigned count, Trampoline trampoline, void* task)
+{
+    if (m_workers.empty() || count <= 1)
+    {
+        for (unsigned i = 0; i != count; ++i)
+        {
+            trampoline(task, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_trampoline = trampoline;
+        m_task = task;
+        m_count = count;
+        m_next = 0;
+        m_busy = unsigned(m_workers.size());
+        ++m_batch;
+    }
+    m_start.notify_all();
+
+    take_tasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+}
+
+void WorkerPool::work()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_start.wait(lock, [this, seen]() { return m_batch != seen || m_stopping; });
+
+        if (m_stopping)
+        {
+            return;
+        }
+
+        seen = m_batch;
+        lock.unlock();
+        take_tasks();
+        lock.lock();
+
+        if (--m_busy == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::take_tasks()
+{
+    unsigned index;
+
+    while ((index = m_next++) < m_count)
+    {
+        m_trampoline(m_task, index);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Runs batches of independent tasks on a fixed set of threads.
+// run(count, task) calls task(i) for every i below count, spread over the
+// worker threads and the calling thread, and returns once all have finished.
+// Which thread runs which task is not fixed, so tasks must not depend on it.
+class WorkerPool
+{
+public:
+    // threads includes the calling thread; 1 runs everything on the caller
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator =(const WorkerPool&) = delete;
+
+    unsigned threads() const { return unsigned(m_workers.size()) + 1; }
+
+    // Does not allocate; task is called as task(unsigned)
+    template<typename F>
+    void run(unsigned count, F& task)
+    {
+        run(count, &call<F>, &task);
+    }
+
+private:
+    typedef void (*Trampoline)(void* task, unsigned index);
+
+    template<typename F>
+    static void call(void* task, unsigned index)
+    {
+        (*static_cast<F*>(task))(index);
+    }
+
+    void run(unsigned count, Trampoline trampoline, void* task);
+    void work();
+    void take_tasks();
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    Trampoline m_trampoline;
+    void* m_task;
+    unsigned m_count;
+    std::atomic<unsigned> m_next;
+    // Workers that have not finished the current batch yet
+    unsigned m_busy;
+    uint64_t m_batch;
+    bool m_stopping;
+    std::vector<std::thread> m_workers;
+};
+
+#endif